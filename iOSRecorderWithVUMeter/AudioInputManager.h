@@ -26,11 +26,14 @@
 #import <Foundation/Foundation.h>
 #import <AVFoundation/AVFoundation.h>
 #import <AudioToolbox/AudioToolbox.h>
+#import "CaptureFanOut.h"
+#include "callbackTrace.h"
 
 @protocol AudioInputManagerDelegate <NSObject>
 
 @optional
 -(void) audioInputClosed;
+// size is in samples, with the channels interleaved.
 -(void) inputDataArrivedWithData:(SInt16*)data size:(UInt32)size;
 @end
 
@@ -54,6 +57,17 @@ enum _stateAIM {
 
 @property AudioUnit       mAudioUnit;
 
+// If set, the captured samples are written to it on the audio thread
+// instead of being passed to inputDataArrivedWithData:size: on the main
+// thread. Set before open.
+@property (nonatomic,strong) CaptureFanOut*
+                          mFanOut;
+
+// If set, each callback writing to mFanOut is traced on the audio thread
+// with its time stamp, just before its samples are written. Set before
+// open.
+@property CALLBACK_TRACE* mCallbackTrace;
+
 -(id)   initWithDelegate : (id<AudioInputManagerDelegate>)delegate;
 
 -(void) terminate;
@@ -74,11 +88,22 @@ enum _stateAIM {
 
 -(NSArray*) getAvailableDataSources;
 
--(void) calsRMS : (float*)  rms
+// Returns the number of the clipped samples, at full scale.
+-(int)  calsRMS : (float*)  rms
       andAbsMax : (float*)  max
        fromData : (SInt16*) data
         andSize : (UInt32)  size;
 
+// Per channel of the interleaved data. rms, max and clipped have numChan
+// elements, and clipped has the number of the clipped samples of each.
+// Returns the number of the clipped samples of all the channels.
+-(int)  calsRMS : (float*)  rms
+      andAbsMax : (float*)  max
+     andClipped : (int*)    clipped
+       fromData : (SInt16*) data
+      numFrames : (UInt32)  numFrames
+    numChannels : (UInt32)  numChan;
+
 @end
 
 #endif /* _AUDIO_INPUT_MANAGER_H_ */
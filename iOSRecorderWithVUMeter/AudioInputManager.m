@@ -25,16 +25,16 @@
 #import <Foundation/Foundation.h>
 #import <AVFoundation/AVFoundation.h>
 #import <AudioToolbox/AudioToolbox.h>
-#import <Accelerate/Accelerate.h>
 
 #include <libkern/OSAtomic.h>
 
 static const UInt32       kOutputBus = 0;
 static const UInt32       kInputBus  = 1;
 
-#define AUDIO_CB_BUF_IN_SAMPLES 1024
+#define AUDIO_RENDER_BUF_IN_SAMPLES 8192
 
 #import "AudioInputManager.h"
+#include "sampleMinMax.h"
 
 
 @implementation AudioInputManager {
@@ -56,10 +56,9 @@ static const UInt32       kInputBus  = 1;
     double             mPreferredSampleRateByAudioSession;
     long               mNumInputComponents;
     AudioComponent*    mInputComponents;
-    
-    // Float buffer to calculate some values out of
-    // audio chunks given by the AudioUnit's callback.
-    float              mFloatBuffer[ AUDIO_CB_BUF_IN_SAMPLES ];
+
+    // Rendered into on the audio thread, and copied to mFanOut.
+    SInt16             mRenderBuffer[ AUDIO_RENDER_BUF_IN_SAMPLES ];
 
 }
 
@@ -68,6 +67,8 @@ static const UInt32       kInputBus  = 1;
 @synthesize mState;
 @synthesize mNumberOfChannels;
 @synthesize mAudioUnit;
+@synthesize mFanOut;
+@synthesize mCallbackTrace;
 
 static OSStatus renderCallbackOnAudioThread(
     void*                       inRefCon,
@@ -737,20 +738,18 @@ static OSStatus renderCallbackOnAudioThread(
 }
 
 
--(void)onArrivalOfInputAudioWithNumberOfFrames: (UInt32 ) inNumberFrames
-                                          data: (SInt16*) frameBuf
+-(void)onArrivalOfInputAudioWithNumberOfSamples: (UInt32 ) numSamples
+                                           data: (SInt16*) frameBuf
 {
-    if ( mDelegate != nil ) {
-        
-        if( [ mDelegate respondsToSelector :
-             @selector( inputDataArrivedWithData:size: ) ] ) {
-            
-            // Do your light-weight stuff here. Do not block.
-            // Do not wait for any condition that depends on anything
-            // that can run on the main thread.
-            [ mDelegate inputDataArrivedWithData : frameBuf
-                                            size : inNumberFrames ];
-        }
+    if (    mDelegate != nil
+         && [ mDelegate respondsToSelector :
+                  @selector( inputDataArrivedWithData:size: ) ] ) {
+
+        // Do your light-weight stuff here. Do not block.
+        // Do not wait for any condition that depends on anything
+        // that can run on the main thread.
+        [ mDelegate inputDataArrivedWithData : frameBuf
+                                        size : numSamples ];
     }
     else {
         free( frameBuf );
@@ -838,10 +837,72 @@ static OSStatus renderCallbackOnAudioThread(
 
     atomic_thread_fence(memory_order_acquire);
 
-    if ( SELF.mState == DEVICE_OPENED ) {
+    CaptureFanOut* fanOut = SELF.mFanOut;
+
+    if ( SELF.mState == DEVICE_OPENED && fanOut != nil ) {
+
+        // Straight to the readers of the fan-out, without going through
+        // the main thread. Allocates only for an unusually long slice.
+        // The channels are interleaved in one buffer.
+        AudioBufferList bufferList;
+        UInt32          numChan    = (UInt32)[SELF mNumberOfChannels];
+        UInt32          numSamples = inNumberFrames * numChan;
+        SInt16*         frameBuf   = SELF->mRenderBuffer;
+
+        if ( numSamples > AUDIO_RENDER_BUF_IN_SAMPLES ) {
+
+            frameBuf = (SInt16*) malloc ( sizeof(SInt16) * numSamples );
+
+            if ( frameBuf == NULL ) {
+                return kAudio_MemFullError;
+            }
+        }
+
+        bufferList.mNumberBuffers              = 1;
+        bufferList.mBuffers[0].mNumberChannels = numChan;
+        bufferList.mBuffers[0].mDataByteSize   = numSamples * sizeof(SInt16);
+        bufferList.mBuffers[0].mData           = frameBuf;
+
+        OSStatus status = AudioUnitRender( [ SELF mAudioUnit ],
+                                           ioActionFlags,
+                                           inTimeStamp,
+                                           1,
+                                           inNumberFrames,
+                                           &bufferList          );
+        if ( status == 0 ) {
+
+            CALLBACK_TRACE* trace = SELF.mCallbackTrace;
+            UInt32          valid = kAudioTimeStampSampleHostTimeValid;
+
+            // Before the samples, so that a reader of the samples finds
+            // the callback of each of them traced already.
+            if ( trace != NULL && ( inTimeStamp->mFlags & valid ) == valid ) {
+
+                CALLBACK_EVENT event;
+
+                event.sampleTime   = inTimeStamp->mSampleTime;
+                event.hostTime     = inTimeStamp->mHostTime;
+                event.streamSample = [ fanOut written ];
+                event.numFrames    = (int32_t) inNumberFrames;
+
+                traceCallback( trace, &event );
+            }
+
+            [ fanOut write : frameBuf length : (int) numSamples ];
+        }
+
+        if ( frameBuf != SELF->mRenderBuffer ) {
+            free( frameBuf );
+        }
+
+        return status;
+    }
+    else if ( SELF.mState == DEVICE_OPENED ) {
 
         AudioBufferList bufferList;
-        SInt16* frameBuf = (SInt16*) malloc ( sizeof(SInt16) * inNumberFrames );
+        UInt32  numChan    = (UInt32)[SELF mNumberOfChannels];
+        UInt32  numSamples = inNumberFrames * numChan;
+        SInt16* frameBuf   = (SInt16*) malloc ( sizeof(SInt16) * numSamples );
     
         if ( frameBuf == NULL ) {
         
@@ -849,9 +910,8 @@ static OSStatus renderCallbackOnAudioThread(
         }
 
         bufferList.mNumberBuffers              = 1;
-        bufferList.mBuffers[0].mNumberChannels =
-                                        (UInt32)[SELF mNumberOfChannels];
-        bufferList.mBuffers[0].mDataByteSize   = inNumberFrames * sizeof(SInt16);
+        bufferList.mBuffers[0].mNumberChannels = numChan;
+        bufferList.mBuffers[0].mDataByteSize   = numSamples * sizeof(SInt16);
         bufferList.mBuffers[0].mData           = frameBuf;
 
         // Num of Bytes is usually 2048.
@@ -869,8 +929,8 @@ static OSStatus renderCallbackOnAudioThread(
 
         dispatch_async ( dispatch_get_main_queue(), ^{
 
-            [ SELF onArrivalOfInputAudioWithNumberOfFrames : inNumberFrames
-                                                      data : frameBuf       ];
+            [ SELF onArrivalOfInputAudioWithNumberOfSamples : numSamples
+                                                        data : frameBuf   ];
         } );
     }
 
@@ -878,30 +938,63 @@ static OSStatus renderCallbackOnAudioThread(
 }
 
 
--(void) calsRMS : (float*)  rms
+-(int)  calsRMS : (float*)  rms
       andAbsMax : (float*)  max
        fromData : (SInt16*) data
         andSize : (UInt32)  size
 {
+    // One pass over the Int16 samples of any size, without converting
+    // them to Float first.
+    SAMPLE_LEVELS levels;
 
-    // This demonstrates the use of vDSP to calculate RMS.
-    // The performance gain, if any, will be limited due to
-    // the conversion from Int16 to Float.
+    levelsOfSamples( data, (int) size, &levels );
 
-    if ( size > 0 ) {
+    *rms = ( size > 0 ) ? sqrtf( (float) levels.sumOfSquares / size ) : 0.0f;
+    *max = (float) levels.absPeak;
 
-        for ( int i = 0; i < size; i++ ) {
+    return levels.numClipped;
+}
 
-            mFloatBuffer[i] = (float)( data[i] );
+
+-(int)  calsRMS : (float*)  rms
+      andAbsMax : (float*)  max
+     andClipped : (int*)    clipped
+       fromData : (SInt16*) data
+      numFrames : (UInt32)  numFrames
+    numChannels : (UInt32)  numChan
+{
+    // One pass over the interleaved samples, with no copy per channel.
+    SAMPLE_LEVELS  local [ SMM_MAX_CHANNELS ];
+    SAMPLE_LEVELS* levels = local;
+
+    if ( numChan > SMM_MAX_CHANNELS ) {
+
+        levels = (SAMPLE_LEVELS*) malloc ( sizeof(SAMPLE_LEVELS) * numChan );
+
+        if ( levels == NULL ) {
+            return 0;
         }
+    }
+
+    levelsOfChannels( data, (int) numFrames, (int) numChan, levels );
 
-        // Calculate RMS
-        vDSP_rmsqv ( mFloatBuffer, 1, rms, size );
+    int numClipped = 0;
 
-        // Calculate Abs Max
-        vDSP_maxmgv( mFloatBuffer, 1, max, size );
+    for ( UInt32 c = 0; c < numChan; c++ ) {
 
+        rms[c]      = ( numFrames > 0 )
+                      ? sqrtf( (float) levels[c].sumOfSquares / numFrames )
+                      : 0.0f;
+        max[c]      = (float) levels[c].absPeak;
+        clipped[c]  = levels[c].numClipped;
+        numClipped += levels[c].numClipped;
     }
+
+    if ( levels != local ) {
+        free( levels );
+    }
+
+    return numClipped;
 }
 
 
@@ -0,0 +1,85 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#ifndef _CAPTURE_FAN_OUT_H_
+#define _CAPTURE_FAN_OUT_H_
+
+#import <Foundation/Foundation.h>
+
+@class CaptureFanOut;
+
+// Called on the queue of the reader with the next samples in order.
+// lost is the number of samples overrun just before them.
+typedef void (^CaptureFanOutHandler)( const SInt16* samples,
+                                      int           length,
+                                      int64_t       lost    );
+
+
+// Broadcasts the captured samples to the readers. See CaptureHub.hpp.
+@interface CaptureFanOut : NSObject
+
+-(id)   initWithCapacity : (int) samples maxReaders : (int) maxReaders;
+
+// Called on the capture thread only. Never blocks nor allocates.
+-(bool) write : (const SInt16*) samples length : (int) len;
+
+// Samples written so far, which is the index of the sample written next
+// as the readers count their position.
+-(int64_t) written;
+
+@end
+
+
+// Reads the samples from a fan-out on its own serial queue, by polling at
+// the interval, and passes them to the handler in blocks.
+@interface CaptureFanOutReader : NSObject
+
+@property (readonly) dispatch_queue_t mQueue;
+
+-(id)      initWithFanOut : (CaptureFanOut*)        fanOut
+                blockSize : (int)                   blockSize
+                 interval : (double)                seconds
+                  handler : (CaptureFanOutHandler)  handler;
+
+// Starts reading from the latest sample.
+-(bool)    start;
+
+// Passes the samples written so far, and stops.
+-(void)    stop;
+
+// Passes the samples written so far now. On mQueue only, typically to
+// order another task on mQueue after them.
+-(void)    drain;
+
+// Samples written but not passed yet.
+-(int64_t) lag;
+
+// Samples overrun since the start.
+-(int64_t) lostSamples;
+
+// Index of the next sample to pass, as counted by written of the fan-out.
+// On mQueue only. In the handler it is just past the samples passed.
+-(int64_t) position;
+
+@end
+
+#endif /*_CAPTURE_FAN_OUT_H_*/
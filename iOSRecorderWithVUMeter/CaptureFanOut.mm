@@ -0,0 +1,216 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#import "CaptureFanOut.h"
+#import "CaptureHub.hpp"
+
+
+@interface CaptureFanOut ()
+-(CaptureHub*) hub;
+@end
+
+
+@implementation CaptureFanOut {
+
+    CaptureHub* mHub;
+}
+
+
+-(id) initWithCapacity : (int) samples maxReaders : (int) maxReaders
+{
+    self = [ super init ];
+
+    if ( self != nil ) {
+
+        mHub = new CaptureHub( samples, maxReaders );
+
+        // Fails on writing if the hub could not be set up.
+    }
+    return self;
+}
+
+
+-(void) dealloc
+{
+    delete mHub;
+}
+
+
+-(bool) write : (const SInt16*) samples length : (int) len
+{
+    return mHub->write( samples, len ) == CaptureHub::OK;
+}
+
+
+-(int64_t) written
+{
+    return mHub->written();
+}
+
+
+-(CaptureHub*) hub
+{
+    return mHub;
+}
+
+
+@end
+
+
+@implementation CaptureFanOutReader {
+
+    CaptureFanOut*       mFanOut;
+    CaptureFanOutHandler mHandler;
+    dispatch_source_t    mTimer;
+    int                  mCursor;
+    int                  mBlockSize;
+    double               mInterval;
+    SInt16*              mBlock;
+}
+
+@synthesize mQueue;
+
+
+-(id)      initWithFanOut : (CaptureFanOut*)        fanOut
+                blockSize : (int)                   blockSize
+                 interval : (double)                seconds
+                  handler : (CaptureFanOutHandler)  handler
+{
+    self = [ super init ];
+
+    if ( self != nil ) {
+
+        mFanOut    = fanOut;
+        mHandler   = handler;
+        mTimer     = nil;
+        mCursor    = -1;
+        mBlockSize = blockSize;
+        mInterval  = seconds;
+        mBlock     = (SInt16*) malloc( sizeof(SInt16) * blockSize );
+        mQueue     = dispatch_queue_create( NULL , NULL );
+
+        if ( mBlock == NULL ) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+
+-(void) dealloc
+{
+    [ self stop ];
+
+    free( mBlock );
+}
+
+
+-(bool) start
+{
+    if ( mTimer != nil ) {
+        return false;
+    }
+
+    mCursor = [ mFanOut hub ]->openCursor();
+
+    if ( mCursor < 0 ) {
+        return false;
+    }
+
+    mTimer = dispatch_source_create( DISPATCH_SOURCE_TYPE_TIMER,
+                                     0, 0, mQueue                );
+
+    uint64_t interval = (uint64_t)( mInterval * NSEC_PER_SEC );
+
+    dispatch_source_set_timer( mTimer,
+                               dispatch_time( DISPATCH_TIME_NOW, interval ),
+                               interval,
+                               interval / 10                                );
+
+    __weak CaptureFanOutReader* weakSelf = self;
+
+    dispatch_source_set_event_handler( mTimer, ^{
+        [ weakSelf drain ];
+    } );
+
+    dispatch_resume( mTimer );
+
+    return true;
+}
+
+
+-(void) stop
+{
+    if ( mTimer == nil ) {
+        return;
+    }
+
+    dispatch_source_cancel( mTimer );
+    mTimer = nil;
+
+    dispatch_sync( mQueue, ^{
+        [ self drain ];
+    } );
+
+    [ mFanOut hub ]->closeCursor( mCursor );
+    mCursor = -1;
+}
+
+
+-(void) drain
+{
+    for ( ;; ) {
+
+        int64_t lost = 0;
+        int     len  = [ mFanOut hub ]->read( mCursor,
+                                              mBlock,
+                                              mBlockSize,
+                                              &lost       );
+
+        if ( len < 0 || ( len == 0 && lost == 0 ) ) {
+            return;
+        }
+
+        mHandler( mBlock, len, lost );
+    }
+}
+
+
+-(int64_t) lag
+{
+    return [ mFanOut hub ]->lag( mCursor );
+}
+
+
+-(int64_t) lostSamples
+{
+    return [ mFanOut hub ]->lost( mCursor );
+}
+
+
+-(int64_t) position
+{
+    return [ mFanOut hub ]->position( mCursor );
+}
+
+
+@end
@@ -0,0 +1,253 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "CaptureHub.hpp"
+
+
+CaptureHub::CaptureHub(
+        int capacity,
+        int maxCursors
+) {
+    mState      = STATE_ERR;
+    mSamples    = NULL;
+    mCursors    = NULL;
+    mCapacity   = capacity;
+    mMaxCursors = maxCursors;
+
+    mReserved.store( 0 );
+    mWritten.store ( 0 );
+
+    if ( capacity <= 0 || maxCursors <= 0 ) {
+        return;
+    }
+
+    mSamples = (short*) malloc ( sizeof(short) * capacity );
+    if ( mSamples == NULL ) {
+        return;
+    }
+
+    mCursors = new (std::nothrow) Cursor [ maxCursors ];
+    if ( mCursors == NULL ) {
+        return;
+    }
+
+    for ( int i = 0; i < maxCursors; i++ ) {
+
+        mCursors[i].mOpen.store( false );
+        mCursors[i].mNext.store( 0 );
+        mCursors[i].mLost.store( 0 );
+    }
+
+    mState = STATE_OPENED;
+}
+
+
+CaptureHub::~CaptureHub()
+{
+    if ( mSamples != NULL ) {
+        free( mSamples );
+    }
+
+    delete [] mCursors;
+}
+
+
+int CaptureHub::write( const short* samples, int numSamples )
+{
+    if ( mState != STATE_OPENED ) {
+        return ERR_STATE;
+    }
+
+    if ( numSamples < 0 || numSamples > mCapacity ) {
+        return ERR_PARAM;
+    }
+
+    int64_t start = mWritten.load( std::memory_order_relaxed );
+    int64_t end   = start + numSamples;
+
+    // Announce the samples about to be overwritten before touching them,
+    // so that a reader copying them can tell.
+    mReserved.store( end, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+
+    int64_t pos   = start % mCapacity;
+    int64_t first = mCapacity - pos;
+
+    first = ( first < numSamples ) ? first : numSamples;
+
+    memcpy( &(mSamples[pos]), samples, sizeof(short) * first );
+    memcpy( mSamples,
+            &(samples[first]),
+            sizeof(short) * ( numSamples - first ) );
+
+    mWritten.store( end, std::memory_order_release );
+
+    return OK;
+}
+
+
+int CaptureHub::openCursor()
+{
+    if ( mState != STATE_OPENED ) {
+        return ERR_STATE;
+    }
+
+    for ( int i = 0; i < mMaxCursors; i++ ) {
+
+        bool closed = false;
+
+        if ( mCursors[i].mOpen.compare_exchange_strong( closed, true ) ) {
+
+            int64_t written = mWritten.load( std::memory_order_acquire );
+
+            mCursors[i].mNext.store( written, std::memory_order_relaxed );
+            mCursors[i].mLost.store( 0,       std::memory_order_relaxed );
+
+            return i;
+        }
+    }
+
+    return ERR_FULL;
+}
+
+
+int CaptureHub::closeCursor( int cursor )
+{
+    if ( mState != STATE_OPENED ) {
+        return ERR_STATE;
+    }
+
+    if ( cursor < 0 || cursor >= mMaxCursors || !mCursors[cursor].mOpen ) {
+        return ERR_PARAM;
+    }
+
+    mCursors[cursor].mOpen.store( false );
+
+    return OK;
+}
+
+
+int CaptureHub::read(
+        int      cursor,
+        short*   samples,
+        int      maxSamples,
+        int64_t* lost
+) {
+    if ( mState != STATE_OPENED ) {
+        return ERR_STATE;
+    }
+
+    if ( cursor < 0 || cursor >= mMaxCursors || !mCursors[cursor].mOpen ) {
+        return ERR_PARAM;
+    }
+
+    Cursor& c       = mCursors[cursor];
+    int64_t written = mWritten.load( std::memory_order_acquire );
+    int64_t next    = c.mNext.load( std::memory_order_relaxed );
+    int64_t skipped = 0;
+
+    if ( written - next > mCapacity ) {
+
+        skipped = written - mCapacity - next;
+        next    = written - mCapacity;
+    }
+
+    int64_t n = written - next;
+
+    n = ( n < maxSamples ) ? n : maxSamples;
+
+    int64_t pos   = next % mCapacity;
+    int64_t first = mCapacity - pos;
+
+    first = ( first < n ) ? first : n;
+
+    memcpy( samples, &(mSamples[pos]), sizeof(short) * first );
+    memcpy( &(samples[first]), mSamples, sizeof(short) * ( n - first ) );
+
+    // The copy races with the producer by design. Drop its head if the
+    // producer has started overwriting it in the meantime. ThreadSanitizer
+    // reports the race; see tools/captureHubCheck.supp.
+    std::atomic_thread_fence( std::memory_order_acquire );
+
+    int64_t oldest = mReserved.load( std::memory_order_relaxed ) - mCapacity;
+
+    if ( oldest > next ) {
+
+        int64_t bad = ( oldest - next < n ) ? oldest - next : n;
+
+        memmove( samples, &(samples[bad]), sizeof(short) * ( n - bad ) );
+
+        n       -= bad;
+        next    += bad;
+        skipped += bad;
+    }
+
+    c.mNext.store( next + n, std::memory_order_relaxed );
+    c.mLost.fetch_add( skipped, std::memory_order_relaxed );
+
+    if ( lost != NULL ) {
+        *lost = skipped;
+    }
+
+    return (int) n;
+}
+
+
+int64_t CaptureHub::lag( int cursor )
+{
+    if ( mState != STATE_OPENED || cursor < 0 || cursor >= mMaxCursors ) {
+        return 0;
+    }
+
+    return   mWritten.load( std::memory_order_acquire )
+           - mCursors[cursor].mNext.load( std::memory_order_relaxed );
+}
+
+
+int64_t CaptureHub::lost( int cursor )
+{
+    if ( mState != STATE_OPENED || cursor < 0 || cursor >= mMaxCursors ) {
+        return 0;
+    }
+
+    return mCursors[cursor].mLost.load( std::memory_order_relaxed );
+}
+
+
+int64_t CaptureHub::written()
+{
+    return mWritten.load( std::memory_order_acquire );
+}
+
+
+int64_t CaptureHub::position( int cursor )
+{
+    if ( mState != STATE_OPENED || cursor < 0 || cursor >= mMaxCursors ) {
+        return 0;
+    }
+
+    return mCursors[cursor].mNext.load( std::memory_order_relaxed );
+}
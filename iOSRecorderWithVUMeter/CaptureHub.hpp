@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Broadcast ring from the capture thread to the consumers of the samples.
+//
+// One producer writes the samples without waiting for anyone, and each
+// consumer reads them through its own cursor at its own pace. A consumer
+// falling more than the capacity behind loses the oldest samples, which
+// are counted as an overrun of its cursor.
+//
+
+
+#ifndef _CAPTURE_HUB_HPP_
+#define _CAPTURE_HUB_HPP_
+
+#include <stdint.h>
+#include <atomic>
+
+class CaptureHub {
+
+private:
+
+    struct Cursor {
+        std::atomic<bool>    mOpen;
+        std::atomic<int64_t> mNext;      // advanced by the consumer only
+        std::atomic<int64_t> mLost;      // advanced by the consumer only
+    };
+
+    int                  mState;
+    short*               mSamples;
+    int64_t              mCapacity;
+    std::atomic<int64_t> mReserved;      // being written up to
+    std::atomic<int64_t> mWritten;       // readable up to
+    Cursor*              mCursors;
+    int                  mMaxCursors;
+
+    static const int STATE_ERR    = -1;
+    static const int STATE_OPENED =  0;
+
+public:
+
+    static const int OK         =  0;
+    static const int ERR_STATE  = -1;
+    static const int ERR_PARAM  = -2;
+    static const int ERR_MEMORY = -3;
+    static const int ERR_FULL   = -5;
+
+    CaptureHub(
+        int capacity,     // samples over all the channels
+        int maxCursors
+    );
+
+    ~CaptureHub();
+
+    // Producer only. Never blocks nor allocates.
+    // numSamples must not exceed the capacity.
+    int     write      ( const short* samples, int numSamples );
+
+    // Returns the cursor, positioned at the latest sample, or ERR_*.
+    int     openCursor ();
+
+    int     closeCursor( int cursor );
+
+    // Consumer of the cursor only. Returns the number of samples copied to
+    // samples, or ERR_*. lost is set to the samples overrun before them.
+    int     read       ( int cursor, short* samples, int maxSamples,
+                         int64_t* lost                               );
+
+    // Samples written but not read yet through the cursor.
+    int64_t lag        ( int cursor );
+
+    // Samples overrun through the cursor since it was opened.
+    int64_t lost       ( int cursor );
+
+    // Samples written since the creation. The sample written next has this
+    // index, as counted by position().
+    int64_t written    ();
+
+    // Consumer of the cursor only. Index of the next sample to be read.
+    int64_t position   ( int cursor );
+
+};
+
+#endif /*_CAPTURE_HUB_HPP_*/
@@ -0,0 +1,337 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "MeterBallistics.hpp"
+
+// The same as the former VUMeterViewGL, in the positions per second^2.
+static const float  VuAcceleration      = 100.0f;
+static const float  VuFriction          =  10.0f;
+
+static const float  PpmAttackSeconds    = 0.005f;       // time constant
+static const float  PpmFallDBPerSecond  = 24.0f / 2.8f; // as the BBC PPM
+static const float  PeakFallDBPerSecond = 20.0f / 1.7f; // as IEC 60268-18
+static const float  HoldSeconds         = 2.0f;
+static const double MaxCatchUpSeconds   = 0.5;
+
+static const int    Log2TableBits       = 8;
+static const int    Log2TableSize       = 1 << Log2TableBits;
+
+
+// Not fminf() nor fmaxf(), which are calls unless NaN is ruled out.
+static inline float clamp_unit( float x )
+{
+    return ( x < 0.0f ) ? 0.0f : ( x > 1.0f ) ? 1.0f : x;
+}
+
+static inline float max_of( float a, float b )
+{
+    return ( a > b ) ? a : b;
+}
+
+
+// log2 of the mantissas 1 + i / Log2TableSize, one more for the interpolation.
+struct Log2Table {
+
+    float mValues [ Log2TableSize + 1 ];
+
+    Log2Table() {
+        for ( int i = 0; i <= Log2TableSize; i++ ) {
+            mValues[i] = (float) log2( 1.0 + (double) i / Log2TableSize );
+        }
+    }
+};
+
+static const Log2Table TheLog2Table;
+
+
+// log2 of x > 0, from the exponent of the float and the table of the
+// mantissa with a linear interpolation. Off by less than 3e-6.
+static inline float table_log2( float x )
+{
+    uint32_t bits;
+
+    memcpy( &bits, &x, sizeof(bits) );
+
+    int      exponent = (int)( ( bits >> 23 ) & 0xFF ) - 127;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    int      index    = (int)( mantissa >> ( 23 - Log2TableBits ) );
+    float    frac     = ( mantissa & ( ( 1 << ( 23 - Log2TableBits ) ) - 1 ) )
+                        * ( 1.0f / ( 1 << ( 23 - Log2TableBits ) ) );
+    float    lo       = TheLog2Table.mValues[ index     ];
+    float    hi       = TheLog2Table.mValues[ index + 1 ];
+
+    return exponent + lo + frac * ( hi - lo );
+}
+
+
+MeterBallistics::MeterBallistics(
+        int   numMeters,
+        int   mode,
+        float stepSeconds
+) {
+    mState       = STATE_ERR;
+    mMode        = mode;
+    mNumMeters   = numMeters;
+    mStepSeconds = stepSeconds;
+    mPending     = 0.0;
+    mTargets     = NULL;
+    mPositions   = NULL;
+    mVelocities  = NULL;
+    mHolds       = NULL;
+    mHoldTimes   = NULL;
+
+    if ( numMeters <= 0 || stepSeconds <= 0.0f
+         || mode < MODE_VU || mode > MODE_PEAK_HOLD ) {
+        return;
+    }
+
+    mTargets    = (float*) malloc ( sizeof(float) * numMeters );
+    mPositions  = (float*) malloc ( sizeof(float) * numMeters );
+    mVelocities = (float*) malloc ( sizeof(float) * numMeters );
+    mHolds      = (float*) malloc ( sizeof(float) * numMeters );
+    mHoldTimes  = (float*) malloc ( sizeof(float) * numMeters );
+
+    if (    mTargets == NULL || mPositions == NULL || mVelocities == NULL
+         || mHolds   == NULL || mHoldTimes == NULL                       ) {
+        return;
+    }
+
+    mState = STATE_OPENED;
+
+    // As the former VUMeterViewGL.
+    setScale( 32767.0f / sqrtf( 2.0f ), -55.0f, 0.0f );
+
+    reset();
+}
+
+
+MeterBallistics::~MeterBallistics()
+{
+    free( mTargets    );
+    free( mPositions  );
+    free( mVelocities );
+    free( mHolds      );
+    free( mHoldTimes  );
+}
+
+
+int MeterBallistics::setScale( float reference, float floorDB, float ceilingDB )
+{
+    if ( mState != STATE_OPENED ) {
+        return ERR_STATE;
+    }
+
+    if ( reference <= 0.0f || ceilingDB <= floorDB ) {
+        return ERR_PARAM;
+    }
+
+    mLog2Reference = log2f( reference );
+    mFloorDB       = floorDB;
+    mCeilingDB     = ceilingDB;
+
+    return OK;
+}
+
+
+int MeterBallistics::setMode( int mode )
+{
+    if ( mState != STATE_OPENED ) {
+        return ERR_STATE;
+    }
+
+    if ( mode < MODE_VU || mode > MODE_PEAK_HOLD ) {
+        return ERR_PARAM;
+    }
+
+    mMode = mode;
+
+    reset();
+
+    return OK;
+}
+
+
+int MeterBallistics::setLevels( int first, int numLevels, const float* levels )
+{
+    if ( mState != STATE_OPENED ) {
+        return ERR_STATE;
+    }
+
+    if ( first < 0 || numLevels < 0 || first + numLevels > mNumMeters ) {
+        return ERR_PARAM;
+    }
+
+    const float scale = 1.0f / ( mCeilingDB - mFloorDB );
+
+    // Not clamped, so that the VU needle is pulled as hard as the level
+    // is beyond the ends.
+    for ( int i = 0; i < numLevels; i++ ) {
+
+        float level = ( levels[i] > 1.0f ) ? levels[i] : 1.0f;
+        float dB    = 20.0f * 0.30103f
+                      * ( table_log2( level ) - mLog2Reference );
+
+        mTargets[ first + i ] = ( dB - mFloorDB ) * scale;
+    }
+
+    return OK;
+}
+
+
+int MeterBallistics::advance( double seconds )
+{
+    if ( mState != STATE_OPENED ) {
+        return ERR_STATE;
+    }
+
+    if ( seconds < 0.0 ) {
+        return ERR_PARAM;
+    }
+
+    mPending += ( seconds < MaxCatchUpSeconds ) ? seconds : MaxCatchUpSeconds;
+
+    int numSteps = (int)( mPending / mStepSeconds );
+
+    mPending -= numSteps * (double)mStepSeconds;
+
+    for ( int s = 0; s < numSteps; s++ ) {
+
+        switch ( mMode ) {
+
+          case MODE_VU:        stepVU();       break;
+          case MODE_PPM:       stepPPM();      break;
+          case MODE_PEAK_HOLD: stepPeakHold(); break;
+        }
+
+        stepHolds();
+    }
+
+    return numSteps;
+}
+
+
+void MeterBallistics::reset()
+{
+    if ( mState != STATE_OPENED ) {
+        return;
+    }
+
+    for ( int i = 0; i < mNumMeters; i++ ) {
+
+        mTargets   [i] = 0.0f;
+        mPositions [i] = 0.0f;
+        mVelocities[i] = 0.0f;
+        mHolds     [i] = 0.0f;
+        mHoldTimes [i] = 0.0f;
+    }
+
+    mPending = 0.0;
+}
+
+
+float MeterBallistics::toDB( float amplitude ) const
+{
+    amplitude = ( amplitude > 1.0e-30f ) ? amplitude : 1.0e-30f;
+
+    return 20.0f * 0.30103f * ( table_log2( amplitude ) - mLog2Reference );
+}
+
+
+// Semi-implicit Euler as the former VUMeterViewGL, which stops the needle
+// at the ends.
+void MeterBallistics::stepVU()
+{
+    const float  dt = mStepSeconds;
+    const float* t  = mTargets;
+    float*       p  = mPositions;
+    float*       v  = mVelocities;
+
+    for ( int i = 0; i < mNumMeters; i++ ) {
+
+        float a  = VuAcceleration * ( t[i] - p[i] ) - VuFriction * v[i];
+        float vn = v[i] + a * dt;
+        float pn = p[i] + vn * dt;
+        float pc = clamp_unit( pn );
+
+        v[i] = ( pc == pn ) ? vn : 0.0f;
+        p[i] = pc;
+    }
+}
+
+
+void MeterBallistics::stepPPM()
+{
+    const float  rise = 1.0f - expf( -mStepSeconds / PpmAttackSeconds );
+    const float  fall = PpmFallDBPerSecond * mStepSeconds
+                        / ( mCeilingDB - mFloorDB );
+    const float* t    = mTargets;
+    float*       p    = mPositions;
+
+    for ( int i = 0; i < mNumMeters; i++ ) {
+
+        float tc = clamp_unit( t[i] );
+        float up = p[i] + ( tc - p[i] ) * rise;
+        float dn = max_of( tc, p[i] - fall );
+
+        p[i] = ( tc > p[i] ) ? up : dn;
+    }
+}
+
+
+void MeterBallistics::stepPeakHold()
+{
+    const float  fall = PeakFallDBPerSecond * mStepSeconds
+                        / ( mCeilingDB - mFloorDB );
+    const float* t    = mTargets;
+    float*       p    = mPositions;
+
+    for ( int i = 0; i < mNumMeters; i++ ) {
+
+        float tc = clamp_unit( t[i] );
+
+        p[i] = max_of( tc, p[i] - fall );
+    }
+}
+
+
+void MeterBallistics::stepHolds()
+{
+    const float  dt   = mStepSeconds;
+    const float  fall = PeakFallDBPerSecond * mStepSeconds
+                        / ( mCeilingDB - mFloorDB );
+    const float* p    = mPositions;
+    float*       h    = mHolds;
+    float*       ht   = mHoldTimes;
+
+    for ( int i = 0; i < mNumMeters; i++ ) {
+
+        bool  higher  = ( p[i] >= h[i] );
+        float falling = max_of( p[i], h[i] - fall );
+
+        h [i] = higher ? p[i] : ( ( ht[i] > 0.0f ) ? h[i] : falling );
+        ht[i] = higher ? HoldSeconds : ht[i] - dt;
+    }
+}
@@ -0,0 +1,126 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//
+// Needle ballistics of a bank of level meters, without any view.
+//
+// The needles are integrated at a fixed time step, however often and
+// irregularly the display refreshes, and the levels are put on the dB scale
+// by a table of log2 instead of log10(). The state of the meters is kept in
+// an array per quantity, so that a step is a few plain loops over all the
+// meters of the bank, which the compiler can vectorize.
+//
+// MODE_VU        The needle of a VU meter, a mass on a spring with friction,
+//                driven by the RMS.
+// MODE_PPM       A quasi-peak programme meter, driven by the peak. It rises
+//                quickly towards the level, and falls at a constant rate in
+//                dB.
+// MODE_PEAK_HOLD A peak meter, which jumps to the peak and falls at a
+//                constant rate in dB.
+//
+// In all the modes, the hold marker stays at the highest position for
+// HoldSeconds, and then falls at the rate of MODE_PEAK_HOLD.
+//
+
+
+#ifndef _METER_BALLISTICS_HPP_
+#define _METER_BALLISTICS_HPP_
+
+#include <stdint.h>
+
+class MeterBallistics {
+
+private:
+
+    int     mState;
+    int     mMode;
+    int     mNumMeters;
+    float   mStepSeconds;
+    double  mPending;        // seconds not integrated yet
+
+    float   mLog2Reference;  // log2 of the amplitude at 0dB
+    float   mFloorDB;        // at the position 0
+    float   mCeilingDB;      // at the position 1
+
+    float*  mTargets;        // where the levels put the needles
+    float*  mPositions;      // 0 at the left end, and 1 at the right
+    float*  mVelocities;     // [1/s], MODE_VU only
+    float*  mHolds;          // positions of the hold markers
+    float*  mHoldTimes;      // seconds before the markers start falling
+
+    static const int STATE_ERR    = -1;
+    static const int STATE_OPENED =  0;
+
+    void    stepVU       ();
+    void    stepPPM      ();
+    void    stepPeakHold ();
+    void    stepHolds    ();
+
+public:
+
+    static const int MODE_VU        = 0;
+    static const int MODE_PPM       = 1;
+    static const int MODE_PEAK_HOLD = 2;
+
+    static const int OK         =  0;
+    static const int ERR_STATE  = -1;
+    static const int ERR_PARAM  = -2;
+    static const int ERR_MEMORY = -3;
+
+    MeterBallistics(
+        int   numMeters,
+        int   mode,
+        float stepSeconds   // e.g., 1/480 for the displays at 60 and 120Hz
+    );
+
+    ~MeterBallistics();
+
+    // The levels are amplitudes of the samples, and reference reads 0dB.
+    // The scale is linear in dB from floorDB to ceilingDB.
+    int          setScale  ( float reference, float floorDB, float ceilingDB );
+
+    int          setMode   ( int mode );
+
+    // The levels of the meters from first. The RMS for MODE_VU, and the
+    // absolute peak for the others. The levels below 1 are taken as 1.
+    int          setLevels ( int first, int numLevels, const float* levels );
+
+    // Integrates as many steps as fit in the seconds elapsed, with the rest
+    // carried over to the next call. A long pause is cut to MaxCatchUpSeconds.
+    // Returns the number of the steps, or ERR_*.
+    int          advance   ( double seconds );
+
+    // All the needles at rest at the left end.
+    void         reset     ();
+
+    int          numMeters () const { return mNumMeters; }
+
+    const float* positions () const { return mPositions; }
+
+    const float* holds     () const { return mHolds; }
+
+    // 20 * log10( amplitude / reference ) by the table.
+    float        toDB      ( float amplitude ) const;
+
+};
+
+#endif /*_METER_BALLISTICS_HPP_*/
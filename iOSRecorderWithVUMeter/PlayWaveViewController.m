@@ -25,7 +25,9 @@
 
 #import "AVFoundation/AVFoundation.h"
 #import "PlayWaveViewController.h"
-#import "estimateSNR.h"
+#import "snrCache.h"
+#import "spectrogramTiles.h"
+#import "wavePeakPyramid.h"
 
 @interface PlayWaveViewController ()
 
@@ -34,7 +36,13 @@
 
 @implementation PlayWaveViewController {
 
-    char mFilePathBuf [ FILE_PATH_LEN ];
+    char               mFilePathBuf [ FILE_PATH_LEN ];
+
+    // Kept open to plot any other window of the file without a rescan.
+    WAVE_PEAK_PYRAMID* mPeakPyramid;
+
+    // Kept open to render any other window from the cached tiles.
+    SPECTROGRAM*       mSpectrogram;
 }
 
 
@@ -48,19 +56,28 @@
     self = [ super initWithNibName : nibNameOrNil bundle : nibBundleOrNil ];
     
     if (self) {
-        ;
+        mPeakPyramid = NULL;
+        mSpectrogram = NULL;
     }
 
     return self;
 }
 
 
+- (void) dealloc
+{
+    freeWavePeakPyramid( mPeakPyramid );
+    freeSpectrogram( mSpectrogram );
+}
+
+
 -(NSData*) getWaveInfoFor : (NSString *) filepath
                     noise : (float*)     noiseLevel
                    speech : (float*)     speechLevel
                  drawArea : (CGRect)     area
                      peak : (int *)      peakVal
-                   length : (int*)       lengthVal
+                   length : (int64_t*)   lengthVal
+                     rate : (int*)       sampleRateVal
 {
 
     int width  = area.size.width;
@@ -70,14 +87,27 @@
                 maxLength : FILE_PATH_LEN - 1
                  encoding : NSUTF8StringEncoding ];
 
-    estimateSNR( mFilePathBuf, noiseLevel, speechLevel );
-    
-    int* plots  = computePeakAndPlots( mFilePathBuf,
-                                       width,
-                                       height,
-                                       peakVal,
-                                       lengthVal     );
+    // Estimated at the first open, and loaded from the sidecar afterwards.
+    estimateSNRWithCache( mFilePathBuf, noiseLevel, speechLevel );
+
+    freeWavePeakPyramid( mPeakPyramid );
+
+    // Built at the first open, and loaded from the sidecar afterwards.
+    mPeakPyramid = openWavePeakPyramid( mFilePathBuf );
 
+    if ( mPeakPyramid == NULL ) {
+        return nil;
+    }
+
+    *peakVal       = mPeakPyramid->peak;
+    *lengthVal     = mPeakPyramid->totalSamples / mPeakPyramid->numChannels;
+    *sampleRateVal = mPeakPyramid->sampleRate;
+
+    int* plots = computePlotsFromWavePeakPyramid( mPeakPyramid,
+                                                  0,
+                                                  mPeakPyramid->totalSamples,
+                                                  width,
+                                                  height                      );
     if ( plots == NULL ) {
         return nil;
     }
@@ -91,6 +121,40 @@
 }
 
 
+-(NSData*) getSpectrogramFor : (NSString *) filepath
+                    drawArea : (CGRect)     area
+{
+    int width  = area.size.width;
+    int height = area.size.height;
+
+    [ filepath getCString : mFilePathBuf
+                maxLength : FILE_PATH_LEN - 1
+                 encoding : NSUTF8StringEncoding ];
+
+    freeSpectrogram( mSpectrogram );
+
+    // Only the tiles of the window are computed, and cached in the sidecar.
+    mSpectrogram = openSpectrogram( mFilePathBuf );
+
+    if ( mSpectrogram == NULL || mPeakPyramid == NULL ) {
+        return nil;
+    }
+
+    unsigned char* image = computeSpectrogramImage( mSpectrogram,
+                                                    0,
+                                                    mPeakPyramid->totalSamples,
+                                                    width,
+                                                    height                      );
+    if ( image == NULL ) {
+        return nil;
+    }
+
+    return [ NSData dataWithBytesNoCopy : image
+                                 length : width * height
+                           freeWhenDone : YES            ];
+}
+
+
 - (void) viewDidLoad
 {
     [super viewDidLoad];
@@ -116,17 +180,28 @@
     NSString* fullPath = [ docsDir stringByAppendingPathComponent : fileName ];
     NSURL*    url      = [ NSURL fileURLWithPath : fullPath ];
 
-    float noiseLevel;
-    float speechLevel;
-    int   peakVal;
-    int   lengthVal;
+    float   noiseLevel;
+    float   speechLevel;
+    int     peakVal;
+    int64_t lengthVal;
+    int     sampleRateVal = 0;
 
     NSData* plots = [ self getWaveInfoFor : fullPath
                                     noise : &noiseLevel
                                    speech : &speechLevel
                                  drawArea : drawFrame
                                      peak : &peakVal
-                                   length : &lengthVal   ];
+                                   length : &lengthVal
+                                     rate : &sampleRateVal ];
+
+    NSData* spectrogram = [ self getSpectrogramFor : fullPath
+                                          drawArea : drawFrame ];
+    if ( spectrogram != nil ) {
+
+        [ mLabelWaveDrawing spectrogramWith : spectrogram
+                                      width : (int) drawFrame.size.width
+                                     height : (int) drawFrame.size.height ];
+    }
 
     //Plot the graph on the screen.
     [ mLabelWaveDrawing plotWith : plots ];
@@ -144,7 +219,9 @@
                              peakVal                                   ];
 
     mLabelLength.text    = [ NSString stringWithFormat : @"%5.3f[sec]",
-                             ((double)lengthVal) / 16000               ];
+                             ( sampleRateVal > 0 )
+                             ? ((double)lengthVal) / sampleRateVal
+                             : 0.0                                     ];
 
     NSError *error;
 
@@ -0,0 +1,59 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#ifndef _SLOW_TASK_SPECTRUM_ANALYZER_H_
+#define _SLOW_TASK_SPECTRUM_ANALYZER_H_
+
+
+#ifdef USE_POSIX_VERSION_OF_SLOW_TASK_MANAGER
+#import "SlowTaskManagerPosix.h"
+#else
+#import "SlowTaskManager.h"
+#endif
+
+#include "spectrumAnalyzer.h"
+
+
+// Analyzes the spectra of the fed samples in the background.
+// The parameters are taken at the first start.
+#ifdef USE_POSIX_VERSION_OF_SLOW_TASK_MANAGER
+@interface SlowTaskSpectrumAnalyzer : SlowTaskManagerPosix
+#else
+@interface SlowTaskSpectrumAnalyzer : SlowTaskManager
+#endif
+
+@property int   mSampleRate;
+@property int   mNumberOfChannels;
+@property int   mFFTSize;           // 1024 by default
+@property float mAveragingSeconds;  // 1.0 by default
+
+// Snapshot sized for this analyzer, or NULL before the first start.
+// To be released by freeSpectrumSnapshot().
+-(SPECTRUM_SNAPSHOT*) allocSnapshot;
+
+// Copies the latest spectra without blocking the analysis.
+// Call from one thread only. Returns false if nothing new is available.
+-(bool) readSnapshot : (SPECTRUM_SNAPSHOT*) snapshot;
+
+@end
+
+#endif /*_SLOW_TASK_SPECTRUM_ANALYZER_H_*/
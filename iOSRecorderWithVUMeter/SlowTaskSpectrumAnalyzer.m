@@ -0,0 +1,135 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#import "SlowTaskSpectrumAnalyzer.h"
+
+#include <stdlib.h>
+
+
+@implementation SlowTaskSpectrumAnalyzer {
+
+    SPECTRUM_ANALYZER* mAnalyzer;
+}
+
+
+@synthesize mSampleRate;
+@synthesize mNumberOfChannels;
+@synthesize mFFTSize;
+@synthesize mAveragingSeconds;
+
+
+-(id) init
+{
+    self =  [ super init ];
+
+    if (self) {
+        mAnalyzer         = NULL;
+        mFFTSize          = 1024;
+        mAveragingSeconds = 1.0f;
+    }
+
+    return self;
+}
+
+
+-(void) dealloc
+{
+    freeSpectrumAnalyzer( mAnalyzer );
+}
+
+
+-(bool) start
+{
+    // Created on the calling thread, so that the snapshots can be read
+    // from it without a race on mAnalyzer.
+    if ( mAnalyzer == NULL ) {
+
+        mAnalyzer = createSpectrumAnalyzer( mFFTSize,
+                                            mSampleRate,
+                                            mNumberOfChannels,
+                                            mAveragingSeconds  );
+        if ( mAnalyzer == NULL ) {
+            return false;
+        }
+    }
+
+    return [ super start ];
+}
+
+
+-(SPECTRUM_SNAPSHOT*) allocSnapshot
+{
+    if ( mAnalyzer == NULL ) {
+        return NULL;
+    }
+
+    return allocSpectrumSnapshot( mAnalyzer );
+}
+
+
+-(bool) readSnapshot : (SPECTRUM_SNAPSHOT*) snapshot
+{
+    if ( mAnalyzer == NULL ) {
+        return false;
+    }
+
+    return readSpectrumSnapshot( mAnalyzer, snapshot ) == 1;
+}
+
+
+-(bool) taskStart
+{
+    resetSpectrumAnalyzer( mAnalyzer );
+
+    return true;
+}
+
+
+-(void) taskStop
+{
+    ;
+}
+
+
+-(void) taskAbort
+{
+    ;
+}
+
+
+-(bool) taskFeed : (void*) data length : (int) len
+{
+    feedSpectrumAnalyzer( mAnalyzer, (const short*) data, len );
+
+    free( data );
+
+    return true;
+}
+
+
+-(void) taskIgnore : (void*) data length : (int) len
+{
+    free(data);
+}
+
+
+@end
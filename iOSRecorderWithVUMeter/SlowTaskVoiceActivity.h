@@ -0,0 +1,57 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#ifndef _SLOW_TASK_VOICE_ACTIVITY_H_
+#define _SLOW_TASK_VOICE_ACTIVITY_H_
+
+
+#ifdef USE_POSIX_VERSION_OF_SLOW_TASK_MANAGER
+#import "SlowTaskManagerPosix.h"
+#else
+#import "SlowTaskManager.h"
+#endif
+
+
+// Offsets are in samples per channel since the start.
+@protocol SlowTaskVoiceActivityDelegate <NSObject>
+@required
+-(void) speechStartedAt : (int64_t) sampleOffset;
+-(void) speechEndedAt   : (int64_t) sampleOffset;
+@end
+
+
+// Detects the speech in the fed samples in the background, and reports
+// its starts and ends on the main queue.
+// The parameters are taken at the first start.
+#ifdef USE_POSIX_VERSION_OF_SLOW_TASK_MANAGER
+@interface SlowTaskVoiceActivity : SlowTaskManagerPosix
+#else
+@interface SlowTaskVoiceActivity : SlowTaskManager
+#endif
+
+@property (nonatomic,weak) id <SlowTaskVoiceActivityDelegate> mVoiceDelegate;
+@property int mSampleRate;
+@property int mNumberOfChannels;
+
+@end
+
+#endif /*_SLOW_TASK_VOICE_ACTIVITY_H_*/
@@ -0,0 +1,148 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#import "SlowTaskVoiceActivity.h"
+
+#include <stdlib.h>
+
+#include "voiceActivity.h"
+
+
+@interface SlowTaskVoiceActivity ()
+-(void) dispatchSpeech : (int) speech at : (int64_t) sampleOffset;
+@end
+
+
+// Called on the task queue from feedVoiceActivity() and flushVoiceActivity().
+static void voiceActivityCallback(
+    int     speech,
+    int64_t sampleOffset,
+    void*   user
+) {
+    SlowTaskVoiceActivity* task = (__bridge SlowTaskVoiceActivity*) user;
+
+    [ task dispatchSpeech : speech at : sampleOffset ];
+}
+
+
+@implementation SlowTaskVoiceActivity {
+
+    VOICE_ACTIVITY* mVAD;
+}
+
+
+@synthesize mVoiceDelegate;
+@synthesize mSampleRate;
+@synthesize mNumberOfChannels;
+
+
+-(id) init
+{
+    self =  [ super init ];
+
+    if (self) {
+        mVAD = NULL;
+    }
+
+    return self;
+}
+
+
+-(void) dealloc
+{
+    freeVoiceActivity( mVAD );
+}
+
+
+-(bool) start
+{
+    if ( mVAD == NULL ) {
+
+        mVAD = createVoiceActivity( mSampleRate,
+                                    mNumberOfChannels,
+                                    voiceActivityCallback,
+                                    (__bridge void*) self  );
+        if ( mVAD == NULL ) {
+            return false;
+        }
+    }
+
+    return [ super start ];
+}
+
+
+-(void) dispatchSpeech : (int) speech at : (int64_t) sampleOffset
+{
+    dispatch_async ( dispatch_get_main_queue(), ^{
+
+        if ( self.mVoiceDelegate == nil ) {
+            return;
+        }
+
+        if ( speech ) {
+            [ self.mVoiceDelegate speechStartedAt : sampleOffset ];
+        }
+        else {
+            [ self.mVoiceDelegate speechEndedAt : sampleOffset ];
+        }
+    } );
+}
+
+
+-(bool) taskStart
+{
+    resetVoiceActivity( mVAD );
+
+    return true;
+}
+
+
+-(void) taskStop
+{
+    // Close the speech still in progress at the end of the recording.
+    flushVoiceActivity( mVAD );
+}
+
+
+-(void) taskAbort
+{
+    ;
+}
+
+
+-(bool) taskFeed : (void*) data length : (int) len
+{
+    feedVoiceActivity( mVAD, (const short*) data, len );
+
+    free( data );
+
+    return true;
+}
+
+
+-(void) taskIgnore : (void*) data length : (int) len
+{
+    free(data);
+}
+
+
+@end
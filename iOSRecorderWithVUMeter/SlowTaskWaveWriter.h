@@ -30,6 +30,9 @@
 #import "SlowTaskManager.h"
 #endif
 
+#include "preRollRing.h"
+#include "dropoutMarkers.h"
+
 
 #ifdef USE_POSIX_VERSION_OF_SLOW_TASK_MANAGER
 @interface SlowTaskWaveWriter : SlowTaskManagerPosix
@@ -41,6 +44,27 @@
 @property int mSampleRate;
 @property int mNumberOfChannels;
 
+// Drops the silence between the speech, and saves the edit list that maps
+// the file back to the recording time in "<base>.wav.edl".
+// See silenceGate.h. Taken at each start.
+// API only: no control of the app sets it, and the player does not read
+// the edit list yet. tools/silenceGateCheck.c checks the gate and the
+// mapping of loadGateEditList() and gatedToSourceOffset().
+@property bool  mSilenceGated;          // false by default
+@property float mGatePreRollSeconds;    // 0.5 by default
+@property float mGateHangoverSeconds;   // 1.0 by default
+
+// Written as the head of the file at each start, if not NULL.
+// The ring must be pushed to on the thread or the serial queue calling
+// start, and outlive this writer.
+@property PRE_ROLL_RING* mPreRoll;
+
+// Marks lostFrames frames the capture never got, frame frames into the
+// next chunk fed. The markers of a recording are saved with it in
+// "<base>.wav.drop". See dropoutMarkers.h. On the thread or the serial
+// queue calling feed, and ignored unless recording.
+-(void) markDropout : (int64_t) lostFrames beforeFrame : (int) frame;
+
 @end
 
 #endif /*_SLOW_TASK_WAVE_WRITER_H_*/
@@ -29,17 +29,54 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#include "silenceGate.h"
+
 static const int readBufferSize = 4096;
 
 
+@interface SlowTaskWaveWriter ()
+-(bool) writeCompleteFd : (int) fd data : (char*) data length : (int) len;
+-(bool) writeSamples : (const short*) samples length : (int) len;
+-(bool) writeChunk   : (const short*) samples length : (int) len;
+-(bool) openRecording;
+@end
+
+
+// Called from feedSilenceGate() with the samples passing the gate.
+static int gateWriter( const short* samples, int numSamples, void* user )
+{
+    SlowTaskWaveWriter* writer = (__bridge SlowTaskWaveWriter*) user;
+
+    return [ writer writeSamples : samples length : numSamples ] ? 0 : -1;
+}
+
+
 @implementation SlowTaskWaveWriter {
-    int       mFd;
+    int             mFd;
+    SILENCE_GATE*   mGate;
+
+    // Detached from mPreRoll by start, and released by taskStart.
+    PRE_ROLL_SPLICE mSplice;
+    bool            mSpliced;
+
+    // Added to on the thread feeding, and saved by taskStop.
+    DROPOUT_LIST*   mDropouts;
+    NSLock*         mDropoutLock;
+
+    // On the thread feeding only. Frames of the recording fed so far,
+    // from the pre-roll on, and whether the markers are taken.
+    int64_t         mFedFrames;
+    bool            mMarking;
 }
 
 
 @synthesize mBaseFileName;
 @synthesize mSampleRate;
 @synthesize mNumberOfChannels;
+@synthesize mSilenceGated;
+@synthesize mGatePreRollSeconds;
+@synthesize mGateHangoverSeconds;
+@synthesize mPreRoll;
 
 
 -(id) init
@@ -47,13 +84,30 @@ static const int readBufferSize = 4096;
     self =  [ super init ];
 
     if (self) {
-        mFd = -1;
+        mFd                  = -1;
+        mGate                = NULL;
+        mSilenceGated        = false;
+        mGatePreRollSeconds  = 0.5f;
+        mGateHangoverSeconds = 1.0f;
+        mPreRoll             = NULL;
+        mSpliced             = false;
+        mDropouts            = NULL;
+        mDropoutLock         = [ NSLock new ];
+        mFedFrames           = 0;
+        mMarking             = false;
     }
 
     return self;
 }
 
 
+-(void) dealloc
+{
+    freeSilenceGate( mGate );
+    freeDropoutList( mDropouts );
+}
+
+
 -(NSString*) makePermissibleFilePathFromBaseFileName : (NSString*) fileName
                                         andExtension : (NSString*) ext
 {
@@ -68,14 +122,152 @@ static const int readBufferSize = 4096;
 }
 
 
+-(bool) start
+{
+    PRE_ROLL_SPLICE splice;
+    bool            spliced = false;
+
+    // Detached on the thread pushing to the ring, so that no chunk is both
+    // in the splice and fed to this writer. A successful detach also means
+    // that no earlier taskStart is using mSplice any more.
+    if ( mPreRoll != NULL && detachPreRoll( mPreRoll, &splice ) ) {
+
+        mSplice  = splice;
+        mSpliced = true;
+        spliced  = true;
+    }
+
+    if ( ![ super start ] ) {
+
+        if ( spliced ) {
+            mSpliced = false;
+            releasePreRoll( mPreRoll );
+        }
+        return false;
+    }
+
+    // The pre-roll is the head of the recording.
+    mFedFrames = spliced ? ( splice.numSamples[0] + splice.numSamples[1] )
+                           / mNumberOfChannels
+                         : 0;
+    mMarking   = true;
+
+    [ mDropoutLock lock ];
+
+    if (    mDropouts != NULL
+         && mDropouts->sampleRate  == mSampleRate
+         && mDropouts->numChannels == mNumberOfChannels ) {
+
+        clearDropoutList( mDropouts );
+    }
+    else {
+        freeDropoutList( mDropouts );
+        mDropouts = createDropoutList( mSampleRate, mNumberOfChannels );
+    }
+
+    [ mDropoutLock unlock ];
+
+    return true;
+}
+
+
+-(bool) stop
+{
+    mMarking = false;
+
+    return [ super stop ];
+}
+
+
+-(bool) feed : (void*) data length : (int) len
+{
+    bool fed = [ super feed : data length : len ];
+
+    if ( fed ) {
+        mFedFrames += len / mNumberOfChannels;
+    }
+
+    return fed;
+}
+
+
+-(void) markDropout : (int64_t) lostFrames beforeFrame : (int) frame
+{
+    if ( !mMarking ) {
+        return;
+    }
+
+    [ mDropoutLock lock ];
+
+    if ( mDropouts != NULL ) {
+        addDropoutMarker( mDropouts, mFedFrames + frame, lostFrames );
+    }
+
+    [ mDropoutLock unlock ];
+}
+
+
 -(bool) taskStart
+{
+    bool rtnVal = [ self openRecording ];
+
+    if ( mSpliced ) {
+
+        // Written from the ring as the head of the file.
+        for ( int i = 0; i < 2 && rtnVal; i++ ) {
+
+            if ( mSplice.numSamples[i] > 0 ) {
+
+                rtnVal = [ self writeChunk : mSplice.pieces[i]
+                                    length : mSplice.numSamples[i] ];
+            }
+        }
+
+        mSpliced = false;
+        releasePreRoll( mPreRoll );
+    }
+
+    return rtnVal;
+}
+
+
+-(bool) openRecording
 {
     NSString* PCMFileName =
          [ self makePermissibleFilePathFromBaseFileName : mBaseFileName
                                            andExtension : @"pcm"        ];
 
+    NSString* EDLFileName =
+         [ self makePermissibleFilePathFromBaseFileName : mBaseFileName
+                                           andExtension : @"wav.edl"    ];
+
+    NSString* DropFileName =
+         [ self makePermissibleFilePathFromBaseFileName : mBaseFileName
+                                           andExtension : @"wav.drop"   ];
+
     unlink( PCMFileName.UTF8String );
 
+    // Neither do an edit list nor the dropouts of an earlier recording
+    // apply to this one.
+    unlink( EDLFileName.UTF8String );
+    unlink( DropFileName.UTF8String );
+
+    freeSilenceGate( mGate );
+    mGate = NULL;
+
+    if ( mSilenceGated ) {
+
+        mGate = createSilenceGate( mSampleRate,
+                                   mNumberOfChannels,
+                                   mGatePreRollSeconds,
+                                   mGateHangoverSeconds,
+                                   gateWriter,
+                                   (__bridge void*) self );
+        if ( mGate == NULL ) {
+            return false;
+        }
+    }
+
     mFd = open( PCMFileName.UTF8String,
                 O_CREAT | O_WRONLY | O_TRUNC, S_IRWXU | S_IRWXG | S_IRWXO
               );
@@ -93,13 +285,35 @@ static const int readBufferSize = 4096;
 
         close(mFd);
 
-        [ self convertFromPCMToWave ];
+        if ( [ self convertFromPCMToWave ] ) {
+
+            NSString* WAVFileName =
+              [ self makePermissibleFilePathFromBaseFileName : mBaseFileName
+                                                andExtension : @"wav"        ];
+            if ( mGate != NULL ) {
+                saveGateEditList( mGate, WAVFileName.UTF8String );
+            }
+
+            [ mDropoutLock lock ];
+
+            if ( mDropouts != NULL ) {
+                saveDropoutList( mDropouts, WAVFileName.UTF8String );
+            }
+
+            [ mDropoutLock unlock ];
+        }
     }
+
+    freeSilenceGate( mGate );
+    mGate = NULL;
 }
 
 
 -(void) taskAbort
 {
+    freeSilenceGate( mGate );
+    mGate = NULL;
+
     if ( mFd != -1 ) {
     
         close(mFd);
@@ -114,15 +328,21 @@ static const int readBufferSize = 4096;
 
 -(bool) taskFeed : (void*) data length : (int) len
 {
-    if( write( mFd, data, len*sizeof(short) ) == -1 ) {
+    bool rtnVal = [ self writeChunk : (const short*) data length : len ];
 
-        free( data );
-        return false;
-    }
-    
     free( data );
 
-    return true;
+    return rtnVal;
+}
+
+
+-(bool) writeChunk : (const short*) samples length : (int) len
+{
+    if ( mGate != NULL ) {
+        return feedSilenceGate( mGate, samples, len ) == 0;
+    }
+
+    return [ self writeSamples : samples length : len ];
 }
 
 
@@ -257,6 +477,14 @@ struct RIFF {
 }
 
 
+-(bool) writeSamples : (const short*) samples length : (int) len
+{
+    return [ self writeCompleteFd : mFd
+                             data : (char*) samples
+                           length : len * (int) sizeof(short) ];
+}
+
+
 -(bool) writeCompleteFd : (int) fd data : (char*) data length : (int) len
 {
     long bytesWritten = 0;
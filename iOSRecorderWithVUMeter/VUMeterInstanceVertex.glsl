@@ -0,0 +1,35 @@
+attribute vec3 Position;    // xy on the base in pixels, z: 0 base, 1 hand, 2 LED
+attribute vec2 TexCoordIn;
+attribute vec4 Instance;    // xy cell origin, z hand angle, w 1 if LED lit
+uniform   vec2 CellSize;    // of the surface
+uniform   vec2 BaseSize;    // in pixels
+uniform   vec2 HandCenter;  // on the base in pixels
+varying   vec2 TexCoordOut;
+
+void main (void) {
+
+    vec2 p = Position.xy;
+
+    if ( Position.z > 0.5 && Position.z < 1.5 ) {
+
+        // The hand lies along x from the center, rotated by the angle.
+        float c = cos( Instance.z );
+        float s = sin( Instance.z );
+
+        p = HandCenter + vec2( c * p.x - s * p.y, -( s * p.x + c * p.y ) );
+    }
+
+    vec2 unit = vec2( p.x / BaseSize.x, 1.0 - p.y / BaseSize.y );
+
+    gl_Position = vec4( ( Instance.xy + unit * CellSize ) * 2.0 - 1.0,
+                        0.0,
+                        1.0                                            );
+
+    // An LED off is clipped away.
+    if ( Position.z > 1.5 && Instance.w < 0.5 ) {
+
+        gl_Position = vec4( 2.0, 2.0, 2.0, 1.0 );
+    }
+
+    TexCoordOut = TexCoordIn;
+}
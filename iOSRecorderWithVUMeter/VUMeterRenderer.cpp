@@ -0,0 +1,642 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "VUMeterRenderer.hpp"
+
+// Points in pixels in VU_Meter_Texture.png, as the former VUMeterViewGL.
+// Y's positive direction is downward.
+static const float TextureWidth             = 512.0f;
+static const float TextureHeight            = 512.0f;
+
+static const float BaseWidth                = 512.0f;
+static const float BaseHeight               = 300.0f;
+
+static const float HandTopLeftX             =   8.0f;
+static const float HandTopLeftY             = 313.0f;
+static const float HandBottomRightX         = 187.0f;
+static const float HandBottomRightY         = 316.0f;
+static const float HandRotatingCenterX      = 251.0f;
+static const float HandRotatingCenterY      = 288.0f;
+static const float HandBottomUprightOnBaseY = 240.0f;
+
+static const float LEDTopLeftOnBaseX        = 414.0f;
+static const float LEDTopLeftOnBaseY        = 116.0f;
+static const float LEDTopLeftX              = 198.0f;
+static const float LEDTopLeftY              = 304.0f;
+static const float LEDBottomRightX          = 231.0f;
+static const float LEDBottomRightY          = 339.0f;
+
+// The tip of the hand may be off by this much at most.
+static const float ResolutionPixels         = 0.25f;
+
+// The parts in the shader.
+static const float PartBase                 = 0.0f;
+static const float PartHand                 = 1.0f;
+static const float PartLED                  = 2.0f;
+
+static const int   VerticesPerQuad          = 4;
+static const int   IndicesPerQuad           = 6;
+static const int   VerticesPerMeter         = 3 * VerticesPerQuad;
+static const int   IndicesPerMeter          = 3 * IndicesPerQuad;
+
+
+// Two triangles of the quad from the vertex first.
+static void make_quad_indices( GLushort* indices, int first )
+{
+    indices[0] = first;
+    indices[1] = first + 1;
+    indices[2] = first + 2;
+    indices[3] = first + 2;
+    indices[4] = first + 3;
+    indices[5] = first;
+}
+
+
+// A quad of the part from the corners x and y, with the texture from the
+// corners u and v.
+static void make_quad(
+    void*        vertices,
+    float        part,
+    const float* x,
+    const float* y,
+    const float* u,
+    const float* v
+) {
+    float* p = (float*) vertices;
+
+    for ( int i = 0; i < VerticesPerQuad; i++ ) {
+
+        p[0] = x[i];
+        p[1] = y[i];
+        p[2] = part;
+        p[3] = u[i] / TextureWidth;
+        p[4] = v[i] / TextureHeight;
+        p   += 5;
+    }
+}
+
+
+VUMeterRenderer::VUMeterRenderer( int maxMeters )
+{
+    mState            = STATE_ERR;
+    mMaxMeters        = maxMeters;
+    mNumMeters        = 1;
+    mWidth            = 0;
+    mHeight           = 0;
+    mLayoutDirty      = true;
+    mProgram          = 0;
+    mVertexBuffer     = 0;
+    mInstanceBuffer   = 0;
+    mIndexBuffer      = 0;
+    mTexture          = 0;
+    mPositionSlot     = -1;
+    mTexCoordSlot     = -1;
+    mInstanceSlot     = -1;
+    mTextureUniform   = -1;
+    mCellSizeUniform  = -1;
+    mInstances        = NULL;
+    mThetas           = NULL;
+    mOverloads        = NULL;
+    mDrawnThetas      = NULL;
+    mDrawnOverloads   = NULL;
+    mThetaResolution  = 0.0f;
+    mInfoLog[0]       = '\0';
+
+    resetStats();
+
+    // The indices are 16 bits.
+    if ( maxMeters <= 0 || maxMeters * VerticesPerMeter > 65536 ) {
+        return;
+    }
+
+    mInstances      = (Instance*) calloc ( VerticesPerMeter * maxMeters,
+                                           sizeof(Instance)             );
+
+    mThetas         = (float*) malloc ( sizeof(float) * maxMeters );
+    mOverloads      = (bool*)  malloc ( sizeof(bool)  * maxMeters );
+    mDrawnThetas    = (float*) malloc ( sizeof(float) * maxMeters );
+    mDrawnOverloads = (bool*)  malloc ( sizeof(bool)  * maxMeters );
+
+    if (    mInstances   == NULL || mThetas         == NULL
+         || mOverloads   == NULL || mDrawnThetas    == NULL
+         || mDrawnOverloads == NULL                          ) {
+        return;
+    }
+
+    for ( int m = 0; m < maxMeters; m++ ) {
+
+        mThetas        [m] = (float) M_PI * 0.75f;
+        mOverloads     [m] = false;
+        mDrawnThetas   [m] = mThetas[m];
+        mDrawnOverloads[m] = false;
+    }
+
+    mState = STATE_INIT;
+}
+
+
+VUMeterRenderer::~VUMeterRenderer()
+{
+    if ( mProgram != 0 ) {
+        glDeleteProgram( mProgram );
+    }
+
+    if ( mVertexBuffer != 0 ) {
+        glDeleteBuffers( 1, &mVertexBuffer );
+    }
+
+    if ( mInstanceBuffer != 0 ) {
+        glDeleteBuffers( 1, &mInstanceBuffer );
+    }
+
+    if ( mIndexBuffer != 0 ) {
+        glDeleteBuffers( 1, &mIndexBuffer );
+    }
+
+    free( mInstances      );
+    free( mThetas         );
+    free( mOverloads      );
+    free( mDrawnThetas    );
+    free( mDrawnOverloads );
+}
+
+
+GLuint VUMeterRenderer::compileShader( const char* source, GLenum type )
+{
+    GLuint shader = glCreateShader( type );
+
+    glShaderSource ( shader, 1, &source, NULL );
+    glCompileShader( shader );
+
+    GLint success;
+
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &success );
+
+    if ( success == GL_FALSE ) {
+
+        glGetShaderInfoLog( shader, sizeof(mInfoLog), NULL, mInfoLog );
+        glDeleteShader( shader );
+
+        return 0;
+    }
+
+    return shader;
+}
+
+
+int VUMeterRenderer::open(
+    const char* vertexShader,
+    const char* fragmentShader,
+    GLuint      texture
+) {
+    if ( mState != STATE_INIT ) {
+        return ERR_STATE;
+    }
+
+    if ( vertexShader == NULL || fragmentShader == NULL ) {
+        return ERR_PARAM;
+    }
+
+    GLuint vertex   = compileShader( vertexShader,   GL_VERTEX_SHADER   );
+    GLuint fragment = compileShader( fragmentShader, GL_FRAGMENT_SHADER );
+
+    if ( vertex == 0 || fragment == 0 ) {
+
+        glDeleteShader( vertex   );
+        glDeleteShader( fragment );
+
+        return ERR_GL;
+    }
+
+    mProgram = glCreateProgram();
+
+    glAttachShader( mProgram, vertex   );
+    glAttachShader( mProgram, fragment );
+    glLinkProgram ( mProgram );
+
+    // Freed with the program.
+    glDeleteShader( vertex   );
+    glDeleteShader( fragment );
+
+    GLint success;
+
+    glGetProgramiv( mProgram, GL_LINK_STATUS, &success );
+
+    if ( success == GL_FALSE ) {
+
+        glGetProgramInfoLog( mProgram, sizeof(mInfoLog), NULL, mInfoLog );
+
+        return ERR_GL;
+    }
+
+    mPositionSlot    = glGetAttribLocation ( mProgram, "Position"   );
+    mTexCoordSlot    = glGetAttribLocation ( mProgram, "TexCoordIn" );
+    mInstanceSlot    = glGetAttribLocation ( mProgram, "Instance"   );
+    mTextureUniform  = glGetUniformLocation( mProgram, "Texture"    );
+    mCellSizeUniform = glGetUniformLocation( mProgram, "CellSize"   );
+    mTexture         = texture;
+
+    if ( mPositionSlot < 0 || mTexCoordSlot < 0 || mInstanceSlot < 0 ) {
+
+        strncpy( mInfoLog, "no attribute Position, TexCoordIn or Instance",
+                 sizeof(mInfoLog) - 1                                      );
+        return ERR_GL;
+    }
+
+    int       numVertices = VerticesPerMeter * mMaxMeters;
+    int       numIndices  = IndicesPerMeter  * mMaxMeters;
+    Vertex*   vertices    = (Vertex*)   malloc ( sizeof(Vertex)
+                                                 * numVertices    );
+    GLushort* indices     = (GLushort*) malloc ( sizeof(GLushort)
+                                                 * numIndices     );
+
+    if ( vertices == NULL || indices == NULL ) {
+
+        free( vertices );
+        free( indices  );
+
+        return ERR_MEMORY;
+    }
+
+    // The same quads for every meter, in the order of drawing.
+    for ( int m = 0; m < mMaxMeters; m++ ) {
+
+        makeVertices( &vertices[ VerticesPerMeter * m ] );
+
+        for ( int q = 0; q < 3; q++ ) {
+
+            make_quad_indices(
+                &indices[ IndicesPerMeter * m + IndicesPerQuad * q ],
+                VerticesPerMeter * m + VerticesPerQuad * q           );
+        }
+    }
+
+    glGenBuffers( 1, &mVertexBuffer   );
+    glGenBuffers( 1, &mInstanceBuffer );
+    glGenBuffers( 1, &mIndexBuffer    );
+
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER,
+                  sizeof(GLushort) * numIndices,
+                  indices,
+                  GL_STATIC_DRAW                  );
+
+    glBindBuffer( GL_ARRAY_BUFFER, mVertexBuffer );
+    glBufferData( GL_ARRAY_BUFFER,
+                  sizeof(Vertex) * numVertices,
+                  vertices,
+                  GL_STATIC_DRAW                 );
+
+    // Rewritten in place for the meters changed.
+    glBindBuffer( GL_ARRAY_BUFFER, mInstanceBuffer );
+    glBufferData( GL_ARRAY_BUFFER,
+                  sizeof(Instance) * numVertices,
+                  mInstances,
+                  GL_DYNAMIC_DRAW                  );
+
+    mStats.mUploads     += 3;
+    mStats.mUploadBytes += sizeof(GLushort) * numIndices
+                           + ( sizeof(Vertex) + sizeof(Instance) )
+                             * numVertices;
+    free( vertices );
+    free( indices  );
+
+    bindState();
+
+    if ( glGetError() != GL_NO_ERROR ) {
+
+        strncpy( mInfoLog, "failed to set up the buffers",
+                 sizeof(mInfoLog) - 1                      );
+        return ERR_GL;
+    }
+
+    mState       = STATE_OPENED;
+    mLayoutDirty = true;
+
+    return OK;
+}
+
+
+// Set once, as nothing else draws in the context. The instance buffer
+// stays bound to GL_ARRAY_BUFFER for the uploads.
+void VUMeterRenderer::bindState()
+{
+    glUseProgram( mProgram );
+
+    glEnableVertexAttribArray( mPositionSlot );
+    glEnableVertexAttribArray( mTexCoordSlot );
+    glEnableVertexAttribArray( mInstanceSlot );
+
+    glBindBuffer( GL_ARRAY_BUFFER, mVertexBuffer );
+
+    glVertexAttribPointer( mPositionSlot,
+                           3,
+                           GL_FLOAT,
+                           GL_FALSE,
+                           sizeof(Vertex),
+                           (GLvoid*) offsetof( Vertex, mPosition ) );
+
+    glVertexAttribPointer( mTexCoordSlot,
+                           2,
+                           GL_FLOAT,
+                           GL_FALSE,
+                           sizeof(Vertex),
+                           (GLvoid*) offsetof( Vertex, mTexCoord ) );
+
+    glBindBuffer( GL_ARRAY_BUFFER, mInstanceBuffer );
+
+    glVertexAttribPointer( mInstanceSlot,
+                           4,
+                           GL_FLOAT,
+                           GL_FALSE,
+                           sizeof(Instance),
+                           (GLvoid*) 0       );
+
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer );
+
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture  ( GL_TEXTURE_2D, mTexture );
+    glUniform1i    ( mTextureUniform, 0 );
+
+    glUniform2f( glGetUniformLocation( mProgram, "BaseSize" ),
+                 BaseWidth, BaseHeight                         );
+
+    glUniform2f( glGetUniformLocation( mProgram, "HandCenter" ),
+                 HandRotatingCenterX, HandRotatingCenterY        );
+
+    glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+    glEnable    ( GL_BLEND );
+    glDepthMask ( GL_FALSE );
+    glBlendFunc ( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+    mStats.mStateChanges += 20;
+}
+
+
+int VUMeterRenderer::setSurface( int width, int height )
+{
+    if ( mState == STATE_ERR ) {
+        return ERR_STATE;
+    }
+
+    if ( width <= 0 || height <= 0 ) {
+        return ERR_PARAM;
+    }
+
+    if ( width != mWidth || height != mHeight ) {
+
+        mWidth       = width;
+        mHeight      = height;
+        mLayoutDirty = true;
+    }
+
+    return OK;
+}
+
+
+int VUMeterRenderer::setNumMeters( int numMeters )
+{
+    if ( mState == STATE_ERR ) {
+        return ERR_STATE;
+    }
+
+    if ( numMeters < 1 || numMeters > mMaxMeters ) {
+        return ERR_PARAM;
+    }
+
+    if ( numMeters != mNumMeters ) {
+
+        mNumMeters   = numMeters;
+        mLayoutDirty = true;
+    }
+
+    return OK;
+}
+
+
+int VUMeterRenderer::setMeter( int meter, float theta, bool overload )
+{
+    if ( mState == STATE_ERR ) {
+        return ERR_STATE;
+    }
+
+    if ( meter < 0 || meter >= mMaxMeters ) {
+        return ERR_PARAM;
+    }
+
+    mThetas   [meter] = theta;
+    mOverloads[meter] = overload;
+
+    return OK;
+}
+
+
+void VUMeterRenderer::resetStats()
+{
+    memset( &mStats, 0, sizeof(mStats) );
+}
+
+
+// The base, the hand and the LED of a meter. The hand lies along x from
+// its center, with y across it, to be rotated in the shader.
+void VUMeterRenderer::makeVertices( Vertex* vertices )
+{
+    float radiusShort   = HandRotatingCenterY - HandBottomUprightOnBaseY;
+    float radiusLong    = radiusShort + HandBottomRightX - HandTopLeftX;
+    float handHalfWidth = ( HandBottomRightY - HandTopLeftY ) * 0.5f;
+    float ledWidth      = LEDBottomRightX - LEDTopLeftX;
+    float ledHeight     = LEDBottomRightY - LEDTopLeftY;
+
+    float baseX[4] = { BaseWidth, BaseWidth, 0.0f, 0.0f };
+    float baseY[4] = { BaseHeight, 0.0f, 0.0f, BaseHeight };
+    float baseU[4] = { BaseWidth, BaseWidth, 0.0f, 0.0f };
+    float baseV[4] = { BaseHeight, 0.0f, 0.0f, BaseHeight };
+
+    float handX[4] = { radiusLong,     radiusLong,
+                       radiusShort,    radiusShort    };
+    float handY[4] = { handHalfWidth, -handHalfWidth,
+                      -handHalfWidth,  handHalfWidth  };
+    float handU[4] = { HandBottomRightX, HandBottomRightX,
+                       HandTopLeftX,     HandTopLeftX     };
+    float handV[4] = { HandBottomRightY, HandTopLeftY,
+                       HandTopLeftY,     HandBottomRightY };
+
+    float ledX [4] = { LEDTopLeftOnBaseX + ledWidth,
+                       LEDTopLeftOnBaseX + ledWidth,
+                       LEDTopLeftOnBaseX,
+                       LEDTopLeftOnBaseX             };
+    float ledY [4] = { LEDTopLeftOnBaseY + ledHeight,
+                       LEDTopLeftOnBaseY,
+                       LEDTopLeftOnBaseY,
+                       LEDTopLeftOnBaseY + ledHeight };
+    float ledU [4] = { LEDBottomRightX, LEDBottomRightX,
+                       LEDTopLeftX,     LEDTopLeftX     };
+    float ledV [4] = { LEDBottomRightY, LEDTopLeftY,
+                       LEDTopLeftY,     LEDBottomRightY };
+
+    make_quad( &vertices[ 0               ], PartBase,
+               baseX, baseY, baseU, baseV              );
+    make_quad( &vertices[ VerticesPerQuad ], PartHand,
+               handX, handY, handU, handV              );
+    make_quad( &vertices[ VerticesPerQuad * 2 ], PartLED,
+               ledX, ledY, ledU, ledV                     );
+}
+
+
+// The meters are laid out in a grid of cells, each of which is the whole
+// surface scaled down, so that the meters keep the aspect ratio.
+void VUMeterRenderer::layOut()
+{
+    int   rows    = (int) ceil( sqrt( (double) mNumMeters ) );
+    int   cols    = ( mNumMeters + rows - 1 ) / rows;
+    float scale   = 1.0f / ( ( rows > cols ) ? rows : cols );
+    float marginX = ( 1.0f - scale * cols ) * 0.5f;
+    float marginY = ( 1.0f - scale * rows ) * 0.5f;
+
+    for ( int m = 0; m < mNumMeters; m++ ) {
+
+        Instance* instance = &mInstances[ VerticesPerMeter * m ];
+
+        // From the top left, in rows.
+        float x = marginX + scale * ( m % cols );
+        float y = marginY + scale * ( rows - 1 - m / cols );
+
+        for ( int i = 0; i < VerticesPerMeter; i++ ) {
+
+            instance[i].mCell[0] = x;
+            instance[i].mCell[1] = y;
+        }
+    }
+
+    glUniform2f( mCellSizeUniform, scale, scale );
+    glViewport ( 0, 0, mWidth, mHeight );
+
+    mStats.mStateChanges += 2;
+
+    float pixelsPerUnit = fminf( mWidth  * scale / BaseWidth,
+                                 mHeight * scale / BaseHeight );
+    float radiusLong    = HandRotatingCenterY - HandBottomUprightOnBaseY
+                          + HandBottomRightX - HandTopLeftX;
+
+    mThetaResolution = ResolutionPixels / ( radiusLong * pixelsPerUnit );
+}
+
+
+// The attributes of the meters changed, in one glBufferSubData() over the
+// range of them. All of them after a change of the layout.
+void VUMeterRenderer::uploadInstances()
+{
+    int first = mLayoutDirty ? 0 : -1;
+    int last  = mLayoutDirty ? mNumMeters - 1 : -1;
+
+    for ( int m = 0; m < mNumMeters; m++ ) {
+
+        bool moved =
+            fabsf( mThetas[m] - mDrawnThetas[m] ) >= mThetaResolution;
+
+        if ( !moved && mOverloads[m] == mDrawnOverloads[m] && !mLayoutDirty ) {
+            continue;
+        }
+
+        if ( moved || mLayoutDirty ) {
+            mDrawnThetas[m] = mThetas[m];
+        }
+
+        mDrawnOverloads[m] = mOverloads[m];
+
+        Instance* instance = &mInstances[ VerticesPerMeter * m ];
+
+        for ( int i = 0; i < VerticesPerMeter; i++ ) {
+
+            instance[i].mTheta    = mDrawnThetas[m];
+            instance[i].mOverload = mDrawnOverloads[m] ? 1.0f : 0.0f;
+        }
+
+        first = ( first < 0 ) ? m : first;
+        last  = m;
+    }
+
+    if ( first < 0 ) {
+        return;
+    }
+
+    int offset = VerticesPerMeter * first;
+    int count  = VerticesPerMeter * ( last - first + 1 );
+
+    glBufferSubData( GL_ARRAY_BUFFER,
+                     sizeof(Instance) * offset,
+                     sizeof(Instance) * count,
+                     &mInstances[ offset ]       );
+
+    mStats.mUploads     += 1;
+    mStats.mUploadBytes += sizeof(Instance) * count;
+}
+
+
+bool VUMeterRenderer::render()
+{
+    if ( mState != STATE_OPENED || mWidth <= 0 || mHeight <= 0 ) {
+        return false;
+    }
+
+    if ( mLayoutDirty ) {
+        layOut();
+    }
+
+    bool dirty = mLayoutDirty;
+
+    for ( int m = 0; m < mNumMeters && !dirty; m++ ) {
+
+        dirty =    fabsf( mThetas[m] - mDrawnThetas[m] ) >= mThetaResolution
+                || mOverloads[m] != mDrawnOverloads[m];
+    }
+
+    if ( !dirty ) {
+
+        mStats.mFramesSkipped++;
+        return false;
+    }
+
+    uploadInstances();
+
+    // The whole surface is drawn, as the previous frame may be gone after
+    // being presented.
+    glClear( GL_COLOR_BUFFER_BIT );
+
+    glDrawElements( GL_TRIANGLES,
+                    IndicesPerMeter * mNumMeters,
+                    GL_UNSIGNED_SHORT,
+                    (GLvoid*) 0                  );
+
+    mStats.mDrawCalls++;
+
+    mLayoutDirty = false;
+
+    mStats.mFramesDrawn++;
+
+    return true;
+}
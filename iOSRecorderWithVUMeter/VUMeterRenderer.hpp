@@ -0,0 +1,166 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Drawing of the VU meters in OpenGL ES 2.0, without any view.
+//
+// All the meters are drawn in one draw call from the same texture, however
+// many they are. The quads of a meter are static, and its hand is rotated
+// in VUMeterInstanceVertex.glsl by the attribute of the meter, which holds
+// the origin of its cell, the angle of the hand and the LED. OpenGL ES 2.0
+// has no divisor of the attributes, so the attribute of a meter is repeated
+// on its 12 vertices.
+//
+// The quads, the indices, the texture and the GL state are uploaded and set
+// once. A frame only uploads the attributes of the meters that have changed
+// by glBufferSubData(). If no hand has moved by a quarter of a pixel at its
+// tip, and no LED has changed, the frame is not drawn at all, and render()
+// tells the caller not to present it.
+//
+// The GL context must be current on the calling thread for all the calls,
+// including the destructor.
+//
+
+
+#ifndef _VU_METER_RENDERER_HPP_
+#define _VU_METER_RENDERER_HPP_
+
+#include <stdint.h>
+#ifdef __APPLE__
+#include <OpenGLES/ES2/gl.h>
+#else
+#include <GLES2/gl2.h>
+#endif
+
+class VUMeterRenderer {
+
+public:
+
+    // Counted from the construction or the last resetStats().
+    struct Stats {
+        int64_t mFramesDrawn;
+        int64_t mFramesSkipped;
+        int64_t mUploads;        // glBufferData() and glBufferSubData()
+        int64_t mUploadBytes;
+        int64_t mDrawCalls;      // glDrawElements()
+        int64_t mStateChanges;   // glViewport(), glUseProgram(), etc.
+    };
+
+private:
+
+    struct Vertex {
+        float mPosition [3];     // on the base in pixels, and the part
+        float mTexCoord [2];
+    };
+
+    struct Instance {
+        float mCell     [2];     // origin of the cell of the meter
+        float mTheta;
+        float mOverload;
+    };
+
+    int     mState;
+    int     mMaxMeters;
+    int     mNumMeters;
+    int     mWidth;              // of the surface in pixels
+    int     mHeight;
+    bool    mLayoutDirty;        // all the meters to be drawn
+
+    GLuint  mProgram;
+    GLuint  mVertexBuffer;
+    GLuint  mInstanceBuffer;
+    GLuint  mIndexBuffer;
+    GLuint  mTexture;
+    GLint   mPositionSlot;
+    GLint   mTexCoordSlot;
+    GLint   mInstanceSlot;
+    GLint   mTextureUniform;
+    GLint   mCellSizeUniform;
+
+    // [ base 4 ][ hand 4 ][ LED 4 ] of each meter.
+    Instance* mInstances;
+
+    float*  mThetas;             // set by the caller
+    bool*   mOverloads;
+    float*  mDrawnThetas;        // in the vertex buffer
+    bool*   mDrawnOverloads;
+    float   mThetaResolution;    // smallest change to be drawn [rad]
+
+    char    mInfoLog [ 512 ];
+    Stats   mStats;
+
+    static const int STATE_ERR    = -1;
+    static const int STATE_INIT   =  0;
+    static const int STATE_OPENED =  1;
+
+    GLuint  compileShader      ( const char* source, GLenum type );
+    void    makeVertices       ( Vertex* vertices );
+    void    bindState          ();
+    void    layOut             ();
+    void    uploadInstances    ();
+
+public:
+
+    static const int OK         =  0;
+    static const int ERR_STATE  = -1;
+    static const int ERR_PARAM  = -2;
+    static const int ERR_MEMORY = -3;
+    static const int ERR_GL     = -4;
+
+    VUMeterRenderer( int maxMeters );
+
+    ~VUMeterRenderer();
+
+    // Compiles the shaders, and uploads the static vertices and the indices.
+    // The vertex shader is VUMeterInstanceVertex.glsl.
+    // The texture is VU_Meter_Texture.png, owned by the caller.
+    // On ERR_GL, infoLog() tells why.
+    int         open          ( const char* vertexShader,
+                                const char* fragmentShader,
+                                GLuint      texture         );
+
+    // The size of the framebuffer in pixels. On a change, all the meters
+    // are redrawn, as on a change of the number of the meters.
+    int         setSurface    ( int width, int height );
+
+    int         setNumMeters  ( int numMeters );
+
+    // The angle of the hand in radians, from 3/4 pi at the left end to
+    // 1/4 pi at the right, and whether the LED is lit.
+    int         setMeter      ( int meter, float theta, bool overload );
+
+    // Draws the frame if anything has changed since the last frame drawn.
+    // Returns true if drawn, and the caller has to present it.
+    bool        render        ();
+
+    // The next render() draws the frame even if nothing has changed,
+    // e.g., after the framebuffer has been lost.
+    void        invalidate    () { mLayoutDirty = true; }
+
+    const char* infoLog       () const { return mInfoLog; }
+
+    const Stats& stats        () const { return mStats; }
+
+    void        resetStats    ();
+
+};
+
+#endif /*_VU_METER_RENDERER_HPP_*/
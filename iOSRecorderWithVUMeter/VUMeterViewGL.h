@@ -34,9 +34,31 @@
 #include <OpenGLES/ES2/gl.h>
 #include <OpenGLES/ES2/glext.h>
 
+// Meters side by side in one view, e.g., one per input channel.
+#define VU_METER_MAX_METERS 8
+
+// How the needles move. See MeterBallistics.hpp.
+enum _vuMeterBallistics {
+
+    VU_METER_BALLISTICS_VU        = 0, // RMS, the classic needle (default)
+    VU_METER_BALLISTICS_PPM       = 1, // quasi-peak programme meter
+    VU_METER_BALLISTICS_PEAK_HOLD = 2  // instant peak with a slow fall
+};
+
 @interface VUMeterViewGL : UIView {}
 
+-(void)setNumberOfMeters : (int)numMeters;
 -(void)setRMS : (unsigned short)rms andAbsMax : (unsigned short)absMax;
+-(void)setRMS : (unsigned short)rms
+    andAbsMax : (unsigned short)absMax
+      ofMeter : (int)meter;
+// The LED of the meter lights for a while after a block with a clipped
+// sample. Without the count, a peak near full scale lights it.
+-(void)setRMS : (unsigned short)rms
+    andAbsMax : (unsigned short)absMax
+   numClipped : (int)numClipped
+      ofMeter : (int)meter;
+-(void)setBallistics : (int)ballistics;
 -(void)reset;
 -(void)activate;
 -(void)deactivate;
@@ -0,0 +1,513 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Dependencies:
+// The image of VU Meter taken from the following:
+// https://en.wikipedia.org/wiki/VU_meter#/media/File:VU_Meter.jpg
+// Iainf 05:15, 12 August 2006 (UTC) - Own work CC BY 2.5
+//
+
+#import <Foundation/Foundation.h>
+#import "VUMeterViewGL.h"
+#include "MeterBallistics.hpp"
+#include "VUMeterRenderer.hpp"
+
+@implementation VUMeterViewGL {
+
+    EAGLContext*   mGLContext;
+    CAEAGLLayer*   mEaglLayer;
+    CADisplayLink* mDisplayLink;
+    GLuint         mTexture;
+
+    GLuint         mColorRenderBuffer;
+    GLuint         mFramebuffer;
+
+    VUMeterRenderer* mRenderer;
+
+    int            mNumMeters;
+
+    float          mTheta    [ VU_METER_MAX_METERS ];
+    double         mPrevTime;
+
+    MeterBallistics* mBallistics;
+    int              mBallisticsMode;
+    
+    unsigned short mRMS      [ VU_METER_MAX_METERS ];
+    unsigned short mAbsMax   [ VU_METER_MAX_METERS ];
+    double         mClipTime [ VU_METER_MAX_METERS ]; // 0: never clipped
+    
+    BOOL           mIsActive;
+}
+
+
+/////////////////////////////////////////////
+//                                         //
+//        VU METER MOVEMENT SECTION        //
+//                                         //
+/////////////////////////////////////////////
+
+
+static const float HandAngularLimitLeft     = M_PI * 3.0/4.0;
+static const float HandAngularLimitRight    = M_PI * 1.0/4.0;
+
+// The needles are integrated at 480Hz whatever the refresh rate is.
+static const float BallisticsStepSeconds    = 1.0 / 480.0;
+static const float AmplitudeRef             = SHRT_MAX / 1.4142135623;
+//static const float DynamicRangeFloorDB      = -96.0;
+
+// Following three parameters depend on the microphone and the amplifier.
+static const short OverloadThreshold        = SHRT_MAX - 500;
+static const float MicGainCalibFloorDB      = -55.0;
+static const float MicGainCalibPeakDB       =  -0.0;
+
+// The LED stays lit this long after the last block with a clipped sample.
+static const double ClipHoldSeconds         = 1.0;
+
+
+-(void) resetPhysics
+{
+    mBallistics->reset();
+
+    for ( int m = 0; m < VU_METER_MAX_METERS; m++ ) {
+
+        mTheta[m]    = HandAngularLimitLeft;
+        mClipTime[m] = 0.0;
+    }
+
+    mPrevTime = 0.0;
+}
+
+
+-(void) updatePhysics
+{
+    double currentTime = CACurrentMediaTime();
+    double dt;
+
+    if ( mPrevTime == 0.0 ) {
+
+        dt = 0.01;
+    }
+    else{
+
+        dt = currentTime - mPrevTime;
+    }
+
+    mPrevTime = currentTime;
+
+    if ( mBallistics->advance( dt ) < 0 ) {
+        return;
+    }
+
+    // The positions are in [0, 1] from the floor to the peak of the scale.
+
+    const float* positions = mBallistics->positions();
+
+    for ( int m = 0; m < mNumMeters; m++ ) {
+
+        mTheta[m] = HandAngularLimitLeft
+                    + ( HandAngularLimitRight - HandAngularLimitLeft )
+                        * positions[m];
+    }
+}
+
+
+/////////////////////////////////////////////
+//                                         //
+//              OPEN GL SECTION            //
+//                                         //
+/////////////////////////////////////////////
+
+
+
+-(void) prepareRenderer
+{
+    NSString* vertexShader   = [ self loadShader : @"VUMeterInstanceVertex" ];
+    NSString* fragmentShader = [ self loadShader : @"PassThruFragment"      ];
+
+    mRenderer = new VUMeterRenderer( VU_METER_MAX_METERS );
+
+    int rtn = mRenderer->open( [ vertexShader   UTF8String ],
+                               [ fragmentShader UTF8String ],
+                               mTexture                      );
+
+    if ( rtn != VUMeterRenderer::OK ) {
+
+        NSLog(@"Failed to set up the VU meter renderer: %s",
+              mRenderer->infoLog()                          );
+        exit(1);
+    }
+}
+
+
+-(NSString*) loadShader : (NSString*) shaderName
+{
+    NSString* shaderPath =
+        [ [NSBundle mainBundle] pathForResource:shaderName ofType : @"glsl" ];
+    
+    NSError* error;
+    NSString* shaderString =
+        [ NSString stringWithContentsOfFile : shaderPath
+                                   encoding : NSUTF8StringEncoding
+                                      error : &error                ];
+    if ( !shaderString ) {
+
+        NSLog(@"Error loading shader: %@", error.localizedDescription);
+        exit(1);
+
+    }
+    
+    return shaderString;
+}
+
+
+-(GLuint) setupTexture : (NSString*) fileName
+{
+    CGImageRef spriteImage = [ UIImage imageNamed : fileName ].CGImage;
+
+    if ( !spriteImage ) {
+
+        NSLog(@"Failed to load image %@", fileName);
+        exit(1);
+
+    }
+    
+    size_t width  = CGImageGetWidth (spriteImage);
+    size_t height = CGImageGetHeight(spriteImage);
+    
+    GLubyte * spriteData =
+               (GLubyte *) calloc( width * height * 4, sizeof(GLubyte) );
+    
+    CGContextRef spriteContext = CGBitmapContextCreate (
+                                    spriteData,
+                                    width,
+                                    height,
+                                    8,
+                                    width * 4,
+                                    CGImageGetColorSpace(spriteImage),
+                                    (CGBitmapInfo)
+                                        kCGImageAlphaPremultipliedLast
+                                );
+    
+    CGContextDrawImage( spriteContext,
+                        CGRectMake( 0, 0, width, height ),
+                        spriteImage                       );
+    
+    CGContextRelease( spriteContext );
+    
+    GLuint texName;
+    glGenTextures( 1, &texName );
+    glBindTexture( GL_TEXTURE_2D, texName );
+    
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    
+    glTexImage2D( GL_TEXTURE_2D,
+                  0,
+                  GL_RGBA,
+                  (int)width,
+                  (int)height,
+                  0,
+                  GL_RGBA,
+                  GL_UNSIGNED_BYTE,
+                  spriteData        );
+    
+    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_REPEAT  );
+    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_REPEAT  );
+    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    
+    free(spriteData);
+    
+    return texName;
+}
+
+
+-(void) setupOpenGL
+{
+    glGenRenderbuffers  ( 1, &mColorRenderBuffer );
+    glGenFramebuffers   ( 1, &mFramebuffer       );
+
+    mEaglLayer = (CAEAGLLayer*) self.layer;
+    mEaglLayer.opaque = YES;
+    self.contentScaleFactor = [ [UIScreen mainScreen] nativeScale ];
+
+    glBindRenderbuffer( GL_RENDERBUFFER, mColorRenderBuffer );
+
+    [ mGLContext renderbufferStorage : GL_RENDERBUFFER
+                        fromDrawable : mEaglLayer       ];
+
+    glBindFramebuffer( GL_FRAMEBUFFER, mFramebuffer );
+
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER,
+                               GL_COLOR_ATTACHMENT0,
+                               GL_RENDERBUFFER,
+                               mColorRenderBuffer    );
+}
+
+
+- (void)render : (CADisplayLink*) displayLink {
+    
+    if( !mIsActive ) {
+        return;
+    }
+    
+    [ self updatePhysics ];
+
+    mRenderer->setSurface( self.frame.size.width  * self.contentScaleFactor,
+                           self.frame.size.height * self.contentScaleFactor );
+
+    mRenderer->setNumMeters( mNumMeters );
+
+    double currentTime = CACurrentMediaTime();
+
+    for ( int m = 0; m < mNumMeters; m++ ) {
+
+        bool lit =    mClipTime[m] > 0.0
+                   && currentTime - mClipTime[m] < ClipHoldSeconds;
+
+        mRenderer->setMeter( m, mTheta[m], lit );
+    }
+
+    // Nothing is drawn nor presented while the hands stay still.
+    if ( mRenderer->render() ) {
+
+        [ mGLContext presentRenderbuffer : GL_RENDERBUFFER ];
+    }
+}
+
+
+/////////////////////////////////////////////
+//                                         //
+//         UIVIEW RELATED SECTION          //
+//                                         //
+/////////////////////////////////////////////
+
+
++ (Class)layerClass {
+
+    return [ CAEAGLLayer class ];
+
+}
+
+
+-(id)initWithCoder:(NSCoder *)aDecoder
+{
+    self = [ super initWithCoder : aDecoder ];
+
+    if (self) {
+        
+        mGLContext = NULL;
+        mGLContext =
+             [ [EAGLContext alloc] initWithAPI : kEAGLRenderingAPIOpenGLES2 ];
+        
+        if ( !mGLContext ) {
+
+            NSLog(@"Failed to initialize OpenGLES 2.0 context");
+            exit(1);
+        }
+        
+        if ( ![ EAGLContext setCurrentContext : mGLContext ] ) {
+
+            NSLog(@"Failed to set current OpenGL context");
+            exit(1);
+        }
+        
+        mTexture = [ self setupTexture : @"VU_Meter_Texture.png" ];
+
+        [ self prepareRenderer ];
+
+        [ self setupOpenGL ];
+        
+        mBallisticsMode = VU_METER_BALLISTICS_VU;
+        mBallistics     = new MeterBallistics( VU_METER_MAX_METERS,
+                                               MeterBallistics::MODE_VU,
+                                               BallisticsStepSeconds     );
+        mBallistics->setScale( AmplitudeRef,
+                               MicGainCalibFloorDB,
+                               MicGainCalibPeakDB   );
+
+        [ self resetPhysics ];
+
+        mNumMeters = 1;
+        mIsActive  = FALSE;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    delete mBallistics;
+
+    // The GL objects of the renderer are deleted in its context.
+    [ EAGLContext setCurrentContext : mGLContext ];
+
+    delete mRenderer;
+
+    mGLContext = nil;
+}
+
+
+/////////////////////////////////////////////
+//                                         //
+//        EXPOSED INTERFACE SECTION        //
+//                                         //
+/////////////////////////////////////////////
+
+-(void)setNumberOfMeters : (int) numMeters
+{
+    numMeters  = ( numMeters < 1 ) ? 1 : numMeters;
+    mNumMeters = ( numMeters > VU_METER_MAX_METERS ) ? VU_METER_MAX_METERS
+                                                     : numMeters;
+}
+
+
+-(void)setRMS : (unsigned short) rms andAbsMax : (unsigned short) absMax;
+{
+    [ self setRMS : rms andAbsMax : absMax ofMeter : 0 ];
+}
+
+
+-(void)setRMS : (unsigned short) rms
+    andAbsMax : (unsigned short) absMax
+      ofMeter : (int)            meter
+{
+    [ self setRMS : rms
+        andAbsMax : absMax
+       numClipped : ( absMax >= OverloadThreshold ) ? 1 : 0
+          ofMeter : meter                                   ];
+}
+
+
+-(void)setRMS : (unsigned short) rms
+    andAbsMax : (unsigned short) absMax
+   numClipped : (int)            numClipped
+      ofMeter : (int)            meter
+{
+    if ( meter < 0 || meter >= VU_METER_MAX_METERS ) {
+        return;
+    }
+
+    mRMS   [meter] = rms;
+    mAbsMax[meter] = absMax;
+
+    if ( numClipped > 0 ) {
+
+        mClipTime[meter] = CACurrentMediaTime();
+    }
+
+    // The VU needle follows the RMS, and the peak meters the peak.
+
+    float level = ( mBallisticsMode == VU_METER_BALLISTICS_VU ) ? rms : absMax;
+
+    mBallistics->setLevels( meter, 1, &level );
+}
+
+
+-(void)setBallistics : (int) ballistics
+{
+    int   mode;
+    float reference;
+
+    switch ( ballistics ) {
+
+      case VU_METER_BALLISTICS_VU:
+        mode      = MeterBallistics::MODE_VU;
+        reference = AmplitudeRef;
+        break;
+
+      case VU_METER_BALLISTICS_PPM:
+        mode      = MeterBallistics::MODE_PPM;
+        reference = SHRT_MAX;
+        break;
+
+      case VU_METER_BALLISTICS_PEAK_HOLD:
+        mode      = MeterBallistics::MODE_PEAK_HOLD;
+        reference = SHRT_MAX;
+        break;
+
+      default:
+        return;
+    }
+
+    mBallisticsMode = ballistics;
+
+    mBallistics->setMode( mode );
+    mBallistics->setScale( reference, MicGainCalibFloorDB, MicGainCalibPeakDB );
+}
+
+
+-(void)reset
+{
+    for ( int m = 0; m < VU_METER_MAX_METERS; m++ ) {
+
+        mRMS     [m] = 0;
+        mAbsMax  [m] = 0;
+        mClipTime[m] = 0.0;
+    }
+
+    float silence[ VU_METER_MAX_METERS ] = { 0.0 };
+
+    mBallistics->setLevels( 0, VU_METER_MAX_METERS, silence );
+}
+
+
+-(void)activate
+{
+    if ( !mIsActive ) {
+
+        // The first frame is drawn whether the hands move or not.
+        mRenderer->invalidate();
+        
+        mDisplayLink =
+            [ CADisplayLink displayLinkWithTarget : self
+                                         selector : @selector( render: ) ];
+
+        [ mDisplayLink addToRunLoop : [ NSRunLoop currentRunLoop ]
+                            forMode : NSDefaultRunLoopMode           ];
+
+        mIsActive = TRUE;
+
+    }
+}
+
+
+-(void)deactivate
+{
+    if ( mIsActive ) {
+        
+        [ mDisplayLink invalidate ];
+        mDisplayLink = nil;
+        
+        [ self reset ];
+
+        mIsActive = FALSE;
+    }
+}
+
+
+
+
+
+@end
+
+
+
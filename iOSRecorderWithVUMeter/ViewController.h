@@ -23,6 +23,7 @@
 
 #import <UIKit/UIKit.h>
 #import "VUMeterViewGL.h"
+#import "WaveDrawingView.h"
 #import "AudioInputManager.h"
 #import "SlowTaskWaveWriter.h"
 #import "PlayWaveViewController.h"
@@ -32,10 +33,11 @@
                                                PlayWaveViewControllerDelegate >
 {
 
-    IBOutlet VUMeterViewGL* mVUMeter;
-    IBOutlet UILabel*       mAudioInputInfo;
-    IBOutlet UIButton*      mRecordingButton;
-    IBOutlet UIButton*      mPlaybackButton;
+    IBOutlet VUMeterViewGL*   mVUMeter;
+    IBOutlet UILabel*         mAudioInputInfo;
+    IBOutlet UIButton*        mRecordingButton;
+    IBOutlet UIButton*        mPlaybackButton;
+    IBOutlet WaveDrawingView* mLiveWave;
 
 }
 
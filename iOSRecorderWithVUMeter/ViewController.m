@@ -22,13 +22,24 @@
 //
 
 #import <Accelerate/Accelerate.h>
+#import <mach/mach_time.h>
 #import "ViewController.h"
+#import "loudnessMeter.h"
+#import "liveWaveform.h"
+#import "callbackTrace.h"
+#import "SlowTaskSpectrumAnalyzer.h"
+#import "SlowTaskVoiceActivity.h"
 
 
-@interface ViewController ()
+@interface ViewController () <SlowTaskVoiceActivityDelegate>
 
 @end
 
+// Gaps found ahead of the samples the writer has got, and the events of
+// the callbacks read at a time.
+#define PENDING_GAPS     16
+#define CALLBACK_BATCH   64
+
 @implementation ViewController {
 
     bool                mRecording;
@@ -39,12 +50,78 @@
     long                mNumOfChan;
     SlowTaskWaveWriter* mWaveWriter;
 
+    // Always filled, so that a recording starts with the last seconds
+    // before the button was pressed.
+    PRE_ROLL_RING*      mPreRoll;
+
+    // The captured samples go from the audio thread to the readers
+    // directly, each on its own queue.
+    CaptureFanOut*       mFanOut;
+    CaptureFanOutReader* mMeterReader;
+    CaptureFanOutReader* mWriterReader;
+    CaptureFanOutReader* mSpectrumReader;
+    CaptureFanOutReader* mVoiceReader;
+
+    // Fed and read on the queue of mMeterReader. Reset at the start of
+    // a recording, so that the integrated loudness is of the recording.
+    LOUDNESS_METER*      mLoudness;
+    NSString*            mAudioInputText;
+
+    // Fed from mSpectrumReader, and its snapshots read on the queue of
+    // mSpectrumReader, which started it.
+    SlowTaskSpectrumAnalyzer* mSpectrum;
+    SPECTRUM_SNAPSHOT*        mSpectrumSnapshot;
+
+    // Fed from mVoiceReader during a recording, and started and stopped
+    // on its queue. Its speech in the recording is counted on the main
+    // queue.
+    SlowTaskVoiceActivity* mVoice;
+    int64_t                mSpeechStart;
+    int64_t                mSpeechFrames;
+    int                    mSpeechSegments;
+
+    // The lines under the audio input, on the main queue.
+    NSString*            mLoudnessText;
+    NSString*            mSpectrumText;
+    NSString*            mVoiceText;
+
+    // Fed on the queue of mMeterReader, and read on the main queue.
+    LIVE_WAVEFORM*       mLiveWaveform;
+
+    // Traced on the audio thread, and read and analyzed on the queue of
+    // mWriterReader, which marks the gaps in the recording as they come.
+    CALLBACK_TRACE*      mCallbackTrace;
+    CALLBACK_TIMING*     mCallbackTiming;
+    CALLBACK_GAP         mPendingGaps [ PENDING_GAPS ];
+    int                  mNumPendingGaps;
+
 }
 
 
 static const NSString* const RecordingButtonStartRecording = @"Start Recording";
 static const NSString* const RecordingButtonStopRecording  = @"Stop Recording";
 
+// Bounds the memory of the pre-roll to 2 * PreRollSeconds of samples.
+static const float PreRollSeconds = 2.0f;
+
+// How far a reader of the capture can fall behind before losing samples.
+static const float FanOutSeconds  = 4.0f;
+static const int   FanOutReaders  = 4;
+
+// In frames, so that a block always holds whole frames of the channels.
+static const double ReaderIntervalSeconds = 0.02;
+static const int    MeterBlockFrames      = 1024;
+static const int    WriterBlockFrames     = 8192;
+static const int    SpectrumBlockFrames   = 4096;
+
+// The live waveform spans the last LiveWaveSeconds over its width, and
+// keeps the columns of a few seconds for the main queue to catch up.
+static const float  LiveWaveSeconds       = 5.0f;
+static const int    LiveWaveColumns       = 2048;
+
+// Events of the callbacks kept until read, about 10 seconds at 50Hz.
+static const int    CallbackTraceEvents   = 512;
+
 
 - (void)viewDidLoad {
 
@@ -72,14 +149,110 @@ static const NSString* const RecordingButtonStopRecording  = @"Stop Recording";
     NSString* line4 = [NSString stringWithFormat :
                                   @"Number of Channels [%ld]", mNumOfChan  ];
 
-    mAudioInputInfo.text = [ NSString stringWithFormat :
+    mAudioInputText      = [ NSString stringWithFormat :
                              @"%@\n%@\n%@\n%@", line1, line2, line3, line4 ];
+    mAudioInputInfo.text = mAudioInputText;
+
+    mLoudness = createLoudnessMeter( (int)mSampleRate, (int)mNumOfChan );
+
+    mSpectrum = [ [ SlowTaskSpectrumAnalyzer alloc ] init ];
+    mSpectrum.mSampleRate       = (int)mSampleRate;
+    mSpectrum.mNumberOfChannels = (int)mNumOfChan;
+    mSpectrumSnapshot           = NULL;
+
+    mVoice = [ [ SlowTaskVoiceActivity alloc ] init ];
+    mVoice.mSampleRate       = (int)mSampleRate;
+    mVoice.mNumberOfChannels = (int)mNumOfChan;
+    mVoice.mVoiceDelegate    = self;
+
+    int liveWidth = (int) mLiveWave.bounds.size.width;
+    int perColumn = (int)( mSampleRate * LiveWaveSeconds
+                           / ( ( liveWidth > 0 ) ? liveWidth : 1 ) );
+
+    mLiveWaveform = createLiveWaveform( ( perColumn > 0 ) ? perColumn : 1,
+                                        (int)mNumOfChan,
+                                        LiveWaveColumns                    );
+
+    [ mLiveWave liveWith : mLiveWaveform ];
+
+    mach_timebase_info_data_t timebase;
+
+    mach_timebase_info( &timebase );
+
+    mCallbackTrace  = createCallbackTrace( CallbackTraceEvents );
+    mCallbackTiming = createCallbackTiming( 1.0e-9 * timebase.numer
+                                                   / timebase.denom );
+    mNumPendingGaps = 0;
 
     mWaveWriter = [ [ SlowTaskWaveWriter alloc ] init ];
     mWaveWriter.mBaseFileName     = @"sample_recorded";
     mWaveWriter.mSampleRate       = (int)mSampleRate;
     mWaveWriter.mNumberOfChannels = (int)mNumOfChan;
 
+    mPreRoll = createPreRollRing( (int)mSampleRate,
+                                  (int)mNumOfChan,
+                                  PreRollSeconds    );
+
+    mWaveWriter.mPreRoll          = mPreRoll;
+
+    mFanOut = [ [ CaptureFanOut alloc ]
+                    initWithCapacity : (int)( mSampleRate * mNumOfChan
+                                              * FanOutSeconds          )
+                          maxReaders : FanOutReaders                      ];
+
+    mAIManager.mFanOut = mFanOut;
+
+    if ( mCallbackTiming != NULL ) {
+        mAIManager.mCallbackTrace = mCallbackTrace;
+    }
+
+    __weak ViewController* weakSelf = self;
+
+    mMeterReader = [ [ CaptureFanOutReader alloc ]
+                         initWithFanOut : mFanOut
+                              blockSize : MeterBlockFrames * (int)mNumOfChan
+                               interval : ReaderIntervalSeconds
+                                handler : ^( const SInt16* samples,
+                                             int           length,
+                                             int64_t       lost    ) {
+
+        [ weakSelf meterSamples : samples length : length ];
+    } ];
+
+    mWriterReader = [ [ CaptureFanOutReader alloc ]
+                          initWithFanOut : mFanOut
+                               blockSize : WriterBlockFrames * (int)mNumOfChan
+                                interval : ReaderIntervalSeconds
+                                 handler : ^( const SInt16* samples,
+                                              int           length,
+                                              int64_t       lost    ) {
+
+        [ weakSelf recordSamples : samples length : length lost : lost ];
+    } ];
+
+    mSpectrumReader = [ [ CaptureFanOutReader alloc ]
+                            initWithFanOut : mFanOut
+                                 blockSize : SpectrumBlockFrames
+                                             * (int)mNumOfChan
+                                  interval : ReaderIntervalSeconds
+                                   handler : ^( const SInt16* samples,
+                                                int           length,
+                                                int64_t       lost    ) {
+
+        [ weakSelf analyzeSamples : samples length : length ];
+    } ];
+
+    mVoiceReader = [ [ CaptureFanOutReader alloc ]
+                         initWithFanOut : mFanOut
+                              blockSize : MeterBlockFrames * (int)mNumOfChan
+                               interval : ReaderIntervalSeconds
+                                handler : ^( const SInt16* samples,
+                                             int           length,
+                                             int64_t       lost    ) {
+
+        [ weakSelf detectVoiceIn : samples length : length ];
+    } ];
+
     mRecording = false;
 
     [ mRecordingButton setEnabled: YES ];
@@ -94,7 +267,19 @@ static const NSString* const RecordingButtonStopRecording  = @"Stop Recording";
 -(void) viewWillAppear : (BOOL) animated
 {
     NSLog(@"viewWillAppear");
+    [ mMeterReader    start ];
+    [ mWriterReader   start ];
+    [ mSpectrumReader start ];
+    [ mVoiceReader    start ];
+
+    SlowTaskSpectrumAnalyzer* spectrum = mSpectrum;
+
+    dispatch_async( mSpectrumReader.mQueue, ^{
+        [ spectrum start ];
+    } );
+
     [ mAIManager open : mSampleRate NumberOfChennels : (UInt32) mNumOfChan ];
+    [ mVUMeter setNumberOfMeters : (int)mNumOfChan ];
     [ mVUMeter activate ];
 }
 
@@ -108,16 +293,52 @@ static const NSString* const RecordingButtonStopRecording  = @"Stop Recording";
 -(void) viewWillDisappear : (BOOL) animated
 {
     NSLog(@"viewWillDisappear");
-    [ mVUMeter   deactivate ];
-    [ mAIManager close      ];
+    [ mVUMeter        deactivate ];
+    [ mAIManager      close      ];
+    [ mMeterReader    stop       ];
+    [ mWriterReader   stop       ];
+    [ mSpectrumReader stop       ];
+    [ mVoiceReader    stop       ];
+
+    SlowTaskSpectrumAnalyzer* spectrum = mSpectrum;
+
+    dispatch_async( mSpectrumReader.mQueue, ^{
+        [ spectrum stop ];
+    } );
 }
 
 
 - (IBAction) onRecordingButtonPressed : (id) sender
 {
+    CaptureFanOutReader*   reader      = mWriterReader;
+    SlowTaskWaveWriter*    writer      = mWaveWriter;
+    CaptureFanOutReader*   voiceReader = mVoiceReader;
+    SlowTaskVoiceActivity* voice       = mVoice;
+
+    // On the queue feeding the writer, after the samples captured so far,
+    // so that the recording starts and stops exactly at the press.
     if ( mRecording ) {
 
-        [ mWaveWriter stop ];
+        CALLBACK_TIMING* timing = mCallbackTiming;
+
+        dispatch_async( mWriterReader.mQueue, ^{
+            [ reader drain ];
+            [ writer stop  ];
+
+            if ( timing != NULL ) {
+
+                char summary [ 256 ];
+
+                formatCallbackTiming( timing, summary, sizeof(summary) );
+                NSLog(@"Callback timing: %s", summary);
+            }
+        } );
+
+        // The speech still in progress ends with the recording.
+        dispatch_async( mVoiceReader.mQueue, ^{
+            [ voiceReader drain ];
+            [ voice       stop  ];
+        } );
 
         [ mRecordingButton setTitleColor : [ UIColor blackColor ]
                                 forState : UIControlStateNormal   ];
@@ -129,7 +350,33 @@ static const NSString* const RecordingButtonStopRecording  = @"Stop Recording";
     }
     else {
 
-        [ mWaveWriter start ];
+        dispatch_async( mWriterReader.mQueue, ^{
+            [ reader drain ];
+            [ writer start ];
+        } );
+
+        // Counted from the start of the recording, as the offsets of the
+        // speech are.
+        mSpeechFrames   = 0;
+        mSpeechSegments = 0;
+        mVoiceText      = nil;
+
+        [ self showAudioInputInfo ];
+
+        dispatch_async( mVoiceReader.mQueue, ^{
+            [ voiceReader drain ];
+            [ voice       start ];
+        } );
+
+        LOUDNESS_METER* loudness = mLoudness;
+
+        if ( loudness != NULL ) {
+
+            dispatch_async( mMeterReader.mQueue, ^{
+                resetLoudnessMeter( loudness );
+            } );
+        }
+
         [ mRecordingButton setTitleColor : [UIColor redColor]
                                 forState : UIControlStateNormal ];
         [ mRecordingButton
@@ -163,32 +410,355 @@ static const NSString* const RecordingButtonStopRecording  = @"Stop Recording";
 }
 
 
--(void) inputDataArrivedWithData : (SInt16*) data size : (UInt32) size
+// On the queue of mMeterReader.
+-(void) meterSamples : (const SInt16*) samples length : (int) len
 {
-    // This demonstrates the use of vDSP to calculate RMS.
-    // The performance gain, if any, will be limited due to
-    // the conversion from Int16 to Float.
+    if ( len <= 0 ) {
+        return;
+    }
 
-    if ( size > 0 ) {
+    // One meter per channel, up to what the view can show.
+    int     numChan   = (int)mNumOfChan;
+    int     numMeters = ( numChan < VU_METER_MAX_METERS ) ? numChan
+                                                          : VU_METER_MAX_METERS;
+    float   fixedRMS     [ VU_METER_MAX_METERS ];
+    float   fixedAbsMAX  [ VU_METER_MAX_METERS ];
+    int     fixedClipped [ VU_METER_MAX_METERS ];
+    float*  fRMS      = fixedRMS;
+    float*  fAbsMAX   = fixedAbsMAX;
+    int*    clipped   = fixedClipped;
+
+    if ( numChan > VU_METER_MAX_METERS ) {
+
+        fRMS    = (float*) malloc( sizeof(float) * numChan );
+        fAbsMAX = (float*) malloc( sizeof(float) * numChan );
+        clipped = (int*)   malloc( sizeof(int)   * numChan );
+    }
 
-        float fRMS, fAbsMAX;
-        
-        [ mAIManager calsRMS : &fRMS
-                   andAbsMax : &fAbsMAX
-                    fromData : data
-                     andSize : size      ];
+    bool metered = ( fRMS != NULL && fAbsMAX != NULL && clipped != NULL );
 
-        [ mVUMeter setRMS : (unsigned short) fRMS
-                andAbsMax : (unsigned short) fAbsMAX ];
+    if ( metered ) {
 
-        [ mWaveWriter feed : data length:size ];
-        
+        [ mAIManager calsRMS : fRMS
+                   andAbsMax : fAbsMAX
+                  andClipped : clipped
+                    fromData : (SInt16*) samples
+                   numFrames : (UInt32) ( len / numChan )
+                 numChannels : (UInt32) numChan           ];
     }
-    else {
 
-        free( data );
+    // A C array can not be captured by the block, but a struct can.
+    struct { unsigned short rms[ VU_METER_MAX_METERS ];
+             unsigned short absMax[ VU_METER_MAX_METERS ];
+             int            clipped[ VU_METER_MAX_METERS ]; } levels;
+
+    for ( int m = 0; m < numMeters; m++ ) {
+
+        levels.rms    [m] = metered ? (unsigned short) fRMS   [m] : 0;
+        levels.absMax [m] = metered ? (unsigned short) fAbsMAX[m] : 0;
+        levels.clipped[m] = metered ? clipped[m]                  : 0;
     }
-    
+
+    if ( fRMS != fixedRMS ) {
+
+        free( fRMS );
+        free( fAbsMAX );
+        free( clipped );
+    }
+
+    NSString* loudnessText = nil;
+
+    if ( mLoudness != NULL ) {
+
+        LOUDNESS_LEVELS loudness;
+
+        feedLoudnessMeter( mLoudness, samples, len / numChan );
+        loudnessLevels( mLoudness, &loudness );
+
+        loudnessText = [ NSString stringWithFormat :
+                           @"M %.1f S %.1f I %.1f [LUFS] TP %.1f [dBTP]",
+                           fmaxf( loudness.momentary,  -99.9f ),
+                           fmaxf( loudness.shortTerm,  -99.9f ),
+                           fmaxf( loudness.integrated, -99.9f ),
+                           fmaxf( loudness.truePeak,   -99.9f )          ];
+    }
+
+    if ( mLiveWaveform != NULL ) {
+
+        feedLiveWaveform( mLiveWaveform, samples, len / numChan );
+    }
+
+    VUMeterViewGL*   meter     = mVUMeter;
+    WaveDrawingView* liveWave  = mLiveWave;
+
+    __weak ViewController* weakSelf = self;
+
+    dispatch_async ( dispatch_get_main_queue(), ^{
+
+        for ( int m = 0; m < numMeters; m++ ) {
+
+            [ meter setRMS : levels.rms[m]
+                 andAbsMax : levels.absMax[m]
+                numClipped : levels.clipped[m]
+                   ofMeter : m                 ];
+        }
+
+        [ liveWave updateLive ];
+
+        if ( loudnessText != nil ) {
+
+            [ weakSelf showLoudness : loudnessText ];
+        }
+    } );
+}
+
+
+// On the main queue.
+-(void) showLoudness : (NSString*) text
+{
+    mLoudnessText = text;
+
+    [ self showAudioInputInfo ];
+}
+
+
+// On the main queue.
+-(void) showSpectrum : (NSString*) text
+{
+    mSpectrumText = text;
+
+    [ self showAudioInputInfo ];
+}
+
+
+// On the main queue.
+-(void) showAudioInputInfo
+{
+    NSMutableString* text = [ NSMutableString
+                                  stringWithString : mAudioInputText ];
+
+    if ( mLoudnessText != nil ) {
+        [ text appendFormat : @"\n%@", mLoudnessText ];
+    }
+
+    if ( mSpectrumText != nil ) {
+        [ text appendFormat : @"\n%@", mSpectrumText ];
+    }
+
+    if ( mVoiceText != nil ) {
+        [ text appendFormat : @"\n%@", mVoiceText ];
+    }
+
+    mAudioInputInfo.text = text;
+}
+
+
+// On the queue of mSpectrumReader.
+-(void) analyzeSamples : (const SInt16*) samples length : (int) len
+{
+    if ( len <= 0 ) {
+        return;
+    }
+
+    SInt16* data = (SInt16*) malloc( sizeof(SInt16) * len );
+
+    if ( data == NULL ) {
+        return;
+    }
+
+    memcpy( data, samples, sizeof(SInt16) * len );
+
+    [ mSpectrum feed : data length : len ];
+
+    // Allocated once the analyzer has been created by its start.
+    if ( mSpectrumSnapshot == NULL ) {
+
+        mSpectrumSnapshot = [ mSpectrum allocSnapshot ];
+
+        if ( mSpectrumSnapshot == NULL ) {
+            return;
+        }
+    }
+
+    if ( ! [ mSpectrum readSnapshot : mSpectrumSnapshot ] ) {
+        return;
+    }
+
+    NSString* spectrumText = [ self spectrumTextOf : mSpectrumSnapshot ];
+
+    __weak ViewController* weakSelf = self;
+
+    dispatch_async ( dispatch_get_main_queue(), ^{
+        [ weakSelf showSpectrum : spectrumText ];
+    } );
+}
+
+
+// On the queue of mVoiceReader. Ignored by the task unless recording.
+-(void) detectVoiceIn : (const SInt16*) samples length : (int) len
+{
+    if ( len <= 0 ) {
+        return;
+    }
+
+    SInt16* data = (SInt16*) malloc( sizeof(SInt16) * len );
+
+    if ( data == NULL ) {
+        return;
+    }
+
+    memcpy( data, samples, sizeof(SInt16) * len );
+
+    [ mVoice feed : data length : len ];
+}
+
+
+// On the main queue, from mVoice.
+-(void) speechStartedAt : (int64_t) sampleOffset
+{
+    mSpeechStart = sampleOffset;
+    mVoiceText   = [ NSString stringWithFormat :
+                         @"Speech since %.1f [s]",
+                         (double) sampleOffset / mSampleRate ];
+
+    [ self showAudioInputInfo ];
+}
+
+
+// On the main queue, from mVoice.
+-(void) speechEndedAt : (int64_t) sampleOffset
+{
+    mSpeechFrames   += sampleOffset - mSpeechStart;
+    mSpeechSegments += 1;
+    mVoiceText       = [ NSString stringWithFormat :
+                             @"Speech %d times, %.1f [s] in total",
+                             mSpeechSegments,
+                             (double) mSpeechFrames / mSampleRate   ];
+
+    [ self showAudioInputInfo ];
+}
+
+
+// The strongest frequency and the broadband noise floor of the first
+// channel. A bin of white noise reads its variance, so the floor is the
+// mean power of the band floors over their bins.
+-(NSString*) spectrumTextOf : (const SPECTRUM_SNAPSHOT*) snapshot
+{
+    const float* average = snapshot->averageDB;
+    const float* floors  = snapshot->bandFloorDB;
+    int          peakBin = 1;
+    double       floorPw = 0.0;
+    int          numBins = 0;
+
+    for ( int i = 2; i < snapshot->numBins; i++ ) {
+
+        if ( average[i] > average[ peakBin ] ) {
+            peakBin = i;
+        }
+    }
+
+    for ( int b = 0; b < snapshot->numBands; b++ ) {
+
+        int width = snapshot->bandEdges[ b + 1 ] - snapshot->bandEdges[b];
+
+        floorPw += width * pow( 10.0, floors[b] / 10.0 );
+        numBins += width;
+    }
+
+    // Relative to the power of a full scale square wave.
+    double fullScaleDB = 20.0 * log10( 32768.0 );
+    double floorDB     = 10.0 * log10( floorPw / ( numBins > 0 ? numBins : 1 )
+                                       + 1.0e-10                            )
+                         - fullScaleDB;
+
+    return [ NSString stringWithFormat :
+                 @"Peak %.0f [Hz] Noise floor %.1f [dBFS]",
+                 peakBin * snapshot->binHz,
+                 fmax( floorDB, -199.9 )                   ];
+}
+
+
+// On the queue of mWriterReader.
+-(void) recordSamples : (const SInt16*) samples
+               length : (int)           len
+                 lost : (int64_t)       lost
+{
+    if ( lost > 0 ) {
+        NSLog(@"Capture overrun: %lld samples lost", lost);
+    }
+
+    if ( len <= 0 ) {
+        return;
+    }
+
+    // Pushed before the feed, on the queue that starts the writer.
+    if ( mPreRoll != NULL ) {
+        pushPreRoll( mPreRoll, samples, len );
+    }
+
+    SInt16* data = (SInt16*) malloc( sizeof(SInt16) * len );
+
+    if ( data == NULL ) {
+        return;
+    }
+
+    memcpy( data, samples, sizeof(SInt16) * len );
+
+    [ self markDropoutsInBlockOf : len ];
+
+    [ mWaveWriter feed : data length : len ];
+}
+
+
+// On the queue of mWriterReader, with the block of len samples just
+// passed, before it is fed to the writer.
+-(void) markDropoutsInBlockOf : (int) len
+{
+    if ( mCallbackTrace == NULL || mCallbackTiming == NULL ) {
+        return;
+    }
+
+    CALLBACK_EVENT events [ CALLBACK_BATCH ];
+    int            numEvents;
+
+    // The callbacks of the samples passed are traced already.
+    while ( ( numEvents = readCallbackTrace( mCallbackTrace,
+                                             events,
+                                             CALLBACK_BATCH ) ) > 0 ) {
+
+        int room    = PENDING_GAPS - mNumPendingGaps;
+        int numGaps = analyzeCallbackEvents( mCallbackTiming,
+                                             events,
+                                             numEvents,
+                                             &mPendingGaps[ mNumPendingGaps ],
+                                             room                            );
+
+        mNumPendingGaps += ( numGaps < room ) ? numGaps : room;
+    }
+
+    int64_t end   = [ mWriterReader position ];
+    int64_t start = end - len;
+    int     kept  = 0;
+
+    // A gap before the block is of samples not passed to the writer, and
+    // one after it waits for its samples.
+    for ( int i = 0; i < mNumPendingGaps; i++ ) {
+
+        CALLBACK_GAP gap = mPendingGaps[i];
+
+        if ( gap.streamSample >= end ) {
+
+            mPendingGaps[ kept++ ] = gap;
+        }
+        else if ( gap.streamSample >= start ) {
+
+            [ mWaveWriter markDropout : gap.lostFrames
+                          beforeFrame : (int)( ( gap.streamSample - start )
+                                               / mNumOfChan             ) ];
+        }
+    }
+
+    mNumPendingGaps = kept;
 }
 
 
@@ -25,6 +25,7 @@
 
 
 #import <UIKit/UIKit.h>
+#import "liveWaveform.h"
 
 @interface WaveDrawingView : UIView
 {
@@ -32,9 +33,22 @@
 }
 
 @property(nonatomic, strong) NSData* mData;
+@property(nonatomic, strong) NSData* mSpectrogram;
 
 -(void)plotWith : (NSData*) plots;
 
+// Gray image from computeSpectrogramImage() drawn behind the plots.
+-(void)spectrogramWith : (NSData*) image
+                 width : (int)     width
+                height : (int)     height;
+
+// Scrolls the columns of the waveform appended from now on, one column
+// per point of the width, instead of the plots.
+-(void)liveWith : (LIVE_WAVEFORM*) waveform;
+
+// Draws the columns appended since the last update. On the main thread.
+-(void)updateLive;
+
 @end
 
 #endif /*_WAVE_DRAWING_VIEW_H_*/
@@ -21,10 +21,30 @@
 // SOFTWARE.
 //
 #import "WaveDrawingView.h"
+#import "waveRaster.h"
 
-@implementation WaveDrawingView
+@implementation WaveDrawingView {
+
+    int mSpectrogramWidth;
+    int mSpectrogramHeight;
+
+    // The plots or the live columns are drawn into the raster only where
+    // they have changed, and the view draws the pixels in place.
+    WAVE_RASTER*      mRaster;
+    CGDataProviderRef mRasterProvider;
+    CGColorSpaceRef   mRGB;
+
+    // The raster is a ring whose oldest column is at mLiveX, drawn in two
+    // parts.
+    LIVE_WAVEFORM*    mLive;
+    int               mLiveX;
+    int64_t           mLiveNext;
+    short*            mLiveMins;
+    short*            mLiveMaxs;
+}
 
 @synthesize mData;
+@synthesize mSpectrogram;
 
 
 - (id)initWithFrame : (CGRect)frame
@@ -32,44 +52,252 @@
     self = [ super initWithFrame : frame ];
 
     if (self) {
-        mData = nil;
+        mData        = nil;
+        mSpectrogram = nil;
     }
 
     return self;
 }
 
 
+- (void)dealloc
+{
+    [ self releaseLive ];
+    [ self releaseRaster ];
+    CGColorSpaceRelease( mRGB );
+}
+
+
 - (void)drawRect : (CGRect)rect {
 
     [ super drawRect : rect ];
 
     CGContextRef context = UIGraphicsGetCurrentContext();
-    
-    CGContextSetStrokeColorWithColor( context, [UIColor greenColor].CGColor );
 
-    CGContextSetLineWidth( context, 1.0 );
+    if ( mSpectrogram != nil && mLive == NULL ) {
+
+        [ self drawSpectrogramIn : context ];
+    }
+
+    if ( mRaster == NULL ) {
+        return;
+    }
+
+    CGImageRef image = CGImageCreate( mRaster->width,
+                                      mRaster->height,
+                                      8,
+                                      32,
+                                      mRaster->width * 4,
+                                      mRGB,
+                                      kCGImageAlphaPremultipliedLast
+                                      | kCGBitmapByteOrder32Big,
+                                      mRasterProvider,
+                                      NULL,
+                                      false,
+                                      kCGRenderingIntentDefault );
+    if ( image == NULL ) {
+        return;
+    }
+
+    int width  = mRaster->width;
+    int height = mRaster->height;
+
+    // Row 0 of the raster is the top of the view.
+    CGContextSaveGState( context );
+    CGContextTranslateCTM( context, 0, self.bounds.size.height );
+    CGContextScaleCTM( context, 1.0, -1.0 );
+
+    if ( mLive != NULL ) {
+
+        // The oldest column at the left, and the latest at the right.
+        CGContextDrawImage( context,
+                            CGRectMake( -mLiveX, 0, width, height ),
+                            image                                   );
+        CGContextDrawImage( context,
+                            CGRectMake( width - mLiveX, 0, width, height ),
+                            image                                          );
+    }
+    else {
+        CGContextDrawImage( context,
+                            CGRectMake( 0, 0, width, height ),
+                            image                             );
+    }
+
+    CGContextRestoreGState( context );
+
+    CGImageRelease( image );
+}
+
+
+-(void)drawSpectrogramIn : (CGContextRef) context
+{
+    CGColorSpaceRef   gray     = CGColorSpaceCreateDeviceGray();
+    CGDataProviderRef provider =
+              CGDataProviderCreateWithCFData( (__bridge CFDataRef) mSpectrogram );
+
+    CGImageRef image = CGImageCreate( mSpectrogramWidth,
+                                      mSpectrogramHeight,
+                                      8,
+                                      8,
+                                      mSpectrogramWidth,
+                                      gray,
+                                      kCGImageAlphaNone,
+                                      provider,
+                                      NULL,
+                                      false,
+                                      kCGRenderingIntentDefault );
+    if ( image != NULL ) {
+
+        // Row 0 of the image is the top of the view.
+        CGContextSaveGState( context );
+        CGContextTranslateCTM( context, 0, self.bounds.size.height );
+        CGContextScaleCTM( context, 1.0, -1.0 );
+        CGContextDrawImage( context,
+                            CGRectMake( 0, 0, self.bounds.size.width,
+                                              self.bounds.size.height ),
+                            image                                      );
+        CGContextRestoreGState( context );
+
+        CGImageRelease( image );
+    }
+
+    CGDataProviderRelease( provider );
+    CGColorSpaceRelease( gray );
+}
+
+
+-(void)spectrogramWith : (NSData*) image
+                 width : (int)     width
+                height : (int)     height
+{
+    mSpectrogram       = image;
+    mSpectrogramWidth  = width;
+    mSpectrogramHeight = height;
+
+    [ self setNeedsDisplay ];
+}
+
+
+// Kept as long as the size and the background stay the same, so that only
+// the columns changed are drawn again.
+-(bool)prepareRasterWith : (uint32_t) background
+{
+    int width  = (int) self.bounds.size.width;
+    int height = (int) self.bounds.size.height;
+
+    if (    mRaster != NULL
+         && mRaster->width      == width
+         && mRaster->height     == height
+         && mRaster->background == background ) {
+        return true;
+    }
+
+    [ self releaseRaster ];
+
+    if ( mRGB == NULL ) {
+        mRGB = CGColorSpaceCreateDeviceRGB();
+    }
+
+    mRaster = createWaveRaster( width,
+                                height,
+                                background,
+                                WAVE_RASTER_RGBA( 0, 255, 0, 255 ) );
+    if ( mRaster == NULL ) {
+        return false;
+    }
+
+    mRasterProvider = CGDataProviderCreateWithData(
+                          NULL,
+                          mRaster->pixels,
+                          sizeof(uint32_t) * width * height,
+                          NULL                               );
+    if ( mRasterProvider == NULL ) {
+
+        [ self releaseRaster ];
+        return false;
+    }
+
+    return true;
+}
+
+
+-(void)releaseRaster
+{
+    CGDataProviderRelease( mRasterProvider );
+    freeWaveRaster( mRaster );
+
+    mRasterProvider = NULL;
+    mRaster         = NULL;
+}
+
+
+-(void)liveWith : (LIVE_WAVEFORM*) waveform
+{
+    [ self releaseLive ];
+
+    if ( waveform == NULL ) {
+        return;
+    }
+
+    if ( ![ self prepareRasterWith : WAVE_RASTER_RGBA( 0, 0, 0, 255 ) ] ) {
+        return;
+    }
+
+    mLiveX    = 0;
+    mLiveMins = (short*) malloc( sizeof(short) * mRaster->width );
+    mLiveMaxs = (short*) malloc( sizeof(short) * mRaster->width );
 
-    int *plots = malloc( [ mData length ] );
+    if ( mLiveMins == NULL || mLiveMaxs == NULL ) {
 
-    if ( plots == NULL ) {
+        [ self releaseLive ];
         return;
     }
 
-    [ mData getBytes : plots length : [ mData length ] ];
+    // From the present, not from the columns of before.
+    mLive     = waveform;
+    mLiveNext = liveWaveformColumns( waveform );
+
+    [ self setNeedsDisplay ];
+}
 
-    unsigned long plotLen = [ mData length ] / sizeof(int);
 
-    CGContextMoveToPoint( context, 0, plots[0] );
+-(void)updateLive
+{
+    if ( mLive == NULL ) {
+        return;
+    }
 
-    for ( int i = 1; i < plotLen; i++ ) {
-    
-        CGContextAddLineToPoint( context, i/2, plots[i] );
+    int width      = mRaster->width;
+    int numColumns = readLiveWaveform( mLive,
+                                       &mLiveNext,
+                                       width,
+                                       mLiveMins,
+                                       mLiveMaxs   );
+    if ( numColumns == 0 ) {
+        return;
     }
 
-    CGContextStrokePath( context );
+    // Only the new columns, over the oldest ones.
+    int run = ( numColumns < width - mLiveX ) ? numColumns : width - mLiveX;
+
+    rasterizeWaveLevels( mRaster, mLiveX, run, mLiveMins, mLiveMaxs );
+    rasterizeWaveLevels( mRaster, 0, numColumns - run,
+                         &mLiveMins[run], &mLiveMaxs[run] );
 
-    free( plots );
+    mLiveX = ( mLiveX + numColumns ) % width;
+
+    [ self setNeedsDisplay ];
+}
+
+
+-(void)releaseLive
+{
+    free( mLiveMins );
+    free( mLiveMaxs );
 
+    mLive     = NULL;
+    mLiveMins = NULL;
+    mLiveMaxs = NULL;
 }
 
 
@@ -77,8 +305,28 @@
 {
 
     mData = plots;
-    
-    [ self setNeedsDisplay ];
+
+    if ( plots == nil || mLive != NULL ) {
+        return;
+    }
+
+    if ( ![ self prepareRasterWith : 0 ] ) {
+        return;
+    }
+
+    // Read in place, one column per point of the width.
+    int numColumns = (int)( [ plots length ] / ( sizeof(int) * 2 ) );
+
+    numColumns = ( numColumns < mRaster->width ) ? numColumns
+                                                 : mRaster->width;
+
+    if ( rasterizeWavePlots( mRaster,
+                             0,
+                             numColumns,
+                             (const int*) [ plots bytes ] ) > 0 ) {
+
+        [ self setNeedsDisplay ];
+    }
 
 }
 
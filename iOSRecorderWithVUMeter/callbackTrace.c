@@ -0,0 +1,306 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "callbackTrace.h"
+
+
+struct callback_trace {
+
+    int             numEvents;
+    CALLBACK_EVENT* events;         /* [ numEvents ] ring */
+
+    atomic_int_fast64_t added;      /* by the capture thread */
+    atomic_int_fast64_t taken;      /* by the reader */
+    atomic_int_fast64_t dropped;    /* by the capture thread */
+};
+
+
+CALLBACK_TRACE* createCallbackTrace( int numEvents )
+{
+    if ( numEvents <= 0 ) {
+        return NULL;
+    }
+
+    CALLBACK_TRACE* trace =
+                 (CALLBACK_TRACE*)calloc( 1, sizeof(CALLBACK_TRACE) );
+
+    if ( trace == NULL ) {
+        return NULL;
+    }
+
+    trace->numEvents = numEvents;
+    trace->events    = (CALLBACK_EVENT*)malloc( sizeof(CALLBACK_EVENT)
+                                                * numEvents            );
+    if ( trace->events == NULL ) {
+
+        freeCallbackTrace( trace );
+        return NULL;
+    }
+
+    atomic_init( &(trace->added),   0 );
+    atomic_init( &(trace->taken),   0 );
+    atomic_init( &(trace->dropped), 0 );
+
+    return trace;
+}
+
+
+int traceCallback( CALLBACK_TRACE* trace, const CALLBACK_EVENT* event )
+{
+    int64_t added = atomic_load_explicit( &(trace->added),
+                                          memory_order_relaxed );
+    int64_t taken = atomic_load_explicit( &(trace->taken),
+                                          memory_order_acquire );
+
+    if ( added - taken >= trace->numEvents ) {
+
+        atomic_store_explicit( &(trace->dropped),
+                               atomic_load_explicit( &(trace->dropped),
+                                                     memory_order_relaxed )
+                               + 1,
+                               memory_order_relaxed                         );
+        return -1;
+    }
+
+    trace->events[ added % trace->numEvents ] = *event;
+
+    atomic_store_explicit( &(trace->added), added + 1, memory_order_release );
+
+    return 0;
+}
+
+
+int readCallbackTrace(
+    CALLBACK_TRACE* trace,
+    CALLBACK_EVENT* events,
+    int             maxEvents
+) {
+    int64_t added = atomic_load_explicit( &(trace->added),
+                                          memory_order_acquire );
+    int64_t taken = atomic_load_explicit( &(trace->taken),
+                                          memory_order_relaxed );
+
+    int numEvents = (int)( added - taken );
+
+    numEvents = ( numEvents < maxEvents ) ? numEvents : maxEvents;
+
+    for ( int i = 0; i < numEvents; i++ ) {
+        events[i] = trace->events[ ( taken + i ) % trace->numEvents ];
+    }
+
+    /* The slots are given back only after they are copied. */
+    atomic_store_explicit( &(trace->taken),
+                           taken + numEvents,
+                           memory_order_release );
+    return numEvents;
+}
+
+
+int64_t droppedCallbackEvents( CALLBACK_TRACE* trace )
+{
+    return atomic_load_explicit( &(trace->dropped), memory_order_relaxed );
+}
+
+
+void freeCallbackTrace( CALLBACK_TRACE* trace )
+{
+    if ( trace == NULL ) {
+        return;
+    }
+
+    free( trace->events );
+    free( trace );
+}
+
+
+CALLBACK_TIMING* createCallbackTiming( double secondsPerHostTick )
+{
+    CALLBACK_TIMING* timing =
+                 (CALLBACK_TIMING*)calloc( 1, sizeof(CALLBACK_TIMING) );
+
+    if ( timing == NULL ) {
+        return NULL;
+    }
+
+    timing->secondsPerHostTick = secondsPerHostTick;
+
+    return timing;
+}
+
+
+int analyzeCallbackEvents(
+    CALLBACK_TIMING*      timing,
+    const CALLBACK_EVENT* events,
+    int                   numEvents,
+    CALLBACK_GAP*         gaps,
+    int                   maxGaps
+) {
+    int numGaps = 0;
+
+    for ( int i = 0; i < numEvents; i++ ) {
+
+        const CALLBACK_EVENT* event = &events[i];
+
+        int bin = event->numFrames / CBT_FRAMES_PER_BIN;
+
+        bin = ( bin < 0 ) ? 0 : ( bin < CBT_FRAMES_BINS ) ? bin
+                                                          : CBT_FRAMES_BINS - 1;
+        timing->framesHistogram[ bin ]++;
+
+        if ( timing->numCallbacks == 0 ) {
+
+            timing->minFrames = event->numFrames;
+            timing->maxFrames = event->numFrames;
+        }
+        else {
+            if ( event->numFrames < timing->minFrames ) {
+                timing->minFrames = event->numFrames;
+            }
+            if ( event->numFrames > timing->maxFrames ) {
+                timing->maxFrames = event->numFrames;
+            }
+        }
+
+        timing->numCallbacks++;
+
+        const CALLBACK_EVENT* last = &(timing->last);
+
+        /* The sample time and the host time start over on a restart of
+         * the capture. */
+        if (    timing->hasLast
+             && (    event->sampleTime < last->sampleTime + 0.5
+                  || event->hostTime   < last->hostTime            ) ) {
+
+            timing->numRestarts++;
+        }
+        else if ( timing->hasLast ) {
+
+            double jump = event->sampleTime
+                          - ( last->sampleTime + last->numFrames );
+
+            if ( jump >= 0.5 ) {
+
+                int64_t lost = (int64_t) llround( jump );
+
+                if ( numGaps < maxGaps ) {
+
+                    gaps[ numGaps ].streamSample = event->streamSample;
+                    gaps[ numGaps ].lostFrames   = lost;
+                }
+
+                numGaps++;
+                timing->numGaps++;
+                timing->lostFrames += lost;
+            }
+
+            double interval = ( event->hostTime - last->hostTime )
+                              * timing->secondsPerHostTick;
+
+            int ibin = (int)( interval * 1000.0 / CBT_INTERVAL_BIN_MS );
+
+            ibin = ( ibin < CBT_INTERVAL_BINS ) ? ibin : CBT_INTERVAL_BINS - 1;
+
+            timing->intervalHistogram[ ibin ]++;
+
+            if ( timing->numIntervals == 0 || interval < timing->minInterval ) {
+                timing->minInterval = interval;
+            }
+            if ( timing->numIntervals == 0 || interval > timing->maxInterval ) {
+                timing->maxInterval = interval;
+            }
+
+            timing->sumIntervals += interval;
+            timing->numIntervals++;
+        }
+
+        timing->last    = *event;
+        timing->hasLast = 1;
+    }
+
+    return numGaps;
+}
+
+
+double callbackIntervalPercentile(
+    const CALLBACK_TIMING* timing,
+    double                 fraction
+) {
+    if ( timing->numIntervals == 0 ) {
+        return 0.0;
+    }
+
+    double  target = fraction * timing->numIntervals;
+    int64_t count  = 0;
+
+    for ( int bin = 0; bin < CBT_INTERVAL_BINS - 1; bin++ ) {
+
+        count += timing->intervalHistogram[ bin ];
+
+        if ( count >= target ) {
+
+            double upper = ( bin + 1 ) * CBT_INTERVAL_BIN_MS / 1000.0;
+
+            return ( upper < timing->maxInterval ) ? upper
+                                                   : timing->maxInterval;
+        }
+    }
+
+    return timing->maxInterval;
+}
+
+
+int formatCallbackTiming(
+    const CALLBACK_TIMING* timing,
+    char*                  summary,
+    int                    size
+) {
+    double mean = ( timing->numIntervals > 0 )
+                  ? timing->sumIntervals / timing->numIntervals : 0.0;
+
+    return snprintf( summary, size,
+                     "callbacks %lld, interval [ms] mean %.2f min %.2f "
+                     "p50 %.2f p99 %.2f max %.2f, frames %d to %d, "
+                     "gaps %lld of %lld frames, restarts %lld",
+                     (long long)timing->numCallbacks,
+                     mean * 1000.0,
+                     timing->minInterval * 1000.0,
+                     callbackIntervalPercentile( timing, 0.50 ) * 1000.0,
+                     callbackIntervalPercentile( timing, 0.99 ) * 1000.0,
+                     timing->maxInterval * 1000.0,
+                     (int)timing->minFrames,
+                     (int)timing->maxFrames,
+                     (long long)timing->numGaps,
+                     (long long)timing->lostFrames,
+                     (long long)timing->numRestarts                         );
+}
+
+
+void freeCallbackTiming( CALLBACK_TIMING* timing )
+{
+    free( timing );
+}
@@ -0,0 +1,201 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Timing of the audio render callbacks.
+ *
+ * The capture thread traces each callback, with the sample time and the
+ * host time of its time stamp, into a fixed ring without locking nor
+ * allocating, and another thread reads the events and analyzes them: the
+ * histograms of the interval between the callbacks and of the frames per
+ * callback, and the gaps where the sample time jumps beyond the frames of
+ * the callback before, which are samples the capture never got.
+ * The host time is in ticks of any clock, e.g., mach_absolute_time() on
+ * iOS, or a simulated clock.
+ */
+
+#ifndef _CALLBACK_TRACE_H_
+#define _CALLBACK_TRACE_H_
+
+#include <stdint.h>
+
+/** @brief one callback */
+typedef struct callback_event {
+
+    double   sampleTime;    /* of the first frame, mSampleTime on iOS */
+    uint64_t hostTime;      /* in ticks, mHostTime on iOS */
+    int64_t  streamSample;  /* samples of the capture stream before it */
+    int32_t  numFrames;
+
+} CALLBACK_EVENT;
+
+
+typedef struct callback_trace CALLBACK_TRACE;
+
+
+/** @brief create a trace.
+ *
+ *  @param numEvents (in): events kept until read, e.g., a few seconds of
+ *                         callbacks
+ *
+ *  @return trace, or NULL on failure.
+ */
+
+CALLBACK_TRACE* createCallbackTrace( int numEvents );
+
+
+/** @brief add the event of a callback. From one thread only, typically the
+ *         capture thread. Never blocks nor allocates.
+ *
+ *  @return 0:  Success
+ *          -1: The ring is full, and the event is dropped and counted.
+ */
+
+int traceCallback( CALLBACK_TRACE* trace, const CALLBACK_EVENT* event );
+
+
+/** @brief take the events added so far, oldest first. From one thread
+ *         other than the one adding them.
+ *
+ *  @return number of the events copied to events
+ */
+
+int readCallbackTrace(
+    CALLBACK_TRACE* trace,
+    CALLBACK_EVENT* events,
+    int             maxEvents );
+
+
+/** @brief number of the events dropped as the ring was full */
+
+int64_t droppedCallbackEvents( CALLBACK_TRACE* trace );
+
+
+/** @brief release the trace */
+
+void freeCallbackTrace( CALLBACK_TRACE* trace );
+
+
+#define CBT_INTERVAL_BINS     256   /* the last one for all the longer */
+#define CBT_INTERVAL_BIN_MS   0.25
+#define CBT_FRAMES_BINS       256   /* the last one for all the larger */
+#define CBT_FRAMES_PER_BIN    16
+
+
+/** @brief samples of the capture stream lost in a gap */
+typedef struct callback_gap {
+
+    int64_t streamSample;   /* samples of the stream before the gap */
+    int64_t lostFrames;
+
+} CALLBACK_GAP;
+
+
+/** @brief statistics of the callbacks analyzed so far */
+typedef struct callback_timing {
+
+    double  secondsPerHostTick;
+    int64_t numCallbacks;
+
+    /* Between the host times of consecutive callbacks, in bins of
+     * CBT_INTERVAL_BIN_MS, not across a restart. */
+    int64_t numIntervals;
+    int64_t intervalHistogram [ CBT_INTERVAL_BINS ];
+    double  minInterval;        /* [sec] */
+    double  maxInterval;        /* [sec] */
+    double  sumIntervals;       /* [sec] */
+
+    /* Frames of the callbacks, in bins of CBT_FRAMES_PER_BIN. */
+    int64_t framesHistogram   [ CBT_FRAMES_BINS ];
+    int32_t minFrames;
+    int32_t maxFrames;
+
+    int64_t numGaps;
+    int64_t lostFrames;
+    int64_t numRestarts;        /* the sample time went back */
+
+    int            hasLast;
+    CALLBACK_EVENT last;
+
+} CALLBACK_TIMING;
+
+
+/** @brief create the statistics.
+ *
+ *  @param secondsPerHostTick (in): length of a tick of the host time
+ *
+ *  @return statistics, or NULL on failure.
+ */
+
+CALLBACK_TIMING* createCallbackTiming( double secondsPerHostTick );
+
+
+/** @brief add the events, in the order of the callbacks, to the statistics,
+ *         and find the gaps in them. A jump of the sample time of less than
+ *         half a frame is not a gap.
+ *
+ *  @param events    (in):  events from readCallbackTrace()
+ *  @param numEvents (in):  number of the events
+ *  @param gaps      (out): gaps found, the first maxGaps of them
+ *  @param maxGaps   (in):  room of gaps
+ *
+ *  @return number of the gaps found, which may exceed maxGaps
+ */
+
+int analyzeCallbackEvents(
+    CALLBACK_TIMING*      timing,
+    const CALLBACK_EVENT* events,
+    int                   numEvents,
+    CALLBACK_GAP*         gaps,
+    int                   maxGaps    );
+
+
+/** @brief interval under which the fraction of the intervals falls, from
+ *         the histogram, at the upper edge of its bin.
+ *
+ *  @param fraction (in): e.g., 0.5 for the median, 0.99
+ *
+ *  @return interval in [sec], or 0.0 if none yet.
+ */
+
+double callbackIntervalPercentile(
+    const CALLBACK_TIMING* timing,
+    double                 fraction );
+
+
+/** @brief summary of the statistics in a line, for a log.
+ *
+ *  @return length of the summary as snprintf() returns it
+ */
+
+int formatCallbackTiming(
+    const CALLBACK_TIMING* timing,
+    char*                  summary,
+    int                    size     );
+
+
+/** @brief release the statistics */
+
+void freeCallbackTiming( CALLBACK_TIMING* timing );
+
+
+#endif /*_CALLBACK_TRACE_H_*/
@@ -0,0 +1,208 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dropoutMarkers.h"
+#include "sidecarFile.h"
+#include "waveFile.h"
+
+#define DROP_MAGIC              "DROP"
+#define DROP_VERSION            1
+#define DROP_SIDECAR_EXTENSION  ".drop"
+#define DROP_INITIAL_MARKERS    16
+
+
+/** @brief header of the sidecar file, which begins as SIDECAR_PREFIX,
+ *         followed by the markers
+ */
+struct DROP_SIDECAR {
+
+    unsigned char    magic [ 4 ];
+    uint32_t         version;
+    WAVE_FINGERPRINT fingerprint;  /* of the wave file */
+    int32_t          sampleRate;
+    int32_t          numChannels;
+    int64_t          numMarkers;
+
+};
+
+
+DROPOUT_LIST* createDropoutList( int sampleRate, int numChannels )
+{
+    DROPOUT_LIST* list = (DROPOUT_LIST*)calloc( 1, sizeof(DROPOUT_LIST) );
+
+    if ( list == NULL ) {
+        return NULL;
+    }
+
+    list->sampleRate  = sampleRate;
+    list->numChannels = numChannels;
+    list->maxMarkers  = DROP_INITIAL_MARKERS;
+    list->markers     = (DROPOUT_MARKER*)malloc( sizeof(DROPOUT_MARKER)
+                                                 * DROP_INITIAL_MARKERS );
+    if ( list->markers == NULL ) {
+
+        free( list );
+        return NULL;
+    }
+
+    return list;
+}
+
+
+int addDropoutMarker(
+    DROPOUT_LIST* list,
+    int64_t       sourceOffset,
+    int64_t       lostFrames
+) {
+    if ( list->numMarkers == list->maxMarkers ) {
+
+        DROPOUT_MARKER* markers =
+            (DROPOUT_MARKER*)realloc( list->markers,
+                                      sizeof(DROPOUT_MARKER)
+                                      * list->maxMarkers * 2 );
+        if ( markers == NULL ) {
+            return -1;
+        }
+
+        list->markers     = markers;
+        list->maxMarkers *= 2;
+    }
+
+    DROPOUT_MARKER* marker = &(list->markers[ list->numMarkers ]);
+
+    marker->sourceOffset = sourceOffset;
+    marker->lostFrames   = lostFrames;
+
+    list->numMarkers++;
+
+    return 0;
+}
+
+
+void clearDropoutList( DROPOUT_LIST* list )
+{
+    list->numMarkers = 0;
+}
+
+
+int saveDropoutList( const DROPOUT_LIST* list, const char* filename )
+{
+    struct DROP_SIDECAR sidecar;
+    FILE*               fp;
+
+    memset( &sidecar, 0, sizeof(sidecar) );
+    memcpy( sidecar.magic, DROP_MAGIC, 4 );
+
+    fp = fopen( filename, "rb" );
+
+    if ( fp == NULL ) {
+        return -1;
+    }
+
+    int rtnVal = computeWaveFingerprint( fp, &(sidecar.fingerprint) );
+
+    fclose(fp);
+
+    if ( rtnVal != 0 ) {
+        return -1;
+    }
+
+    sidecar.version     = DROP_VERSION;
+    sidecar.sampleRate  = list->sampleRate;
+    sidecar.numChannels = list->numChannels;
+    sidecar.numMarkers  = list->numMarkers;
+
+    char* path = sidecarPathFor( filename, DROP_SIDECAR_EXTENSION );
+
+    if ( path == NULL ) {
+        return -1;
+    }
+
+    size_t markersSize = sizeof(DROPOUT_MARKER) * (size_t)list->numMarkers;
+
+    rtnVal = saveSidecarFile( path,
+                              &sidecar,
+                              sizeof(sidecar),
+                              list->markers,
+                              markersSize );
+
+    free(path);
+
+    return rtnVal;
+}
+
+
+DROPOUT_LIST* loadDropoutList( const char* filename )
+{
+    struct DROP_SIDECAR sidecar;
+    size_t              countOffset = offsetof( struct DROP_SIDECAR,
+                                                numMarkers          );
+
+    DROPOUT_MARKER* markers =
+        (DROPOUT_MARKER*)loadSidecarFile( filename,
+                                          DROP_SIDECAR_EXTENSION,
+                                          DROP_MAGIC,
+                                          DROP_VERSION,
+                                          &sidecar,
+                                          sizeof(sidecar),
+                                          countOffset,
+                                          sizeof(DROPOUT_MARKER)  );
+    if ( markers == NULL ) {
+        return NULL;
+    }
+
+    DROPOUT_LIST* list = (DROPOUT_LIST*)malloc( sizeof(DROPOUT_LIST) );
+
+    if ( list == NULL ) {
+
+        free( markers );
+        return NULL;
+    }
+
+    list->sampleRate  = sidecar.sampleRate;
+    list->numChannels = sidecar.numChannels;
+    list->numMarkers  = sidecar.numMarkers;
+    list->maxMarkers  = sidecar.numMarkers + 1;
+    list->markers     = markers;
+
+    return list;
+}
+
+
+void freeDropoutList( DROPOUT_LIST* list )
+{
+    if ( list == NULL ) {
+        return;
+    }
+
+    free( list->markers );
+    free( list );
+}
+
+
@@ -0,0 +1,115 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Dropout markers of a recording.
+ *
+ * A dropout is a run of frames the capture never got, found by the timing
+ * of the callbacks in callbackTrace.h. The recording goes on over it, so
+ * the frames on both sides are joined in the file, and a marker keeps
+ * where it was and how long. The markers are saved in a sidecar
+ * "<wave file>.drop" tied to the wave file by its fingerprint, as the edit
+ * list of silenceGate.h.
+ */
+
+#ifndef _DROPOUT_MARKERS_H_
+#define _DROPOUT_MARKERS_H_
+
+#include <stdint.h>
+
+/** @brief a dropout. Offsets and lengths are in samples per channel. */
+typedef struct dropout_marker {
+
+    int64_t sourceOffset;  /* in the captured stream since the start, as
+                              GATE_SEGMENT, which is the offset in the file
+                              unless the recording is gated */
+    int64_t lostFrames;
+
+} DROPOUT_MARKER;
+
+
+/** @brief markers of a recording */
+typedef struct dropout_list {
+
+    int             sampleRate;
+    int             numChannels;
+    int64_t         numMarkers;
+    int64_t         maxMarkers;   /* allocated */
+    DROPOUT_MARKER* markers;      /* in the order of sourceOffset */
+
+} DROPOUT_LIST;
+
+
+/** @brief create an empty list.
+ *
+ *  @param sampleRate  (in): sample rate in [Hz]
+ *  @param numChannels (in): number of the interleaved channels
+ *
+ *  @return list, or NULL on failure.
+ */
+
+DROPOUT_LIST* createDropoutList( int sampleRate, int numChannels );
+
+
+/** @brief append a marker after the ones added so far.
+ *
+ *  @return 0:  Success
+ *          -1: Failure
+ */
+
+int addDropoutMarker(
+    DROPOUT_LIST* list,
+    int64_t       sourceOffset,
+    int64_t       lostFrames    );
+
+
+/** @brief remove all the markers */
+
+void clearDropoutList( DROPOUT_LIST* list );
+
+
+/** @brief save the markers in the sidecar of the given wave file, which
+ *         must be complete. An empty list is saved too, to tell that the
+ *         recording had no dropout.
+ *
+ *  @return 0:  Success
+ *          -1: Failure
+ */
+
+int saveDropoutList( const DROPOUT_LIST* list, const char* filename );
+
+
+/** @brief load the markers of the given wave file.
+ *
+ *  @return list to be released by freeDropoutList(), or NULL if none was
+ *          saved or the file has changed since.
+ */
+
+DROPOUT_LIST* loadDropoutList( const char* filename );
+
+
+/** @brief release the list */
+
+void freeDropoutList( DROPOUT_LIST* list );
+
+
+#endif /*_DROPOUT_MARKERS_H_*/
@@ -21,17 +21,45 @@
  * SOFTWARE.
  */
 
-#include "estimateSNR.h"
+#include <pthread.h>
+#include <unistd.h>
 
-#define SNR_HIGH_DB            96.875
-#define SNR_LOW_DB             -28.125
-#define SNR_NUM_BINS           500
-#define SNR_BLOCKSIZE          2048
-#define SNR_NEGATIVE_INFINITY  -20.0
-#define SNR_SMOOTH_BINS        7
-#define SNR_PI                 3.14159265358979323846
-#define SNR_CDB_BUF_SIZE_BYTES 4096
-#define SNR_PEAK_LEVEL         0.95
+#include "estimateSNR.h"
+#include "jobRunner.h"
+#include "sampleMinMax.h"
+#include "waveFile.h"
+
+#define SNR_HIGH_DB             96.875
+#define SNR_LOW_DB              -28.125
+#define SNR_NUM_BINS            500
+#define SNR_BLOCKSIZE           2048
+#define SNR_NEGATIVE_INFINITY   -20.0
+#define SNR_SMOOTH_BINS         7
+#define SNR_MIN_SPAN_BINS       SNR_SMOOTH_BINS  /* narrower is not fitted */
+#define SNR_PI                  3.14159265358979323846
+#define SNR_CDB_BUF_SIZE_BYTES  4096
+#define SNR_PEAK_LEVEL          0.95
+#define SNR_MIN_FRAMES_PER_JOB  6000
+#define SNR_MIN_SAMPLES_PER_JOB 1048576
+#define SNR_PLOT_BUF_SIZE_BYTES 65536
+#define SNR_FIT_MEMO_SIZE       1024
+#define SNR_FIT_EXTEND_DB       5.0
+#define SNR_FRAME_MS            20
+#define SNR_MIN_WINDOWS_PER_JOB 32
+#define SNR_ANALYSIS_RATE       16000
+#define SNR_FIR_TAPS_PER_PHASE  16
+#define SNR_FIR_KAISER_BETA     5.65    /* 60dB of stop band attenuation */
+#define SNR_MAX_DECIMATION      24      /* 384kHz */
+
+#ifndef SNR_USE_DECIMATION
+#define SNR_USE_DECIMATION      1
+#endif
+
+/* 0 makes comp1() evaluate over the full width as it originally did, for
+   tools/snrFitCheck.c to compare the fits. */
+#ifndef SNR_USE_FIT_TABLES
+#define SNR_USE_FIT_TABLES      1
+#endif
 
 /** @brief element of the bucket for the histogram */
 typedef struct hist{
@@ -42,26 +70,158 @@ typedef struct hist{
 
 } SNR_HIST;
 
-/** @brief header of the wave file */
-struct RIFF {
-
-    unsigned char magic [ 4 ];
-    uint32_t      chunkSize;
-    unsigned char wave [ 4 ];
-    unsigned char fmtMarker [ 4 ];
-    uint32_t      subChunkSize;
-    uint16_t      fmtCode;
-    uint16_t      numChannels;
-    uint32_t      sampleRate;
-    uint32_t      SBC;  // (Sample Rate * BitsPerSample * Channels) / 8
-    uint16_t      BPSC; // (BitsPerSample * Channels) / 8
-    uint16_t      BitsPerSample;
-    unsigned char dataMarker [ 4 ];
-    uint32_t      dataSize;
+/** @brief framing of the analysis derived from the wave header.
+ *         An analysis sample of a channel is the output of an anti-alias
+ *         FIR low-pass filter of the channel at every decimation sample
+ *         frames, which brings the rate down to SNR_ANALYSIS_RATE or
+ *         above. The analysis samples stay interleaved, and the widths below
+ *         count all the channels, so that the power of a frame is the
+ *         mean over the channels.
+ */
+typedef struct framing {
+
+    int     numChannels;
+    int     decimation;
+    int     analysisRate;   /* sample rate / decimation              */
+    int     frameWidth;     /* SNR_FRAME_MS in analysis samples      */
+    int     frameAdv;       /* frameWidth / 2                        */
+    int64_t totalSamples;   /* analysis samples in the data chunk    */
+
+} SNR_FRAMING;
+
+
+/** @brief part of the frames assigned to one histogram worker.
+ *         The worker reads the samples from firstFrame * frameAdv up to
+ *         the end of its last frame, i.e., the adjacent jobs overlap
+ *         by ( frameWidth - frameAdv ) samples.
+ */
+typedef struct pwr_hist_job {
+
+    const char* filename;
+    int64_t     dataOffset;
+    const SNR_FRAMING* framing;
+    int*        counts;     /* private histogram of numBins counts */
+    int         numBins;
+    float       from;
+    float       dist;
+    float       dcBias;
+    int64_t     firstFrame;
+    int64_t     numFrames;
+    int         result;
+
+} SNR_PWR_HIST_JOB;
+
+
+/** @brief part of the windows assigned to one timeline worker.
+ *         The worker slides a window histogram over the frames from
+ *         firstWindow * hopFrames, adding the frames entering the window
+ *         and removing the ones leaving it.
+ */
+typedef struct timeline_job {
+
+    const char*        filename;
+    int64_t            dataOffset;
+    const SNR_FRAMING* framing;
+    float              dcBias;
+    int                windowFrames;
+    int                hopFrames;
+    int64_t            firstWindow;
+    int64_t            numWindows;
+    float*             noiseLevels;   /* numWindows levels from firstWindow */
+    float*             speechLevels;
+    int                result;
+
+} SNR_TIMELINE_JOB;
+
+
+/** @brief sliding histogram of the powers of the last historyFrames
+ *         frames. The bins of the frames are kept in a ring buffer as in
+ *         compute_timeline_job(), -1 for the frames below the histogram.
+ */
+struct snr_level_tracker {
+
+    SNR_HIST** hist;
+    int*       ring;
+    int        historyFrames;
+    int64_t    numFrames;    /* tracked since the creation or the reset */
+    int        numCounted;   /* frames in the histogram */
+    float      from;
+    float      dist;
 
 };
 
 
+/** @brief sequential reader of the frames of the analysis samples.
+ *         With decimation, rawBuffer starts with the last numTaps -
+ *         decimation sample frames read, which the filter needs as its
+ *         history, and which are primed from before the first frame.
+ */
+typedef struct frame_reader {
+
+    FILE*              fp;
+    const SNR_FRAMING* framing;
+    short*             readBuffer;
+    short*             rawBuffer;
+    short*             laneBuffer;      /* a channel of rawBuffer         */
+    short*             filter;          /* [ numTaps ] in Q15             */
+    int                numTaps;
+    int64_t            samplesLeft;     /* analysis samples to be read    */
+    int                samplesInBuffer;
+    int                position;        /* next frame in readBuffer       */
+    int                error;
+
+} SNR_FRAME_READER;
+
+
+/** @brief part of the samples assigned to one DC bias worker. */
+typedef struct dc_bias_job {
+
+    const char* filename;
+    int64_t     dataOffset;
+    int64_t     firstSample;
+    int64_t     numSamples;
+    int64_t     sum;         /* exact, independent of the summation order */
+    int64_t     samplesRead; /* fewer than numSamples if cut short */
+    short       minValue;
+    short       maxValue;
+    int         result;
+
+} SNR_DC_BIAS_JOB;
+
+
+/** @brief memoized value of comp1() at a point (middle, height, width) */
+typedef struct fit_memo {
+
+    int   used;
+    int   vector [ 3 ];
+    float result;
+
+} SNR_FIT_MEMO;
+
+
+/** @brief state of the raised cosine fitting by direct_search().
+ *         The squared errors of the reference histogram against zero are
+ *         accumulated in advance, and the cosine values are tabulated per
+ *         width, so that an evaluation of comp1() visits the bins under
+ *         the cosine plus the extension of do_least_squares() only.
+ */
+typedef struct fit {
+
+    SNR_HIST**    ref;
+    SNR_HIST**    hyp;
+    int           numBins;
+    double        extendBins;  /* SNR_FIT_EXTEND_DB in bins            */
+    double*       refSqrSum;   /* refSqrSum[i]: sum of the errors < i  */
+    int           maxWidth;
+    double**      cosTables;   /* cosTables[w]: 2*(w/2)+1 cos values   */
+    double*       wideTable;   /* for the widths beyond maxWidth       */
+    SNR_FIT_MEMO* memo;
+    int           lastVector [ 3 ];
+    int           hasLast;
+
+} SNR_FIT;
+
+
 /******************************/
 /* static function definition */
 /******************************/
@@ -71,17 +231,48 @@ static SNR_HIST** alloc_hist ( int num_bins, int num_elems );
 
 static SNR_HIST** init_hist ( int num_bins, float from, float to );
 
-static float      compute_dc_bias ( const char *filename );
+static void       framing_for (
+                      const WAVE_FILE_INFO* info,
+                      SNR_FRAMING*          framing );
+
+static float      compute_dc_bias (
+                      const char*           filename,
+                      const WAVE_FILE_INFO* info,
+                      int*                  peak      );
+
+static void*      compute_dc_bias_job ( void* p );
 
 static float      pwr1 ( short *win, int len, float dc_bias );
 
 static int        compute_pwr_hist_sd (
-                      const char* filename,
-                      SNR_HIST**  pwr_hist,
+                      const char*           filename,
+                      const WAVE_FILE_INFO* info,
+                      const SNR_FRAMING*    framing,
+                      SNR_HIST**            pwr_hist,
+                      int                   num_bins,
+                      float                 dc_bias   );
+
+static void*      compute_pwr_hist_job ( void* p );
+
+static int        pwr_bin (
+                      float       pwr,
                       int         num_bins,
-                      int         frame_width,
-                      int         frame_adv,
-                      float       dc_bias        );
+                      float       from,
+                      float       dist       );
+
+static int        open_frame_reader (
+                      SNR_FRAME_READER*  reader,
+                      const char*        filename,
+                      int64_t            data_offset,
+                      const SNR_FRAMING* framing,
+                      int64_t            first_frame,
+                      int64_t            num_frames   );
+
+static short*     next_frame ( SNR_FRAME_READER* reader );
+
+static void       close_frame_reader ( SNR_FRAME_READER* reader );
+
+static void*      compute_timeline_job ( void* p );
 
 static void       build_raised_cos_hist (
                       SNR_HIST**   ref_hist,
@@ -108,9 +299,25 @@ static void       hist_copy (
                       int          start,
                       int          end           );
 
-static void       do_init_comp1 ( SNR_HIST **ref, SNR_HIST **hyp, int num_bins);
+static void       do_init_comp1 (
+                      SNR_FIT*   fit,
+                      SNR_HIST** ref,
+                      SNR_HIST** hyp,
+                      int        num_bins        );
+
+static void       do_finish_comp1 ( SNR_FIT* fit );
 
-static float      comp1 ( int *vector );
+static float      comp1 ( SNR_FIT* fit, int *vector );
+
+static float      fit_least_squares (
+                      SNR_FIT*   fit,
+                      int        middle,
+                      int        height,
+                      int        width           );
+
+static double*    fit_cosine_table ( SNR_FIT* fit, int width );
+
+static void       fill_cosine_table ( double* table, int width );
 
 static float      do_least_squares (
                       SNR_HIST**   noise,
@@ -136,9 +343,48 @@ static void       subtract_hist (
 
 static int        hist_area ( SNR_HIST **hist, int num_bins );
 
+static int        occupied_span (
+                      SNR_HIST** hist,
+                      int        num_bins,
+                      int*       first,
+                      int*       last            );
+
 static int        read_bytes ( FILE *fp, char *b, int len );
 
+static int        read_analysis_samples (
+                      FILE*        fp,
+                      short*       out,
+                      short*       raw,
+                      short*       lane,
+                      int          num_samples,
+                      int          num_channels,
+                      int          decimation,
+                      const short* filter,
+                      int          num_taps     );
+
+static void       design_decimation_filter (
+                      short*     filter,
+                      int        num_taps,
+                      int        decimation   );
+
+static double     bessel_i0 ( double x );
+
+static int        plot_columns (
+                      FILE*      fp,
+                      int64_t    total_samples,
+                      int        width,
+                      int*       plot_array,
+                      int*       peak            );
+
+static int        plot_sparse_columns (
+                      FILE*      fp,
+                      int64_t    total_samples,
+                      int        width,
+                      int*       plot_array,
+                      int*       peak            );
+
 static void       direct_search (
+                      SNR_FIT*   fit,
                       int*       IN_psi,
                       int        IN_K,
                       float*     IN_DELTA,
@@ -192,10 +438,10 @@ int *computePeakAndPlots (
     int         width,
     int         height,
     int*        peak,
-    int*        length
+    int64_t*    length
 ) {
 
-    struct RIFF header;
+    WAVE_FILE_INFO info;
 
     FILE *fp;
 
@@ -205,16 +451,14 @@ int *computePeakAndPlots (
         return NULL;
     }
 
-    if ( read_bytes( fp,
-                     (char *)&header,
-                     sizeof(header)   ) < sizeof(header) ) {
+    if ( readWaveFileInfo( fp, &info ) != 0 ) {
 
         fclose(fp);
         return NULL;
     }
 
-    int totalSamples = header.dataSize / 2;
-    
+    int64_t totalSamples = info.totalSamples;
+
     *length = totalSamples;
 
     int *plotArray = (int*)malloc( sizeof(int) * width * 2 );
@@ -227,15 +471,162 @@ int *computePeakAndPlots (
 
     memset(plotArray, 0, sizeof(int) * width * 2 );
 
-    short *readBuffer = (short*)malloc( SNR_CDB_BUF_SIZE_BYTES );
+    int lPeak = 0;
+    int rtnVal;
+
+    if ( width <= totalSamples ) {
+
+        rtnVal = plot_columns( fp, totalSamples, width, plotArray, &lPeak );
+    }
+    else {
+        rtnVal = plot_sparse_columns( fp, totalSamples, width, plotArray, &lPeak );
+    }
+
+    if ( rtnVal != 0 ) {
 
-    if ( readBuffer == NULL ) {
-    
         free(plotArray);
         fclose(fp);
         return NULL;
     }
 
+    *peak =lPeak;
+
+    int i2;
+    double halfHeight = ((double)height) / 2.0 ;
+    
+    for ( i2 = 0; i2 < width * 2; i2++ ) {
+    
+        plotArray[i2] = (int) ( ((double)plotArray[i2])
+                                * halfHeight
+                                / 32767.0
+                                + halfHeight            );
+    }
+
+    fclose(fp);
+
+    return plotArray;
+}
+
+
+/** @brief find the positive and the negative maxima of each column, where
+ *         column x has the samples at pos with x = pos * width / totalSamples,
+ *         i.e., from ceil( x * totalSamples / width ). The boundaries are
+ *         computed once per column, and the samples in between are reduced
+ *         by minMaxOfSamples(). Requires width <= totalSamples so that no
+ *         column is empty.
+ */
+static int plot_columns(
+    FILE*   fp,
+    int64_t totalSamples,
+    int     width,
+    int*    plotArray,
+    int*    peak
+) {
+    short *readBuffer = (short*)malloc( SNR_PLOT_BUF_SIZE_BYTES );
+
+    if ( readBuffer == NULL ) {
+        return -1;
+    }
+
+    int64_t samplesRead = 0;
+    int     currentX    = 0;
+    int64_t nextColumn  = ( totalSamples + width - 1 ) / width;
+    int     maxYp       = 0;
+    int     maxYn       = 0;
+    int     minAll      = 0;
+    int     maxAll      = 0;
+
+    while ( totalSamples > samplesRead ) {
+
+        int64_t samplesToBeRequested = totalSamples - samplesRead;
+
+        if ( samplesToBeRequested > (SNR_PLOT_BUF_SIZE_BYTES / 2) ) {
+
+            samplesToBeRequested = SNR_PLOT_BUF_SIZE_BYTES / 2;
+        }
+
+        int bytesRead = read_bytes( fp,
+                                    (char *)readBuffer,
+                                    (int)samplesToBeRequested * 2 );
+        if ( bytesRead == -1 ) {
+            /* error */
+            free(readBuffer);
+            return -1;
+        }
+
+        if ( bytesRead == 0 ) {
+            /* EOF before the end of the data chunk */
+            break;
+        }
+
+        int numSamples = bytesRead / 2;
+        int i          = 0;
+
+        while ( i < numSamples ) {
+
+            int64_t toBoundary = nextColumn - ( samplesRead + i );
+            int     segment    = ( toBoundary < numSamples - i )
+                                 ? (int)toBoundary : ( numSamples - i );
+            short   segMin;
+            short   segMax;
+
+            minMaxOfSamples( &(readBuffer[i]), segment, &segMin, &segMax );
+
+            maxYp  = ( segMax > maxYp  ) ? segMax : maxYp;
+            maxYn  = ( segMin < maxYn  ) ? segMin : maxYn;
+            maxAll = ( segMax > maxAll ) ? segMax : maxAll;
+            minAll = ( segMin < minAll ) ? segMin : minAll;
+
+            i += segment;
+
+            if ( samplesRead + i == nextColumn ) {
+
+                plotArray [ currentX * 2     ] = maxYp;
+                plotArray [ currentX * 2 + 1 ] = maxYn;
+                currentX++;
+                maxYp = 0;
+                maxYn = 0;
+                nextColumn = ( totalSamples * ( currentX + 1 )
+                               + width - 1 ) / width;
+            }
+        }
+
+        samplesRead += numSamples;
+    }
+
+    if ( currentX < width ) {
+
+        plotArray [ currentX * 2     ] = maxYp;
+        plotArray [ currentX * 2 + 1 ] = maxYn;
+    }
+
+    *peak = ( maxAll > -minAll ) ? maxAll : -minAll;
+
+    free(readBuffer);
+
+    return 0;
+}
+
+
+/** @brief plot_columns() for width > totalSamples, where the columns
+ *         are advanced by one per sample at most. totalSamples is less
+ *         than width, and hence it fits in int.
+ */
+static int plot_sparse_columns(
+    FILE*   fp,
+    int64_t numSamples,
+    int     width,
+    int*    plotArray,
+    int*    peak
+) {
+    int totalSamples = (int)numSamples;
+
+    short *readBuffer = (short*)malloc( SNR_CDB_BUF_SIZE_BYTES );
+
+    if ( readBuffer == NULL ) {
+        return -1;
+    }
+
     int samplesRead = 0;
     int samplesToBeRequested;
 
@@ -260,12 +651,15 @@ int *computePeakAndPlots (
                                    samplesToBeRequested * 2 );
         if ( bytesRead == -1 ) {
             /* error */
-            free(plotArray);
             free(readBuffer);
-            fclose(fp);
-            return NULL;
+            return -1;
         }
-        
+
+        if ( bytesRead == 0 ) {
+            /* EOF before the end of the data chunk */
+            break;
+        }
+
         samplesRead += (bytesRead / 2);
 
         int i;
@@ -282,7 +676,7 @@ int *computePeakAndPlots (
                 plotArray [ currentX * 2     ] = currentMaxYp;
                 plotArray [ currentX * 2 + 1 ] = currentMaxYn;
                 currentX++;
-                
+
                 if ( y >= 0 ) {
                     currentMaxYp = y;
                     currentMaxYn = 0;
@@ -315,118 +709,168 @@ int *computePeakAndPlots (
             samplesToBeRequested = totalSamples - samplesRead;
         }
     }
-    
+
     if ( currentX < width ) {
 
         plotArray [ currentX * 2     ] = currentMaxYp;
         plotArray [ currentX * 2 + 1 ] = currentMaxYn;
-        currentX++;
     }
 
-    while ( currentX < width ) {
+    *peak = lPeak;
+
+    free(readBuffer);
+
+    return 0;
+}
+
+
+static float compute_dc_bias(
+    const char*           filename,
+    const WAVE_FILE_INFO* info,
+    int*                  peak
+) {
+    int64_t totalSamples = info->totalSamples;
 
-        plotArray [ currentX * 2     ] = 0;
-        plotArray [ currentX * 2 + 1 ] = 0;
-        currentX++;
+    if ( peak != NULL ) {
+        *peak = 0;
     }
-    
-    *peak =lPeak;
 
-    int i2;
-    double halfHeight = ((double)height) / 2.0 ;
-    
-    for ( i2 = 0; i2 < width * 2; i2++ ) {
-    
-        plotArray[i2] = (int) ( ((double)plotArray[i2])
-                                * halfHeight
-                                / 32767.0
-                                + halfHeight            );
+    if ( totalSamples <= 0 ) {
+
+        return 0.0;
     }
-    
-    free(readBuffer);
-    fclose(fp);
 
-    return plotArray;
+    int numJobs = numJobsFor( totalSamples, SNR_MIN_SAMPLES_PER_JOB );
+
+    SNR_DC_BIAS_JOB jobs [ JOB_MAX_THREADS ];
+
+    int64_t samplesPerJob = totalSamples / numJobs;
+
+    for ( int i = 0; i < numJobs; i++ ) {
+
+        jobs[i].filename    = filename;
+        jobs[i].dataOffset  = info->dataOffset;
+        jobs[i].firstSample = samplesPerJob * i;
+        jobs[i].numSamples  = ( i == numJobs - 1 )
+                              ? ( totalSamples - samplesPerJob * i )
+                              : samplesPerJob;
+        jobs[i].sum         = 0;
+        jobs[i].samplesRead = 0;
+        jobs[i].minValue    = 0;
+        jobs[i].maxValue    = 0;
+        jobs[i].result      = -1;
+    }
+
+    runJobs( compute_dc_bias_job, jobs, sizeof(SNR_DC_BIAS_JOB), numJobs );
+
+    int64_t sum         = 0;
+    int64_t samplesRead = 0;
+    int     minValue    = 0;
+    int     maxValue    = 0;
+
+    for ( int i = 0; i < numJobs; i++ ) {
+
+        if ( jobs[i].result < 0 ) {
+            return 0.0;
+        }
+        sum         += jobs[i].sum;
+        samplesRead += jobs[i].samplesRead;
+        minValue = ( jobs[i].minValue < minValue ) ? jobs[i].minValue
+                                                   : minValue;
+        maxValue = ( jobs[i].maxValue > maxValue ) ? jobs[i].maxValue
+                                                   : maxValue;
+    }
+
+    if ( peak != NULL ) {
+        *peak = ( maxValue > -minValue ) ? maxValue : -minValue;
+    }
+
+    /* A file cut short has fewer samples than its header says. */
+    if ( samplesRead == 0 ) {
+        return 0.0;
+    }
+
+    return (float)( (double)sum / (double)samplesRead );
 }
 
 
-static float compute_dc_bias( const char *filename )
+static void* compute_dc_bias_job( void* p )
 {
-    struct RIFF header;
-    FILE *fp;
+    SNR_DC_BIAS_JOB* job = (SNR_DC_BIAS_JOB*)p;
+    FILE* fp;
 
-    fp = fopen( filename, "rb" );
+    fp = fopen( job->filename, "rb" );
 
     if ( fp == NULL ) {
 
-        return 0.0;
+        return NULL;
     }
 
-    if(read_bytes ( fp, (char *)&header, sizeof(header) )
-                  < sizeof(header)                        ) {
-
+    if ( fseeko( fp,
+                 (off_t)( job->dataOffset + job->firstSample * 2 ),
+                 SEEK_SET                                          ) != 0 ) {
         fclose(fp);
-        return 0.0;
+        return NULL;
     }
 
-    int    totalSamples = header.dataSize / 2;
-    short* readBuffer   = (short*)malloc(SNR_CDB_BUF_SIZE_BYTES);
+    short* readBuffer = (short*)malloc(SNR_CDB_BUF_SIZE_BYTES);
 
     if ( readBuffer == NULL ) {
         fclose(fp);
-        return 0.0;
+        return NULL;
     }
 
-    double sum         = 0.0;
-    int    samplesRead = 0;
-
-    int samplesToBeRequested;
+    int64_t sum         = 0;
+    int64_t samplesRead = 0;
 
-    if ( ( totalSamples - samplesRead )
-         > (SNR_CDB_BUF_SIZE_BYTES / 2) ) {
+    while ( job->numSamples > samplesRead ) {
 
-        samplesToBeRequested = SNR_CDB_BUF_SIZE_BYTES / 2;
-    }
-    else{
+        int64_t samplesToBeRequested = job->numSamples - samplesRead;
 
-        samplesToBeRequested = totalSamples - samplesRead;
-    }
+        if ( samplesToBeRequested > (SNR_CDB_BUF_SIZE_BYTES / 2) ) {
 
-    while ( totalSamples > samplesRead ) {
+            samplesToBeRequested = SNR_CDB_BUF_SIZE_BYTES / 2;
+        }
 
         int bytesRead = read_bytes ( fp,
                                      (char *)readBuffer,
-                                     samplesToBeRequested * 2 );
+                                     (int)samplesToBeRequested * 2 );
         if ( bytesRead == -1 ) {
             /* error */
             free(readBuffer);
             fclose(fp);
-            return 0.0;
+            return NULL;
+        }
+
+        if ( bytesRead == 0 ) {
+            /* EOF before the end of the data chunk */
+            break;
         }
 
         samplesRead += ( bytesRead / 2 );
 
         for ( int i = 0; i < bytesRead / 2; i++ ) {
-        
-            double val = (double)(readBuffer[i]);
-            sum += val;
-        }
-        
-        if( ( totalSamples - samplesRead)
-            > (SNR_CDB_BUF_SIZE_BYTES / 2) ) {
 
-            samplesToBeRequested = SNR_CDB_BUF_SIZE_BYTES / 2;
+            sum += readBuffer[i];
         }
-        else{
 
-            samplesToBeRequested = totalSamples - samplesRead;
-        }
+        short segMin;
+        short segMax;
+
+        minMaxOfSamples( readBuffer, bytesRead / 2, &segMin, &segMax );
+
+        job->minValue = ( segMin < job->minValue ) ? segMin : job->minValue;
+        job->maxValue = ( segMax > job->maxValue ) ? segMax : job->maxValue;
     }
 
     free(readBuffer);
     fclose(fp);
 
-    return (float)( sum / (double)(samplesRead) );
+    job->sum         = sum;
+    job->samplesRead = samplesRead;
+    job->result      = 0;
+
+    return NULL;
 }
 
 
@@ -435,22 +879,52 @@ int estimateSNR(
     float*      noiseLevel,
     float*      speechLevel
 ) {
+    int peak;
+
+    return estimateSNRAndPeak( filename, noiseLevel, speechLevel, &peak );
+}
+
+
+int estimateSNRAndPeak(
+    const char* filename,
+    float*      noiseLevel,
+    float*      speechLevel,
+    int*        peak
+) {
+
+    WAVE_FILE_INFO info;
+    SNR_FRAMING    framing;
+    FILE*          fp;
+
+    fp = fopen ( filename, "rb" );
+    if ( fp == NULL ) {
+        return -1;
+    }
 
-    int        frameWidth = 320; /* 20ms */
-    int        frameAdv   = frameWidth / 2;
-    float      dcBias     = compute_dc_bias ( filename );
+    if ( readWaveFileInfo( fp, &info ) != 0 ) {
+
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+
+    framing_for( &info, &framing );
+
+    float      dcBias     = compute_dc_bias ( filename, &info, peak );
     SNR_HIST** powerHist  = init_hist ( SNR_NUM_BINS,
                                         SNR_LOW_DB,
                                         SNR_HIGH_DB   );
     int rtn_val;
     rtn_val = compute_pwr_hist_sd( filename,
+                                   &info,
+                                   &framing,
                                    powerHist,
                                    SNR_NUM_BINS,
-                                   frameWidth,
-                                   frameAdv,
                                    dcBias          );
 
     if ( rtn_val < 0 ) {
+        free_hist ( powerHist, SNR_NUM_BINS );
         return -1;
     }
 
@@ -466,15 +940,557 @@ int estimateSNR(
 }
 
 
-static SNR_HIST** init_hist(int numBins, float from, float to)
+/** @brief derive the framing from the sample rate and the number of
+ *         channels. The frame is SNR_FRAME_MS long at any rate. With
+ *         SNR_USE_DECIMATION, the rate is divided by the largest integer
+ *         that keeps it at SNR_ANALYSIS_RATE or above, e.g., by 3 for
+ *         48kHz and by 2 for 44.1kHz, after an anti-alias low-pass, so
+ *         that the frames cover the same band as at 16kHz. The filter
+ *         costs about as much as the frames it saves.
+ */
+static void framing_for( const WAVE_FILE_INFO* info, SNR_FRAMING* framing )
 {
-    SNR_HIST** th;
-    double     dist;
+    int sampleRate  = ( info->sampleRate  > 0 ) ? info->sampleRate
+                                                : SNR_ANALYSIS_RATE;
+    int numChannels = ( info->numChannels > 0 ) ? info->numChannels : 1;
+    int decimation  = 1;
 
-    /* what's the span of possible values */
-    dist = (double) ( to - from );
-    
-    th = alloc_hist( numBins, 1 );
+    if ( SNR_USE_DECIMATION && sampleRate > SNR_ANALYSIS_RATE ) {
+
+        decimation = sampleRate / SNR_ANALYSIS_RATE;
+        decimation = ( decimation < SNR_MAX_DECIMATION ) ? decimation
+                                                         : SNR_MAX_DECIMATION;
+    }
+
+    int frameAdv = ( sampleRate / decimation ) * SNR_FRAME_MS / 1000 / 2;
+
+    if ( frameAdv < 1 ) {
+        frameAdv = 1;
+    }
+
+    framing->numChannels  = numChannels;
+    framing->decimation   = decimation;
+    framing->analysisRate = sampleRate / decimation;
+    framing->frameAdv     = frameAdv * numChannels;
+    framing->frameWidth   = frameAdv * numChannels * 2;
+    framing->totalSamples = info->totalSamples / numChannels / decimation
+                            * numChannels;
+}
+
+
+/** @brief read up to num_samples interleaved analysis samples into out,
+ *         rounded down to whole sample frames. With decimation, each of
+ *         them is the output of the filter of num_taps for the channel,
+ *         at the last of the decimation sample frames read for it into
+ *         raw. raw starts with num_taps - decimation sample frames of
+ *         history, and has room for num_samples * decimation samples after
+ *         them. The history is moved along for the next call. The
+ *         channels are filtered from their copies in lane, as large as raw,
+ *         unless there is one only.
+ *         Without decimation, the samples are read into out directly.
+ *
+ *  @return the number of the analysis samples read, which is less than
+ *          num_samples at EOF, or -1 on error.
+ */
+static int read_analysis_samples(
+    FILE*        fp,
+    short*       out,
+    short*       raw,
+    short*       lane,
+    int          numSamples,
+    int          numChannels,
+    int          decimation,
+    const short* filter,
+    int          numTaps
+) {
+    int numFrames = numSamples / numChannels;
+
+    if ( decimation == 1 ) {
+
+        int bytesRead = read_bytes( fp,
+                                    (char*)out,
+                                    numFrames * numChannels * 2 );
+
+        return ( bytesRead == -1 ) ? -1
+                                   : bytesRead / 2 / numChannels * numChannels;
+    }
+
+    int    historyFrames = numTaps - decimation;
+    short* fresh         = &(raw[ historyFrames * numChannels ]);
+    int    bytesRead     = read_bytes( fp,
+                                       (char*)fresh,
+                                       numFrames * numChannels
+                                                 * decimation * 2 );
+    if ( bytesRead == -1 ) {
+        return -1;
+    }
+
+    int numRead   = bytesRead / 2 / ( numChannels * decimation );
+    int rawFrames = historyFrames + numRead * decimation;
+
+    /* The channels are split in one pass, each into rawFrames of lane. */
+    if ( numChannels > 1 ) {
+
+        for ( int k = 0; k < rawFrames; k++ ) {
+
+            for ( int c = 0; c < numChannels; c++ ) {
+
+                lane[ c * rawFrames + k ] = raw[ k * numChannels + c ];
+            }
+        }
+    }
+
+    for ( int c = 0; c < numChannels; c++ ) {
+
+        const short* x = ( numChannels > 1 ) ? &(lane[ c * rawFrames ]) : raw;
+
+        /* Polyphase: the filter is evaluated at the output samples only,
+           in Q15 with the products summed exactly in 32 bits. */
+        for ( int i = 0; i < numRead; i++ ) {
+
+            const short* window = &(x[ i * decimation ]);
+            int32_t      sum    = 0;
+
+            /* In runs of a constant length, which the compiler unrolls
+               and vectorizes. numTaps is a multiple of it. */
+            for ( int k = 0; k < numTaps; k += SNR_FIR_TAPS_PER_PHASE ) {
+
+                const short* f = &(filter[k]);
+                const short* w = &(window[k]);
+
+                for ( int j = 0; j < SNR_FIR_TAPS_PER_PHASE; j++ ) {
+
+                    sum += (int32_t)f[j] * (int32_t)w[j];
+                }
+            }
+
+            sum = ( sum + 16384 ) >> 15;
+            sum = ( sum >  32767 ) ?  32767 : sum;
+            sum = ( sum < -32768 ) ? -32768 : sum;
+
+            out[ i * numChannels + c ] = (short)sum;
+        }
+    }
+
+    memmove( raw,
+             &(raw[ numRead * decimation * numChannels ]),
+             sizeof(short) * historyFrames * numChannels   );
+
+    return numRead * numChannels;
+}
+
+
+/** @brief a linear phase low-pass of num_taps in Q15, cut off at the
+ *         Nyquist frequency of the decimated rate, by the Kaiser window
+ *         method. The taps sum up to 1 exactly, so that the DC bias passes
+ *         as it is. The sum of their magnitudes stays well below 2, so that
+ *         a 32-bit sum of the products can not overflow.
+ */
+static void design_decimation_filter(
+    short* filter,
+    int    numTaps,
+    int    decimation
+) {
+    double cutoff = 0.5 / decimation;    /* in cycles per sample */
+    double center = ( numTaps - 1 ) / 2.0;
+    double i0Beta = bessel_i0( SNR_FIR_KAISER_BETA );
+    double sum    = 0.0;
+    double taps [ SNR_FIR_TAPS_PER_PHASE * SNR_MAX_DECIMATION ];
+
+    for ( int j = 0; j < numTaps; j++ ) {
+
+        double t      = j - center;
+        double ratio  = t / center;
+        double sinc   = ( t == 0.0 )
+                        ? 2.0 * cutoff
+                        : sin( 2.0 * SNR_PI * cutoff * t ) / ( SNR_PI * t );
+        double window = bessel_i0( SNR_FIR_KAISER_BETA
+                                   * sqrt( 1.0 - ratio * ratio ) ) / i0Beta;
+
+        taps[j] = sinc * window;
+        sum    += taps[j];
+    }
+
+    int total = 0;
+
+    for ( int j = 0; j < numTaps; j++ ) {
+
+        filter[j] = (short)lrint( taps[j] / sum * 32768.0 );
+        total    += filter[j];
+    }
+
+    /* The rounding error goes to the center. */
+    filter[ numTaps / 2 ] += (short)( 32768 - total );
+}
+
+
+/** @brief modified Bessel function of the first kind of order 0 */
+static double bessel_i0( double x )
+{
+    double term = 1.0;
+    double sum  = 1.0;
+
+    for ( int k = 1; k < 50 && term > sum * 1e-12; k++ ) {
+
+        term *= ( x / ( 2.0 * k ) ) * ( x / ( 2.0 * k ) );
+        sum  += term;
+    }
+
+    return sum;
+}
+
+
+SNR_TIMELINE* estimateSNRTimeline(
+    const char* filename,
+    float       windowSeconds,
+    float       hopSeconds
+) {
+    WAVE_FILE_INFO info;
+    SNR_FRAMING    framing;
+    FILE*          fp;
+
+    if ( windowSeconds <= 0.0 || hopSeconds <= 0.0 ) {
+        return NULL;
+    }
+
+    fp = fopen ( filename, "rb" );
+    if ( fp == NULL ) {
+        return NULL;
+    }
+
+    if ( readWaveFileInfo( fp, &info ) != 0 ) {
+
+        fclose(fp);
+        return NULL;
+    }
+
+    fclose(fp);
+
+    framing_for( &info, &framing );
+
+    /* The frames start at every frameAdv analysis samples of all the
+       channels, i.e., every SNR_FRAME_MS / 2. */
+    double frameSeconds = (double)( framing.frameAdv / framing.numChannels )
+                          / (double)framing.analysisRate;
+
+    int64_t totalFrames = 0;
+
+    if ( framing.totalSamples >= framing.frameWidth ) {
+
+        totalFrames = ( framing.totalSamples - framing.frameWidth )
+                      / framing.frameAdv + 1;
+    }
+
+    double windowFramesF = windowSeconds / frameSeconds + 0.5;
+    double hopFramesF    = hopSeconds    / frameSeconds + 0.5;
+
+    /* A file shorter than a window makes one window of all the frames. */
+    if ( windowFramesF > (double)totalFrames ) {
+        windowFramesF = (double)totalFrames;
+    }
+
+    if ( hopFramesF > (double)totalFrames ) {
+        hopFramesF = (double)totalFrames;
+    }
+
+    int windowFrames = ( windowFramesF >= 1.0 ) ? (int)windowFramesF : 1;
+    int hopFrames    = ( hopFramesF    >= 1.0 ) ? (int)hopFramesF    : 1;
+
+    int64_t numWindows = ( totalFrames > 0 )
+                         ? ( totalFrames - windowFrames ) / hopFrames + 1
+                         : 0;
+
+    SNR_TIMELINE* timeline = (SNR_TIMELINE*)calloc( 1, sizeof(SNR_TIMELINE) );
+
+    if ( timeline == NULL ) {
+        return NULL;
+    }
+
+    timeline->numWindows    = numWindows;
+    timeline->windowSeconds = (float)( windowFrames * frameSeconds );
+    timeline->hopSeconds    = (float)( hopFrames    * frameSeconds );
+    timeline->noiseLevels   = (float*)malloc( sizeof(float) * ( numWindows + 1 ) );
+    timeline->speechLevels  = (float*)malloc( sizeof(float) * ( numWindows + 1 ) );
+
+    if ( timeline->noiseLevels == NULL || timeline->speechLevels == NULL ) {
+
+        freeSNRTimeline( timeline );
+        return NULL;
+    }
+
+    if ( numWindows == 0 ) {
+        return timeline;
+    }
+
+    float dcBias         = compute_dc_bias ( filename, &info, NULL );
+    int   numJobs        = numJobsFor( numWindows, SNR_MIN_WINDOWS_PER_JOB );
+    int64_t windowsPerJob = numWindows / numJobs;
+
+    SNR_TIMELINE_JOB jobs [ JOB_MAX_THREADS ];
+
+    for ( int i = 0; i < numJobs; i++ ) {
+
+        jobs[i].filename     = filename;
+        jobs[i].dataOffset   = info.dataOffset;
+        jobs[i].framing      = &framing;
+        jobs[i].dcBias       = dcBias;
+        jobs[i].windowFrames = windowFrames;
+        jobs[i].hopFrames    = hopFrames;
+        jobs[i].firstWindow  = windowsPerJob * i;
+        jobs[i].numWindows   = ( i == numJobs - 1 )
+                               ? ( numWindows - windowsPerJob * i )
+                               : windowsPerJob;
+        jobs[i].noiseLevels  = &(timeline->noiseLevels  [ jobs[i].firstWindow ]);
+        jobs[i].speechLevels = &(timeline->speechLevels [ jobs[i].firstWindow ]);
+        jobs[i].result       = -1;
+    }
+
+    runJobs( compute_timeline_job, jobs, sizeof(SNR_TIMELINE_JOB), numJobs );
+
+    for ( int i = 0; i < numJobs; i++ ) {
+
+        if ( jobs[i].result < 0 ) {
+
+            freeSNRTimeline( timeline );
+            return NULL;
+        }
+    }
+
+    return timeline;
+}
+
+
+void freeSNRTimeline( SNR_TIMELINE* timeline )
+{
+    if ( timeline == NULL ) {
+        return;
+    }
+
+    free( timeline->noiseLevels  );
+    free( timeline->speechLevels );
+    free( timeline );
+}
+
+
+float framePowerDB( const short* samples, int numSamples, float dcBias )
+{
+    return pwr1( (short*)samples, numSamples, dcBias );
+}
+
+
+SNR_LEVEL_TRACKER* createSNRLevelTracker( int historyFrames )
+{
+    if ( historyFrames <= 0 ) {
+        return NULL;
+    }
+
+    SNR_LEVEL_TRACKER* tracker =
+                   (SNR_LEVEL_TRACKER*)calloc( 1, sizeof(SNR_LEVEL_TRACKER) );
+
+    if ( tracker == NULL ) {
+        return NULL;
+    }
+
+    tracker->historyFrames = historyFrames;
+    tracker->ring          = (int*)malloc( sizeof(int) * historyFrames );
+    tracker->hist          = init_hist( SNR_NUM_BINS, SNR_LOW_DB, SNR_HIGH_DB );
+
+    if ( tracker->ring == NULL || tracker->hist == NULL ) {
+
+        freeSNRLevelTracker( tracker );
+        return NULL;
+    }
+
+    tracker->from = tracker->hist [0]->from;
+    tracker->dist = tracker->hist [SNR_NUM_BINS - 1]->to - tracker->from;
+
+    return tracker;
+}
+
+
+void trackSNRFramePower( SNR_LEVEL_TRACKER* tracker, float framePower )
+{
+    int index = -1;
+    int slot  = (int)( tracker->numFrames % tracker->historyFrames );
+
+    if ( framePower != SNR_NEGATIVE_INFINITY ) {
+
+        index = pwr_bin( framePower,
+                         SNR_NUM_BINS,
+                         tracker->from,
+                         tracker->dist  );
+    }
+
+    if (    tracker->numFrames >= tracker->historyFrames
+         && tracker->ring[ slot ] >= 0                   ) {
+
+        tracker->hist [ tracker->ring[ slot ] ]->count--;
+        tracker->numCounted--;
+    }
+
+    tracker->ring[ slot ] = index;
+
+    if ( index >= 0 ) {
+
+        tracker->hist [ index ]->count++;
+        tracker->numCounted++;
+    }
+
+    tracker->numFrames++;
+}
+
+
+int estimateTrackedSNR(
+    SNR_LEVEL_TRACKER* tracker,
+    float*             noiseLevel,
+    float*             speechLevel
+) {
+    if ( tracker->numCounted == 0 ) {
+        return -1;
+    }
+
+    snr ( tracker->hist,
+          SNR_NUM_BINS,
+          SNR_PEAK_LEVEL,
+          noiseLevel,
+          speechLevel     );
+
+    return 0;
+}
+
+
+void resetSNRLevelTracker( SNR_LEVEL_TRACKER* tracker )
+{
+    erase_hist( tracker->hist, SNR_NUM_BINS );
+
+    tracker->numFrames  = 0;
+    tracker->numCounted = 0;
+}
+
+
+void freeSNRLevelTracker( SNR_LEVEL_TRACKER* tracker )
+{
+    if ( tracker == NULL ) {
+        return;
+    }
+
+    if ( tracker->hist != NULL ) {
+        free_hist( tracker->hist, SNR_NUM_BINS );
+    }
+
+    free( tracker->ring );
+    free( tracker );
+}
+
+
+/** @brief compute the levels of the windows of the job. The bins of the
+ *         frames in the current window are kept in a ring buffer, so that
+ *         each frame is read and binned once, and is removed from the
+ *         window histogram when it leaves the window. The frames past the
+ *         end of the file are treated as silence.
+ */
+static void* compute_timeline_job( void* p )
+{
+    SNR_TIMELINE_JOB* job = (SNR_TIMELINE_JOB*)p;
+    SNR_FRAME_READER  reader;
+
+    int64_t numFrames = ( job->numWindows - 1 ) * job->hopFrames
+                        + job->windowFrames;
+
+    SNR_HIST** windowHist = init_hist( SNR_NUM_BINS, SNR_LOW_DB, SNR_HIGH_DB );
+    int*       ring       = (int*)malloc( sizeof(int) * job->windowFrames );
+
+    if ( windowHist == NULL || ring == NULL ) {
+
+        free( ring );
+        if ( windowHist != NULL ) {
+            free_hist( windowHist, SNR_NUM_BINS );
+        }
+        return NULL;
+    }
+
+    float from = windowHist [0]->from;
+    float dist = windowHist [SNR_NUM_BINS - 1]->to - windowHist [0]->from;
+
+    if ( open_frame_reader( &reader,
+                            job->filename,
+                            job->dataOffset,
+                            job->framing,
+                            job->firstWindow * job->hopFrames,
+                            numFrames                          ) != 0 ) {
+        free( ring );
+        free_hist( windowHist, SNR_NUM_BINS );
+        return NULL;
+    }
+
+    int64_t window = 0;
+
+    for ( int64_t i = 0; i < numFrames && window < job->numWindows; i++ ) {
+
+        short* frame = next_frame( &reader );
+        int    index = -1;
+
+        if ( frame != NULL ) {
+
+            float pwr = pwr1( frame, job->framing->frameWidth, job->dcBias );
+
+            if ( pwr != SNR_NEGATIVE_INFINITY ) {
+
+                index = pwr_bin( pwr, SNR_NUM_BINS, from, dist );
+            }
+        }
+        else if ( reader.error ) {
+            break;
+        }
+
+        int slot = (int)( i % job->windowFrames );
+
+        if ( i >= job->windowFrames && ring[ slot ] >= 0 ) {
+
+            windowHist [ ring[ slot ] ]->count--;
+        }
+
+        ring[ slot ] = index;
+
+        if ( index >= 0 ) {
+
+            windowHist [ index ]->count++;
+        }
+
+        if ( i + 1 == window * job->hopFrames + job->windowFrames ) {
+
+            snr ( windowHist,
+                  SNR_NUM_BINS,
+                  SNR_PEAK_LEVEL,
+                  &(job->noiseLevels  [ window ]),
+                  &(job->speechLevels [ window ])  );
+            window++;
+        }
+    }
+
+    int error = reader.error;
+
+    close_frame_reader( &reader );
+    free( ring );
+    free_hist( windowHist, SNR_NUM_BINS );
+
+    if ( error == 0 && window == job->numWindows ) {
+        job->result = 0;
+    }
+
+    return NULL;
+}
+
+
+static SNR_HIST** init_hist(int numBins, float from, float to)
+{
+    SNR_HIST** th;
+    double     dist;
+
+    /* what's the span of possible values */
+    dist = (double) ( to - from );
+    
+    th = alloc_hist( numBins, 1 );
 
     /* initialize the count, and set up the ranges */
     int i;
@@ -486,171 +1502,361 @@ static SNR_HIST** init_hist(int numBins, float from, float to)
                        + ( dist
                            * ( (double)i     / (double)numBins) );
 
-        th[i]->to    = from
-                       + ( dist
-                           * ( (double)(i+1) / (double)numBins) );
+        th[i]->to    = from
+                       + ( dist
+                           * ( (double)(i+1) / (double)numBins) );
+    }
+
+    return th;
+}
+
+
+static SNR_HIST** alloc_hist( int numBins, int numElems )
+{
+    SNR_HIST** th;
+
+    th = (SNR_HIST**)malloc( sizeof(SNR_HIST*) * numBins );
+
+    if ( th == NULL ) {
+        return NULL;
+    }
+
+    int i;
+    for ( i = 0; i <numBins; i++ ) {
+
+        th[i] = (SNR_HIST*)malloc( sizeof(SNR_HIST) * numElems );
+
+        if ( th[i] == NULL ) {
+
+            int j;
+            for ( j = 0; j < i; j++ ) {
+
+                free(th[j]);
+            }
+
+            return NULL;
+        }
+    }
+
+    return th;
+}
+
+
+/** @brief build the power histogram of the frames at every frameAdv
+ *         samples. The frames are split into the jobs of consecutive
+ *         frames, each of which builds its private histogram in parallel.
+ *         The counts are summed up afterwards, and hence the result is
+ *         identical to the one made sequentially.
+ */
+static int compute_pwr_hist_sd(
+
+    const char*           filename,
+    const WAVE_FILE_INFO* info,
+    const SNR_FRAMING*    framing,
+    SNR_HIST**            pwrHist,
+    int                   numBins,
+    float                 dcBias
+
+) {
+    int     frameWidth   = framing->frameWidth;
+    int     frameAdv     = framing->frameAdv;
+    int64_t totalSamples = framing->totalSamples;
+
+    if ( totalSamples < frameWidth ) {
+        return 0; /* OK. No frame. */
+    }
+
+    int64_t totalFrames  = ( totalSamples - frameWidth ) / frameAdv + 1;
+    int     numJobs      = numJobsFor( totalFrames, SNR_MIN_FRAMES_PER_JOB );
+    int64_t framesPerJob = totalFrames / numJobs;
+
+    int* counts = (int*)malloc( sizeof(int) * numBins * numJobs );
+    if ( counts == NULL ) {
+        return -1;
+    }
+
+    memset( counts, 0, sizeof(int) * numBins * numJobs );
+
+    SNR_PWR_HIST_JOB jobs [ JOB_MAX_THREADS ];
+
+    for ( int i = 0; i < numJobs; i++ ) {
+
+        jobs[i].filename   = filename;
+        jobs[i].dataOffset = info->dataOffset;
+        jobs[i].framing    = framing;
+        jobs[i].counts     = &(counts[ numBins * i ]);
+        jobs[i].numBins    = numBins;
+        jobs[i].from       = pwrHist [0]->from;
+        jobs[i].dist       = pwrHist [numBins - 1]->to - pwrHist [0]->from;
+        jobs[i].dcBias     = dcBias;
+        jobs[i].firstFrame = framesPerJob * i;
+        jobs[i].numFrames  = ( i == numJobs - 1 )
+                             ? ( totalFrames - framesPerJob * i )
+                             : framesPerJob;
+        jobs[i].result     = -1;
+    }
+
+    runJobs( compute_pwr_hist_job, jobs, sizeof(SNR_PWR_HIST_JOB), numJobs );
+
+    for ( int i = 0; i < numJobs; i++ ) {
+
+        if ( jobs[i].result < 0 ) {
+
+            free(counts);
+            return -1;
+        }
+
+        for ( int j = 0; j < numBins; j++ ) {
+
+            pwrHist [j]->count += jobs[i].counts[j];
+        }
     }
 
-    return th;
+    free(counts);
+
+    return 0; /* OK */
 }
 
 
-static SNR_HIST** alloc_hist( int numBins, int numElems )
+static void* compute_pwr_hist_job( void* p )
 {
-    SNR_HIST** th;
-
-    th = (SNR_HIST**)malloc( sizeof(SNR_HIST*) * numBins );
-
-    if ( th == NULL ) {
+    SNR_PWR_HIST_JOB* job = (SNR_PWR_HIST_JOB*)p;
+    SNR_FRAME_READER  reader;
+    short*            frame;
+    int               outOfRange = 0;
+
+    if ( open_frame_reader( &reader,
+                            job->filename,
+                            job->dataOffset,
+                            job->framing,
+                            job->firstFrame,
+                            job->numFrames   ) != 0 ) {
         return NULL;
     }
 
-    int i;
-    for ( i = 0; i <numBins; i++ ) {
+    for ( int64_t i = 0; i < job->numFrames; i++ ) {
 
-        th[i] = (SNR_HIST*)malloc( sizeof(SNR_HIST) * numElems );
+        if ( ( frame = next_frame( &reader ) ) == NULL ) {
+            /* EOF before the end of the data chunk */
+            break;
+        }
 
-        if ( th[i] == NULL ) {
+        /* compute log magnitude of (filtered) speech vector */
+        float pwr = pwr1( frame, job->framing->frameWidth, job->dcBias );
 
-            int j;
-            for ( j = 0; j < i; j++ ) {
+        if ( pwr != SNR_NEGATIVE_INFINITY ) {
 
-                free(th[j]);
-            }
+            /* insert that value in the histogram */
+            int index = pwr_bin( pwr, job->numBins, job->from, job->dist );
 
-            return NULL;
+            if ( index >= 0 ) {
+
+                job->counts [index]++;
+            }
+            else{
+                outOfRange++;
+            }
         }
     }
 
-    return th;
+    if ( outOfRange > 0 ) {
+        /*printf("Hist Library: %d samples out of range (%4.2f,%4.2f)\n",
+               _out_of_range,_from,pwr_hist[num_bins-1]->to);*/
+    }
+
+    int error = reader.error;
+
+    close_frame_reader( &reader );
+
+    if ( error == 0 ) {
+        job->result = 0;
+    }
+
+    return NULL;
 }
 
 
-static int compute_pwr_hist_sd(
+/** @brief bin of the histogram for the power, or -1 if out of range. */
+static int pwr_bin( float pwr, int numBins, float from, float dist )
+{
+    int index = (int) ( (float)numBins
+                        * ( (float)pwr - (float)from )
+                        / (float)dist                  );
+
+    return ( ( index >= 0 ) && ( index < numBins ) ) ? index : -1;
+}
 
-    const char*  filename,
-    SNR_HIST**   pwrHist,
-    int          numBins,
-    int          frameWidth,
-    int          frameAdv,
-    float        dcBias
 
+/** @brief open the file and seek to the first frame. The reader delivers
+ *         num_frames frames at most, or fewer at EOF.
+ */
+static int open_frame_reader(
+    SNR_FRAME_READER*  reader,
+    const char*        filename,
+    int64_t            dataOffset,
+    const SNR_FRAMING* framing,
+    int64_t            firstFrame,
+    int64_t            numFrames
 ) {
-    int    samplesRead = 0;
-    float  pwr;
+    memset( reader, 0, sizeof(SNR_FRAME_READER) );
 
-    struct RIFF header;
-    FILE* fp;
+    reader->framing     = framing;
+    reader->samplesLeft = ( numFrames - 1 ) * framing->frameAdv
+                          + framing->frameWidth;
 
-    fp = fopen ( filename, "r" );
-    if(fp == NULL){
+    reader->fp = fopen ( filename, "r" );
+    if ( reader->fp == NULL ) {
         return -1;
     }
 
-    if(read_bytes( fp,
-                   (char *)&header,
-                   sizeof(header)   ) < sizeof(header) ) {
+    int     numChannels   = framing->numChannels;
+    int     decimation    = framing->decimation;
+    int64_t firstRaw      = firstFrame * ( framing->frameAdv / numChannels )
+                                       * decimation;
+    int     historyFrames = 0;
 
-        fclose(fp);
-        return -1;
+    if ( decimation > 1 ) {
+
+        reader->numTaps = SNR_FIR_TAPS_PER_PHASE * decimation;
+        historyFrames   = reader->numTaps - decimation;
     }
 
-    int    totalSamples = header.dataSize / 2;
-    short* readBuffer  = (short*)malloc( SNR_CDB_BUF_SIZE_BYTES +
-                                          +frameWidth * sizeof(short) );
-    if ( readBuffer == NULL ) {
-        fclose(fp);
+    /* The history of the filter is read from before the first frame, and
+       is silence before the start of the data, so that the frames are the
+       same whichever job reads them. */
+    int64_t seekRaw    = ( firstRaw > historyFrames )
+                         ? firstRaw - historyFrames : 0;
+    int     silentRaw  = (int)( historyFrames - ( firstRaw - seekRaw ) );
+
+    if ( fseeko( reader->fp,
+                 (off_t)( dataOffset + seekRaw * numChannels * 2 ),
+                 SEEK_SET                                           ) != 0 ) {
+
+        fclose(reader->fp);
         return -1;
     }
 
-    samplesRead = 0;
-    int samplesProcessed   = 0;
-    int samplesCarriedOver = 0;
-    int samplesToBeRequested;
-    int samplesInBuffer;
+    reader->readBuffer = (short*)malloc( SNR_CDB_BUF_SIZE_BYTES
+                                         + framing->frameWidth * sizeof(short) );
 
-    if( (totalSamples - samplesRead) > (SNR_CDB_BUF_SIZE_BYTES / 2) ) {
+    if ( decimation > 1 ) {
 
-        samplesToBeRequested = (SNR_CDB_BUF_SIZE_BYTES / 2);
+        int rawSamples = SNR_CDB_BUF_SIZE_BYTES / 2 * decimation
+                         + historyFrames * numChannels;
+
+        reader->filter     = (short*)malloc( sizeof(short) * reader->numTaps );
+        reader->rawBuffer  = (short*)calloc( rawSamples, sizeof(short) );
+        reader->laneBuffer = (short*)malloc( sizeof(short) * rawSamples );
     }
-    else{
-        samplesToBeRequested = (totalSamples - samplesRead);
+
+    if (    reader->readBuffer == NULL
+         || ( decimation > 1 && (    reader->rawBuffer  == NULL
+                                  || reader->laneBuffer == NULL
+                                  || reader->filter     == NULL ) ) ) {
+
+        close_frame_reader( reader );
+        return -1;
     }
-    
-    while((totalSamples - samplesProcessed) >= frameWidth ) {
 
-        int bytesRead = read_bytes( fp,
-                                    (char*)&(readBuffer[ samplesCarriedOver ]),
-                                    samplesToBeRequested * 2
-                                  );
-        if ( bytesRead == -1 ) {
+    if ( decimation > 1 ) {
 
-            free(readBuffer);
-            fclose(fp);
+        design_decimation_filter( reader->filter, reader->numTaps, decimation );
+
+        int primeSamples = ( historyFrames - silentRaw ) * numChannels;
+
+        if ( read_bytes( reader->fp,
+                         (char*)&(reader->rawBuffer[ silentRaw * numChannels ]),
+                         primeSamples * 2 ) != primeSamples * 2 ) {
+
+            close_frame_reader( reader );
             return -1;
         }
+    }
+
+    return 0;
+}
 
-        samplesRead    += ( bytesRead / 2 );
-        samplesInBuffer = samplesCarriedOver + ( bytesRead / 2 );
 
-        int index;
-        int outOfRange=0;
-        float from = pwrHist [0]->from;
-        float dist = pwrHist [numBins - 1]->to - pwrHist [0]->from;
+/** @brief return the next frame in the read buffer, which stays valid until
+ *         the next call, or NULL at EOF or on error.
+ */
+static short* next_frame( SNR_FRAME_READER* reader )
+{
+    const SNR_FRAMING* framing = reader->framing;
 
-        int samplesProcessedInBuffer = 0;
-        
-        while( (samplesInBuffer - samplesProcessedInBuffer) >= frameWidth ) {
+    while ( reader->samplesInBuffer - reader->position < framing->frameWidth ) {
 
-            /* compute log magnitude of (filtered) speech vector */
-            pwr = pwr1( &(readBuffer[ samplesProcessedInBuffer ] ),
-                        frameWidth,
-                        dcBias                                     );
+        if ( reader->samplesLeft <= 0 ) {
+            return NULL;
+        }
 
-            if ( pwr != SNR_NEGATIVE_INFINITY ) {
+        int samplesCarriedOver = reader->samplesInBuffer - reader->position;
 
-                /* insert that value in the histogram */
-                index = (int) ( (float)numBins
-                                * ( (float)pwr - (float)from )
-                                / (float)dist                  );
+        memmove( reader->readBuffer,
+                 &(reader->readBuffer [ reader->position ] ),
+                 samplesCarriedOver * 2                       );
 
-                if( ( index >= 0 ) && ( index < numBins ) ) {
+        reader->samplesInBuffer = samplesCarriedOver;
+        reader->position        = 0;
 
-                    pwrHist [index]->count++;
-                }
-                else{
-                    outOfRange++;
-                }
-            }
-            samplesProcessedInBuffer += frameAdv;
-        }
+        int samplesToBeRequested = SNR_CDB_BUF_SIZE_BYTES / 2;
 
-        samplesProcessed += samplesProcessedInBuffer;
-        samplesCarriedOver = samplesInBuffer - samplesProcessedInBuffer;
+        if ( reader->samplesLeft < samplesToBeRequested ) {
 
-        memcpy( readBuffer,
-                &(readBuffer [ samplesProcessedInBuffer ] ),
-                samplesCarriedOver * 2                       );
-        
-        if ( outOfRange > 0 ) {
-            /*printf("Hist Library: %d samples out of range (%4.2f,%4.2f)\n",
-                   _out_of_range,_from,pwr_hist[num_bins-1]->to);*/
+            samplesToBeRequested = (int)reader->samplesLeft;
         }
 
-        if( (totalSamples - samplesRead)
-            > (SNR_CDB_BUF_SIZE_BYTES / 2) ) {
-
-            samplesToBeRequested = ( SNR_CDB_BUF_SIZE_BYTES / 2 );
+        int numRead = read_analysis_samples(
+                          reader->fp,
+                          &(reader->readBuffer[ samplesCarriedOver ]),
+                          reader->rawBuffer,
+                          reader->laneBuffer,
+                          samplesToBeRequested,
+                          framing->numChannels,
+                          framing->decimation,
+                          reader->filter,
+                          reader->numTaps                              );
+        if ( numRead == -1 ) {
+
+            reader->error = 1;
+            return NULL;
         }
-        else{
-            samplesToBeRequested = ( totalSamples - samplesRead );
+
+        if ( numRead == 0 ) {
+
+            reader->samplesLeft = 0;
+            return NULL;
         }
+
+        reader->samplesLeft     -= numRead;
+        reader->samplesInBuffer += numRead;
     }
 
-    free(readBuffer);
-    fclose(fp);
+    short* frame = &(reader->readBuffer[ reader->position ]);
 
-    return 0; /* OK */
+    reader->position += framing->frameAdv;
+
+    return frame;
+}
+
+
+static void close_frame_reader( SNR_FRAME_READER* reader )
+{
+    if ( reader->fp != NULL ) {
+
+        fclose( reader->fp );
+        reader->fp = NULL;
+    }
+
+    free( reader->filter     );
+    free( reader->laneBuffer );
+    free( reader->rawBuffer  );
+    free( reader->readBuffer );
+
+    reader->filter     = NULL;
+    reader->laneBuffer = NULL;
+    reader->rawBuffer  = NULL;
+    reader->readBuffer = NULL;
 }
 
 
@@ -702,6 +1908,27 @@ static void snr (
 
     SNR_HIST** cosHist;
     SNR_HIST** workHist;
+    int        first;
+    int        last;
+
+    if ( hist_area( fullHist, numBins ) == 0 ) {
+
+        /* No frame above the silence. Nothing to fit. */
+        *noiseLevel  = fullHist [0]->from;
+        *speechLevel = fullHist [0]->from;
+        return;
+    }
+
+    if ( occupied_span( fullHist, numBins, &first, &last )
+         < SNR_MIN_SPAN_BINS                               ) {
+
+        /* A few levels only, e.g., a tone or a click in digital silence.
+           There is no shape to fit, and the search for the peak would run
+           off the end of the histogram. */
+        *noiseLevel  = ( fullHist [first]->from + fullHist [first]->to ) / 2;
+        *speechLevel = ( fullHist [last ]->from + fullHist [last ]->to ) / 2;
+        return;
+    }
 
     cosHist  = init_hist( numBins,
                           fullHist [0]->from,
@@ -757,7 +1984,9 @@ void build_raised_cos_hist(
 
     /* find the beginning of the hist and the first peak */
     int i;
-    for ( i = 0; (i < numBins) && (workHist[i]->count <= beginVal ) ; i++ ) {
+    for ( i = 0;
+          ( i < numBins - 1 ) && ( workHist[i]->count <= beginVal );
+          i++                                                      ) {
         /*fprintf(stderr,"In loop1 %d\n",i)*/;
     }
 
@@ -766,7 +1995,7 @@ void build_raised_cos_hist(
 
     /* first the slope method */
     for ( i = beginBin;
-          ( i < numBins)
+          ( i < numBins - 1 )
           && ( ( tmp = hist_slope( workHist, numBins, i, 2 ) ) >= 0 );
           i++                                                           ){
         /*fprintf(stderr, "In loop2 %d\n",i)*/;
@@ -836,10 +2065,14 @@ void build_raised_cos_hist(
     chgLimit[1] = chgFact[1] / 2;
     chgLimit[2] = chgFact[2] / 2;
 
-    do_init_comp1( workHist, retHist, numBins );
+    SNR_FIT fit;
+
+    do_init_comp1( &fit, workHist, retHist, numBins );
+
+    direct_search( &fit, vector, 3, chgFact, 0.7, chgLimit );
+
+    do_finish_comp1( &fit );
 
-    direct_search(vector, 3, chgFact, 0.7, chgLimit );
-  
     special_cosine_hist( retHist,
                          numBins,
                          vector[0],
@@ -937,44 +2170,309 @@ static void hist_copy(
     }
 }
 
-static SNR_HIST** stRef;
-static SNR_HIST** stHyp;
-static int        stNumBins;
+/** @brief set up the fitting. If the tables can not be allocated, or if
+ *         SNR_USE_FIT_TABLES is 0, comp1() falls back to materializing the
+ *         cosine in hyp at every evaluation.
+ */
+static void do_init_comp1(
+    SNR_FIT*   fit,
+    SNR_HIST** ref,
+    SNR_HIST** hyp,
+    int        numBins
+) {
+    fit->ref        = ref;
+    fit->hyp        = hyp;
+    fit->numBins    = numBins;
+    fit->maxWidth   = numBins * 4;
+    fit->hasLast    = 0;
+    fit->extendBins = ( (float)numBins
+                        / ( hyp[numBins-1]->to - hyp[0]->from ) )
+                        * SNR_FIT_EXTEND_DB;
+
+    fit->refSqrSum  = (double*) malloc( sizeof(double) * ( numBins + 1 ) );
+    fit->cosTables  = (double**)calloc( fit->maxWidth + 1, sizeof(double*) );
+    fit->wideTable  = NULL;
+    fit->memo       = (SNR_FIT_MEMO*)calloc( SNR_FIT_MEMO_SIZE,
+                                             sizeof(SNR_FIT_MEMO) );
+
+    if ( !SNR_USE_FIT_TABLES ) {
+
+        free( fit->memo );
+        fit->memo = NULL;
+    }
+
+    if (    !SNR_USE_FIT_TABLES
+         || fit->refSqrSum == NULL || fit->cosTables == NULL ) {
+
+        free( fit->refSqrSum );
+        free( fit->cosTables );
+        fit->refSqrSum = NULL;
+        fit->cosTables = NULL;
+        return;
+    }
+
+    /* Same terms in the same order as do_least_squares() against
+       the empty bins, so that the partial sums are bit-identical. */
+    double sqrSum = 0.0;
+    double sqr;
+    int    i;
+
+    fit->refSqrSum[0] = 0.0;
+
+    for ( i = 0; i < numBins; i++ ) {
+
+        sqr = (float)( ref[i]->count ) * (float)( ref[i]->count );
+
+        if ( ref[i]->count == 0 ) {
+
+            sqrSum += (sqr * sqr);
+        }
+        else{
+
+            sqrSum += sqr;
+        }
+
+        fit->refSqrSum[i+1] = sqrSum;
+    }
+}
+
 
-static void do_init_comp1(SNR_HIST** ref, SNR_HIST** hyp, int numBins )
+/** @brief leave the hypothesis histogram as comp1() used to, i.e., the
+ *         cosine of the last evaluated point, which snr() relies on
+ *         outside of the final cosine. It also releases the tables.
+ */
+static void do_finish_comp1( SNR_FIT* fit )
 {
-    stRef     = ref;
-    stHyp     = hyp;
-    stNumBins = numBins;
+    erase_hist( fit->hyp, fit->numBins );
+
+    if ( fit->hasLast ) {
+
+        special_cosine_hist( fit->hyp,
+                             fit->numBins,
+                             fit->lastVector[0],
+                             fit->lastVector[1],
+                             fit->lastVector[2] );
+    }
+
+    if ( fit->cosTables != NULL ) {
+
+        for ( int w = 0; w <= fit->maxWidth; w++ ) {
+
+            free( fit->cosTables[w] );
+        }
+    }
+
+    free( fit->cosTables );
+    free( fit->wideTable );
+    free( fit->refSqrSum );
+    free( fit->memo      );
 }
 
 
-static float comp1( int* vector )
+static float comp1( SNR_FIT* fit, int* vector )
 {
     float result;
 
-    erase_hist( stHyp, stNumBins );
-    
-    /* at least 4 bins wide, height at least 10 */
-    if ( (vector[0] <= 0) || (vector[1] < 10) || (vector[2] < 4) ) {
-    
-        result = 99999999.99; /* a really large float */
+    fit->lastVector[0] = vector[0];
+    fit->lastVector[1] = vector[1];
+    fit->lastVector[2] = vector[2];
+
+    /* at least 4 bins wide, height at least 10, middle in the histogram */
+    if (    (vector[0] <= 0) || (vector[0] >= fit->numBins)
+         || (vector[1] < 10) || (vector[2] < 4)             ) {
+
+        fit->hasLast = 0;
+
+        return 99999999.99; /* a really large float */
     }
-    else {
 
-        special_cosine_hist( stHyp,
-                             stNumBins,
-                             vector[0],
-                             vector[1],
-                             vector[2]   );
+    fit->hasLast = 1;
+
+    unsigned int  hash = (   (unsigned int)vector[0] * 73856093u
+                           ^ (unsigned int)vector[1] * 19349663u
+                           ^ (unsigned int)vector[2] * 83492791u );
+    SNR_FIT_MEMO* slot = NULL;
+
+    for ( int i = 0; ( fit->memo != NULL ) && ( i < SNR_FIT_MEMO_SIZE ); i++ ) {
+
+        SNR_FIT_MEMO* m = &(fit->memo[ ( hash + i ) % SNR_FIT_MEMO_SIZE ]);
+
+        if ( !m->used ) {
+
+            slot = m;
+            break;
+        }
+
+        if (    m->vector[0] == vector[0]
+             && m->vector[1] == vector[1]
+             && m->vector[2] == vector[2] ) {
+
+            return m->result;
+        }
+    }
+
+    result = fit_least_squares( fit, vector[0], vector[1], vector[2] );
+
+    if ( slot != NULL ) {
 
-        result = do_least_squares( stRef, stHyp, stNumBins );
+        slot->used      = 1;
+        slot->vector[0] = vector[0];
+        slot->vector[1] = vector[1];
+        slot->vector[2] = vector[2];
+        slot->result    = result;
     }
 
     return result;
 }
 
 
+/** @brief do_least_squares() of special_cosine_hist() against the reference
+ *         without materializing the cosine. The bins below the cosine are
+ *         taken from refSqrSum, and the rest is visited in the same order.
+ */
+static float fit_least_squares(
+    SNR_FIT* fit,
+    int      middle,
+    int      height,
+    int      width
+) {
+    SNR_HIST** ref     = fit->ref;
+    int        numBins = fit->numBins;
+    double*    table   = NULL;
+    float      heightby2;
+    double     sqrSum;
+    double     sqr;
+    int        first   = middle - (width/2);
+    int        last    = middle + (width/2);
+    int        i;
+    int        end;
+
+    if ( fit->refSqrSum != NULL ) {
+
+        table = fit_cosine_table( fit, width );
+    }
+
+    if ( table == NULL ) {
+
+        erase_hist( fit->hyp, numBins );
+        special_cosine_hist( fit->hyp, numBins, middle, height, width );
+        return do_least_squares( ref, fit->hyp, numBins );
+    }
+
+    heightby2 = height / 2;
+
+#define SNR_FIT_HYP(bin) ( ( (bin) >= first && (bin) <= last ) \
+                           ? (int)( heightby2                  \
+                                    + heightby2 * table[ (bin) - first ] ) \
+                           : 0 )
+
+    i = ( first > 0 ) ? first : 0;
+
+    while ( (i < numBins) && (i <= last) && ( SNR_FIT_HYP(i) <= 0 ) ) {
+        i++;
+    }
+
+    if ( ( i > last ) || ( i >= numBins ) ) {
+        i = numBins;
+    }
+
+    for ( end = i; end < numBins && ( SNR_FIT_HYP(end) > 0 ); end++ ) {
+        ;
+    }
+
+    if (end >= numBins ) {
+
+        end = numBins - 1;
+    }
+
+    end += fit->extendBins;
+
+    if ( end >= numBins ) {
+
+        end = numBins - 1;
+    }
+
+    if ( i >= end ) {
+
+        return fit->refSqrSum[ end ];
+    }
+
+    sqrSum = fit->refSqrSum[ i ];
+
+    for (; i < end; i++ ) {
+
+        int diff = ref[i]->count - SNR_FIT_HYP(i);
+
+        sqr = (float)diff * (float)diff;
+
+        if ( ref[i]->count == 0 ) {
+
+            sqrSum += (sqr * sqr);
+        }
+        else{
+
+            sqrSum += sqr;
+        }
+    }
+
+#undef SNR_FIT_HYP
+
+    return sqrSum;
+}
+
+
+static double* fit_cosine_table( SNR_FIT* fit, int width )
+{
+    if ( width > fit->maxWidth ) {
+
+        double* table = (double*)realloc( fit->wideTable,
+                                          sizeof(double) * ( width + 1 ) );
+        if ( table == NULL ) {
+            return NULL;
+        }
+
+        fit->wideTable = table;
+        fill_cosine_table( table, width );
+
+        return table;
+    }
+
+    if ( fit->cosTables[ width ] == NULL ) {
+
+        double* table = (double*)malloc( sizeof(double) * ( width + 1 ) );
+        if ( table == NULL ) {
+            return NULL;
+        }
+
+        fill_cosine_table( table, width );
+        fit->cosTables[ width ] = table;
+    }
+
+    return fit->cosTables[ width ];
+}
+
+
+/** @brief the cosine values special_cosine_hist() computes for the width,
+ *         with the same accumulation of the phase in float.
+ */
+static void fill_cosine_table( double* table, int width )
+{
+    int   j;
+    float factor;
+    float cFact = 0.0;
+    float SNR_PI2 = SNR_PI * 2.0;
+
+    factor = 1.0 / (float)(width);
+
+    for ( j = 0; j <= (width/2) * 2; j++ ) {
+
+        table[j] = cos( (float)(cFact * SNR_PI2 - SNR_PI) );
+
+        cFact += factor;
+    }
+}
+
+
 static float do_least_squares(
 
     SNR_HIST** noise,
@@ -1137,6 +2635,32 @@ static int hist_area(SNR_HIST** hist, int numBins )
 }
 
 
+/** @brief find the first and the last bins with a count.
+ *
+ *  @return number of the bins from the first to the last, 0 if all empty
+ */
+static int occupied_span(
+    SNR_HIST** hist,
+    int        numBins,
+    int*       first,
+    int*       last
+) {
+    *first = 0;
+    *last  = -1;
+
+    for ( int i = 0; i < numBins; i++ ) {
+
+        if ( hist[i]->count > 0 ) {
+
+            *first = ( *last < 0 ) ? i : *first;
+            *last  = i;
+        }
+    }
+
+    return *last - *first + 1;
+}
+
+
 /*  this the direct_search algorithm from Robert Hook and T. A. Reeves
     "Direct Search" Solution of Numerical and Statistical Problems
     (Journal ACM 1961 (p212-229)
@@ -1167,6 +2691,7 @@ static int hist_area(SNR_HIST** hist, int numBins )
 
 static void direct_search(
 
+    SNR_FIT* fit,
     int*   IN_psi,
     int    IN_K,
     float* IN_DELTA,
@@ -1194,7 +2719,7 @@ static void direct_search(
     rho   = IN_rho;
     delta = IN_delta;
 
-    Spsi  = comp1(psi);
+    Spsi  = comp1(fit, psi);
 
 L1:
     SS = Spsi;
@@ -1207,7 +2732,7 @@ L1:
     for ( k = 0; k < K; k++ ) {
 
         phi[k] += DELTA[k];
-        Sphi = comp1(phi);
+        Sphi = comp1(fit, phi);
 
         if ( Sphi < SS ) {
 
@@ -1216,7 +2741,7 @@ L1:
         else{
 
             phi[k] -= ( 2 * (int)DELTA[k] );
-            Sphi = comp1(phi);
+            Sphi = comp1(fit, phi);
 
             if ( Sphi < SS ) {
                 SS = Sphi;
@@ -1238,12 +2763,12 @@ L1:
             }
             
             Spsi = SS;
-            SS   = Sphi = comp1(phi);
+            SS   = Sphi = comp1(fit, phi);
 
             for ( k = 0; k < K; k++ ) {
 
                 phi[k] += DELTA[k];
-                Sphi   = comp1(phi);
+                Sphi   = comp1(fit, phi);
                 
                 if ( Sphi < SS ) {
                     SS = Sphi;
@@ -1251,7 +2776,7 @@ L1:
                 else{
                 
                     phi[k] -= ( 2 * (int)DELTA[k] );
-                    Sphi   = comp1(phi);
+                    Sphi   = comp1(fit, phi);
 
                     if ( Sphi < SS ) {
                         SS = Sphi;
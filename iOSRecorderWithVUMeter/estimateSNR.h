@@ -24,7 +24,10 @@
  * Comments on the algorithm:
  *
  * SNR = 10*log_10(RMS_peak_speech / RMS_mean_noise)
- * The window size is 20ms, and the shift is 10ms.
+ * The window size is 20ms, and the shift is 10ms, at the sample rate in
+ * the header. Rates above 16kHz are low-pass filtered and decimated by an
+ * integer factor to 16kHz or just above, and the power of a frame is the
+ * mean over the channels.
  *
  * It first calculates RMS for each frame, and make a histogram.
  * It then finds the average noise power with a raised cosine function with
@@ -62,6 +65,7 @@
 #define _ESTIMATE_SNR_H_
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
@@ -83,6 +87,26 @@ int estimateSNR(
     float*      speechLevel   );
 
 
+/** @brief estimateSNR() that also finds the absolute peak amplitude in the
+ *         pass over the samples for the DC bias, so that the caller does
+ *         not read the file again for it.
+ *
+ *  @param filename    (in):  wave file name
+ *  @param noiseLevel  (out): background noise level in [dB]
+ *  @param speechLevel (out): speech level in [dB]
+ *  @param peak        (out): absolute peak amplitude
+ *
+ *  @return 0:  Success
+ *          -1: Failure mostlikely due to wrong input file.
+ */
+
+int estimateSNRAndPeak(
+    const char* filename,
+    float*      noiseLevel,
+    float*      speechLevel,
+    int*        peak          );
+
+
 /** @brief generate an array of integers to plot the wave on the 2D screen.
  *         The array has width * 2 elements. The elements at even indices
  *         (index starts at 0) are positive amplitude, and at odd indices
@@ -102,7 +126,108 @@ int* computePeakAndPlots(
     int         width,
     int         height,
     int*        peak,
-    int*        length         );
+    int64_t*    length         );
+
+
+/** @brief noise and speech levels over the sliding windows of a wave file.
+ *         Window i covers [ i * hopSeconds, i * hopSeconds + windowSeconds ).
+ */
+typedef struct snr_timeline {
+
+    int64_t numWindows;
+    float   windowSeconds;  /* rounded to the frame shift (10ms) */
+    float   hopSeconds;     /* rounded to the frame shift (10ms) */
+    float*  noiseLevels;    /* [dB] per window */
+    float*  speechLevels;   /* [dB] per window */
+
+} SNR_TIMELINE;
+
+
+/** @brief estimate the speech and the background noise levels over the
+ *         sliding windows of the given wave file in the same way as
+ *         estimateSNR(). The window histograms are updated incrementally
+ *         as the window slides, and the ranges of the windows are
+ *         computed in parallel.
+ *
+ *  @param filename      (in):  wave file name
+ *  @param windowSeconds (in):  length of a window, e.g., 10.0
+ *  @param hopSeconds    (in):  shift of the windows, e.g., 1.0
+ *
+ *  @return the timeline to be released by freeSNRTimeline(),
+ *          or NULL on failure.
+ */
+
+SNR_TIMELINE* estimateSNRTimeline(
+    const char* filename,
+    float       windowSeconds,
+    float       hopSeconds     );
+
+
+/** @brief release the timeline */
+
+void freeSNRTimeline( SNR_TIMELINE* timeline );
+
+
+/** @brief power of a frame in [dB] as estimateSNR() computes it.
+ *
+ *  @param samples     (in):  samples of the frame, interleaved if stereo
+ *  @param numSamples  (in):  number of the samples
+ *  @param dcBias      (in):  DC bias subtracted from the samples
+ *
+ *  @return power in [dB], or -20.0 for a silent or constant frame, which
+ *          the level tracker ignores.
+ */
+
+float framePowerDB(
+    const short* samples,
+    int          numSamples,
+    float        dcBias      );
+
+
+/** @brief sliding histogram of the frame powers of a stream, from which
+ *         the noise and speech levels are estimated in the same way as
+ *         estimateSNR(), over the last historyFrames frames only.
+ */
+typedef struct snr_level_tracker SNR_LEVEL_TRACKER;
+
+
+/** @brief create a tracker.
+ *
+ *  @param historyFrames (in):  number of the latest frames in the histogram
+ *
+ *  @return tracker, or NULL on failure.
+ */
+
+SNR_LEVEL_TRACKER* createSNRLevelTracker( int historyFrames );
+
+
+/** @brief add the power of the next frame from framePowerDB(), and drop
+ *         the oldest one beyond historyFrames.
+ */
+
+void trackSNRFramePower( SNR_LEVEL_TRACKER* tracker, float framePower );
+
+
+/** @brief estimate the levels over the frames in the histogram now.
+ *
+ *  @return 0:  Success
+ *          -1: No frame above the silence yet.
+ */
+
+int estimateTrackedSNR(
+    SNR_LEVEL_TRACKER* tracker,
+    float*             noiseLevel,
+    float*             speechLevel );
+
+
+/** @brief forget all the frames */
+
+void resetSNRLevelTracker( SNR_LEVEL_TRACKER* tracker );
+
+
+/** @brief release the tracker */
+
+void freeSNRLevelTracker( SNR_LEVEL_TRACKER* tracker );
 
 
 
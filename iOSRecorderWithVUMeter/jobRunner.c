@@ -0,0 +1,96 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "jobRunner.h"
+
+
+static int stMaxJobs = JOB_MAX_THREADS;
+
+
+int numJobsFor( int64_t numUnits, int minUnitsPerJob )
+{
+    long numCores = sysconf( _SC_NPROCESSORS_ONLN );
+
+    if ( numCores < 1 ) {
+        numCores = 1;
+    }
+
+    if ( numCores > stMaxJobs ) {
+        numCores = stMaxJobs;
+    }
+
+    int64_t numJobs = numUnits / minUnitsPerJob;
+
+    if ( numJobs > numCores ) {
+        numJobs = numCores;
+    }
+
+    if ( numJobs < 1 ) {
+        numJobs = 1;
+    }
+
+    return (int)numJobs;
+}
+
+
+void limitJobs( int maxJobs )
+{
+    stMaxJobs = ( maxJobs < 1 )               ? 1
+              : ( maxJobs > JOB_MAX_THREADS ) ? JOB_MAX_THREADS
+              :                                 maxJobs;
+}
+
+
+void runJobs(
+    void*  (*func)( void* ),
+    void*    jobs,
+    size_t   jobSize,
+    int      numJobs
+) {
+    pthread_t threads [ JOB_MAX_THREADS ];
+    int       created [ JOB_MAX_THREADS ];
+
+    for ( int i = 1; i < numJobs; i++ ) {
+
+        created[i] = ( pthread_create( &threads[i],
+                                       NULL,
+                                       func,
+                                       (char*)jobs + jobSize * i ) == 0 );
+    }
+
+    func( jobs );
+
+    for ( int i = 1; i < numJobs; i++ ) {
+
+        if ( created[i] ) {
+
+            pthread_join( threads[i], NULL );
+        }
+        else {
+            func( (char*)jobs + jobSize * i );
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Jobs that split a piece of work over the online cores, one of them on the
+ * calling thread, as used by estimateSNR.c and spectrogramTiles.c.
+ */
+
+#ifndef _JOB_RUNNER_H_
+#define _JOB_RUNNER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JOB_MAX_THREADS  8
+
+
+/** @brief decide how many jobs to split the units of work into.
+ *         It is bounded by the number of online cores and JOB_MAX_THREADS,
+ *         and each job gets at least minUnitsPerJob units so that short
+ *         work is done in the calling thread only.
+ *
+ *  @param numUnits        (in):  number of the units of work
+ *  @param minUnitsPerJob  (in):  minimum number of the units per job ( > 0 )
+ *
+ *  @return number of the jobs in [1, JOB_MAX_THREADS]
+ */
+
+int numJobsFor( int64_t numUnits, int minUnitsPerJob );
+
+
+/** @brief limit the number of the jobs from numJobsFor() further, for a
+ *         caller that runs its own pool of threads on the same cores,
+ *         e.g., tools/snrBatch.c. Call it before any job is run.
+ *
+ *  @param maxJobs  (in):  maximum number of the jobs, clamped to
+ *                         [1, JOB_MAX_THREADS]
+ */
+
+void limitJobs( int maxJobs );
+
+
+/** @brief run func on each of the jobs, the first one in the calling
+ *         thread and the rest in their own threads. If a thread can not
+ *         be created, the job is run in the calling thread instead.
+ *
+ *  @param func     (in):  function called with the address of a job
+ *  @param jobs     (in):  array of the jobs
+ *  @param jobSize  (in):  size of a job in bytes
+ *  @param numJobs  (in):  number of the jobs ( <= JOB_MAX_THREADS )
+ */
+
+void runJobs(
+    void*  (*func)( void* ),
+    void*    jobs,
+    size_t   jobSize,
+    int      numJobs          );
+
+
+#endif /*_JOB_RUNNER_H_*/
@@ -0,0 +1,242 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sampleMinMax.h"
+#include "liveWaveform.h"
+
+
+struct live_waveform {
+
+    int            framesPerColumn;
+    int            numChannels;
+    int            numColumns;
+    short*         mins;            /* [ numColumns ] ring */
+    short*         maxs;            /* [ numColumns ] ring */
+
+    /* The column being decimated, by the feed only. */
+    int            partialFrames;
+    short          partialMin;
+    short          partialMax;
+
+    /* Columns completed. Published after each column is written. */
+    atomic_int_fast64_t completed;
+
+    /* Columns reserved. Announced before each column is written. */
+    atomic_int_fast64_t reserved;
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static void append_column( LIVE_WAVEFORM* waveform );
+
+
+LIVE_WAVEFORM* createLiveWaveform(
+    int framesPerColumn,
+    int numChannels,
+    int numColumns
+) {
+    if ( framesPerColumn <= 0 || numChannels <= 0 || numColumns <= 0 ) {
+        return NULL;
+    }
+
+    LIVE_WAVEFORM* waveform =
+                 (LIVE_WAVEFORM*)calloc( 1, sizeof(LIVE_WAVEFORM) );
+
+    if ( waveform == NULL ) {
+        return NULL;
+    }
+
+    waveform->framesPerColumn = framesPerColumn;
+    waveform->numChannels     = numChannels;
+    waveform->numColumns      = numColumns;
+    waveform->mins            = (short*)malloc( sizeof(short) * numColumns );
+    waveform->maxs            = (short*)malloc( sizeof(short) * numColumns );
+
+    if ( waveform->mins == NULL || waveform->maxs == NULL ) {
+
+        freeLiveWaveform( waveform );
+        return NULL;
+    }
+
+    atomic_init( &(waveform->completed), 0 );
+    atomic_init( &(waveform->reserved),  0 );
+
+    return waveform;
+}
+
+
+void feedLiveWaveform(
+    LIVE_WAVEFORM* waveform,
+    const short*   samples,
+    int            numFrames
+) {
+    int chans = waveform->numChannels;
+
+    while ( numFrames > 0 ) {
+
+        int   frames = waveform->framesPerColumn - waveform->partialFrames;
+        short minVal;
+        short maxVal;
+
+        frames = ( frames < numFrames ) ? frames : numFrames;
+
+        /* Each sample is visited once, in a span of a column. */
+        minMaxOfSamples( samples, frames * chans, &minVal, &maxVal );
+
+        if ( waveform->partialFrames == 0 ) {
+
+            waveform->partialMin = minVal;
+            waveform->partialMax = maxVal;
+        }
+        else {
+            if ( minVal < waveform->partialMin ) {
+                waveform->partialMin = minVal;
+            }
+            if ( maxVal > waveform->partialMax ) {
+                waveform->partialMax = maxVal;
+            }
+        }
+
+        waveform->partialFrames += frames;
+        samples                 += frames * chans;
+        numFrames               -= frames;
+
+        if ( waveform->partialFrames == waveform->framesPerColumn ) {
+
+            append_column( waveform );
+        }
+    }
+}
+
+
+/* Announced before it overwrites the slot of the column capacity before
+ * it, and published after, as CaptureHub::write does with the samples. */
+static void append_column( LIVE_WAVEFORM* waveform )
+{
+    int64_t count = atomic_load_explicit( &(waveform->completed),
+                                          memory_order_relaxed    );
+    int     index = (int)( count % waveform->numColumns );
+
+    atomic_store_explicit( &(waveform->reserved),
+                           count + 1,
+                           memory_order_relaxed    );
+
+    atomic_thread_fence( memory_order_seq_cst );
+
+    waveform->mins[ index ] = waveform->partialMin;
+    waveform->maxs[ index ] = waveform->partialMax;
+
+    waveform->partialFrames = 0;
+
+    atomic_store_explicit( &(waveform->completed),
+                           count + 1,
+                           memory_order_release    );
+}
+
+
+int64_t liveWaveformColumns( LIVE_WAVEFORM* waveform )
+{
+    return atomic_load_explicit( &(waveform->completed), memory_order_acquire );
+}
+
+
+int readLiveWaveform(
+    LIVE_WAVEFORM* waveform,
+    int64_t*       next,
+    int            maxColumns,
+    short*         mins,
+    short*         maxs
+) {
+    int64_t completed = liveWaveformColumns( waveform );
+    int64_t capacity  = waveform->numColumns;
+
+    if ( *next < completed - capacity ) {
+        *next = completed - capacity;
+    }
+
+    if ( *next > completed ) {
+        *next = completed;
+    }
+
+    int numColumns = (int)( completed - *next );
+
+    numColumns = ( numColumns < maxColumns ) ? numColumns : maxColumns;
+
+    for ( int i = 0; i < numColumns; ) {
+
+        int index = (int)( ( *next + i ) % capacity );
+        int run   = (int)( capacity - index );
+
+        run = ( run < numColumns - i ) ? run : numColumns - i;
+
+        memcpy( &(mins[i]), &(waveform->mins[index]), sizeof(short) * run );
+        memcpy( &(maxs[i]), &(waveform->maxs[index]), sizeof(short) * run );
+
+        i += run;
+    }
+
+    /* The oldest of them may have been overwritten during the copy by the
+     * columns reserved since, each in the place of the column capacity
+     * before it. Those are dropped. */
+    atomic_thread_fence( memory_order_acquire );
+
+    int64_t overwritten = atomic_load_explicit( &(waveform->reserved),
+                                                memory_order_relaxed    )
+                          - capacity - *next;
+
+    if ( overwritten > 0 ) {
+
+        overwritten = ( overwritten < numColumns ) ? overwritten : numColumns;
+
+        numColumns -= (int)overwritten;
+
+        memmove( mins, &(mins[overwritten]), sizeof(short) * numColumns );
+        memmove( maxs, &(maxs[overwritten]), sizeof(short) * numColumns );
+
+        *next += overwritten;
+    }
+
+    *next += numColumns;
+
+    return numColumns;
+}
+
+
+void freeLiveWaveform( LIVE_WAVEFORM* waveform )
+{
+    if ( waveform == NULL ) {
+        return;
+    }
+
+    free( waveform->mins );
+    free( waveform->maxs );
+    free( waveform );
+}
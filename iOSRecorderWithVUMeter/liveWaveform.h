@@ -0,0 +1,104 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Live waveform of the captured samples, for a view scrolling as they come.
+ *
+ * The samples are decimated once as they are fed, into the minimum and the
+ * maximum of every framesPerColumn frames over all the channels, which
+ * are a column of the plot. The columns are kept in a ring of a fixed
+ * number, so that the memory and the cost of a feed or a read do not grow
+ * with the length of the recording. There is no file access.
+ *
+ * One thread feeds the samples, and another reads the columns appended
+ * since its last read, without locking. A reader falling more than the
+ * ring behind skips the oldest columns.
+ */
+
+#ifndef _LIVE_WAVEFORM_H_
+#define _LIVE_WAVEFORM_H_
+
+#include <stdint.h>
+
+typedef struct live_waveform LIVE_WAVEFORM;
+
+
+/** @brief create a waveform.
+ *
+ *  @param framesPerColumn (in): frames decimated into a column
+ *  @param numChannels     (in): number of the interleaved channels
+ *  @param numColumns      (in): number of the latest columns kept
+ *
+ *  @return waveform, or NULL on failure.
+ */
+
+LIVE_WAVEFORM* createLiveWaveform(
+    int framesPerColumn,
+    int numChannels,
+    int numColumns       );
+
+
+/** @brief decimate the interleaved samples into the columns. A column left
+ *         incomplete is completed by the next feed. From one thread only.
+ *         Does not allocate.
+ *
+ *  @param samples   (in): interleaved samples
+ *  @param numFrames (in): number of the frames
+ */
+
+void feedLiveWaveform(
+    LIVE_WAVEFORM* waveform,
+    const short*   samples,
+    int            numFrames );
+
+
+/** @brief number of the columns completed since the creation. */
+
+int64_t liveWaveformColumns( LIVE_WAVEFORM* waveform );
+
+
+/** @brief copy the columns completed from *next on, oldest first, and
+ *         advance *next past them. From one thread other than the feed.
+ *
+ *  @param next       (in/out): index of the next column to read, from 0.
+ *                              Moved to the oldest column kept if older.
+ *  @param maxColumns (in):     room of mins and maxs in columns
+ *  @param mins       (out):    minimum of each column
+ *  @param maxs       (out):    maximum of each column
+ *
+ *  @return number of the columns copied
+ */
+
+int readLiveWaveform(
+    LIVE_WAVEFORM* waveform,
+    int64_t*       next,
+    int            maxColumns,
+    short*         mins,
+    short*         maxs        );
+
+
+/** @brief release the waveform */
+
+void freeLiveWaveform( LIVE_WAVEFORM* waveform );
+
+
+#endif /*_LIVE_WAVEFORM_H_*/
@@ -0,0 +1,657 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "loudnessMeter.h"
+
+#define LM_SUB_BLOCK_MS        100
+#define LM_MOMENTARY_BLOCKS    4       /* 400ms */
+#define LM_SHORT_TERM_BLOCKS   30      /* 3s */
+#define LM_ABSOLUTE_GATE       -70.0   /* [LUFS] */
+#define LM_RELATIVE_GATE       -10.0   /* [LU]   */
+#define LM_HIST_MAX_LUFS       20.0
+#define LM_HIST_STEP_LU        0.01
+#define LM_LANES               4       /* channels in a vector */
+#define LM_FIR_TAPS            12      /* per phase */
+#define LM_FIR_PHASES          4
+#define LM_SCRATCH_FRAMES      1024
+
+
+/* BS.1770-4 Annex 2. The phase p of the output at n is
+   sum_k LM_FIR[k][p] * x[n-k]. */
+static const float LM_FIR [ LM_FIR_TAPS ][ LM_FIR_PHASES ] = {
+
+    {  0.0017089843750f, -0.0291748046875f,
+      -0.0189208984375f, -0.0083007812500f },
+    {  0.0109863281250f,  0.0292968750000f,
+       0.0330810546875f,  0.0148925781250f },
+    { -0.0196533203125f, -0.0517578125000f,
+      -0.0582275390625f, -0.0266113281250f },
+    {  0.0332031250000f,  0.0891113281250f,
+       0.1015625000000f,  0.0476074218750f },
+    { -0.0594482421875f, -0.1665039062500f,
+      -0.2003173828125f, -0.1022949218750f },
+    {  0.1373291015625f,  0.4650878906250f,
+       0.7797851562500f,  0.9721679687500f },
+    {  0.9721679687500f,  0.7797851562500f,
+       0.4650878906250f,  0.1373291015625f },
+    { -0.1022949218750f, -0.2003173828125f,
+      -0.1665039062500f, -0.0594482421875f },
+    {  0.0476074218750f,  0.1015625000000f,
+       0.0891113281250f,  0.0332031250000f },
+    { -0.0266113281250f, -0.0582275390625f,
+      -0.0517578125000f, -0.0196533203125f },
+    {  0.0148925781250f,  0.0330810546875f,
+       0.0292968750000f,  0.0109863281250f },
+    { -0.0083007812500f, -0.0189208984375f,
+      -0.0291748046875f,  0.0017089843750f }
+};
+
+
+struct loudness_meter {
+
+    int      numChannels;
+    int      numGroups;         /* of LM_LANES channels */
+    int      subBlockFrames;
+
+    float    shelf    [ 5 ];    /* b0, b1, b2, a1, a2 */
+    float    highPass [ 5 ];
+    float*   weights;           /* [ numGroups * LM_LANES ], 0 if padding */
+    float*   state;             /* [ numGroups ][ 4 ][ LM_LANES ] */
+    double*  laneSums;          /* [ numGroups * LM_LANES ] */
+    int      subBlockFill;
+
+    double   subBlocks [ LM_SHORT_TERM_BLOCKS ];  /* weighted powers */
+    int64_t  numSubBlocks;
+    float    momentary;
+    float    shortTerm;
+    float    maxMomentary;
+    float    maxShortTerm;
+
+    int      numBins;
+    uint32_t* binCounts;        /* gating blocks above the absolute gate */
+    double*  binSums;           /* sum of their powers */
+    int64_t  numGated;
+    double   gatedSum;
+
+    float*   history;           /* [ numChannels ][ LM_FIR_TAPS - 1
+                                                    + LM_SCRATCH_FRAMES ] */
+    float    truePeak;          /* linear */
+    int      samplePeak;
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static void  make_biquads ( LOUDNESS_METER* meter, int sample_rate );
+
+static void  weigh_group (
+                 LOUDNESS_METER* meter,
+                 const short*    samples,
+                 int             num_frames,
+                 int             group       );
+
+static float oversampled_peak ( const float* x, int num_frames );
+
+static void  close_sub_block ( LOUDNESS_METER* meter );
+
+static float to_lufs ( double power );
+
+
+LOUDNESS_METER* createLoudnessMeter( int sampleRate, int numChannels )
+{
+    if ( sampleRate <= 0 || numChannels <= 0 ) {
+        return NULL;
+    }
+
+    LOUDNESS_METER* meter = (LOUDNESS_METER*)calloc( 1,
+                                                     sizeof(LOUDNESS_METER) );
+
+    if ( meter == NULL ) {
+        return NULL;
+    }
+
+    int subBlockFrames = sampleRate * LM_SUB_BLOCK_MS / 1000;
+
+    meter->numChannels    = numChannels;
+    meter->numGroups      = ( numChannels + LM_LANES - 1 ) / LM_LANES;
+    meter->subBlockFrames = ( subBlockFrames > 0 ) ? subBlockFrames : 1;
+    meter->numBins        = (int)( ( LM_HIST_MAX_LUFS - LM_ABSOLUTE_GATE )
+                                   / LM_HIST_STEP_LU + 0.5                 );
+
+    int numLanes = meter->numGroups * LM_LANES;
+
+    meter->weights   = (float*) calloc( numLanes, sizeof(float) );
+    meter->state     = (float*) calloc( numLanes * 4, sizeof(float) );
+    meter->laneSums  = (double*)calloc( numLanes, sizeof(double) );
+    meter->binCounts = (uint32_t*)calloc( meter->numBins, sizeof(uint32_t) );
+    meter->binSums   = (double*)calloc( meter->numBins, sizeof(double) );
+    meter->history   = (float*) calloc( (size_t)numChannels
+                                        * ( LM_FIR_TAPS - 1
+                                            + LM_SCRATCH_FRAMES ),
+                                        sizeof(float)             );
+
+    if (    meter->weights   == NULL || meter->state   == NULL
+         || meter->laneSums  == NULL || meter->binSums == NULL
+         || meter->binCounts == NULL || meter->history == NULL ) {
+
+        freeLoudnessMeter( meter );
+        return NULL;
+    }
+
+    for ( int c = 0; c < numChannels; c++ ) {
+
+        int surround = ( numChannels == 5 && c >= 3 )
+                       || ( numChannels == 6 && c >= 4 );
+        int lfe      = ( numChannels == 6 && c == 3 );
+
+        meter->weights[c] = lfe ? 0.0f : surround ? 1.41f : 1.0f;
+    }
+
+    make_biquads( meter, sampleRate );
+
+    resetLoudnessMeter( meter );
+
+    return meter;
+}
+
+
+void resetLoudnessMeter( LOUDNESS_METER* meter )
+{
+    int numLanes = meter->numGroups * LM_LANES;
+
+    memset( meter->state,     0, sizeof(float)    * numLanes * 4     );
+    memset( meter->laneSums,  0, sizeof(double)   * numLanes         );
+    memset( meter->subBlocks, 0, sizeof(meter->subBlocks)            );
+    memset( meter->binCounts, 0, sizeof(uint32_t) * meter->numBins   );
+    memset( meter->binSums,   0, sizeof(double)   * meter->numBins   );
+    memset( meter->history,   0, sizeof(float)    * meter->numChannels
+                                 * ( LM_FIR_TAPS - 1 )               );
+
+    meter->subBlockFill = 0;
+    meter->numSubBlocks = 0;
+    meter->momentary    = LM_SILENCE_LUFS;
+    meter->shortTerm    = LM_SILENCE_LUFS;
+    meter->maxMomentary = LM_SILENCE_LUFS;
+    meter->maxShortTerm = LM_SILENCE_LUFS;
+    meter->numGated     = 0;
+    meter->gatedSum     = 0.0;
+    meter->truePeak     = 0.0f;
+    meter->samplePeak   = 0;
+}
+
+
+void feedLoudnessMeter(
+    LOUDNESS_METER* meter,
+    const short*    samples,
+    int             numFrames
+) {
+    const int stride = LM_FIR_TAPS - 1 + LM_SCRATCH_FRAMES;
+
+    while ( numFrames > 0 ) {
+
+        /* Up to the end of the sub-block, and within the scratch. */
+        int n = meter->subBlockFrames - meter->subBlockFill;
+
+        n = ( n < numFrames         ) ? n : numFrames;
+        n = ( n < LM_SCRATCH_FRAMES ) ? n : LM_SCRATCH_FRAMES;
+
+        for ( int g = 0; g < meter->numGroups; g++ ) {
+            weigh_group( meter, samples, n, g );
+        }
+
+        for ( int c = 0; c < meter->numChannels; c++ ) {
+
+            float* x    = &(meter->history[ c * stride ]);
+            int    peak = meter->samplePeak;
+
+            for ( int i = 0; i < n; i++ ) {
+
+                int v   = samples[ i * meter->numChannels + c ];
+                int abs = ( v < 0 ) ? -v : v;
+
+                peak = ( abs > peak ) ? abs : peak;
+
+                x[ LM_FIR_TAPS - 1 + i ] = v * ( 1.0f / 32768.0f );
+            }
+
+            float truePeak = oversampled_peak( x, n );
+
+            meter->samplePeak = peak;
+            meter->truePeak   = ( truePeak > meter->truePeak )
+                                ? truePeak : meter->truePeak;
+
+            memmove( x, &(x[n]), sizeof(float) * ( LM_FIR_TAPS - 1 ) );
+        }
+
+        samples             += n * meter->numChannels;
+        numFrames           -= n;
+        meter->subBlockFill += n;
+
+        if ( meter->subBlockFill == meter->subBlockFrames ) {
+            close_sub_block( meter );
+        }
+    }
+}
+
+
+void loudnessLevels( LOUDNESS_METER* meter, LOUDNESS_LEVELS* levels )
+{
+    levels->momentary    = meter->momentary;
+    levels->shortTerm    = meter->shortTerm;
+    levels->maxMomentary = meter->maxMomentary;
+    levels->maxShortTerm = meter->maxShortTerm;
+    levels->integrated   = LM_SILENCE_LUFS;
+
+    if ( meter->numGated > 0 ) {
+
+        /* The relative gate, with the bins whose mean is above it. */
+        double  gate  = to_lufs( meter->gatedSum / meter->numGated )
+                        + LM_RELATIVE_GATE;
+        int     first = (int)( ( gate - LM_ABSOLUTE_GATE ) / LM_HIST_STEP_LU );
+        int64_t count = 0;
+        double  sum   = 0.0;
+
+        first = ( first > 0 ) ? first : 0;
+
+        for ( int b = first; b < meter->numBins; b++ ) {
+
+            uint32_t n = meter->binCounts[b];
+
+            if ( n > 0 && to_lufs( meter->binSums[b] / n ) > gate ) {
+
+                count += n;
+                sum   += meter->binSums[b];
+            }
+        }
+
+        if ( count > 0 ) {
+            levels->integrated = to_lufs( sum / count );
+        }
+    }
+
+    levels->truePeak   = ( meter->truePeak > 0.0f )
+                         ? 20.0f * log10f( meter->truePeak )
+                         : LM_SILENCE_LUFS;
+    levels->samplePeak = ( meter->samplePeak > 0 )
+                         ? 20.0f * log10f( meter->samplePeak / 32768.0f )
+                         : LM_SILENCE_LUFS;
+}
+
+
+void freeLoudnessMeter( LOUDNESS_METER* meter )
+{
+    if ( meter == NULL ) {
+        return;
+    }
+
+    free( meter->weights   );
+    free( meter->state     );
+    free( meter->laneSums  );
+    free( meter->binCounts );
+    free( meter->binSums   );
+    free( meter->history   );
+    free( meter );
+}
+
+
+/** @brief the K-weighting filters of BS.1770 at the sample rate, from
+ *         their analog prototypes by the bilinear transform. At 48kHz they
+ *         are the coefficients in the standard.
+ */
+static void make_biquads( LOUDNESS_METER* meter, int sampleRate )
+{
+    /* Stage 1: high shelf of about +4dB above 1.5kHz for the head. */
+    double f0 = 1681.974450955533;
+    double G  = 3.999843853973347;
+    double Q  = 0.7071752369554196;
+    double K  = tan( M_PI * f0 / sampleRate );
+    double Vh = pow( 10.0, G / 20.0 );
+    double Vb = pow( Vh, 0.4996667741545416 );
+    double a0 = 1.0 + K / Q + K * K;
+
+    meter->shelf[0] = (float)( ( Vh + Vb * K / Q + K * K ) / a0 );
+    meter->shelf[1] = (float)( 2.0 * ( K * K - Vh ) / a0 );
+    meter->shelf[2] = (float)( ( Vh - Vb * K / Q + K * K ) / a0 );
+    meter->shelf[3] = (float)( 2.0 * ( K * K - 1.0 ) / a0 );
+    meter->shelf[4] = (float)( ( 1.0 - K / Q + K * K ) / a0 );
+
+    /* Stage 2: the RLB high-pass at about 38Hz. */
+    f0 = 38.13547087602444;
+    Q  = 0.5003270373238773;
+    K  = tan( M_PI * f0 / sampleRate );
+    a0 = 1.0 + K / Q + K * K;
+
+    meter->highPass[0] =  1.0f;
+    meter->highPass[1] = -2.0f;
+    meter->highPass[2] =  1.0f;
+    meter->highPass[3] = (float)( 2.0 * ( K * K - 1.0 ) / a0 );
+    meter->highPass[4] = (float)( ( 1.0 - K / Q + K * K ) / a0 );
+}
+
+
+/** @brief K-weight the channels of a group in the lanes of a vector, in
+ *         the transposed direct form II, and add up their squares into
+ *         laneSums.
+ */
+static void weigh_group(
+    LOUDNESS_METER* meter,
+    const short*    samples,
+    int             numFrames,
+    int             group
+) {
+    const int    numChannels = meter->numChannels;
+    const int    first       = group * LM_LANES;
+    const int    numLanes    = ( numChannels - first < LM_LANES )
+                               ? numChannels - first : LM_LANES;
+    const float* s           = meter->shelf;
+    const float* h           = meter->highPass;
+    float*       state       = &(meter->state[ group * 4 * LM_LANES ]);
+    float        in  [ LM_LANES ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float        acc [ LM_LANES ];
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+    float32x4_t z1s = vld1q_f32( &(state[ 0 ]) );
+    float32x4_t z2s = vld1q_f32( &(state[ 4 ]) );
+    float32x4_t z1h = vld1q_f32( &(state[ 8 ]) );
+    float32x4_t z2h = vld1q_f32( &(state[12 ]) );
+    float32x4_t sum = vdupq_n_f32( 0.0f );
+
+    for ( int i = 0; i < numFrames; i++ ) {
+
+        const short* frame = &(samples[ i * numChannels + first ]);
+
+        for ( int l = 0; l < numLanes; l++ ) {
+            in[l] = frame[l] * ( 1.0f / 32768.0f );
+        }
+
+        float32x4_t x = vld1q_f32( in );
+        float32x4_t y = vmlaq_n_f32( z1s, x, s[0] );
+
+        z1s = vmlsq_n_f32( vmlaq_n_f32( z2s, x, s[1] ), y, s[3] );
+        z2s = vmlsq_n_f32( vmulq_n_f32( x, s[2] ),      y, s[4] );
+
+        x   = y;
+        y   = vmlaq_n_f32( z1h, x, h[0] );
+
+        z1h = vmlsq_n_f32( vmlaq_n_f32( z2h, x, h[1] ), y, h[3] );
+        z2h = vmlsq_n_f32( vmulq_n_f32( x, h[2] ),      y, h[4] );
+
+        sum = vmlaq_f32( sum, y, y );
+    }
+
+    vst1q_f32( &(state[ 0 ]), z1s );
+    vst1q_f32( &(state[ 4 ]), z2s );
+    vst1q_f32( &(state[ 8 ]), z1h );
+    vst1q_f32( &(state[12 ]), z2h );
+    vst1q_f32( acc, sum );
+
+#elif defined(__SSE2__)
+
+    __m128 s0  = _mm_set1_ps( s[0] ), s1 = _mm_set1_ps( s[1] );
+    __m128 s2  = _mm_set1_ps( s[2] ), s3 = _mm_set1_ps( s[3] );
+    __m128 s4  = _mm_set1_ps( s[4] );
+    __m128 h0  = _mm_set1_ps( h[0] ), h1 = _mm_set1_ps( h[1] );
+    __m128 h2  = _mm_set1_ps( h[2] ), h3 = _mm_set1_ps( h[3] );
+    __m128 h4  = _mm_set1_ps( h[4] );
+    __m128 z1s = _mm_loadu_ps( &(state[ 0 ]) );
+    __m128 z2s = _mm_loadu_ps( &(state[ 4 ]) );
+    __m128 z1h = _mm_loadu_ps( &(state[ 8 ]) );
+    __m128 z2h = _mm_loadu_ps( &(state[12 ]) );
+    __m128 sum = _mm_setzero_ps();
+
+    for ( int i = 0; i < numFrames; i++ ) {
+
+        const short* frame = &(samples[ i * numChannels + first ]);
+
+        for ( int l = 0; l < numLanes; l++ ) {
+            in[l] = frame[l] * ( 1.0f / 32768.0f );
+        }
+
+        __m128 x = _mm_loadu_ps( in );
+        __m128 y = _mm_add_ps( _mm_mul_ps( x, s0 ), z1s );
+
+        z1s = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( x, s1 ), z2s ),
+                          _mm_mul_ps( y, s3 )                     );
+        z2s = _mm_sub_ps( _mm_mul_ps( x, s2 ), _mm_mul_ps( y, s4 ) );
+
+        x   = y;
+        y   = _mm_add_ps( _mm_mul_ps( x, h0 ), z1h );
+
+        z1h = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( x, h1 ), z2h ),
+                          _mm_mul_ps( y, h3 )                     );
+        z2h = _mm_sub_ps( _mm_mul_ps( x, h2 ), _mm_mul_ps( y, h4 ) );
+
+        sum = _mm_add_ps( sum, _mm_mul_ps( y, y ) );
+    }
+
+    _mm_storeu_ps( &(state[ 0 ]), z1s );
+    _mm_storeu_ps( &(state[ 4 ]), z2s );
+    _mm_storeu_ps( &(state[ 8 ]), z1h );
+    _mm_storeu_ps( &(state[12 ]), z2h );
+    _mm_storeu_ps( acc, sum );
+
+#else
+
+    for ( int l = 0; l < LM_LANES; l++ ) {
+        acc[l] = 0.0f;
+    }
+
+    for ( int i = 0; i < numFrames; i++ ) {
+
+        const short* frame = &(samples[ i * numChannels + first ]);
+
+        for ( int l = 0; l < numLanes; l++ ) {
+
+            float* z = &(state[l]);     /* z1s, z2s, z1h, z2h at 0,4,8,12 */
+            float  x = frame[l] * ( 1.0f / 32768.0f );
+            float  y = s[0] * x + z[0];
+
+            z[0] = s[1] * x + z[4] - s[3] * y;
+            z[4] = s[2] * x        - s[4] * y;
+
+            x    = y;
+            y    = h[0] * x + z[8];
+
+            z[8]  = h[1] * x + z[12] - h[3] * y;
+            z[12] = h[2] * x         - h[4] * y;
+
+            acc[l] += y * y;
+        }
+    }
+
+#endif
+
+    for ( int l = 0; l < numLanes; l++ ) {
+        meter->laneSums[ first + l ] += acc[l];
+    }
+}
+
+
+/** @brief the largest magnitude of the 4 phases of the oversampled signal
+ *         at the numFrames samples from x[ LM_FIR_TAPS - 1 ], with the
+ *         phases in the lanes of a vector.
+ */
+static float oversampled_peak( const float* x, int numFrames )
+{
+    const float* in = &(x[ LM_FIR_TAPS - 1 ]);
+    float        peaks [ LM_FIR_PHASES ];
+    float        peak = 0.0f;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+    float32x4_t coeffs [ LM_FIR_TAPS ];
+    float32x4_t vPeak = vdupq_n_f32( 0.0f );
+
+    for ( int k = 0; k < LM_FIR_TAPS; k++ ) {
+        coeffs[k] = vld1q_f32( LM_FIR[k] );
+    }
+
+    for ( int i = 0; i < numFrames; i++ ) {
+
+        float32x4_t y = vmulq_n_f32( coeffs[0], in[i] );
+
+        for ( int k = 1; k < LM_FIR_TAPS; k++ ) {
+            y = vmlaq_n_f32( y, coeffs[k], in[ i - k ] );
+        }
+
+        vPeak = vmaxq_f32( vPeak, vabsq_f32( y ) );
+    }
+
+    vst1q_f32( peaks, vPeak );
+
+#elif defined(__SSE2__)
+
+    const __m128 signBit = _mm_set1_ps( -0.0f );
+    __m128       coeffs [ LM_FIR_TAPS ];
+    __m128       vPeak = _mm_setzero_ps();
+
+    for ( int k = 0; k < LM_FIR_TAPS; k++ ) {
+        coeffs[k] = _mm_loadu_ps( LM_FIR[k] );
+    }
+
+    for ( int i = 0; i < numFrames; i++ ) {
+
+        __m128 y = _mm_mul_ps( coeffs[0], _mm_set1_ps( in[i] ) );
+
+        for ( int k = 1; k < LM_FIR_TAPS; k++ ) {
+            y = _mm_add_ps( y, _mm_mul_ps( coeffs[k],
+                                           _mm_set1_ps( in[ i - k ] ) ) );
+        }
+
+        vPeak = _mm_max_ps( vPeak, _mm_andnot_ps( signBit, y ) );
+    }
+
+    _mm_storeu_ps( peaks, vPeak );
+
+#else
+
+    for ( int p = 0; p < LM_FIR_PHASES; p++ ) {
+        peaks[p] = 0.0f;
+    }
+
+    for ( int i = 0; i < numFrames; i++ ) {
+
+        for ( int p = 0; p < LM_FIR_PHASES; p++ ) {
+
+            float y = 0.0f;
+
+            for ( int k = 0; k < LM_FIR_TAPS; k++ ) {
+                y += LM_FIR[k][p] * in[ i - k ];
+            }
+
+            peaks[p] = ( fabsf( y ) > peaks[p] ) ? fabsf( y ) : peaks[p];
+        }
+    }
+
+#endif
+
+    for ( int p = 0; p < LM_FIR_PHASES; p++ ) {
+        peak = ( peaks[p] > peak ) ? peaks[p] : peak;
+    }
+
+    return peak;
+}
+
+
+/** @brief turn the lane sums into the power of the sub-block, update the
+ *         momentary and the short-term loudness, and add the gating block
+ *         ending here to the histogram.
+ */
+static void close_sub_block( LOUDNESS_METER* meter )
+{
+    int    numLanes = meter->numGroups * LM_LANES;
+    double power    = 0.0;
+
+    for ( int l = 0; l < numLanes; l++ ) {
+
+        power += meter->weights[l] * meter->laneSums[l];
+        meter->laneSums[l] = 0.0;
+    }
+
+    power /= meter->subBlockFrames;
+
+    meter->subBlocks[ meter->numSubBlocks % LM_SHORT_TERM_BLOCKS ] = power;
+    meter->numSubBlocks++;
+    meter->subBlockFill = 0;
+
+    /* The windows are taken as silent before the start. */
+    double momentary = 0.0;
+    double shortTerm = 0.0;
+
+    for ( int b = 0; b < LM_SHORT_TERM_BLOCKS; b++ ) {
+        shortTerm += meter->subBlocks[b];
+    }
+
+    for ( int b = 1; b <= LM_MOMENTARY_BLOCKS; b++ ) {
+
+        momentary += meter->subBlocks[ ( meter->numSubBlocks - b
+                                         + LM_SHORT_TERM_BLOCKS )
+                                       % LM_SHORT_TERM_BLOCKS     ];
+    }
+
+    momentary /= LM_MOMENTARY_BLOCKS;
+    shortTerm /= LM_SHORT_TERM_BLOCKS;
+
+    meter->momentary    = to_lufs( momentary );
+    meter->shortTerm    = to_lufs( shortTerm );
+    meter->maxMomentary = ( meter->momentary > meter->maxMomentary )
+                          ? meter->momentary : meter->maxMomentary;
+    meter->maxShortTerm = ( meter->shortTerm > meter->maxShortTerm )
+                          ? meter->shortTerm : meter->maxShortTerm;
+
+    /* Only the gating blocks of the full 400ms. */
+    if ( meter->numSubBlocks >= LM_MOMENTARY_BLOCKS
+         && meter->momentary > LM_ABSOLUTE_GATE       ) {
+
+        int bin = (int)( ( meter->momentary - LM_ABSOLUTE_GATE )
+                         / LM_HIST_STEP_LU                       );
+
+        bin = ( bin < meter->numBins ) ? bin : meter->numBins - 1;
+
+        meter->binCounts[bin]++;
+        meter->binSums  [bin] += momentary;
+        meter->numGated++;
+        meter->gatedSum       += momentary;
+    }
+}
+
+
+static float to_lufs( double power )
+{
+    return ( power > 0.0 ) ? (float)( -0.691 + 10.0 * log10( power ) )
+                           : LM_SILENCE_LUFS;
+}
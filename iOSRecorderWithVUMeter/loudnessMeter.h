@@ -0,0 +1,120 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Loudness and true-peak metering after ITU-R BS.1770-4 and EBU R128.
+ *
+ * Each channel is K-weighted by the two biquads of BS.1770, a high shelf
+ * and a high-pass, and the mean squares are summed over the channels with
+ * their weights into the power of every 100ms sub-block:
+ *
+ *   L = -0.691 + 10 * log10( sum_c G_c * z_c )  [LUFS]
+ *
+ * The momentary loudness is over the last 4 sub-blocks (400ms) and the
+ * short-term over the last 30 (3s). The integrated loudness is over the
+ * gating blocks of 400ms at every 100ms. The blocks below -70 LUFS are
+ * dropped, then the ones 10 LU below the mean of the rest. The blocks are
+ * kept in a histogram of LM_HIST_STEP_LU wide bins, each with the sum of
+ * its powers, so that the memory does not grow with the duration and the
+ * relative gate is off by at most one bin.
+ *
+ * The true peak is the sample peak of the signal oversampled by 4 with the
+ * 48-tap polyphase FIR of BS.1770-4 Annex 2.
+ *
+ * All the memory is taken by createLoudnessMeter(). feedLoudnessMeter()
+ * does not allocate, and runs the filters of up to 4 channels in the
+ * lanes of a vector, and the 4 phases of the FIR in the lanes of another,
+ * with NEON or SSE2 where available.
+ */
+
+#ifndef _LOUDNESS_METER_H_
+#define _LOUDNESS_METER_H_
+
+#include <stdint.h>
+
+/* Floor of the levels reported when there is nothing to measure. */
+#define LM_SILENCE_LUFS  -200.0f
+
+typedef struct loudness_meter LOUDNESS_METER;
+
+
+/** @brief levels since the start or the reset */
+typedef struct loudness_levels {
+
+    float momentary;        /* [LUFS] over the last 400ms */
+    float shortTerm;        /* [LUFS] over the last 3s */
+    float integrated;       /* [LUFS] gated, over all the samples */
+    float maxMomentary;     /* [LUFS] */
+    float maxShortTerm;     /* [LUFS] */
+    float truePeak;         /* [dBTP] over all the channels */
+    float samplePeak;       /* [dBFS] over all the channels */
+
+} LOUDNESS_LEVELS;
+
+
+/** @brief create a meter.
+ *
+ *  @param sampleRate  (in): sample rate in [Hz]
+ *  @param numChannels (in): number of the interleaved channels. With 5, the
+ *                           order is L, R, C, Ls, Rs, and with 6, it is L,
+ *                           R, C, LFE, Ls, Rs. The surround channels are
+ *                           weighted by 1.41 and the LFE is ignored. All
+ *                           the channels are weighted by 1.0 otherwise.
+ *
+ *  @return meter, or NULL on failure.
+ */
+
+LOUDNESS_METER* createLoudnessMeter( int sampleRate, int numChannels );
+
+
+/** @brief measure the next samples, without allocating.
+ *
+ *  @param meter      (in): meter
+ *  @param samples    (in): interleaved samples
+ *  @param numFrames  (in): number of the frames
+ */
+
+void feedLoudnessMeter(
+    LOUDNESS_METER* meter,
+    const short*    samples,
+    int             numFrames  );
+
+
+/** @brief get the levels as of the last complete sub-block.
+ *         The loudness is LM_SILENCE_LUFS until there is a block to
+ *         measure, and so are the peaks until there is a sample.
+ */
+
+void loudnessLevels( LOUDNESS_METER* meter, LOUDNESS_LEVELS* levels );
+
+
+/** @brief forget the samples, to start a new programme. */
+
+void resetLoudnessMeter( LOUDNESS_METER* meter );
+
+
+/** @brief release the meter */
+
+void freeLoudnessMeter( LOUDNESS_METER* meter );
+
+
+#endif /*_LOUDNESS_METER_H_*/
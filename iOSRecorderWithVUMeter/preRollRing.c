@@ -0,0 +1,158 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "preRollRing.h"
+
+
+struct pre_roll_ring {
+
+    short*     samples;     /* [ 2 * capacity ] */
+    int        capacity;    /* samples of all the channels per buffer */
+    int        active;      /* 0 or 1 */
+    int        head;        /* oldest sample in the active buffer */
+    int        fill;
+    atomic_int detached;    /* the other buffer is in a splice */
+};
+
+
+PRE_ROLL_RING* createPreRollRing(
+    int   sampleRate,
+    int   numChannels,
+    float seconds
+) {
+    if ( sampleRate <= 0 || numChannels <= 0 || seconds <= 0.0f ) {
+        return NULL;
+    }
+
+    PRE_ROLL_RING* ring = (PRE_ROLL_RING*)calloc( 1, sizeof(PRE_ROLL_RING) );
+
+    if ( ring == NULL ) {
+        return NULL;
+    }
+
+    ring->capacity = (int)( seconds * sampleRate ) * numChannels;
+    ring->samples  = (short*)malloc( sizeof(short) * 2 * ring->capacity );
+
+    if ( ring->capacity <= 0 || ring->samples == NULL ) {
+
+        freePreRollRing( ring );
+        return NULL;
+    }
+
+    atomic_init( &(ring->detached), 0 );
+
+    return ring;
+}
+
+
+void pushPreRoll(
+    PRE_ROLL_RING* ring,
+    const short*   samples,
+    int            numSamples
+) {
+    short* buffer = &(ring->samples[ ring->active * ring->capacity ]);
+
+    if ( numSamples >= ring->capacity ) {
+
+        memcpy( buffer,
+                &(samples[ numSamples - ring->capacity ]),
+                sizeof(short) * ring->capacity             );
+
+        ring->head = 0;
+        ring->fill = ring->capacity;
+        return;
+    }
+
+    int tail  = ( ring->head + ring->fill ) % ring->capacity;
+    int first = ring->capacity - tail;
+
+    first = ( first < numSamples ) ? first : numSamples;
+
+    memcpy( &(buffer[tail]), samples, sizeof(short) * first );
+    memcpy( buffer, &(samples[first]), sizeof(short) * ( numSamples - first ) );
+
+    ring->fill += numSamples;
+
+    if ( ring->fill > ring->capacity ) {
+
+        ring->head = ( ring->head + ring->fill - ring->capacity )
+                     % ring->capacity;
+        ring->fill = ring->capacity;
+    }
+}
+
+
+int detachPreRoll( PRE_ROLL_RING* ring, PRE_ROLL_SPLICE* splice )
+{
+    memset( splice, 0, sizeof(PRE_ROLL_SPLICE) );
+
+    if ( atomic_load_explicit( &(ring->detached), memory_order_acquire ) ) {
+        return 0;
+    }
+
+    const short* buffer = &(ring->samples[ ring->active * ring->capacity ]);
+    int          first  = ring->capacity - ring->head;
+
+    first = ( first < ring->fill ) ? first : ring->fill;
+
+    splice->pieces[0]     = &(buffer[ ring->head ]);
+    splice->numSamples[0] = first;
+    splice->pieces[1]     = buffer;
+    splice->numSamples[1] = ring->fill - first;
+
+    atomic_store_explicit( &(ring->detached), 1, memory_order_relaxed );
+
+    ring->active = 1 - ring->active;
+    ring->head   = 0;
+    ring->fill   = 0;
+
+    return 1;
+}
+
+
+void releasePreRoll( PRE_ROLL_RING* ring )
+{
+    atomic_store_explicit( &(ring->detached), 0, memory_order_release );
+}
+
+
+void resetPreRollRing( PRE_ROLL_RING* ring )
+{
+    ring->head = 0;
+    ring->fill = 0;
+}
+
+
+void freePreRollRing( PRE_ROLL_RING* ring )
+{
+    if ( ring == NULL ) {
+        return;
+    }
+
+    free( ring->samples );
+    free( ring );
+}
@@ -0,0 +1,105 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Pre-roll of the captured samples for a retroactive recording start.
+ *
+ * The ring keeps the latest samples pushed to it in one of two buffers
+ * allocated at the creation, so that the memory is bounded and a push
+ * does not allocate. Starting a recording detaches the buffer in use as
+ * it is, and the recording writes its pieces as the head of the file
+ * directly, while the pushes continue to the other buffer.
+ * The detached buffer is taken again only after it is released.
+ */
+
+#ifndef _PRE_ROLL_RING_H_
+#define _PRE_ROLL_RING_H_
+
+typedef struct pre_roll_ring PRE_ROLL_RING;
+
+
+/** @brief samples of a detached buffer in at most two pieces, oldest first.
+ */
+typedef struct pre_roll_splice {
+
+    const short* pieces     [ 2 ];
+    int          numSamples [ 2 ];   /* over all the channels */
+
+} PRE_ROLL_SPLICE;
+
+
+/** @brief create a ring.
+ *
+ *  @param sampleRate  (in): sample rate in [Hz]
+ *  @param numChannels (in): number of the interleaved channels
+ *  @param seconds     (in): length of the pre-roll. Twice this length of
+ *                           samples are allocated.
+ *
+ *  @return ring, or NULL on failure.
+ */
+
+PRE_ROLL_RING* createPreRollRing(
+    int   sampleRate,
+    int   numChannels,
+    float seconds      );
+
+
+/** @brief keep the interleaved samples, dropping the oldest beyond the
+ *         length. To be called from one thread together with
+ *         detachPreRoll().
+ */
+
+void pushPreRoll(
+    PRE_ROLL_RING* ring,
+    const short*   samples,
+    int            numSamples );
+
+
+/** @brief detach the samples kept so far, and start an empty pre-roll.
+ *
+ *  @param splice (out): pieces valid until releasePreRoll()
+ *
+ *  @return 1: Detached
+ *          0: The previous splice is not released yet. The splice is empty.
+ */
+
+int detachPreRoll( PRE_ROLL_RING* ring, PRE_ROLL_SPLICE* splice );
+
+
+/** @brief give the detached samples back to the ring. Can be called from
+ *         any thread.
+ */
+
+void releasePreRoll( PRE_ROLL_RING* ring );
+
+
+/** @brief forget the samples kept so far. */
+
+void resetPreRollRing( PRE_ROLL_RING* ring );
+
+
+/** @brief release the ring */
+
+void freePreRollRing( PRE_ROLL_RING* ring );
+
+
+#endif /*_PRE_ROLL_RING_H_*/
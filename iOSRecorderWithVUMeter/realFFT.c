@@ -0,0 +1,359 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "realFFT.h"
+
+#define RFFT_PI            3.14159265358979323846
+#define RFFT_MIN_FFT_SIZE  64
+#define RFFT_MAX_FFT_SIZE  16384
+
+
+struct real_fft {
+
+    int    fftSize;
+    int    halfSize;     /* size of the complex FFT */
+    float* window;       /* [ fftSize ], normalized */
+    int*   bitReverse;   /* [ halfSize ] */
+    float* twiddleRe;    /* [ halfSize ], stage h at h - 1 */
+    float* twiddleIm;
+    float* splitRe;      /* [ halfSize ], exp(-2 pi i k / fftSize) */
+    float* splitIm;
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static void init_tables ( REAL_FFT* fft );
+
+static void fft_in_place (
+                const REAL_FFT* fft,
+                float*          re,
+                float*          im   );
+
+static void butterflies (
+                float*       a_re,
+                float*       a_im,
+                float*       b_re,
+                float*       b_im,
+                const float* w_re,
+                const float* w_im,
+                int          n       );
+
+
+REAL_FFT* createRealFFT( int fftSize )
+{
+    if ( fftSize < RFFT_MIN_FFT_SIZE || fftSize > RFFT_MAX_FFT_SIZE
+         || ( fftSize & ( fftSize - 1 ) ) != 0                       ) {
+
+        return NULL;
+    }
+
+    REAL_FFT* fft = (REAL_FFT*)calloc( 1, sizeof(REAL_FFT) );
+
+    if ( fft == NULL ) {
+        return NULL;
+    }
+
+    int half = fftSize / 2;
+
+    fft->fftSize    = fftSize;
+    fft->halfSize   = half;
+    fft->window     = (float*)malloc( sizeof(float) * fftSize );
+    fft->bitReverse = (int*)  malloc( sizeof(int)   * half    );
+    fft->twiddleRe  = (float*)malloc( sizeof(float) * half    );
+    fft->twiddleIm  = (float*)malloc( sizeof(float) * half    );
+    fft->splitRe    = (float*)malloc( sizeof(float) * half    );
+    fft->splitIm    = (float*)malloc( sizeof(float) * half    );
+
+    if (    fft->window    == NULL || fft->bitReverse == NULL
+         || fft->twiddleRe == NULL || fft->twiddleIm  == NULL
+         || fft->splitRe   == NULL || fft->splitIm    == NULL ) {
+
+        freeRealFFT( fft );
+        return NULL;
+    }
+
+    init_tables( fft );
+
+    return fft;
+}
+
+
+void powerSpectrumOfFrame(
+    const REAL_FFT* fft,
+    const float*    frame,
+    float*          work,
+    float*          power
+) {
+    int          half   = fft->halfSize;
+    float*       re     = work;
+    float*       im     = &(work[ half ]);
+    const float* window = fft->window;
+    const int*   rev    = fft->bitReverse;
+
+    /* Even samples to the real part, odd to the imaginary part,
+       in the bit-reversed order. */
+    for ( int n = 0; n < half; n++ ) {
+
+        re[ rev[n] ] = frame[ 2 * n     ] * window[ 2 * n     ];
+        im[ rev[n] ] = frame[ 2 * n + 1 ] * window[ 2 * n + 1 ];
+    }
+
+    fft_in_place( fft, re, im );
+
+    /* Split into the spectrum of the real frame. */
+    power[0]      = ( re[0] + im[0] ) * ( re[0] + im[0] );
+    power[ half ] = ( re[0] - im[0] ) * ( re[0] - im[0] );
+
+    for ( int k = 1; k < half; k++ ) {
+
+        /* Z[k] and conj( Z[half - k] ) */
+        float zr =  re[k];
+        float zi =  im[k];
+        float mr =  re[ half - k ];
+        float mi = -im[ half - k ];
+
+        /* even part, and odd part divided by 2i */
+        float er =  0.5f * ( zr + mr );
+        float ei =  0.5f * ( zi + mi );
+        float dr =  0.5f * ( zi - mi );
+        float di = -0.5f * ( zr - mr );
+
+        float wr = fft->splitRe[k];
+        float wi = fft->splitIm[k];
+
+        float xr = er + wr * dr - wi * di;
+        float xi = ei + wr * di + wi * dr;
+
+        power[k] = xr * xr + xi * xi;
+    }
+}
+
+
+void freeRealFFT( REAL_FFT* fft )
+{
+    if ( fft == NULL ) {
+        return;
+    }
+
+    free( fft->window );
+    free( fft->bitReverse );
+    free( fft->twiddleRe );
+    free( fft->twiddleIm );
+    free( fft->splitRe );
+    free( fft->splitIm );
+    free( fft );
+}
+
+
+static void init_tables( REAL_FFT* fft )
+{
+    int    N         = fft->fftSize;
+    int    half      = fft->halfSize;
+    double sumSquare = 0.0;
+
+    for ( int n = 0; n < N; n++ ) {
+
+        double w = 0.5 - 0.5 * cos( 2.0 * RFFT_PI * n / N );
+
+        fft->window[n] = (float)w;
+        sumSquare     += w * w;
+    }
+
+    /* |X[k]|^2 reads the variance for white noise. */
+    float scale = (float)( 1.0 / sqrt( sumSquare ) );
+
+    for ( int n = 0; n < N; n++ ) {
+        fft->window[n] *= scale;
+    }
+
+    int numBits = 0;
+
+    while ( ( 1 << numBits ) < half ) {
+        numBits++;
+    }
+
+    for ( int n = 0; n < half; n++ ) {
+
+        int r = 0;
+
+        for ( int b = 0; b < numBits; b++ ) {
+            r |= ( ( n >> b ) & 1 ) << ( numBits - 1 - b );
+        }
+
+        fft->bitReverse[n] = r;
+    }
+
+    /* The twiddles of each stage are contiguous for the SIMD butterflies. */
+    for ( int h = 1; h < half; h *= 2 ) {
+
+        for ( int j = 0; j < h; j++ ) {
+
+            fft->twiddleRe[ h - 1 + j ] = (float)cos( -RFFT_PI * j / h );
+            fft->twiddleIm[ h - 1 + j ] = (float)sin( -RFFT_PI * j / h );
+        }
+    }
+
+    for ( int k = 0; k < half; k++ ) {
+
+        fft->splitRe[k] = (float)cos( -2.0 * RFFT_PI * k / N );
+        fft->splitIm[k] = (float)sin( -2.0 * RFFT_PI * k / N );
+    }
+}
+
+
+/** @brief iterative radix-2 decimation in time on the bit-reversed input */
+static void fft_in_place(
+    const REAL_FFT* fft,
+    float*          re,
+    float*          im
+) {
+    int half = fft->halfSize;
+
+    /* The first two stages have the trivial twiddles 1 and -i. */
+    for ( int b = 0; b + 4 <= half; b += 4 ) {
+
+        float r0 = re[b] + re[b+1],  i0 = im[b] + im[b+1];
+        float r1 = re[b] - re[b+1],  i1 = im[b] - im[b+1];
+        float r2 = re[b+2] + re[b+3], i2 = im[b+2] + im[b+3];
+        float r3 = re[b+2] - re[b+3], i3 = im[b+2] - im[b+3];
+
+        re[b]   = r0 + r2;  im[b]   = i0 + i2;
+        re[b+2] = r0 - r2;  im[b+2] = i0 - i2;
+        re[b+1] = r1 + i3;  im[b+1] = i1 - r3;
+        re[b+3] = r1 - i3;  im[b+3] = i1 + r3;
+    }
+
+    for ( int h = 4; h < half; h *= 2 ) {
+
+        const float* wr = &(fft->twiddleRe[ h - 1 ]);
+        const float* wi = &(fft->twiddleIm[ h - 1 ]);
+
+        for ( int b = 0; b < half; b += 2 * h ) {
+
+            butterflies( &(re[b]), &(im[b]), &(re[b+h]), &(im[b+h]),
+                         wr, wi, h                                   );
+        }
+    }
+}
+
+
+/** @brief a = a + w * b, b = a - w * b, for n ( >= 4 ) elements */
+static void butterflies(
+    float*       aRe,
+    float*       aIm,
+    float*       bRe,
+    float*       bIm,
+    const float* wRe,
+    const float* wIm,
+    int          n
+) {
+    int j = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+    for ( ; j + 4 <= n; j += 4 ) {
+
+        float32x4_t ar = vld1q_f32( &(aRe[j]) );
+        float32x4_t ai = vld1q_f32( &(aIm[j]) );
+        float32x4_t br = vld1q_f32( &(bRe[j]) );
+        float32x4_t bi = vld1q_f32( &(bIm[j]) );
+        float32x4_t wr = vld1q_f32( &(wRe[j]) );
+        float32x4_t wi = vld1q_f32( &(wIm[j]) );
+
+        float32x4_t tr = vmlsq_f32( vmulq_f32( br, wr ), bi, wi );
+        float32x4_t ti = vmlaq_f32( vmulq_f32( br, wi ), bi, wr );
+
+        vst1q_f32( &(aRe[j]), vaddq_f32( ar, tr ) );
+        vst1q_f32( &(aIm[j]), vaddq_f32( ai, ti ) );
+        vst1q_f32( &(bRe[j]), vsubq_f32( ar, tr ) );
+        vst1q_f32( &(bIm[j]), vsubq_f32( ai, ti ) );
+    }
+
+#elif defined(__AVX__)
+
+    for ( ; j + 8 <= n; j += 8 ) {
+
+        __m256 ar = _mm256_loadu_ps( &(aRe[j]) );
+        __m256 ai = _mm256_loadu_ps( &(aIm[j]) );
+        __m256 br = _mm256_loadu_ps( &(bRe[j]) );
+        __m256 bi = _mm256_loadu_ps( &(bIm[j]) );
+        __m256 wr = _mm256_loadu_ps( &(wRe[j]) );
+        __m256 wi = _mm256_loadu_ps( &(wIm[j]) );
+
+        __m256 tr = _mm256_sub_ps( _mm256_mul_ps( br, wr ),
+                                   _mm256_mul_ps( bi, wi ) );
+        __m256 ti = _mm256_add_ps( _mm256_mul_ps( br, wi ),
+                                   _mm256_mul_ps( bi, wr ) );
+
+        _mm256_storeu_ps( &(aRe[j]), _mm256_add_ps( ar, tr ) );
+        _mm256_storeu_ps( &(aIm[j]), _mm256_add_ps( ai, ti ) );
+        _mm256_storeu_ps( &(bRe[j]), _mm256_sub_ps( ar, tr ) );
+        _mm256_storeu_ps( &(bIm[j]), _mm256_sub_ps( ai, ti ) );
+    }
+
+#elif defined(__SSE2__)
+
+    for ( ; j + 4 <= n; j += 4 ) {
+
+        __m128 ar = _mm_loadu_ps( &(aRe[j]) );
+        __m128 ai = _mm_loadu_ps( &(aIm[j]) );
+        __m128 br = _mm_loadu_ps( &(bRe[j]) );
+        __m128 bi = _mm_loadu_ps( &(bIm[j]) );
+        __m128 wr = _mm_loadu_ps( &(wRe[j]) );
+        __m128 wi = _mm_loadu_ps( &(wIm[j]) );
+
+        __m128 tr = _mm_sub_ps( _mm_mul_ps( br, wr ), _mm_mul_ps( bi, wi ) );
+        __m128 ti = _mm_add_ps( _mm_mul_ps( br, wi ), _mm_mul_ps( bi, wr ) );
+
+        _mm_storeu_ps( &(aRe[j]), _mm_add_ps( ar, tr ) );
+        _mm_storeu_ps( &(aIm[j]), _mm_add_ps( ai, ti ) );
+        _mm_storeu_ps( &(bRe[j]), _mm_sub_ps( ar, tr ) );
+        _mm_storeu_ps( &(bIm[j]), _mm_sub_ps( ai, ti ) );
+    }
+
+#endif
+
+    for ( ; j < n; j++ ) {
+
+        float tr = bRe[j] * wRe[j] - bIm[j] * wIm[j];
+        float ti = bRe[j] * wIm[j] + bIm[j] * wRe[j];
+
+        bRe[j] = aRe[j] - tr;
+        bIm[j] = aIm[j] - ti;
+        aRe[j] = aRe[j] + tr;
+        aIm[j] = aIm[j] + ti;
+    }
+}
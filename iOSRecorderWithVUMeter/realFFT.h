@@ -0,0 +1,72 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Power spectra of real frames with a precomputed plan.
+ *
+ * The frame is Hann-windowed and its real FFT is computed as a complex
+ * radix-2 FFT of fftSize/2 points followed by a split into the spectrum of
+ * the real frame. The window, the bit reversal and the twiddles are in the
+ * plan, which can be shared by threads with a work buffer each.
+ *
+ * The power of a bin is normalized by the energy of the window, so that
+ * white noise of variance s^2 reads s^2 in every bin, on the same scale as
+ * the levels of estimateSNR().
+ */
+
+#ifndef _REAL_FFT_H_
+#define _REAL_FFT_H_
+
+typedef struct real_fft REAL_FFT;
+
+
+/** @brief create a plan.
+ *
+ *  @param fftSize (in): frame length, a power of 2 in [64, 16384]
+ *
+ *  @return plan, or NULL on failure.
+ */
+
+REAL_FFT* createRealFFT( int fftSize );
+
+
+/** @brief compute the normalized power spectrum of a frame.
+ *
+ *  @param fft   (in):  plan
+ *  @param frame (in):  fftSize samples, not windowed
+ *  @param work  (in):  fftSize floats of scratch space
+ *  @param power (out): fftSize / 2 + 1 bins from DC to Nyquist
+ */
+
+void powerSpectrumOfFrame(
+    const REAL_FFT* fft,
+    const float*    frame,
+    float*          work,
+    float*          power  );
+
+
+/** @brief release the plan */
+
+void freeRealFFT( REAL_FFT* fft );
+
+
+#endif /*_REAL_FFT_H_*/
@@ -0,0 +1,716 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <limits.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "sampleMinMax.h"
+
+
+/* static function definition */
+
+static void fold_lane_levels(
+    const uint64_t*       sums,
+    const unsigned short* peaks,
+    int                   position,
+    int                   num_lanes,
+    int                   num_channels,
+    SAMPLE_LEVELS*        levels       );
+
+static void fold_lane_clips(
+    const unsigned short* clips,
+    int                   position,
+    int                   num_lanes,
+    int                   num_channels,
+    SAMPLE_LEVELS*        levels       );
+
+
+void minMaxOfSamples(
+    const short* samples,
+    int          numSamples,
+    short*       minVal,
+    short*       maxVal
+) {
+    short lMin = SHRT_MAX;
+    short lMax = SHRT_MIN;
+    int   i    = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+    if ( numSamples >= 16 ) {
+
+        int16x8_t vMin0 = vdupq_n_s16( SHRT_MAX );
+        int16x8_t vMin1 = vdupq_n_s16( SHRT_MAX );
+        int16x8_t vMax0 = vdupq_n_s16( SHRT_MIN );
+        int16x8_t vMax1 = vdupq_n_s16( SHRT_MIN );
+
+        for ( ; i + 16 <= numSamples; i += 16 ) {
+
+            int16x8_t v0 = vld1q_s16( &(samples[ i     ]) );
+            int16x8_t v1 = vld1q_s16( &(samples[ i + 8 ]) );
+
+            vMin0 = vminq_s16( vMin0, v0 );
+            vMin1 = vminq_s16( vMin1, v1 );
+            vMax0 = vmaxq_s16( vMax0, v0 );
+            vMax1 = vmaxq_s16( vMax1, v1 );
+        }
+
+        vMin0 = vminq_s16( vMin0, vMin1 );
+        vMax0 = vmaxq_s16( vMax0, vMax1 );
+
+        short mins [ 8 ];
+        short maxs [ 8 ];
+
+        vst1q_s16( mins, vMin0 );
+        vst1q_s16( maxs, vMax0 );
+
+        for ( int j = 0; j < 8; j++ ) {
+
+            lMin = ( mins[j] < lMin ) ? mins[j] : lMin;
+            lMax = ( maxs[j] > lMax ) ? maxs[j] : lMax;
+        }
+    }
+
+#elif defined(__AVX2__)
+
+    if ( numSamples >= 16 ) {
+
+        __m256i vMin = _mm256_set1_epi16( SHRT_MAX );
+        __m256i vMax = _mm256_set1_epi16( SHRT_MIN );
+
+        for ( ; i + 16 <= numSamples; i += 16 ) {
+
+            __m256i v = _mm256_loadu_si256( (const __m256i*)&(samples[i]) );
+
+            vMin = _mm256_min_epi16( vMin, v );
+            vMax = _mm256_max_epi16( vMax, v );
+        }
+
+        short mins [ 16 ];
+        short maxs [ 16 ];
+
+        _mm256_storeu_si256( (__m256i*)mins, vMin );
+        _mm256_storeu_si256( (__m256i*)maxs, vMax );
+
+        for ( int j = 0; j < 16; j++ ) {
+
+            lMin = ( mins[j] < lMin ) ? mins[j] : lMin;
+            lMax = ( maxs[j] > lMax ) ? maxs[j] : lMax;
+        }
+    }
+
+#elif defined(__SSE2__)
+
+    if ( numSamples >= 8 ) {
+
+        __m128i vMin = _mm_set1_epi16( SHRT_MAX );
+        __m128i vMax = _mm_set1_epi16( SHRT_MIN );
+
+        for ( ; i + 8 <= numSamples; i += 8 ) {
+
+            __m128i v = _mm_loadu_si128( (const __m128i*)&(samples[i]) );
+
+            vMin = _mm_min_epi16( vMin, v );
+            vMax = _mm_max_epi16( vMax, v );
+        }
+
+        short mins [ 8 ];
+        short maxs [ 8 ];
+
+        _mm_storeu_si128( (__m128i*)mins, vMin );
+        _mm_storeu_si128( (__m128i*)maxs, vMax );
+
+        for ( int j = 0; j < 8; j++ ) {
+
+            lMin = ( mins[j] < lMin ) ? mins[j] : lMin;
+            lMax = ( maxs[j] > lMax ) ? maxs[j] : lMax;
+        }
+    }
+
+#endif
+
+    for ( ; i < numSamples; i++ ) {
+
+        lMin = ( samples[i] < lMin ) ? samples[i] : lMin;
+        lMax = ( samples[i] > lMax ) ? samples[i] : lMax;
+    }
+
+    *minVal = lMin;
+    *maxVal = lMax;
+}
+
+
+/* Vectors between the flushes of the 16-bit clip counters. */
+#define SMM_CLIP_FLUSH  16384
+
+
+void levelsOfSamples(
+    const short*   samples,
+    int            numSamples,
+    SAMPLE_LEVELS* levels
+) {
+    uint64_t sum     = 0;
+    int      peak    = 0;
+    int      clipped = 0;
+    int      i       = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+    if ( numSamples >= 8 ) {
+
+        uint64x2_t vSum  = vdupq_n_u64( 0 );
+        uint16x8_t vPeak = vdupq_n_u16( 0 );
+
+        while ( i + 8 <= numSamples ) {
+
+            uint16x8_t vClip = vdupq_n_u16( 0 );
+            int        end   = i + 8 * SMM_CLIP_FLUSH;
+
+            end = ( end < numSamples ) ? end : numSamples;
+
+            for ( ; i + 8 <= end; i += 8 ) {
+
+                int16x8_t  v   = vld1q_s16( &(samples[i]) );
+
+                /* |-32768| wraps to 0x8000, which is right as unsigned. */
+                uint16x8_t abs = vreinterpretq_u16_s16( vabsq_s16( v ) );
+
+                /* Each product is at most 2^30. */
+                int32x4_t  lo  = vmull_s16( vget_low_s16 ( v ),
+                                            vget_low_s16 ( v ) );
+                int32x4_t  hi  = vmull_s16( vget_high_s16( v ),
+                                            vget_high_s16( v ) );
+
+                vSum  = vpadalq_u32( vSum, vreinterpretq_u32_s32( lo ) );
+                vSum  = vpadalq_u32( vSum, vreinterpretq_u32_s32( hi ) );
+                vPeak = vmaxq_u16( vPeak, abs );
+
+                /* The mask is 0xFFFF, i.e., -1, on the clipped samples. */
+                vClip = vsubq_u16( vClip,
+                                   vcgeq_u16( abs, vdupq_n_u16( 32767 ) ) );
+            }
+
+            unsigned short clips [ 8 ];
+
+            vst1q_u16( clips, vClip );
+
+            for ( int j = 0; j < 8; j++ ) {
+                clipped += clips[j];
+            }
+        }
+
+        uint64_t       sums  [ 2 ];
+        unsigned short peaks [ 8 ];
+
+        vst1q_u64( sums,  vSum  );
+        vst1q_u16( peaks, vPeak );
+
+        sum = sums[0] + sums[1];
+
+        for ( int j = 0; j < 8; j++ ) {
+            peak = ( peaks[j] > peak ) ? peaks[j] : peak;
+        }
+    }
+
+#elif defined(__AVX2__)
+
+    if ( numSamples >= 16 ) {
+
+        const __m256i zero  = _mm256_setzero_si256();
+        const __m256i limit = _mm256_set1_epi16( 32767 );
+        __m256i       vSum  = _mm256_setzero_si256();
+        __m256i       vPeak = _mm256_setzero_si256();
+
+        while ( i + 16 <= numSamples ) {
+
+            __m256i vClip = _mm256_setzero_si256();
+            int     end   = i + 16 * SMM_CLIP_FLUSH;
+
+            end = ( end < numSamples ) ? end : numSamples;
+
+            for ( ; i + 16 <= end; i += 16 ) {
+
+                __m256i v   = _mm256_loadu_si256(
+                                  (const __m256i*)&(samples[i]) );
+
+                /* |-32768| wraps to 0x8000, which is right as unsigned. */
+                __m256i abs = _mm256_abs_epi16( v );
+
+                /* Each pair sums to at most 2^31, which fits unsigned. */
+                __m256i sq  = _mm256_madd_epi16( v, v );
+                __m256i lo  = _mm256_unpacklo_epi32( sq, zero );
+                __m256i hi  = _mm256_unpackhi_epi32( sq, zero );
+
+                /* abs >= 32767 as unsigned. The mask is -1. */
+                __m256i clp = _mm256_cmpeq_epi16(
+                                  _mm256_max_epu16( abs, limit ), abs );
+
+                vSum  = _mm256_add_epi64( vSum, lo );
+                vSum  = _mm256_add_epi64( vSum, hi );
+                vPeak = _mm256_max_epu16( vPeak, abs );
+                vClip = _mm256_sub_epi16( vClip, clp );
+            }
+
+            unsigned short clips [ 16 ];
+
+            _mm256_storeu_si256( (__m256i*)clips, vClip );
+
+            for ( int j = 0; j < 16; j++ ) {
+                clipped += clips[j];
+            }
+        }
+
+        uint64_t       sums  [ 4 ];
+        unsigned short peaks [ 16 ];
+
+        _mm256_storeu_si256( (__m256i*)sums,  vSum  );
+        _mm256_storeu_si256( (__m256i*)peaks, vPeak );
+
+        sum = sums[0] + sums[1] + sums[2] + sums[3];
+
+        for ( int j = 0; j < 16; j++ ) {
+            peak = ( peaks[j] > peak ) ? peaks[j] : peak;
+        }
+    }
+
+#elif defined(__SSE2__)
+
+    if ( numSamples >= 8 ) {
+
+        /* SSE2 has no unsigned 16-bit max. The peaks are kept biased by
+           0x8000 to use the signed one. */
+        const __m128i zero  = _mm_setzero_si128();
+        const __m128i bias  = _mm_set1_epi16( SHRT_MIN );
+        const __m128i limit = _mm_set1_epi16( -2 );   /* 32766 biased */
+        __m128i       vSum  = _mm_setzero_si128();
+        __m128i       vPeak = bias;
+
+        while ( i + 8 <= numSamples ) {
+
+            __m128i vClip = _mm_setzero_si128();
+            int     end   = i + 8 * SMM_CLIP_FLUSH;
+
+            end = ( end < numSamples ) ? end : numSamples;
+
+            for ( ; i + 8 <= end; i += 8 ) {
+
+                __m128i v    = _mm_loadu_si128( (const __m128i*)&(samples[i]) );
+                __m128i sign = _mm_srai_epi16( v, 15 );
+                __m128i abs  = _mm_sub_epi16( _mm_xor_si128( v, sign ), sign );
+                __m128i absB = _mm_xor_si128( abs, bias );
+                __m128i sq   = _mm_madd_epi16( v, v );
+
+                vSum  = _mm_add_epi64( vSum, _mm_unpacklo_epi32( sq, zero ) );
+                vSum  = _mm_add_epi64( vSum, _mm_unpackhi_epi32( sq, zero ) );
+                vPeak = _mm_max_epi16( vPeak, absB );
+                vClip = _mm_sub_epi16( vClip, _mm_cmpgt_epi16( absB, limit ) );
+            }
+
+            unsigned short clips [ 8 ];
+
+            _mm_storeu_si128( (__m128i*)clips, vClip );
+
+            for ( int j = 0; j < 8; j++ ) {
+                clipped += clips[j];
+            }
+        }
+
+        uint64_t       sums  [ 2 ];
+        unsigned short peaks [ 8 ];
+
+        _mm_storeu_si128( (__m128i*)sums,  vSum );
+        _mm_storeu_si128( (__m128i*)peaks, _mm_xor_si128( vPeak, bias ) );
+
+        sum = sums[0] + sums[1];
+
+        for ( int j = 0; j < 8; j++ ) {
+            peak = ( peaks[j] > peak ) ? peaks[j] : peak;
+        }
+    }
+
+#endif
+
+    for ( ; i < numSamples; i++ ) {
+
+        int v   = samples[i];
+        int abs = ( v < 0 ) ? -v : v;
+
+        sum     += (uint64_t)( v * v );
+        peak     = ( abs > peak ) ? abs : peak;
+        clipped += ( abs >= 32767 );
+    }
+
+    levels->sumOfSquares = sum;
+    levels->absPeak      = peak;
+    levels->numClipped   = clipped;
+}
+
+
+void levelsOfChannels(
+    const short*   samples,
+    int            numFrames,
+    int            numChannels,
+    SAMPLE_LEVELS* levels
+) {
+    int numSamples = numFrames * numChannels;
+    int i          = 0;
+
+    if ( numChannels == 1 ) {
+
+        levelsOfSamples( samples, numFrames, levels );
+        return;
+    }
+
+    for ( int c = 0; c < numChannels; c++ ) {
+
+        levels[c].sumOfSquares = 0;
+        levels[c].absPeak      = 0;
+        levels[c].numClipped   = 0;
+    }
+
+    /* A group of numChannels vectors starts at a frame, so that lane t of
+       the m-th vector of every group belongs to the same channel,
+       ( m * lanes + t ) % numChannels. Each vector of the group has its
+       own accumulators, and the squares are widened in the lane order
+       instead of being added pairwise across the channels. */
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+    if ( numChannels <= SMM_MAX_CHANNELS && numSamples >= 8 * numChannels ) {
+
+        const int  group = 8 * numChannels;
+        uint64x2_t vSum  [ SMM_MAX_CHANNELS ][ 4 ];
+        uint16x8_t vPeak [ SMM_MAX_CHANNELS ];
+        uint16x8_t vClip [ SMM_MAX_CHANNELS ];
+
+        for ( int m = 0; m < numChannels; m++ ) {
+
+            for ( int k = 0; k < 4; k++ ) {
+                vSum[m][k] = vdupq_n_u64( 0 );
+            }
+
+            vPeak[m] = vdupq_n_u16( 0 );
+        }
+
+        while ( i + group <= numSamples ) {
+
+            int end = i + group * SMM_CLIP_FLUSH;
+
+            end = ( end < numSamples ) ? end : numSamples;
+
+            for ( int m = 0; m < numChannels; m++ ) {
+                vClip[m] = vdupq_n_u16( 0 );
+            }
+
+            for ( ; i + group <= end; i += group ) {
+
+                for ( int m = 0; m < numChannels; m++ ) {
+
+                    int16x8_t  v   = vld1q_s16( &(samples[ i + 8 * m ]) );
+                    uint16x8_t abs = vreinterpretq_u16_s16( vabsq_s16( v ) );
+
+                    uint32x4_t lo  = vreinterpretq_u32_s32(
+                                         vmull_s16( vget_low_s16 ( v ),
+                                                    vget_low_s16 ( v ) ) );
+                    uint32x4_t hi  = vreinterpretq_u32_s32(
+                                         vmull_s16( vget_high_s16( v ),
+                                                    vget_high_s16( v ) ) );
+
+                    vSum[m][0] = vaddw_u32( vSum[m][0], vget_low_u32 ( lo ) );
+                    vSum[m][1] = vaddw_u32( vSum[m][1], vget_high_u32( lo ) );
+                    vSum[m][2] = vaddw_u32( vSum[m][2], vget_low_u32 ( hi ) );
+                    vSum[m][3] = vaddw_u32( vSum[m][3], vget_high_u32( hi ) );
+
+                    vPeak[m]   = vmaxq_u16( vPeak[m], abs );
+                    vClip[m]   = vsubq_u16( vClip[m],
+                                     vcgeq_u16( abs, vdupq_n_u16( 32767 ) ) );
+                }
+            }
+
+            for ( int m = 0; m < numChannels; m++ ) {
+
+                unsigned short clips [ 8 ];
+
+                vst1q_u16( clips, vClip[m] );
+
+                fold_lane_clips( clips, m, 8, numChannels, levels );
+            }
+        }
+
+        for ( int m = 0; m < numChannels; m++ ) {
+
+            uint64_t       sums  [ 8 ];
+            unsigned short peaks [ 8 ];
+
+            for ( int k = 0; k < 4; k++ ) {
+                vst1q_u64( &(sums[ 2 * k ]), vSum[m][k] );
+            }
+
+            vst1q_u16( peaks, vPeak[m] );
+
+            fold_lane_levels( sums, peaks, m, 8, numChannels, levels );
+        }
+    }
+
+#elif defined(__AVX2__)
+
+    if ( numChannels <= SMM_MAX_CHANNELS && numSamples >= 16 * numChannels ) {
+
+        const int     group = 16 * numChannels;
+        const __m256i limit = _mm256_set1_epi16( 32767 );
+        __m256i       vSum  [ SMM_MAX_CHANNELS ][ 4 ];
+        __m256i       vPeak [ SMM_MAX_CHANNELS ];
+        __m256i       vClip [ SMM_MAX_CHANNELS ];
+
+        for ( int m = 0; m < numChannels; m++ ) {
+
+            for ( int k = 0; k < 4; k++ ) {
+                vSum[m][k] = _mm256_setzero_si256();
+            }
+
+            vPeak[m] = _mm256_setzero_si256();
+        }
+
+        while ( i + group <= numSamples ) {
+
+            int end = i + group * SMM_CLIP_FLUSH;
+
+            end = ( end < numSamples ) ? end : numSamples;
+
+            for ( int m = 0; m < numChannels; m++ ) {
+                vClip[m] = _mm256_setzero_si256();
+            }
+
+            for ( ; i + group <= end; i += group ) {
+
+                for ( int m = 0; m < numChannels; m++ ) {
+
+                    const short* p = &(samples[ i + 16 * m ]);
+
+                    __m256i v   = _mm256_loadu_si256( (const __m256i*)p );
+                    __m256i abs = _mm256_abs_epi16( v );
+
+                    /* Lanes 0-7 and 8-15 as 32 bits. Each square is at
+                       most 2^30. */
+                    __m256i lo  = _mm256_cvtepi16_epi32(
+                                      _mm256_castsi256_si128( v ) );
+                    __m256i hi  = _mm256_cvtepi16_epi32(
+                                      _mm256_extracti128_si256( v, 1 ) );
+
+                    lo = _mm256_mullo_epi32( lo, lo );
+                    hi = _mm256_mullo_epi32( hi, hi );
+
+                    vSum[m][0] = _mm256_add_epi64( vSum[m][0],
+                                     _mm256_cvtepu32_epi64(
+                                         _mm256_castsi256_si128( lo ) ) );
+                    vSum[m][1] = _mm256_add_epi64( vSum[m][1],
+                                     _mm256_cvtepu32_epi64(
+                                         _mm256_extracti128_si256( lo, 1 ) ) );
+                    vSum[m][2] = _mm256_add_epi64( vSum[m][2],
+                                     _mm256_cvtepu32_epi64(
+                                         _mm256_castsi256_si128( hi ) ) );
+                    vSum[m][3] = _mm256_add_epi64( vSum[m][3],
+                                     _mm256_cvtepu32_epi64(
+                                         _mm256_extracti128_si256( hi, 1 ) ) );
+
+                    vPeak[m]   = _mm256_max_epu16( vPeak[m], abs );
+                    vClip[m]   = _mm256_sub_epi16( vClip[m],
+                                     _mm256_cmpeq_epi16(
+                                         _mm256_max_epu16( abs, limit ),
+                                         abs                             ) );
+                }
+            }
+
+            for ( int m = 0; m < numChannels; m++ ) {
+
+                unsigned short clips [ 16 ];
+
+                _mm256_storeu_si256( (__m256i*)clips, vClip[m] );
+
+                fold_lane_clips( clips, m, 16, numChannels, levels );
+            }
+        }
+
+        for ( int m = 0; m < numChannels; m++ ) {
+
+            uint64_t       sums  [ 16 ];
+            unsigned short peaks [ 16 ];
+
+            for ( int k = 0; k < 4; k++ ) {
+                _mm256_storeu_si256( (__m256i*)&(sums[ 4 * k ]), vSum[m][k] );
+            }
+
+            _mm256_storeu_si256( (__m256i*)peaks, vPeak[m] );
+
+            fold_lane_levels( sums, peaks, m, 16, numChannels, levels );
+        }
+    }
+
+#elif defined(__SSE2__)
+
+    if ( numChannels <= SMM_MAX_CHANNELS && numSamples >= 8 * numChannels ) {
+
+        /* The peaks are kept biased by 0x8000 as in levelsOfSamples(). */
+        const int     group = 8 * numChannels;
+        const __m128i zero  = _mm_setzero_si128();
+        const __m128i bias  = _mm_set1_epi16( SHRT_MIN );
+        const __m128i limit = _mm_set1_epi16( -2 );   /* 32766 biased */
+        __m128i       vSum  [ SMM_MAX_CHANNELS ][ 4 ];
+        __m128i       vPeak [ SMM_MAX_CHANNELS ];
+        __m128i       vClip [ SMM_MAX_CHANNELS ];
+
+        for ( int m = 0; m < numChannels; m++ ) {
+
+            for ( int k = 0; k < 4; k++ ) {
+                vSum[m][k] = _mm_setzero_si128();
+            }
+
+            vPeak[m] = bias;
+        }
+
+        while ( i + group <= numSamples ) {
+
+            int end = i + group * SMM_CLIP_FLUSH;
+
+            end = ( end < numSamples ) ? end : numSamples;
+
+            for ( int m = 0; m < numChannels; m++ ) {
+                vClip[m] = _mm_setzero_si128();
+            }
+
+            for ( ; i + group <= end; i += group ) {
+
+                for ( int m = 0; m < numChannels; m++ ) {
+
+                    const short* p = &(samples[ i + 8 * m ]);
+
+                    __m128i v    = _mm_loadu_si128( (const __m128i*)p );
+                    __m128i sign = _mm_srai_epi16( v, 15 );
+                    __m128i abs  = _mm_sub_epi16( _mm_xor_si128( v, sign ),
+                                                  sign                      );
+                    __m128i absB = _mm_xor_si128( abs, bias );
+
+                    /* The squares as 32 bits in the lane order from their
+                       low and high halves. */
+                    __m128i sqL  = _mm_mullo_epi16( v, v );
+                    __m128i sqH  = _mm_mulhi_epi16( v, v );
+                    __m128i lo   = _mm_unpacklo_epi16( sqL, sqH );
+                    __m128i hi   = _mm_unpackhi_epi16( sqL, sqH );
+
+                    vSum[m][0] = _mm_add_epi64( vSum[m][0],
+                                     _mm_unpacklo_epi32( lo, zero ) );
+                    vSum[m][1] = _mm_add_epi64( vSum[m][1],
+                                     _mm_unpackhi_epi32( lo, zero ) );
+                    vSum[m][2] = _mm_add_epi64( vSum[m][2],
+                                     _mm_unpacklo_epi32( hi, zero ) );
+                    vSum[m][3] = _mm_add_epi64( vSum[m][3],
+                                     _mm_unpackhi_epi32( hi, zero ) );
+
+                    vPeak[m]   = _mm_max_epi16( vPeak[m], absB );
+                    vClip[m]   = _mm_sub_epi16(
+                                     vClip[m], _mm_cmpgt_epi16( absB, limit ) );
+                }
+            }
+
+            for ( int m = 0; m < numChannels; m++ ) {
+
+                unsigned short clips [ 8 ];
+
+                _mm_storeu_si128( (__m128i*)clips, vClip[m] );
+
+                fold_lane_clips( clips, m, 8, numChannels, levels );
+            }
+        }
+
+        for ( int m = 0; m < numChannels; m++ ) {
+
+            uint64_t       sums  [ 8 ];
+            unsigned short peaks [ 8 ];
+
+            for ( int k = 0; k < 4; k++ ) {
+                _mm_storeu_si128( (__m128i*)&(sums[ 2 * k ]), vSum[m][k] );
+            }
+
+            _mm_storeu_si128( (__m128i*)peaks,
+                              _mm_xor_si128( vPeak[m], bias ) );
+
+            fold_lane_levels( sums, peaks, m, 8, numChannels, levels );
+        }
+    }
+
+#endif
+
+    /* i is at a frame here. */
+    for ( ; i < numSamples; i += numChannels ) {
+
+        for ( int c = 0; c < numChannels; c++ ) {
+
+            int v   = samples[ i + c ];
+            int abs = ( v < 0 ) ? -v : v;
+
+            levels[c].sumOfSquares += (uint64_t)( v * v );
+            levels[c].absPeak       = ( abs > levels[c].absPeak )
+                                      ? abs : levels[c].absPeak;
+            levels[c].numClipped   += ( abs >= 32767 );
+        }
+    }
+}
+
+
+static void fold_lane_levels(
+    const uint64_t*       sums,
+    const unsigned short* peaks,
+    int                   position,
+    int                   num_lanes,
+    int                   num_channels,
+    SAMPLE_LEVELS*        levels
+) {
+    for ( int t = 0; t < num_lanes; t++ ) {
+
+        SAMPLE_LEVELS* l = &(levels[ ( position * num_lanes + t )
+                                     % num_channels               ]);
+
+        l->sumOfSquares += sums[t];
+        l->absPeak       = ( peaks[t] > l->absPeak ) ? peaks[t] : l->absPeak;
+    }
+}
+
+
+static void fold_lane_clips(
+    const unsigned short* clips,
+    int                   position,
+    int                   num_lanes,
+    int                   num_channels,
+    SAMPLE_LEVELS*        levels
+) {
+    for ( int t = 0; t < num_lanes; t++ ) {
+
+        levels[ ( position * num_lanes + t ) % num_channels ].numClipped
+            += clips[t];
+    }
+}
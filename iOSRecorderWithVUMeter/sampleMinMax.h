@@ -0,0 +1,97 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SAMPLE_MIN_MAX_H_
+#define _SAMPLE_MIN_MAX_H_
+
+#include <stdint.h>
+
+/** @brief find the minimum and the maximum of the 16-bit samples in one
+ *         pass, with NEON, AVX2 or SSE2 where available.
+ *         The absolute peak is max( *maxVal, -(*minVal) ).
+ *
+ *  @param samples     (in):  samples
+ *  @param numSamples  (in):  number of the samples ( > 0 )
+ *  @param minVal      (out): minimum of the samples
+ *  @param maxVal      (out): maximum of the samples
+ */
+
+void minMaxOfSamples(
+    const short* samples,
+    int          numSamples,
+    short*       minVal,
+    short*       maxVal         );
+
+
+/** @brief levels of a block of 16-bit samples */
+typedef struct sample_levels {
+
+    uint64_t sumOfSquares;
+    int      absPeak;       /* 0 to 32768 */
+    int      numClipped;    /* samples at full scale, |s| >= 32767 */
+
+} SAMPLE_LEVELS;
+
+
+/** @brief find the sum of squares, the absolute peak and the number of the
+ *         clipped samples in one pass over the 16-bit samples, without
+ *         converting them, with NEON, AVX2 or SSE2 where available.
+ *         The RMS is sqrt( sumOfSquares / numSamples ).
+ *
+ *  @param samples     (in):  samples
+ *  @param numSamples  (in):  number of the samples ( >= 0 )
+ *  @param levels      (out): levels of the samples, all 0 if none
+ */
+
+void levelsOfSamples(
+    const short*   samples,
+    int            numSamples,
+    SAMPLE_LEVELS* levels       );
+
+
+/** @brief largest number of the channels levelsOfChannels() handles in
+ *         one SIMD pass. It falls back to plain C above that.
+ */
+#define SMM_MAX_CHANNELS  8
+
+
+/** @brief find the levels of each channel of the interleaved 16-bit
+ *         samples in one pass, as levelsOfSamples() does for one channel.
+ *         The samples are not deinterleaved into separate buffers. The
+ *         lanes of the vectors are summed up into their channels at the
+ *         end instead.
+ *
+ *  @param samples     (in):  interleaved samples
+ *  @param numFrames   (in):  number of the frames ( >= 0 )
+ *  @param numChannels (in):  number of the channels ( > 0 )
+ *  @param levels      (out): levels of each channel, numChannels elements
+ */
+
+void levelsOfChannels(
+    const short*   samples,
+    int            numFrames,
+    int            numChannels,
+    SAMPLE_LEVELS* levels       );
+
+
+#endif /*_SAMPLE_MIN_MAX_H_*/
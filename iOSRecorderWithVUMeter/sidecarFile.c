@@ -0,0 +1,167 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sidecarFile.h"
+
+#define SIDECAR_TMP_EXTENSION  ".tmp"
+
+
+char* sidecarPathFor( const char* filename, const char* extension )
+{
+    size_t len    = strlen( filename );
+    size_t extLen = strlen( extension );
+    char*  path   = (char*)malloc( len + extLen + 1 );
+
+    if ( path == NULL ) {
+        return NULL;
+    }
+
+    memcpy( path,       filename,  len        );
+    memcpy( path + len, extension, extLen + 1 );
+
+    return path;
+}
+
+
+int saveSidecarFile(
+    const char* path,
+    const void* header,
+    size_t      headerSize,
+    const void* body,
+    size_t      bodySize
+) {
+    char* tmpPath = sidecarPathFor( path, SIDECAR_TMP_EXTENSION );
+
+    if ( tmpPath == NULL ) {
+        return -1;
+    }
+
+    FILE* fp = fopen( tmpPath, "wb" );
+
+    if ( fp == NULL ) {
+
+        free(tmpPath);
+        return -1;
+    }
+
+    int failed = fwrite( header, 1, headerSize, fp ) != headerSize;
+
+    if ( !failed && bodySize > 0 ) {
+        failed = fwrite( body, 1, bodySize, fp ) != bodySize;
+    }
+
+    failed = ( fclose(fp) != 0 ) || failed;
+
+    if ( failed || rename( tmpPath, path ) != 0 ) {
+
+        unlink( tmpPath );
+        free(tmpPath);
+        return -1;
+    }
+
+    free(tmpPath);
+
+    return 0;
+}
+
+
+void* loadSidecarFile(
+    const char* filename,
+    const char* extension,
+    const char* magic,
+    uint32_t    version,
+    void*       header,
+    size_t      headerSize,
+    size_t      countOffset,
+    size_t      elementSize
+) {
+    WAVE_FINGERPRINT fingerprint;
+    SIDECAR_PREFIX   prefix;
+    int64_t          count;
+    FILE*            fp;
+
+    fp = fopen( filename, "rb" );
+
+    if ( fp == NULL ) {
+        return NULL;
+    }
+
+    int rtnVal = computeWaveFingerprint( fp, &fingerprint );
+
+    fclose(fp);
+
+    char* path = sidecarPathFor( filename, extension );
+
+    if ( rtnVal != 0 || path == NULL ) {
+
+        free(path);
+        return NULL;
+    }
+
+    fp = fopen( path, "rb" );
+
+    free(path);
+
+    if ( fp == NULL ) {
+        return NULL;
+    }
+
+    if ( fread( header, headerSize, 1, fp ) != 1 ) {
+
+        fclose(fp);
+        return NULL;
+    }
+
+    memcpy( &prefix, header,                        sizeof(prefix) );
+    memcpy( &count,  (char*)header + countOffset,   sizeof(count)  );
+
+    if (    memcmp( prefix.magic, magic, 4 ) != 0
+         || prefix.version != version
+         || count < 0
+         || (uint64_t)count >= SIZE_MAX / elementSize
+         || !equalWaveFingerprints( &(prefix.fingerprint), &fingerprint ) ) {
+
+        fclose(fp);
+        return NULL;
+    }
+
+    void* elements = malloc( elementSize * ( (size_t)count + 1 ) );
+
+    if (    elements == NULL
+         || fread( elements, elementSize, (size_t)count, fp )
+            != (size_t)count                                  ) {
+
+        fclose(fp);
+        free(elements);
+        return NULL;
+    }
+
+    fclose(fp);
+
+    return elements;
+}
@@ -0,0 +1,113 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Sidecar files next to a wave file, which hold what has been computed from
+ * it, such as the peak pyramid, the SNR, the silence gate and the dropouts.
+ */
+
+#ifndef _SIDECAR_FILE_H_
+#define _SIDECAR_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "waveFile.h"
+
+
+/** @brief the beginning of the header of every sidecar, which tells its
+ *         kind, its layout and the wave file it was computed from.
+ */
+typedef struct sidecar_prefix {
+
+    unsigned char    magic [ 4 ];
+    uint32_t         version;
+    WAVE_FINGERPRINT fingerprint;  /* of the wave file */
+
+} SIDECAR_PREFIX;
+
+
+/** @brief the path of the sidecar, which is the file name of the wave file
+ *         followed by the extension.
+ *
+ *  @param filename   (in):  wave file name
+ *  @param extension  (in):  extension of the sidecar, e.g., ".peaks"
+ *
+ *  @return path to be released by free(), or NULL on failure.
+ */
+
+char* sidecarPathFor( const char* filename, const char* extension );
+
+
+/** @brief write the header followed by the body to a temporary file next
+ *         to the path and rename it, so that a reader never sees a
+ *         partially written sidecar.
+ *
+ *  @param path        (in):  path of the sidecar
+ *  @param header      (in):  header of the sidecar
+ *  @param headerSize  (in):  size of the header in bytes
+ *  @param body        (in):  body of the sidecar, or NULL if bodySize is 0
+ *  @param bodySize    (in):  size of the body in bytes
+ *
+ *  @return 0:  Success
+ *          -1: Failure, and the temporary file is removed
+ */
+
+int saveSidecarFile(
+    const char* path,
+    const void* header,
+    size_t      headerSize,
+    const void* body,
+    size_t      bodySize      );
+
+
+/** @brief read the sidecar of the wave file saved by saveSidecarFile() with
+ *         a header that begins as SIDECAR_PREFIX and is followed by an
+ *         array. The header is taken only if the magic and the version
+ *         match, and the fingerprint matches the wave file as it is now.
+ *
+ *  @param filename     (in):  wave file name
+ *  @param extension    (in):  extension of the sidecar
+ *  @param magic        (in):  4 bytes of the magic
+ *  @param version      (in):  version of the layout
+ *  @param header       (out): header of headerSize bytes
+ *  @param headerSize   (in):  size of the header in bytes
+ *  @param countOffset  (in):  offset of the int64_t number of the elements
+ *                             of the array in the header
+ *  @param elementSize  (in):  size of an element of the array in bytes
+ *
+ *  @return array with room for one more element, to be released by free(),
+ *          or NULL on failure, e.g., a missing or stale sidecar.
+ */
+
+void* loadSidecarFile(
+    const char* filename,
+    const char* extension,
+    const char* magic,
+    uint32_t    version,
+    void*       header,
+    size_t      headerSize,
+    size_t      countOffset,
+    size_t      elementSize   );
+
+
+#endif /*_SIDECAR_FILE_H_*/
@@ -0,0 +1,435 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "silenceGate.h"
+#include "preRollRing.h"
+#include "voiceActivity.h"
+#include "sidecarFile.h"
+#include "waveFile.h"
+
+#define SGATE_MAGIC              "SGEL"
+#define SGATE_VERSION            1
+#define SGATE_SIDECAR_EXTENSION  ".edl"
+#define SGATE_INITIAL_SEGMENTS   64
+
+
+/** @brief header of the sidecar file, which begins as SIDECAR_PREFIX,
+ *         followed by the segments
+ */
+struct SGATE_SIDECAR {
+
+    unsigned char    magic [ 4 ];
+    uint32_t         version;
+    WAVE_FINGERPRINT fingerprint;  /* of the wave file */
+    int32_t          sampleRate;
+    int32_t          numChannels;
+    int64_t          numSegments;
+
+};
+
+
+struct silence_gate {
+
+    int             numChannels;
+    GATE_WRITER     writer;
+    void*           user;
+    VOICE_ACTIVITY* vad;
+    int             sawSpeech;       /* speech started in the current chunk */
+
+    int64_t         hangover;        /* samples of all the channels */
+    int64_t         numFed;          /* samples of all the channels */
+    int64_t         numWritten;      /* samples of all the channels */
+    int64_t         lastActive;      /* end of the last chunk with speech */
+    int             hasSpoken;
+    int             open;
+
+    PRE_ROLL_RING*  preRoll;         /* NULL without a pre-roll */
+
+    GATE_EDIT_LIST  list;            /* the last segment is open if open */
+    int64_t         listCapacity;
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static void  gate_voice_activity (
+                 int     speech,
+                 int64_t sample_offset,
+                 void*   user           );
+
+static int   open_gate           (
+                 SILENCE_GATE* gate,
+                 int64_t       chunk_start );
+
+static int   write_through       (
+                 SILENCE_GATE* gate,
+                 const short*  samples,
+                 int           num_samples );
+
+
+
+SILENCE_GATE* createSilenceGate(
+    int         sampleRate,
+    int         numChannels,
+    float       preRollSeconds,
+    float       hangoverSeconds,
+    GATE_WRITER writer,
+    void*       user
+) {
+    if (    sampleRate <= 0 || numChannels <= 0 || writer == NULL
+         || preRollSeconds < 0.0f || hangoverSeconds < 0.0f           ) {
+        return NULL;
+    }
+
+    SILENCE_GATE* gate = (SILENCE_GATE*)calloc( 1, sizeof(SILENCE_GATE) );
+
+    if ( gate == NULL ) {
+        return NULL;
+    }
+
+    gate->numChannels      = numChannels;
+    gate->writer           = writer;
+    gate->user             = user;
+    gate->hangover         = (int64_t)( hangoverSeconds * sampleRate )
+                             * numChannels;
+    gate->listCapacity     = SGATE_INITIAL_SEGMENTS;
+    gate->list.sampleRate  = sampleRate;
+    gate->list.numChannels = numChannels;
+    gate->list.segments    = (GATE_SEGMENT*)malloc( sizeof(GATE_SEGMENT)
+                                                    * gate->listCapacity );
+    gate->vad              = createVoiceActivity( sampleRate,
+                                                  numChannels,
+                                                  gate_voice_activity,
+                                                  gate                 );
+
+    int hasPreRoll = ( (int)( preRollSeconds * sampleRate ) > 0 );
+
+    if ( hasPreRoll ) {
+        gate->preRoll = createPreRollRing( sampleRate, numChannels,
+                                           preRollSeconds           );
+    }
+
+    if (    gate->list.segments == NULL || gate->vad == NULL
+         || ( hasPreRoll && gate->preRoll == NULL )          ) {
+
+        freeSilenceGate( gate );
+        return NULL;
+    }
+
+    return gate;
+}
+
+
+int feedSilenceGate(
+    SILENCE_GATE* gate,
+    const short*  samples,
+    int           numSamples
+) {
+    int64_t chunkStart = gate->numFed;
+
+    gate->sawSpeech = 0;
+
+    feedVoiceActivity( gate->vad, samples, numSamples );
+
+    gate->numFed += numSamples;
+
+    int active = gate->sawSpeech || isVoiceActive( gate->vad );
+
+    if ( active ) {
+
+        gate->lastActive = gate->numFed;
+        gate->hasSpoken  = 1;
+    }
+
+    int open = active
+               || (    gate->hasSpoken
+                    && chunkStart - gate->lastActive < gate->hangover );
+
+    if ( !open ) {
+
+        gate->open = 0;
+
+        if ( gate->preRoll != NULL ) {
+            pushPreRoll( gate->preRoll, samples, numSamples );
+        }
+
+        return 0;
+    }
+
+    if ( !gate->open && open_gate( gate, chunkStart ) != 0 ) {
+        return -1;
+    }
+
+    return write_through( gate, samples, numSamples );
+}
+
+
+void silenceGateTotals(
+    const SILENCE_GATE* gate,
+    int64_t*            fedSamples,
+    int64_t*            writtenSamples
+) {
+    *fedSamples     = gate->numFed     / gate->numChannels;
+    *writtenSamples = gate->numWritten / gate->numChannels;
+}
+
+
+int saveGateEditList( const SILENCE_GATE* gate, const char* filename )
+{
+    struct SGATE_SIDECAR sidecar;
+    FILE*                fp;
+
+    memset( &sidecar, 0, sizeof(sidecar) );
+    memcpy( sidecar.magic, SGATE_MAGIC, 4 );
+
+    fp = fopen( filename, "rb" );
+
+    if ( fp == NULL ) {
+        return -1;
+    }
+
+    int rtnVal = computeWaveFingerprint( fp, &(sidecar.fingerprint) );
+
+    fclose(fp);
+
+    if ( rtnVal != 0 ) {
+        return -1;
+    }
+
+    sidecar.version     = SGATE_VERSION;
+    sidecar.sampleRate  = gate->list.sampleRate;
+    sidecar.numChannels = gate->list.numChannels;
+    sidecar.numSegments = gate->list.numSegments;
+
+    char* path = sidecarPathFor( filename, SGATE_SIDECAR_EXTENSION );
+
+    if ( path == NULL ) {
+        return -1;
+    }
+
+    size_t segmentsSize = sizeof(GATE_SEGMENT) * (size_t)gate->list.numSegments;
+
+    rtnVal = saveSidecarFile( path,
+                              &sidecar,
+                              sizeof(sidecar),
+                              gate->list.segments,
+                              segmentsSize );
+
+    free(path);
+
+    return rtnVal;
+}
+
+
+void freeSilenceGate( SILENCE_GATE* gate )
+{
+    if ( gate == NULL ) {
+        return;
+    }
+
+    freeVoiceActivity( gate->vad );
+    freePreRollRing( gate->preRoll );
+    free( gate->list.segments );
+    free( gate );
+}
+
+
+GATE_EDIT_LIST* loadGateEditList( const char* filename )
+{
+    struct SGATE_SIDECAR sidecar;
+    size_t               countOffset = offsetof( struct SGATE_SIDECAR,
+                                                 numSegments          );
+
+    GATE_SEGMENT* segments =
+        (GATE_SEGMENT*)loadSidecarFile( filename,
+                                        SGATE_SIDECAR_EXTENSION,
+                                        SGATE_MAGIC,
+                                        SGATE_VERSION,
+                                        &sidecar,
+                                        sizeof(sidecar),
+                                        countOffset,
+                                        sizeof(GATE_SEGMENT)     );
+    if ( segments == NULL ) {
+        return NULL;
+    }
+
+    GATE_EDIT_LIST* list = (GATE_EDIT_LIST*)malloc( sizeof(GATE_EDIT_LIST) );
+
+    if ( list == NULL ) {
+
+        free( segments );
+        return NULL;
+    }
+
+    list->sampleRate  = sidecar.sampleRate;
+    list->numChannels = sidecar.numChannels;
+    list->numSegments = sidecar.numSegments;
+    list->segments    = segments;
+
+    return list;
+}
+
+
+int64_t gatedToSourceOffset( const GATE_EDIT_LIST* list, int64_t fileOffset )
+{
+    int64_t lo = 0;
+    int64_t hi = list->numSegments;
+
+    /* the last segment starting at or before fileOffset */
+    while ( hi - lo > 1 ) {
+
+        int64_t mid = ( lo + hi ) / 2;
+
+        if ( list->segments[mid].fileOffset <= fileOffset ) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    if ( list->numSegments == 0 || fileOffset < 0 ) {
+        return -1;
+    }
+
+    const GATE_SEGMENT* seg = &(list->segments[lo]);
+
+    if ( fileOffset >= seg->fileOffset + seg->length ) {
+        return -1;
+    }
+
+    return seg->sourceOffset + ( fileOffset - seg->fileOffset );
+}
+
+
+void freeGateEditList( GATE_EDIT_LIST* list )
+{
+    if ( list == NULL ) {
+        return;
+    }
+
+    free( list->segments );
+    free( list );
+}
+
+
+static void gate_voice_activity(
+    int     speech,
+    int64_t sampleOffset,
+    void*   user
+) {
+    SILENCE_GATE* gate = (SILENCE_GATE*)user;
+
+    (void)sampleOffset;
+
+    /* catches the speech that ends within the chunk it started in */
+    if ( speech ) {
+        gate->sawSpeech = 1;
+    }
+}
+
+
+/** @brief start a segment with the pre-roll before the chunk at
+ *         chunk_start.
+ */
+static int open_gate( SILENCE_GATE* gate, int64_t chunkStart )
+{
+    if ( gate->list.numSegments == gate->listCapacity ) {
+
+        size_t        size     = sizeof(GATE_SEGMENT) * gate->listCapacity * 2;
+        GATE_SEGMENT* segments = (GATE_SEGMENT*)realloc( gate->list.segments,
+                                                         size                );
+        if ( segments == NULL ) {
+            return -1;
+        }
+
+        gate->list.segments  = segments;
+        gate->listCapacity  *= 2;
+    }
+
+    /* The pre-roll in at most two pieces, oldest first. It is written and
+       released at once on this thread, so it is never detached already. */
+    PRE_ROLL_SPLICE splice;
+
+    memset( &splice, 0, sizeof(splice) );
+
+    if ( gate->preRoll != NULL ) {
+        detachPreRoll( gate->preRoll, &splice );
+    }
+
+    int64_t       numPreRoll = splice.numSamples[0] + splice.numSamples[1];
+    GATE_SEGMENT* seg        = &(gate->list.segments[ gate->list.numSegments ]);
+
+    seg->fileOffset   = gate->numWritten / gate->numChannels;
+    seg->sourceOffset = ( chunkStart - numPreRoll ) / gate->numChannels;
+    seg->length       = 0;
+
+    gate->list.numSegments++;
+    gate->open = 1;
+
+    int rtnVal = write_through( gate, splice.pieces[0], splice.numSamples[0] );
+
+    if ( rtnVal == 0 ) {
+        rtnVal = write_through( gate, splice.pieces[1], splice.numSamples[1] );
+    }
+
+    if ( gate->preRoll != NULL ) {
+        releasePreRoll( gate->preRoll );
+    }
+
+    return rtnVal;
+}
+
+
+static int write_through(
+    SILENCE_GATE* gate,
+    const short*  samples,
+    int           numSamples
+) {
+    if ( numSamples == 0 ) {
+        return 0;
+    }
+
+    if ( gate->writer( samples, numSamples, gate->user ) != 0 ) {
+        return -1;
+    }
+
+    gate->numWritten += numSamples;
+
+    GATE_SEGMENT* seg = &(gate->list.segments[ gate->list.numSegments - 1 ]);
+
+    seg->length = gate->numWritten / gate->numChannels - seg->fileOffset;
+
+    return 0;
+}
+
+
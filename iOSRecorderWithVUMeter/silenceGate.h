@@ -0,0 +1,160 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Silence gate for recording.
+ *
+ * The samples are passed to the writer only while the voice activity
+ * detector of voiceActivity.h finds speech, and for the hangover after it.
+ * The samples in between are dropped, except for the last pre-roll seconds
+ * before the gate opens again, which are kept in a fixed ring so that the
+ * onsets are not clipped.
+ *
+ * Each run of the written samples is a segment of the edit list, which maps
+ * the offsets in the written file back to the positions in the captured
+ * stream. The list is saved in a sidecar "<wave file>.edl" tied to the wave
+ * file by its fingerprint.
+ */
+
+#ifndef _SILENCE_GATE_H_
+#define _SILENCE_GATE_H_
+
+#include <stdint.h>
+
+typedef struct silence_gate SILENCE_GATE;
+
+
+/** @brief run of written samples. Offsets and lengths are in samples per
+ *         channel.
+ */
+typedef struct gate_segment {
+
+    int64_t fileOffset;    /* in the written file */
+    int64_t sourceOffset;  /* in the captured stream since the start */
+    int64_t length;
+
+} GATE_SEGMENT;
+
+
+/** @brief edit list of a gated recording */
+typedef struct gate_edit_list {
+
+    int           sampleRate;
+    int           numChannels;
+    int64_t       numSegments;
+    GATE_SEGMENT* segments;     /* in the order of fileOffset */
+
+} GATE_EDIT_LIST;
+
+
+/** @brief called to write the samples passing through the gate.
+ *
+ *  @return 0:  Success
+ *          -1: Failure, returned by feedSilenceGate()
+ */
+typedef int (*GATE_WRITER)( const short* samples, int numSamples, void* user );
+
+
+/** @brief create a gate.
+ *
+ *  @param sampleRate      (in): sample rate in [Hz]
+ *  @param numChannels     (in): number of the interleaved channels
+ *  @param preRollSeconds  (in): samples kept before the gate opens
+ *  @param hangoverSeconds (in): samples kept after the speech ends
+ *  @param writer          (in): called with the samples to write
+ *  @param user            (in): passed to the writer
+ *
+ *  @return gate, or NULL on failure.
+ */
+
+SILENCE_GATE* createSilenceGate(
+    int         sampleRate,
+    int         numChannels,
+    float       preRollSeconds,
+    float       hangoverSeconds,
+    GATE_WRITER writer,
+    void*       user             );
+
+
+/** @brief pass a chunk of interleaved samples through the gate. The chunk
+ *         is either written, after the pre-roll if the gate opens with it,
+ *         or held in the pre-roll.
+ *
+ *  @return 0:  Success
+ *          -1: The writer failed.
+ */
+
+int feedSilenceGate(
+    SILENCE_GATE* gate,
+    const short*  samples,
+    int           numSamples );
+
+
+/** @brief number of the samples per channel fed and written so far */
+
+void silenceGateTotals(
+    const SILENCE_GATE* gate,
+    int64_t*            fedSamples,
+    int64_t*            writtenSamples );
+
+
+/** @brief save the edit list of the samples written so far in the sidecar
+ *         of the given wave file, which must be complete.
+ *
+ *  @return 0:  Success
+ *          -1: Failure
+ */
+
+int saveGateEditList( const SILENCE_GATE* gate, const char* filename );
+
+
+/** @brief release the gate */
+
+void freeSilenceGate( SILENCE_GATE* gate );
+
+
+/** @brief load the edit list of the given wave file.
+ *
+ *  @return edit list to be released by freeGateEditList(), or NULL if the
+ *          file was not gated or has changed since.
+ */
+
+GATE_EDIT_LIST* loadGateEditList( const char* filename );
+
+
+/** @brief position in the captured stream of a sample in the file.
+ *
+ *  @param fileOffset (in): offset in the wave file in samples per channel
+ *
+ *  @return offset in the captured stream in samples per channel, or -1 if
+ *          beyond the file.
+ */
+
+int64_t gatedToSourceOffset( const GATE_EDIT_LIST* list, int64_t fileOffset );
+
+
+/** @brief release the edit list */
+
+void freeGateEditList( GATE_EDIT_LIST* list );
+
+
+#endif /*_SILENCE_GATE_H_*/
@@ -0,0 +1,166 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <unistd.h>
+
+#include "snrCache.h"
+#include "sidecarFile.h"
+#include "waveFile.h"
+
+#define SNRC_MAGIC              "SNRC"
+#define SNRC_VERSION            1     /* bump when estimateSNR() changes */
+#define SNRC_SIDECAR_EXTENSION  ".snr"
+
+/** @brief contents of the sidecar file */
+struct SNRC_SIDECAR {
+
+    unsigned char    magic [ 4 ];
+    uint32_t         version;
+    WAVE_FINGERPRINT fingerprint;  /* of the wave file */
+    float            noiseLevel;
+    float            speechLevel;
+
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int   load_sidecar (
+                 const char*             path,
+                 const WAVE_FINGERPRINT* fingerprint,
+                 float*                  noise_level,
+                 float*                  speech_level );
+
+static int   save_sidecar (
+                 const char*             path,
+                 const WAVE_FINGERPRINT* fingerprint,
+                 float                   noise_level,
+                 float                   speech_level );
+
+
+int estimateSNRWithCache(
+    const char* filename,
+    float*      noiseLevel,
+    float*      speechLevel
+) {
+    WAVE_FINGERPRINT fingerprint;
+    FILE*            fp;
+
+    fp = fopen( filename, "rb" );
+
+    if ( fp == NULL ) {
+        return -1;
+    }
+
+    int rtnVal = computeWaveFingerprint( fp, &fingerprint );
+
+    fclose(fp);
+
+    if ( rtnVal != 0 ) {
+        return -1;
+    }
+
+    char* path = sidecarPathFor( filename, SNRC_SIDECAR_EXTENSION );
+
+    if (    path != NULL
+         && load_sidecar( path, &fingerprint, noiseLevel, speechLevel ) == 0 ) {
+
+        free(path);
+        return 0;
+    }
+
+    if ( estimateSNR( filename, noiseLevel, speechLevel ) != 0 ) {
+
+        free(path);
+        return -1;
+    }
+
+    if ( path != NULL ) {
+
+        /* The sidecar is only a cache. Failing to save it is not fatal. */
+        save_sidecar( path, &fingerprint, *noiseLevel, *speechLevel );
+        free(path);
+    }
+
+    return 0;
+}
+
+
+static int load_sidecar(
+    const char*             path,
+    const WAVE_FINGERPRINT* fingerprint,
+    float*                  noiseLevel,
+    float*                  speechLevel
+) {
+    struct SNRC_SIDECAR sidecar;
+    FILE*               fp;
+
+    fp = fopen( path, "rb" );
+
+    if ( fp == NULL ) {
+        return -1;
+    }
+
+    size_t len = fread( &sidecar, 1, sizeof(sidecar), fp );
+
+    fclose(fp);
+
+    if (    len != sizeof(sidecar)
+         || memcmp( sidecar.magic, SNRC_MAGIC, 4 ) != 0
+         || sidecar.version != SNRC_VERSION
+         || !equalWaveFingerprints( &sidecar.fingerprint, fingerprint ) ) {
+
+        return -1;
+    }
+
+    *noiseLevel  = sidecar.noiseLevel;
+    *speechLevel = sidecar.speechLevel;
+
+    return 0;
+}
+
+
+/** @brief write the sidecar to a temporary file and rename it, so that
+ *         a reader never sees a partially written one.
+ */
+static int save_sidecar(
+    const char*             path,
+    const WAVE_FINGERPRINT* fingerprint,
+    float                   noiseLevel,
+    float                   speechLevel
+) {
+    struct SNRC_SIDECAR sidecar;
+
+    memset( &sidecar, 0, sizeof(sidecar) );
+    memcpy( sidecar.magic, SNRC_MAGIC, 4 );
+
+    sidecar.version     = SNRC_VERSION;
+    sidecar.fingerprint = *fingerprint;
+    sidecar.noiseLevel  = noiseLevel;
+    sidecar.speechLevel = speechLevel;
+
+    return saveSidecarFile( path, &sidecar, sizeof(sidecar), NULL, 0 );
+}
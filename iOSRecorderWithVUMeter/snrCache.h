@@ -0,0 +1,49 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SNR_CACHE_H_
+#define _SNR_CACHE_H_
+
+#include "estimateSNR.h"
+
+/** @brief estimateSNR() with the results cached in a sidecar file next to
+ *         the wave file. The sidecar is used while the fingerprint of the
+ *         wave file stays the same. Otherwise the levels are estimated
+ *         again, and the sidecar is (re)written.
+ *         Failing to write the sidecar does not make this fail.
+ *
+ *  @param filename    (in):  wave file name
+ *  @param noiseLevel  (out): background noise level in [dB]
+ *  @param speechLevel (out): speech level in [dB]
+ *
+ *  @return 0:  Success
+ *          -1: Failure mostlikely due to wrong input file.
+ */
+
+int estimateSNRWithCache(
+    const char* filename,
+    float*      noiseLevel,
+    float*      speechLevel   );
+
+
+#endif /*_SNR_CACHE_H_*/
@@ -0,0 +1,918 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "spectrogramTiles.h"
+#include "jobRunner.h"
+#include "realFFT.h"
+#include "sidecarFile.h"
+#include "waveFile.h"
+
+#define SPG_MAGIC              "SPGM"
+#define SPG_VERSION            2
+#define SPG_SIDECAR_EXTENSION  ".spg"
+#define SPG_FFT_SIZE           ( SPG_TILE_BINS * 2 )
+#define SPG_HOP                256
+#define SPG_MAX_LEVELS         40
+#define SPG_FLOOR_DB           0.0f    /* byte 0   */
+#define SPG_RANGE_DB           120.0f  /* byte 255, above a full-scale tone */
+#define SPG_MIN_POWER          1.0e-10f
+
+/** @brief header of the sidecar file followed by the offsets of the tiles
+ *         of all the levels (0 for missing), and then by the tiles.
+ */
+struct SPG_SIDECAR {
+
+    unsigned char    magic [ 4 ];
+    uint32_t         version;
+    WAVE_FINGERPRINT fingerprint;  /* of the wave file */
+    int64_t          totalSamples;
+    int32_t          fftSize;
+    int32_t          hop;
+    int32_t          tileFrames;
+    int32_t          tileBins;
+    int64_t          numTiles;
+
+};
+
+
+struct spectrogram {
+
+    int              waveFd;
+    int64_t          dataOffset;
+    int64_t          numFrames;       /* samples per channel */
+    int              numChannels;
+    REAL_FFT*        fft;
+
+    int              numLevels;
+    int64_t          levelTiles [ SPG_MAX_LEVELS ];
+    int64_t          levelFirst [ SPG_MAX_LEVELS ];  /* in tileOffsets */
+    int64_t          numTiles;
+
+    pthread_mutex_t  lock;            /* for the following */
+    int64_t*         tileOffsets;     /* in the sidecar, 0 for missing */
+    int              cacheFd;         /* -1 without the sidecar */
+    int64_t          cacheEnd;
+};
+
+
+/** @brief buffers of a thread to compute tiles */
+typedef struct spg_work {
+
+    short*         samples;   /* [ SPG_FFT_SIZE * numChannels ] */
+    float*         frame;     /* [ SPG_FFT_SIZE ] */
+    float*         fftWork;   /* [ SPG_FFT_SIZE ] */
+    float*         power;     /* [ SPG_FFT_SIZE / 2 + 1 ] */
+    unsigned char* tile;      /* [ SPG_TILE_BYTES ] */
+
+} SPG_WORK;
+
+
+/** @brief missing tiles for a thread: indices[ i ] for i = jobIndex,
+ *         jobIndex + numJobs, ...
+ */
+typedef struct spg_tile_job {
+
+    SPECTROGRAM*   spectrogram;
+    int            level;
+    const int64_t* indices;
+    int64_t        numIndices;
+    int            jobIndex;
+    int            numJobs;
+    int            rtnVal;
+
+} SPG_TILE_JOB;
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int       open_sidecar (
+                     SPECTROGRAM*            spectrogram,
+                     const char*             path,
+                     const WAVE_FINGERPRINT* fingerprint,
+                     int64_t                 total_samples );
+
+static int       read_fully ( int fd, void* buf, size_t len, int64_t offset );
+
+static int       write_fully (
+                     int         fd,
+                     const void* buf,
+                     size_t      len,
+                     int64_t     offset );
+
+static SPG_WORK* alloc_work ( int num_channels );
+
+static void      free_work ( SPG_WORK* work );
+
+static int       read_cached_tile (
+                     SPECTROGRAM*   spectrogram,
+                     int64_t        slot,
+                     unsigned char* tile         );
+
+static int       get_tile (
+                     SPECTROGRAM*   spectrogram,
+                     SPG_WORK*      work,
+                     int            level,
+                     int64_t        index,
+                     unsigned char* tile         );
+
+static int       compute_tile (
+                     SPECTROGRAM*   spectrogram,
+                     SPG_WORK*      work,
+                     int            level,
+                     int64_t        index,
+                     unsigned char* tile         );
+
+static int       compute_frames_tile (
+                     SPECTROGRAM*   spectrogram,
+                     SPG_WORK*      work,
+                     int64_t        index,
+                     unsigned char* tile         );
+
+static int       pool_tiles (
+                     SPECTROGRAM*   spectrogram,
+                     SPG_WORK*      work,
+                     int            level,
+                     int64_t        index,
+                     unsigned char* tile         );
+
+static void      store_tile (
+                     SPECTROGRAM*         spectrogram,
+                     int64_t              slot,
+                     const unsigned char* tile         );
+
+static void*     compute_tiles_job ( void* p );
+
+
+SPECTROGRAM* openSpectrogram( const char* filename )
+{
+    WAVE_FILE_INFO   info;
+    WAVE_FINGERPRINT fingerprint;
+    FILE*            fp;
+
+    fp = fopen( filename, "rb" );
+
+    if ( fp == NULL ) {
+        return NULL;
+    }
+
+    if (    computeWaveFingerprint( fp, &fingerprint ) != 0
+         || readWaveFileInfo( fp, &info )              != 0 ) {
+
+        fclose(fp);
+        return NULL;
+    }
+
+    fclose(fp);
+
+    SPECTROGRAM* spectrogram = (SPECTROGRAM*)calloc( 1, sizeof(SPECTROGRAM) );
+
+    if ( spectrogram == NULL ) {
+        return NULL;
+    }
+
+    if ( pthread_mutex_init( &(spectrogram->lock), NULL ) != 0 ) {
+
+        free( spectrogram );
+        return NULL;
+    }
+
+    spectrogram->cacheFd     = -1;
+    spectrogram->numChannels = ( info.numChannels > 0 ) ? info.numChannels : 1;
+    spectrogram->dataOffset  = info.dataOffset;
+    spectrogram->numFrames   = info.totalSamples / spectrogram->numChannels;
+    spectrogram->waveFd      = open( filename, O_RDONLY );
+    spectrogram->fft         = createRealFFT( SPG_FFT_SIZE );
+
+    if ( spectrogram->waveFd == -1 || spectrogram->fft == NULL ) {
+
+        freeSpectrogram( spectrogram );
+        return NULL;
+    }
+
+    /* Levels until one tile covers the whole file. */
+    int64_t numTiles = 0;
+    int     L        = 0;
+
+    for ( ; L < SPG_MAX_LEVELS; L++ ) {
+
+        int64_t stride = (int64_t)SPG_HOP << L;
+        int64_t frames = ( spectrogram->numFrames + stride - 1 ) / stride;
+        int64_t tiles  = ( frames + SPG_TILE_FRAMES - 1 ) / SPG_TILE_FRAMES;
+
+        tiles = ( tiles > 0 ) ? tiles : 1;
+
+        spectrogram->levelTiles[ L ] = tiles;
+        spectrogram->levelFirst[ L ] = numTiles;
+        numTiles                    += tiles;
+
+        if ( tiles == 1 ) {
+            break;
+        }
+    }
+
+    spectrogram->numLevels   = ( L < SPG_MAX_LEVELS ) ? L + 1 : SPG_MAX_LEVELS;
+    spectrogram->numTiles    = numTiles;
+    spectrogram->tileOffsets = (int64_t*)calloc( numTiles, sizeof(int64_t) );
+
+    if ( spectrogram->tileOffsets == NULL ) {
+
+        freeSpectrogram( spectrogram );
+        return NULL;
+    }
+
+    char* path = sidecarPathFor( filename, SPG_SIDECAR_EXTENSION );
+
+    if ( path != NULL ) {
+
+        /* The sidecar is only a cache. Without it the tiles are computed
+           every time they are read. */
+        open_sidecar( spectrogram, path, &fingerprint, info.totalSamples );
+        free( path );
+    }
+
+    return spectrogram;
+}
+
+
+int spectrogramLevelFor(
+    const SPECTROGRAM* spectrogram,
+    int64_t            numSamples,
+    int                width
+) {
+    int64_t numFrames = numSamples / spectrogram->numChannels;
+    int     level     = 0;
+
+    while (    level + 1 < spectrogram->numLevels
+            && numFrames / ( (int64_t)SPG_HOP << ( level + 1 ) ) >= width ) {
+
+        level++;
+    }
+
+    return level;
+}
+
+
+int prepareSpectrogramTiles(
+    SPECTROGRAM* spectrogram,
+    int          level,
+    int64_t      fromSample,
+    int64_t      toSample
+) {
+    if ( level < 0 || level >= spectrogram->numLevels || toSample <= fromSample ) {
+        return -1;
+    }
+
+    int64_t tileSpan = ( (int64_t)SPG_HOP << level ) * SPG_TILE_FRAMES;
+    int64_t first    = ( fromSample   / spectrogram->numChannels ) / tileSpan;
+    int64_t last     = ( ( toSample - 1 ) / spectrogram->numChannels ) / tileSpan;
+
+    first = ( first > 0 ) ? first : 0;
+    last  = ( last < spectrogram->levelTiles[ level ] )
+            ? last : spectrogram->levelTiles[ level ] - 1;
+
+    if ( last < first ) {
+        return 0;
+    }
+
+    int64_t* indices = (int64_t*)malloc( sizeof(int64_t) * ( last - first + 1 ) );
+
+    if ( indices == NULL ) {
+        return -1;
+    }
+
+    int64_t numIndices = 0;
+
+    pthread_mutex_lock( &(spectrogram->lock) );
+
+    for ( int64_t i = first; i <= last; i++ ) {
+
+        if ( spectrogram->tileOffsets[ spectrogram->levelFirst[ level ] + i ]
+             == 0 ) {
+
+            indices[ numIndices++ ] = i;
+        }
+    }
+
+    pthread_mutex_unlock( &(spectrogram->lock) );
+
+    int          numJobs = numJobsFor( numIndices, 1 );
+    SPG_TILE_JOB jobs [ JOB_MAX_THREADS ];
+
+    for ( int j = 0; j < numJobs; j++ ) {
+
+        jobs[j].spectrogram = spectrogram;
+        jobs[j].level       = level;
+        jobs[j].indices     = indices;
+        jobs[j].numIndices  = numIndices;
+        jobs[j].jobIndex    = j;
+        jobs[j].numJobs     = numJobs;
+        jobs[j].rtnVal      = 0;
+    }
+
+    if ( numIndices > 0 ) {
+        runJobs( compute_tiles_job, jobs, sizeof(SPG_TILE_JOB), numJobs );
+    }
+
+    free( indices );
+
+    for ( int j = 0; j < numJobs; j++ ) {
+
+        if ( jobs[j].rtnVal != 0 ) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+int readSpectrogramTile(
+    SPECTROGRAM*   spectrogram,
+    int            level,
+    int64_t        index,
+    unsigned char* tile
+) {
+    if (    level < 0 || level >= spectrogram->numLevels
+         || index < 0 || index >= spectrogram->levelTiles[ level ] ) {
+
+        return -1;
+    }
+
+    if ( read_cached_tile( spectrogram,
+                           spectrogram->levelFirst[ level ] + index,
+                           tile                                     ) == 0 ) {
+        return 0;
+    }
+
+    SPG_WORK* work = alloc_work( spectrogram->numChannels );
+
+    if ( work == NULL ) {
+        return -1;
+    }
+
+    int rtnVal = get_tile( spectrogram, work, level, index, tile );
+
+    free_work( work );
+
+    return rtnVal;
+}
+
+
+unsigned char* computeSpectrogramImage(
+    SPECTROGRAM* spectrogram,
+    int64_t      fromSample,
+    int64_t      toSample,
+    int          width,
+    int          height
+) {
+    if ( width <= 0 || height <= 0 || toSample <= fromSample ) {
+        return NULL;
+    }
+
+    int level = spectrogramLevelFor( spectrogram, toSample - fromSample, width );
+
+    if ( prepareSpectrogramTiles( spectrogram, level, fromSample, toSample )
+         != 0 ) {
+        return NULL;
+    }
+
+    unsigned char* image = (unsigned char*)calloc( (size_t)width * height, 1 );
+    unsigned char* tile  = (unsigned char*)malloc( SPG_TILE_BYTES );
+    int*           bins  = (int*)malloc( sizeof(int) * height );
+
+    if ( image == NULL || tile == NULL || bins == NULL ) {
+
+        free( image );
+        free( tile );
+        free( bins );
+        return NULL;
+    }
+
+    for ( int y = 0; y < height; y++ ) {
+        bins[y] = (int)( (int64_t)( height - 1 - y ) * SPG_TILE_BINS / height );
+    }
+
+    int64_t stride    = (int64_t)SPG_HOP << level;
+    int64_t fromFrame = fromSample / spectrogram->numChannels;
+    int64_t numFrames = ( toSample - fromSample ) / spectrogram->numChannels;
+    int64_t loaded    = -1;
+
+    for ( int x = 0; x < width; x++ ) {
+
+        /* the frame at the center of the column */
+        int64_t t     = fromFrame + ( 2 * x + 1 ) * numFrames / ( 2 * width );
+        int64_t frame = t / stride;
+        int64_t index = frame / SPG_TILE_FRAMES;
+
+        if ( index >= spectrogram->levelTiles[ level ] ) {
+            break;
+        }
+
+        if ( index != loaded ) {
+
+            if ( readSpectrogramTile( spectrogram, level, index, tile ) != 0 ) {
+
+                free( image );
+                free( tile );
+                free( bins );
+                return NULL;
+            }
+
+            loaded = index;
+        }
+
+        const unsigned char* row = &(tile[ ( frame % SPG_TILE_FRAMES )
+                                           * SPG_TILE_BINS             ]);
+
+        for ( int y = 0; y < height; y++ ) {
+            image[ (size_t)y * width + x ] = row[ bins[y] ];
+        }
+    }
+
+    free( tile );
+    free( bins );
+
+    return image;
+}
+
+
+void freeSpectrogram( SPECTROGRAM* spectrogram )
+{
+    if ( spectrogram == NULL ) {
+        return;
+    }
+
+    if ( spectrogram->waveFd != -1 ) {
+        close( spectrogram->waveFd );
+    }
+
+    if ( spectrogram->cacheFd != -1 ) {
+        close( spectrogram->cacheFd );
+    }
+
+    freeRealFFT( spectrogram->fft );
+    free( spectrogram->tileOffsets );
+    pthread_mutex_destroy( &(spectrogram->lock) );
+    free( spectrogram );
+}
+
+
+/** @brief open the sidecar and load the offsets of its tiles, or start an
+ *         empty one if it is missing or stale.
+ */
+static int open_sidecar(
+    SPECTROGRAM*            spectrogram,
+    const char*             path,
+    const WAVE_FINGERPRINT* fingerprint,
+    int64_t                 totalSamples
+) {
+    struct SPG_SIDECAR sidecar;
+    struct stat        statBuf;
+    size_t             tableSize  = sizeof(int64_t) * spectrogram->numTiles;
+    int64_t            tilesBegin = (int64_t)( sizeof(sidecar) + tableSize );
+
+    int fd = open( path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+
+    if ( fd == -1 ) {
+        return -1;
+    }
+
+    if (    fstat( fd, &statBuf ) == 0
+         && read_fully( fd, &sidecar, sizeof(sidecar), 0 ) == 0
+         && memcmp( sidecar.magic, SPG_MAGIC, 4 ) == 0
+         && sidecar.version      == SPG_VERSION
+         && equalWaveFingerprints( &sidecar.fingerprint, fingerprint )
+         && sidecar.totalSamples == totalSamples
+         && sidecar.fftSize      == SPG_FFT_SIZE
+         && sidecar.hop          == SPG_HOP
+         && sidecar.tileFrames   == SPG_TILE_FRAMES
+         && sidecar.tileBins     == SPG_TILE_BINS
+         && sidecar.numTiles     == spectrogram->numTiles
+         && read_fully( fd, spectrogram->tileOffsets, tableSize,
+                        sizeof(sidecar)                          ) == 0 ) {
+
+        /* Forget the tiles cut short. */
+        for ( int64_t i = 0; i < spectrogram->numTiles; i++ ) {
+
+            int64_t offset = spectrogram->tileOffsets[i];
+
+            if ( offset < tilesBegin
+                 || offset + SPG_TILE_BYTES > (int64_t)statBuf.st_size ) {
+
+                spectrogram->tileOffsets[i] = 0;
+            }
+        }
+
+        spectrogram->cacheFd  = fd;
+        spectrogram->cacheEnd = ( statBuf.st_size > tilesBegin )
+                                ? (int64_t)statBuf.st_size : tilesBegin;
+        return 0;
+    }
+
+    memset( &sidecar, 0, sizeof(sidecar) );
+    memcpy( sidecar.magic, SPG_MAGIC, 4 );
+
+    sidecar.version      = SPG_VERSION;
+    sidecar.fingerprint  = *fingerprint;
+    sidecar.totalSamples = totalSamples;
+    sidecar.fftSize      = SPG_FFT_SIZE;
+    sidecar.hop          = SPG_HOP;
+    sidecar.tileFrames   = SPG_TILE_FRAMES;
+    sidecar.tileBins     = SPG_TILE_BINS;
+    sidecar.numTiles     = spectrogram->numTiles;
+
+    memset( spectrogram->tileOffsets, 0, tableSize );
+
+    if (    ftruncate( fd, 0 ) != 0
+         || write_fully( fd, &sidecar, sizeof(sidecar), 0 ) != 0
+         || write_fully( fd, spectrogram->tileOffsets, tableSize,
+                         sizeof(sidecar)                          ) != 0 ) {
+
+        close( fd );
+        unlink( path );
+        return -1;
+    }
+
+    spectrogram->cacheFd  = fd;
+    spectrogram->cacheEnd = tilesBegin;
+
+    return 0;
+}
+
+
+static int read_fully( int fd, void* buf, size_t len, int64_t offset )
+{
+    size_t done = 0;
+
+    while ( done < len ) {
+
+        ssize_t n = pread( fd, (char*)buf + done, len - done, offset + done );
+
+        if ( n <= 0 ) {
+            return -1;
+        }
+
+        done += n;
+    }
+
+    return 0;
+}
+
+
+static int write_fully( int fd, const void* buf, size_t len, int64_t offset )
+{
+    size_t done = 0;
+
+    while ( done < len ) {
+
+        ssize_t n = pwrite( fd, (const char*)buf + done, len - done,
+                            offset + done                            );
+        if ( n <= 0 ) {
+            return -1;
+        }
+
+        done += n;
+    }
+
+    return 0;
+}
+
+
+static SPG_WORK* alloc_work( int numChannels )
+{
+    SPG_WORK* work = (SPG_WORK*)calloc( 1, sizeof(SPG_WORK) );
+
+    if ( work == NULL ) {
+        return NULL;
+    }
+
+    work->samples = (short*)malloc( sizeof(short) * SPG_FFT_SIZE * numChannels );
+    work->frame   = (float*)malloc( sizeof(float) * SPG_FFT_SIZE );
+    work->fftWork = (float*)malloc( sizeof(float) * SPG_FFT_SIZE );
+    work->power   = (float*)malloc( sizeof(float) * ( SPG_FFT_SIZE / 2 + 1 ) );
+    work->tile    = (unsigned char*)malloc( SPG_TILE_BYTES );
+
+    if (    work->samples == NULL || work->frame == NULL
+         || work->fftWork == NULL || work->power == NULL
+         || work->tile    == NULL                        ) {
+
+        free_work( work );
+        return NULL;
+    }
+
+    return work;
+}
+
+
+static void free_work( SPG_WORK* work )
+{
+    if ( work == NULL ) {
+        return;
+    }
+
+    free( work->samples );
+    free( work->frame );
+    free( work->fftWork );
+    free( work->power );
+    free( work->tile );
+    free( work );
+}
+
+
+/** @brief read the tile of the slot from the sidecar.
+ *
+ *  @return 0: Success, -1: not in the sidecar
+ */
+static int read_cached_tile(
+    SPECTROGRAM*   spectrogram,
+    int64_t        slot,
+    unsigned char* tile
+) {
+    pthread_mutex_lock( &(spectrogram->lock) );
+
+    int64_t offset = spectrogram->tileOffsets[ slot ];
+
+    pthread_mutex_unlock( &(spectrogram->lock) );
+
+    if (    offset != 0
+         && read_fully( spectrogram->cacheFd, tile, SPG_TILE_BYTES, offset )
+            == 0                                                            ) {
+        return 0;
+    }
+
+    return -1;
+}
+
+
+/** @brief read the tile from the sidecar, or compute it and store it. */
+static int get_tile(
+    SPECTROGRAM*   spectrogram,
+    SPG_WORK*      work,
+    int            level,
+    int64_t        index,
+    unsigned char* tile
+) {
+    int64_t slot = spectrogram->levelFirst[ level ] + index;
+
+    if ( read_cached_tile( spectrogram, slot, tile ) == 0 ) {
+        return 0;
+    }
+
+    if ( compute_tile( spectrogram, work, level, index, tile ) != 0 ) {
+        return -1;
+    }
+
+    store_tile( spectrogram, slot, tile );
+
+    return 0;
+}
+
+
+/** @brief compute the tile of the level into tile. Level 0 is computed
+ *         from the samples, and the others from the level below.
+ */
+static int compute_tile(
+    SPECTROGRAM*   spectrogram,
+    SPG_WORK*      work,
+    int            level,
+    int64_t        index,
+    unsigned char* tile
+) {
+    if ( level == 0 ) {
+        return compute_frames_tile( spectrogram, work, index, tile );
+    }
+
+    return pool_tiles( spectrogram, work, level, index, tile );
+}
+
+
+/** @brief compute a tile of level 0. The frame j of the tile starts at the
+ *         sample ( index * SPG_TILE_FRAMES + j ) * SPG_HOP of each channel,
+ *         and the frames past the end are silent.
+ */
+static int compute_frames_tile(
+    SPECTROGRAM*   spectrogram,
+    SPG_WORK*      work,
+    int64_t        index,
+    unsigned char* tile
+) {
+    int     numChannels = spectrogram->numChannels;
+    float   scale       = 255.0f / SPG_RANGE_DB;
+    float   mix         = 1.0f / numChannels;
+
+    for ( int j = 0; j < SPG_TILE_FRAMES; j++ ) {
+
+        unsigned char* row   = &(tile[ j * SPG_TILE_BINS ]);
+        int64_t        start = ( index * SPG_TILE_FRAMES + j ) * SPG_HOP;
+
+        if ( start >= spectrogram->numFrames ) {
+
+            memset( row, 0, SPG_TILE_BINS );
+            continue;
+        }
+
+        int64_t n = spectrogram->numFrames - start;
+
+        n = ( n < SPG_FFT_SIZE ) ? n : SPG_FFT_SIZE;
+
+        if ( read_fully( spectrogram->waveFd,
+                         work->samples,
+                         sizeof(short) * n * numChannels,
+                         spectrogram->dataOffset
+                         + start * numChannels * (int64_t)sizeof(short) ) != 0 ) {
+            return -1;
+        }
+
+        if ( numChannels == 1 ) {
+
+            for ( int64_t i = 0; i < n; i++ ) {
+                work->frame[i] = (float)work->samples[i];
+            }
+        }
+        else {
+
+            for ( int64_t i = 0; i < n; i++ ) {
+
+                int sum = 0;
+
+                for ( int c = 0; c < numChannels; c++ ) {
+                    sum += work->samples[ i * numChannels + c ];
+                }
+
+                work->frame[i] = sum * mix;
+            }
+        }
+
+        for ( int64_t i = n; i < SPG_FFT_SIZE; i++ ) {
+            work->frame[i] = 0.0f;
+        }
+
+        powerSpectrumOfFrame( spectrogram->fft,
+                              work->frame,
+                              work->fftWork,
+                              work->power     );
+
+        for ( int k = 0; k < SPG_TILE_BINS; k++ ) {
+
+            float p = work->power[k];
+            float v = ( 10.0f * log10f( ( p > SPG_MIN_POWER ) ? p : SPG_MIN_POWER )
+                        - SPG_FLOOR_DB ) * scale;
+
+            row[k] = ( v <= 0.0f ) ? 0 : ( v >= 255.0f ) ? 255
+                                                         : (unsigned char)( v + 0.5f );
+        }
+    }
+
+    return 0;
+}
+
+
+/** @brief compute a tile of the level from the two tiles below it, which
+ *         are read or computed and stored first. The frame j of the tile
+ *         is the maximum of the frames 2j and 2j+1 below in each bin, which
+ *         is the maximum of their powers as the bytes are monotonic, so
+ *         that a short event stays visible at any zoom. The frames past
+ *         the last tile below are silent.
+ */
+static int pool_tiles(
+    SPECTROGRAM*   spectrogram,
+    SPG_WORK*      work,
+    int            level,
+    int64_t        index,
+    unsigned char* tile
+) {
+    unsigned char* below = (unsigned char*)malloc( SPG_TILE_BYTES );
+
+    if ( below == NULL ) {
+        return -1;
+    }
+
+    for ( int half = 0; half < 2; half++ ) {
+
+        unsigned char* rows       = &(tile[ half * ( SPG_TILE_BYTES / 2 ) ]);
+        int64_t        belowIndex = index * 2 + half;
+
+        if ( belowIndex >= spectrogram->levelTiles[ level - 1 ] ) {
+
+            memset( rows, 0, SPG_TILE_BYTES / 2 );
+            continue;
+        }
+
+        if ( get_tile( spectrogram, work, level - 1, belowIndex, below )
+             != 0 ) {
+
+            free( below );
+            return -1;
+        }
+
+        for ( int j = 0; j < SPG_TILE_FRAMES / 2; j++ ) {
+
+            const unsigned char* even = &(below[ ( 2 * j     ) * SPG_TILE_BINS ]);
+            const unsigned char* odd  = &(below[ ( 2 * j + 1 ) * SPG_TILE_BINS ]);
+            unsigned char*       row  = &(rows [ j * SPG_TILE_BINS ]);
+
+            for ( int k = 0; k < SPG_TILE_BINS; k++ ) {
+                row[k] = ( even[k] > odd[k] ) ? even[k] : odd[k];
+            }
+        }
+    }
+
+    free( below );
+
+    return 0;
+}
+
+
+/** @brief append the tile to the sidecar, and then record its offset, so
+ *         that a tile cut short is never referred to.
+ */
+static void store_tile(
+    SPECTROGRAM*         spectrogram,
+    int64_t              slot,
+    const unsigned char* tile
+) {
+    pthread_mutex_lock( &(spectrogram->lock) );
+
+    if ( spectrogram->cacheFd != -1 && spectrogram->tileOffsets[ slot ] == 0 ) {
+
+        int64_t offset = spectrogram->cacheEnd;
+
+        if (    write_fully( spectrogram->cacheFd, tile, SPG_TILE_BYTES, offset )
+                == 0
+             && write_fully( spectrogram->cacheFd,
+                             &offset,
+                             sizeof(offset),
+                             sizeof(struct SPG_SIDECAR) + sizeof(int64_t) * slot )
+                == 0                                                            ) {
+
+            spectrogram->tileOffsets[ slot ] = offset;
+            spectrogram->cacheEnd           += SPG_TILE_BYTES;
+        }
+    }
+
+    pthread_mutex_unlock( &(spectrogram->lock) );
+}
+
+
+static void* compute_tiles_job( void* p )
+{
+    SPG_TILE_JOB* job  = (SPG_TILE_JOB*)p;
+    SPECTROGRAM*  spg  = job->spectrogram;
+    SPG_WORK*     work = alloc_work( spg->numChannels );
+
+    if ( work == NULL ) {
+
+        job->rtnVal = -1;
+        return NULL;
+    }
+
+    for ( int64_t i = job->jobIndex; i < job->numIndices; i += job->numJobs ) {
+
+        int64_t index = job->indices[i];
+
+        if ( compute_tile( spg, work, job->level, index, work->tile ) != 0 ) {
+
+            job->rtnVal = -1;
+            break;
+        }
+
+        store_tile( spg, spg->levelFirst[ job->level ] + index, work->tile );
+    }
+
+    free_work( work );
+
+    return NULL;
+}
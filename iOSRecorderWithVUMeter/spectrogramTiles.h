@@ -0,0 +1,133 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Spectrogram of a wave file in tiles.
+ *
+ * A tile has SPG_TILE_FRAMES frames of SPG_TILE_BINS bins of 8-bit
+ * log-magnitude, frame after frame, from DC upwards. The channels are mixed
+ * to mono. Level 0 has a frame every SPG_HOP samples, and each of the
+ * following levels doubles the hop like mipmaps, until a level has only one
+ * tile. A frame of a level is the maximum of the two frames below it in
+ * each bin, so that every sample is covered at any zoom, and a tile is
+ * pooled from the two tiles below once they are cached.
+ *
+ * The tiles are computed lazily, in parallel, when they are first needed,
+ * and they are appended to a sidecar file next to the wave file, which is
+ * invalidated by the fingerprint of the wave file.
+ */
+
+#ifndef _SPECTROGRAM_TILES_H_
+#define _SPECTROGRAM_TILES_H_
+
+#include <stdint.h>
+
+#define SPG_TILE_FRAMES  256
+#define SPG_TILE_BINS    256
+#define SPG_TILE_BYTES   ( SPG_TILE_FRAMES * SPG_TILE_BINS )
+
+typedef struct spectrogram SPECTROGRAM;
+
+
+/** @brief open the spectrogram of the given wave file with its sidecar.
+ *         No tile is computed yet.
+ *
+ *  @param filename    (in):  wave file name
+ *
+ *  @return spectrogram to be released by freeSpectrogram(),
+ *          or NULL on failure.
+ */
+
+SPECTROGRAM* openSpectrogram( const char* filename );
+
+
+/** @brief the coarsest level that still has at least one frame per column
+ *         for the window.
+ *
+ *  @param numSamples  (in):  length of the window in samples of all the
+ *                            channels, as in computePlotsFromWavePeakPyramid()
+ *  @param width       (in):  width of the screen (axis of time)
+ */
+
+int spectrogramLevelFor(
+    const SPECTROGRAM* spectrogram,
+    int64_t            numSamples,
+    int                width        );
+
+
+/** @brief compute the missing tiles of the level that cover the window
+ *         [fromSample, toSample), in parallel.
+ *
+ *  @return 0:  Success
+ *          -1: Failure
+ */
+
+int prepareSpectrogramTiles(
+    SPECTROGRAM* spectrogram,
+    int          level,
+    int64_t      fromSample,
+    int64_t      toSample     );
+
+
+/** @brief get a tile, which is computed first if it is missing.
+ *
+ *  @param level       (in):  level of the tile
+ *  @param index       (in):  index of the tile in the level
+ *  @param tile        (out): SPG_TILE_BYTES bytes
+ *
+ *  @return 0:  Success
+ *          -1: Failure, e.g., out of range
+ */
+
+int readSpectrogramTile(
+    SPECTROGRAM*   spectrogram,
+    int            level,
+    int64_t        index,
+    unsigned char* tile         );
+
+
+/** @brief render the window [fromSample, toSample) into a gray image from
+ *         the tiles of the level chosen by spectrogramLevelFor().
+ *         Row 0 is the Nyquist frequency, and the last row is DC.
+ *
+ *  @param fromSample  (in):  first sample of the window
+ *  @param toSample    (in):  end of the window (exclusive)
+ *  @param width       (in):  width of the image (axis of time)
+ *  @param height      (in):  height of the image (axis of frequency)
+ *
+ *  @return width * height bytes row by row, or NULL on failure.
+ */
+
+unsigned char* computeSpectrogramImage(
+    SPECTROGRAM* spectrogram,
+    int64_t      fromSample,
+    int64_t      toSample,
+    int          width,
+    int          height       );
+
+
+/** @brief release the spectrogram */
+
+void freeSpectrogram( SPECTROGRAM* spectrogram );
+
+
+#endif /*_SPECTROGRAM_TILES_H_*/
@@ -0,0 +1,456 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "realFFT.h"
+#include "spectrumAnalyzer.h"
+
+#define SPA_BANDS_PER_OCTAVE       3
+#define SPA_FLOOR_RISE_DB_PER_SEC  3.0
+#define SPA_MIN_POWER              1.0e-10f
+#define SPA_FRESH                  4   /* flag on the middle buffer index */
+
+
+struct spectrum_analyzer {
+
+    int               fftSize;
+    int               halfSize;         /* hop */
+    int               numBins;
+    int               numBands;
+    int               numChannels;
+    int               sampleRate;
+    float             alpha;            /* weight of a new frame in the average */
+    float             floorRise;        /* per frame */
+
+    REAL_FFT*         fft;
+    int*              bandEdges;        /* [ numBands + 1 ] */
+
+    /* state of the feeding thread */
+    float*            frames;           /* [ numChannels * fftSize ] */
+    int               fill;             /* samples per channel in frames */
+    float*            work;             /* [ fftSize ] */
+    float*            framePower;       /* [ numBins ] */
+    float*            power;            /* [ numChannels * numBins ] */
+    float*            bandFloor;        /* [ numChannels * numBands ] */
+    int64_t           numFrames;
+
+    /* triple buffer of the snapshots */
+    SPECTRUM_SNAPSHOT buffers [ 3 ];
+    int               back;             /* owned by the feeding thread */
+    int               front;            /* owned by the reading thread */
+    atomic_int        middle;           /* index | SPA_FRESH */
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int  count_bands ( int num_bins, int* band_edges );
+
+static void analyze_frame ( SPECTRUM_ANALYZER* analyzer );
+
+static void publish ( SPECTRUM_ANALYZER* analyzer );
+
+static int  init_snapshot (
+                SPECTRUM_SNAPSHOT*       snapshot,
+                const SPECTRUM_ANALYZER* analyzer  );
+
+
+SPECTRUM_ANALYZER* createSpectrumAnalyzer(
+    int   fftSize,
+    int   sampleRate,
+    int   numChannels,
+    float averagingSeconds
+) {
+    if ( sampleRate <= 0 || numChannels <= 0 ) {
+
+        return NULL;
+    }
+
+    SPECTRUM_ANALYZER* analyzer =
+                   (SPECTRUM_ANALYZER*)calloc( 1, sizeof(SPECTRUM_ANALYZER) );
+
+    if ( analyzer == NULL ) {
+        return NULL;
+    }
+
+    analyzer->fft = createRealFFT( fftSize );
+
+    if ( analyzer->fft == NULL ) {
+
+        free( analyzer );
+        return NULL;
+    }
+
+    analyzer->fftSize     = fftSize;
+    analyzer->halfSize    = fftSize / 2;
+    analyzer->numBins     = fftSize / 2 + 1;
+    analyzer->numChannels = numChannels;
+    analyzer->sampleRate  = sampleRate;
+    analyzer->numBands    = count_bands( analyzer->numBins, NULL );
+
+    double hopSeconds = (double)analyzer->halfSize / sampleRate;
+
+    analyzer->alpha     = ( averagingSeconds > 0.0f )
+                          ? (float)( 1.0 - exp( -hopSeconds / averagingSeconds ) )
+                          : 1.0f;
+
+    analyzer->floorRise = (float)pow( 10.0, SPA_FLOOR_RISE_DB_PER_SEC
+                                            * hopSeconds / 10.0           );
+
+    analyzer->bandEdges  = (int*)  malloc( sizeof(int)
+                                           * ( analyzer->numBands + 1 ) );
+    analyzer->frames     = (float*)malloc( sizeof(float) * fftSize
+                                                         * numChannels   );
+    analyzer->work       = (float*)malloc( sizeof(float) * fftSize );
+    analyzer->framePower = (float*)malloc( sizeof(float) * analyzer->numBins );
+    analyzer->power      = (float*)malloc( sizeof(float) * numChannels
+                                                         * analyzer->numBins );
+    analyzer->bandFloor  = (float*)malloc( sizeof(float) * numChannels
+                                                         * analyzer->numBands );
+
+    if (    analyzer->bandEdges  == NULL || analyzer->frames     == NULL
+         || analyzer->work       == NULL || analyzer->framePower == NULL
+         || analyzer->power      == NULL || analyzer->bandFloor  == NULL ) {
+
+        freeSpectrumAnalyzer( analyzer );
+        return NULL;
+    }
+
+    count_bands( analyzer->numBins, analyzer->bandEdges );
+
+    for ( int i = 0; i < 3; i++ ) {
+
+        if ( init_snapshot( &(analyzer->buffers[i]), analyzer ) != 0 ) {
+
+            freeSpectrumAnalyzer( analyzer );
+            return NULL;
+        }
+    }
+
+    analyzer->front = 0;
+    atomic_init( &(analyzer->middle), 1 );
+    analyzer->back  = 2;
+
+    resetSpectrumAnalyzer( analyzer );
+
+    return analyzer;
+}
+
+
+void resetSpectrumAnalyzer( SPECTRUM_ANALYZER* analyzer )
+{
+    analyzer->fill      = 0;
+    analyzer->numFrames = 0;
+}
+
+
+void feedSpectrumAnalyzer(
+    SPECTRUM_ANALYZER* analyzer,
+    const short*       samples,
+    int                numSamples
+) {
+    int N           = analyzer->fftSize;
+    int numChannels = analyzer->numChannels;
+    int numIn       = numSamples / numChannels;
+
+    for ( int i = 0; i < numIn; ) {
+
+        int n = N - analyzer->fill;
+
+        n = ( n < numIn - i ) ? n : numIn - i;
+
+        if ( numChannels == 1 ) {
+
+            float*       dst = &(analyzer->frames[ analyzer->fill ]);
+            const short* src = &(samples[ i ]);
+
+            for ( int j = 0; j < n; j++ ) {
+                dst[j] = (float)src[j];
+            }
+        }
+        else {
+
+            for ( int c = 0; c < numChannels; c++ ) {
+
+                float*       dst = &(analyzer->frames[ c * N + analyzer->fill ]);
+                const short* src = &(samples[ i * numChannels + c ]);
+
+                for ( int j = 0; j < n; j++ ) {
+                    dst[j] = (float)src[ j * numChannels ];
+                }
+            }
+        }
+
+        analyzer->fill += n;
+        i              += n;
+
+        if ( analyzer->fill == N ) {
+
+            analyze_frame( analyzer );
+
+            /* 50% overlap */
+            for ( int c = 0; c < numChannels; c++ ) {
+
+                memmove( &(analyzer->frames[ c * N ]),
+                         &(analyzer->frames[ c * N + analyzer->halfSize ]),
+                         sizeof(float) * analyzer->halfSize                );
+            }
+
+            analyzer->fill = analyzer->halfSize;
+        }
+    }
+}
+
+
+SPECTRUM_SNAPSHOT* allocSpectrumSnapshot( const SPECTRUM_ANALYZER* analyzer )
+{
+    SPECTRUM_SNAPSHOT* snapshot =
+                   (SPECTRUM_SNAPSHOT*)calloc( 1, sizeof(SPECTRUM_SNAPSHOT) );
+
+    if ( snapshot == NULL ) {
+        return NULL;
+    }
+
+    if ( init_snapshot( snapshot, analyzer ) != 0 ) {
+
+        freeSpectrumSnapshot( snapshot );
+        return NULL;
+    }
+
+    return snapshot;
+}
+
+
+int readSpectrumSnapshot(
+    SPECTRUM_ANALYZER* analyzer,
+    SPECTRUM_SNAPSHOT* snapshot
+) {
+    if ( ( atomic_load_explicit( &(analyzer->middle), memory_order_relaxed )
+           & SPA_FRESH ) == 0 ) {
+
+        return 0;
+    }
+
+    analyzer->front = atomic_exchange_explicit( &(analyzer->middle),
+                                                analyzer->front,
+                                                memory_order_acq_rel  ) & 3;
+
+    const SPECTRUM_SNAPSHOT* src = &(analyzer->buffers[ analyzer->front ]);
+
+    snapshot->numFrames = src->numFrames;
+
+    memcpy( snapshot->averageDB,   src->averageDB,
+            sizeof(float) * src->numChannels * src->numBins  );
+
+    memcpy( snapshot->bandFloorDB, src->bandFloorDB,
+            sizeof(float) * src->numChannels * src->numBands );
+
+    return 1;
+}
+
+
+void freeSpectrumSnapshot( SPECTRUM_SNAPSHOT* snapshot )
+{
+    if ( snapshot == NULL ) {
+        return;
+    }
+
+    free( snapshot->averageDB );
+    free( snapshot->bandFloorDB );
+    free( snapshot );
+}
+
+
+void freeSpectrumAnalyzer( SPECTRUM_ANALYZER* analyzer )
+{
+    if ( analyzer == NULL ) {
+        return;
+    }
+
+    for ( int i = 0; i < 3; i++ ) {
+
+        free( analyzer->buffers[i].averageDB );
+        free( analyzer->buffers[i].bandFloorDB );
+    }
+
+    freeRealFFT( analyzer->fft );
+    free( analyzer->bandEdges );
+    free( analyzer->frames );
+    free( analyzer->work );
+    free( analyzer->framePower );
+    free( analyzer->power );
+    free( analyzer->bandFloor );
+    free( analyzer );
+}
+
+
+/** @brief bands of 1/SPA_BANDS_PER_OCTAVE octave, at least one bin wide,
+ *         from bin 1 to the Nyquist bin.
+ *
+ *  @return number of the bands
+ */
+static int count_bands( int numBins, int* bandEdges )
+{
+    double ratio    = pow( 2.0, 1.0 / SPA_BANDS_PER_OCTAVE );
+    int    numBands = 0;
+    int    lo       = 1;
+
+    while ( lo < numBins ) {
+
+        int hi = (int)ceil( lo * ratio );
+
+        hi = ( hi > lo + 1 ) ? hi : lo + 1;
+        hi = ( hi < numBins ) ? hi : numBins;
+
+        if ( bandEdges != NULL ) {
+            bandEdges[ numBands ] = lo;
+        }
+
+        numBands++;
+        lo = hi;
+    }
+
+    if ( bandEdges != NULL ) {
+        bandEdges[ numBands ] = numBins;
+    }
+
+    return numBands;
+}
+
+
+static void analyze_frame( SPECTRUM_ANALYZER* analyzer )
+{
+    int    N       = analyzer->fftSize;
+    int    numBins = analyzer->numBins;
+    float* p       = analyzer->framePower;
+    int    first   = ( analyzer->numFrames == 0 );
+    float  a       = analyzer->alpha;
+
+    for ( int c = 0; c < analyzer->numChannels; c++ ) {
+
+        float* power  = &(analyzer->power[ c * numBins ]);
+        float* floors = &(analyzer->bandFloor[ c * analyzer->numBands ]);
+
+        powerSpectrumOfFrame( analyzer->fft,
+                              &(analyzer->frames[ c * N ]),
+                              analyzer->work,
+                              p                             );
+
+        /* The first frame replaces whatever the average held, which is
+           not initialized, or is of the last session. */
+        for ( int k = 0; k < numBins; k++ ) {
+            power[k] = first ? p[k] : power[k] + a * ( p[k] - power[k] );
+        }
+
+        for ( int b = 0; b < analyzer->numBands; b++ ) {
+
+            int   lo  = analyzer->bandEdges[ b ];
+            int   hi  = analyzer->bandEdges[ b + 1 ];
+            float sum = 0.0f;
+
+            for ( int k = lo; k < hi; k++ ) {
+                sum += power[k];
+            }
+
+            float bandPower = sum / ( hi - lo );
+            float risen     = floors[b] * analyzer->floorRise;
+
+            floors[b] = ( first || bandPower < risen ) ? bandPower : risen;
+        }
+    }
+
+    analyzer->numFrames++;
+
+    publish( analyzer );
+}
+
+
+/** @brief fill the back buffer, and swap it with the middle one. */
+static void publish( SPECTRUM_ANALYZER* analyzer )
+{
+    SPECTRUM_SNAPSHOT* dst = &(analyzer->buffers[ analyzer->back ]);
+    int                nb  = analyzer->numChannels * analyzer->numBins;
+    int                nf  = analyzer->numChannels * analyzer->numBands;
+
+    dst->numFrames = analyzer->numFrames;
+
+    for ( int i = 0; i < nb; i++ ) {
+
+        float p = analyzer->power[i];
+
+        dst->averageDB[i] = 10.0f * log10f( ( p > SPA_MIN_POWER ) ? p
+                                                                  : SPA_MIN_POWER );
+    }
+
+    for ( int i = 0; i < nf; i++ ) {
+
+        float p = analyzer->bandFloor[i];
+
+        dst->bandFloorDB[i] = 10.0f * log10f( ( p > SPA_MIN_POWER ) ? p
+                                                                    : SPA_MIN_POWER );
+    }
+
+    analyzer->back = atomic_exchange_explicit( &(analyzer->middle),
+                                               analyzer->back | SPA_FRESH,
+                                               memory_order_acq_rel        ) & 3;
+}
+
+
+static int init_snapshot(
+    SPECTRUM_SNAPSHOT*       snapshot,
+    const SPECTRUM_ANALYZER* analyzer
+) {
+    snapshot->numFrames   = 0;
+    snapshot->numChannels = analyzer->numChannels;
+    snapshot->numBins     = analyzer->numBins;
+    snapshot->numBands    = analyzer->numBands;
+    snapshot->binHz       = (float)analyzer->sampleRate / analyzer->fftSize;
+    snapshot->bandEdges   = analyzer->bandEdges;
+    snapshot->averageDB   = (float*)malloc( sizeof(float)
+                                            * analyzer->numChannels
+                                            * analyzer->numBins     );
+    snapshot->bandFloorDB = (float*)malloc( sizeof(float)
+                                            * analyzer->numChannels
+                                            * analyzer->numBands    );
+
+    if ( snapshot->averageDB == NULL || snapshot->bandFloorDB == NULL ) {
+        return -1;
+    }
+
+    for ( int i = 0; i < analyzer->numChannels * analyzer->numBins; i++ ) {
+        snapshot->averageDB[i] = 10.0f * log10f( SPA_MIN_POWER );
+    }
+
+    for ( int i = 0; i < analyzer->numChannels * analyzer->numBands; i++ ) {
+        snapshot->bandFloorDB[i] = 10.0f * log10f( SPA_MIN_POWER );
+    }
+
+    return 0;
+}
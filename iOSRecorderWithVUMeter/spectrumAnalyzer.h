@@ -0,0 +1,129 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Streaming spectral analysis of 16-bit interleaved samples.
+ *
+ * Each channel is cut into frames of fftSize samples at 50% overlap, and
+ * the power spectrum of a frame is computed by realFFT.h, on which white
+ * noise of variance s^2 reads 10*log10(s^2) [dB] in every bin.
+ *
+ * The noise floor of a band (1/3 octave or one bin, whichever is wider) is
+ * the minimum of the averaged power of the band, which is allowed to rise
+ * by SPA_FLOOR_RISE_DB_PER_SEC at most.
+ *
+ * One thread feeds the analyzer, and one other thread can take snapshots
+ * at any time without locks, through a triple buffer.
+ */
+
+#ifndef _SPECTRUM_ANALYZER_H_
+#define _SPECTRUM_ANALYZER_H_
+
+#include <stdint.h>
+
+typedef struct spectrum_analyzer SPECTRUM_ANALYZER;
+
+
+/** @brief averaged spectra and band noise floors of all the channels */
+typedef struct spectrum_snapshot {
+
+    int64_t    numFrames;     /* frames analyzed per channel */
+    int        numChannels;
+    int        numBins;       /* fftSize / 2 + 1 */
+    int        numBands;
+    float      binHz;         /* sampleRate / fftSize */
+    float*     averageDB;     /* [ numChannels * numBins ]  */
+    float*     bandFloorDB;   /* [ numChannels * numBands ] */
+    const int* bandEdges;     /* band i: bins [ bandEdges[i], bandEdges[i+1] ) */
+
+} SPECTRUM_SNAPSHOT;
+
+
+/** @brief create an analyzer.
+ *
+ *  @param fftSize          (in): frame length, a power of 2 in [64, 16384]
+ *  @param sampleRate       (in): sample rate in [Hz]
+ *  @param numChannels      (in): number of the interleaved channels
+ *  @param averagingSeconds (in): time constant of the averaged spectra
+ *
+ *  @return analyzer, or NULL on failure.
+ */
+
+SPECTRUM_ANALYZER* createSpectrumAnalyzer(
+    int   fftSize,
+    int   sampleRate,
+    int   numChannels,
+    float averagingSeconds );
+
+
+/** @brief forget the samples and the averages, to start a new session.
+ *         Called from the feeding thread.
+ */
+
+void resetSpectrumAnalyzer( SPECTRUM_ANALYZER* analyzer );
+
+
+/** @brief analyze the interleaved samples. A partial frame is kept for the
+ *         next call. A snapshot is published after every frame.
+ *
+ *  @param samples    (in): interleaved samples
+ *  @param numSamples (in): number of the samples over all the channels
+ */
+
+void feedSpectrumAnalyzer(
+    SPECTRUM_ANALYZER* analyzer,
+    const short*       samples,
+    int                numSamples );
+
+
+/** @brief allocate a snapshot sized for the analyzer.
+ *
+ *  @return snapshot to be released by freeSpectrumSnapshot(),
+ *          or NULL on failure.
+ */
+
+SPECTRUM_SNAPSHOT* allocSpectrumSnapshot( const SPECTRUM_ANALYZER* analyzer );
+
+
+/** @brief copy the latest published spectra into the snapshot without
+ *         blocking the feeding thread. Only one thread may read snapshots.
+ *
+ *  @return 1: the snapshot was updated
+ *          0: nothing new has been published since the last read
+ */
+
+int readSpectrumSnapshot(
+    SPECTRUM_ANALYZER* analyzer,
+    SPECTRUM_SNAPSHOT* snapshot  );
+
+
+/** @brief release the snapshot */
+
+void freeSpectrumSnapshot( SPECTRUM_SNAPSHOT* snapshot );
+
+
+/** @brief release the analyzer */
+
+void freeSpectrumAnalyzer( SPECTRUM_ANALYZER* analyzer );
+
+
+#endif /*_SPECTRUM_ANALYZER_H_*/
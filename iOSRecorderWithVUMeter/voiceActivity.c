@@ -0,0 +1,298 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "estimateSNR.h"
+#include "voiceActivity.h"
+
+#define VAD_FRAME_MS          20
+#define VAD_HISTORY_SECONDS   10
+#define VAD_REFIT_FRAMES      50      /* 0.5 sec */
+#define VAD_ONSET_FRAMES      3
+#define VAD_HANGOVER_MS       300
+#define VAD_MIN_MARGIN_DB     6.0f
+#define VAD_MARGIN_RATIO      0.25f
+#define VAD_HYSTERESIS_DB     3.0f
+#define VAD_DC_SECONDS        1.0     /* time constant of the DC bias */
+
+
+struct voice_activity {
+
+    int                numChannels;
+    int                frameWidth;      /* samples of all the channels */
+    int                frameAdv;        /* samples of all the channels */
+    int                hangoverFrames;
+    float              dcAlpha;         /* per frame advance */
+    VAD_CALLBACK       callback;
+    void*              user;
+    SNR_LEVEL_TRACKER* tracker;
+
+    short*             frame;           /* [ frameWidth ] */
+    int                fill;
+    int64_t            numFrames;       /* frames processed */
+    float              dcBias;
+
+    int                hasThresholds;
+    float              onLevel;
+    float              offLevel;
+
+    int                speech;
+    int                numAbove;        /* consecutive frames above on  */
+    int                numBelow;        /* consecutive frames below off */
+    int64_t            onsetFrame;
+    int64_t            lastSpeechFrame;
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static void process_frame ( VOICE_ACTIVITY* vad );
+
+static void update_thresholds ( VOICE_ACTIVITY* vad );
+
+
+VOICE_ACTIVITY* createVoiceActivity(
+    int          sampleRate,
+    int          numChannels,
+    VAD_CALLBACK callback,
+    void*        user
+) {
+    if ( sampleRate <= 0 || numChannels <= 0 || callback == NULL ) {
+        return NULL;
+    }
+
+    VOICE_ACTIVITY* vad = (VOICE_ACTIVITY*)calloc( 1, sizeof(VOICE_ACTIVITY) );
+
+    if ( vad == NULL ) {
+        return NULL;
+    }
+
+    int frameAdv = sampleRate * VAD_FRAME_MS / 2000;
+
+    frameAdv = ( frameAdv > 0 ) ? frameAdv : 1;
+
+    vad->numChannels    = numChannels;
+    vad->frameAdv       = frameAdv * numChannels;
+    vad->frameWidth     = frameAdv * numChannels * 2;
+    vad->hangoverFrames = VAD_HANGOVER_MS * 2 / VAD_FRAME_MS;
+    vad->dcAlpha        = (float)( 1.0 - exp( -(double)frameAdv / sampleRate
+                                              / VAD_DC_SECONDS              ) );
+    vad->callback       = callback;
+    vad->user           = user;
+    vad->frame          = (short*)malloc( sizeof(short) * vad->frameWidth );
+    vad->tracker        = createSNRLevelTracker( VAD_HISTORY_SECONDS * 2000
+                                                 / VAD_FRAME_MS            );
+
+    if ( vad->frame == NULL || vad->tracker == NULL ) {
+
+        freeVoiceActivity( vad );
+        return NULL;
+    }
+
+    resetVoiceActivity( vad );
+
+    return vad;
+}
+
+
+void resetVoiceActivity( VOICE_ACTIVITY* vad )
+{
+    resetSNRLevelTracker( vad->tracker );
+
+    vad->fill            = 0;
+    vad->numFrames       = 0;
+    vad->dcBias          = 0.0f;
+    vad->hasThresholds   = 0;
+    vad->speech          = 0;
+    vad->numAbove        = 0;
+    vad->numBelow        = 0;
+    vad->onsetFrame      = 0;
+    vad->lastSpeechFrame = 0;
+}
+
+
+void feedVoiceActivity(
+    VOICE_ACTIVITY* vad,
+    const short*    samples,
+    int             numSamples
+) {
+    for ( int i = 0; i < numSamples; ) {
+
+        int n = vad->frameWidth - vad->fill;
+
+        n = ( n < numSamples - i ) ? n : numSamples - i;
+
+        memcpy( &(vad->frame[ vad->fill ]), &(samples[i]), sizeof(short) * n );
+
+        vad->fill += n;
+        i         += n;
+
+        if ( vad->fill == vad->frameWidth ) {
+
+            process_frame( vad );
+
+            /* 50% overlap */
+            memmove( vad->frame,
+                     &(vad->frame[ vad->frameAdv ]),
+                     sizeof(short) * ( vad->frameWidth - vad->frameAdv ) );
+
+            vad->fill = vad->frameWidth - vad->frameAdv;
+        }
+    }
+}
+
+
+void flushVoiceActivity( VOICE_ACTIVITY* vad )
+{
+    if ( vad->speech ) {
+
+        int64_t end = vad->lastSpeechFrame * vad->frameAdv + vad->frameWidth;
+
+        vad->speech = 0;
+        vad->callback( 0, end / vad->numChannels, vad->user );
+    }
+}
+
+
+int isVoiceActive( const VOICE_ACTIVITY* vad )
+{
+    return vad->speech;
+}
+
+
+void freeVoiceActivity( VOICE_ACTIVITY* vad )
+{
+    if ( vad == NULL ) {
+        return;
+    }
+
+    freeSNRLevelTracker( vad->tracker );
+    free( vad->frame );
+    free( vad );
+}
+
+
+/** @brief classify the frame in vad->frame, which starts at the sample
+ *         numFrames * frameAdv of all the channels.
+ */
+static void process_frame( VOICE_ACTIVITY* vad )
+{
+    /* DC bias from the samples entering with this frame. */
+    const short* entering = ( vad->numFrames == 0 )
+                            ? vad->frame
+                            : &(vad->frame[ vad->frameWidth - vad->frameAdv ]);
+    int          numEntering = ( vad->numFrames == 0 ) ? vad->frameWidth
+                                                       : vad->frameAdv;
+    int64_t      sum         = 0;
+
+    for ( int i = 0; i < numEntering; i++ ) {
+        sum += entering[i];
+    }
+
+    float mean = (float)sum / numEntering;
+
+    vad->dcBias = ( vad->numFrames == 0 ) ? mean
+                  : vad->dcBias + vad->dcAlpha * ( mean - vad->dcBias );
+
+    float   pwr   = framePowerDB( vad->frame, vad->frameWidth, vad->dcBias );
+    int64_t index = vad->numFrames;
+
+    trackSNRFramePower( vad->tracker, pwr );
+
+    vad->numFrames++;
+
+    if ( vad->numFrames % VAD_REFIT_FRAMES == 0 ) {
+        update_thresholds( vad );
+    }
+
+    if ( !vad->hasThresholds ) {
+        return;
+    }
+
+    if ( !vad->speech ) {
+
+        if ( pwr >= vad->onLevel ) {
+
+            if ( vad->numAbove == 0 ) {
+                vad->onsetFrame = index;
+            }
+
+            vad->numAbove++;
+
+            if ( vad->numAbove >= VAD_ONSET_FRAMES ) {
+
+                vad->speech          = 1;
+                vad->numBelow        = 0;
+                vad->lastSpeechFrame = index;
+                int64_t start = vad->onsetFrame * vad->frameAdv;
+
+                vad->callback( 1, start / vad->numChannels, vad->user );
+            }
+        }
+        else {
+            vad->numAbove = 0;
+        }
+    }
+    else {
+
+        if ( pwr >= vad->offLevel ) {
+
+            vad->numBelow        = 0;
+            vad->lastSpeechFrame = index;
+        }
+        else if ( ++(vad->numBelow) >= vad->hangoverFrames ) {
+
+            int64_t end = vad->lastSpeechFrame * vad->frameAdv
+                          + vad->frameWidth;
+
+            vad->speech   = 0;
+            vad->numAbove = 0;
+            vad->callback( 0, end / vad->numChannels, vad->user );
+        }
+    }
+}
+
+
+static void update_thresholds( VOICE_ACTIVITY* vad )
+{
+    float noiseLevel;
+    float speechLevel;
+
+    if ( estimateTrackedSNR( vad->tracker, &noiseLevel, &speechLevel ) != 0 ) {
+        return;
+    }
+
+    float margin = VAD_MARGIN_RATIO * ( speechLevel - noiseLevel );
+
+    margin = ( margin > VAD_MIN_MARGIN_DB ) ? margin : VAD_MIN_MARGIN_DB;
+
+    vad->onLevel       = noiseLevel + margin;
+    vad->offLevel      = vad->onLevel - VAD_HYSTERESIS_DB;
+    vad->hasThresholds = 1;
+}
@@ -0,0 +1,110 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Streaming voice activity detection.
+ *
+ * The samples are cut into frames of 20ms at every 10ms, and the power of
+ * a frame is taken by framePowerDB() as in estimateSNR(). The noise and
+ * the speech levels are re-estimated every VAD_REFIT_FRAMES frames from
+ * the histogram of the last VAD_HISTORY_SECONDS by the level tracker of
+ * estimateSNR.h, and a frame is speech if it is well above the noise:
+ *
+ *   on  = noise + max( VAD_MIN_MARGIN_DB,
+ *                      VAD_MARGIN_RATIO * ( speech - noise ) )
+ *   off = on - VAD_HYSTERESIS_DB
+ *
+ * Speech starts at the first of VAD_ONSET_FRAMES consecutive frames above
+ * on, and ends at the end of the last frame above off once the frames have
+ * stayed below off for VAD_HANGOVER_MS.
+ */
+
+#ifndef _VOICE_ACTIVITY_H_
+#define _VOICE_ACTIVITY_H_
+
+#include <stdint.h>
+
+typedef struct voice_activity VOICE_ACTIVITY;
+
+
+/** @brief called when speech starts or ends.
+ *
+ *  @param speech       (in): 1 at the start and 0 at the end of speech
+ *  @param sampleOffset (in): offset in samples per channel since the start
+ *                            or the reset. The end is exclusive.
+ *  @param user         (in): user data given to createVoiceActivity()
+ */
+typedef void (*VAD_CALLBACK)( int speech, int64_t sampleOffset, void* user );
+
+
+/** @brief create a detector.
+ *
+ *  @param sampleRate  (in): sample rate in [Hz]
+ *  @param numChannels (in): number of the interleaved channels
+ *  @param callback    (in): called from feedVoiceActivity() and
+ *                           flushVoiceActivity()
+ *  @param user        (in): passed to the callback
+ *
+ *  @return detector, or NULL on failure.
+ */
+
+VOICE_ACTIVITY* createVoiceActivity(
+    int          sampleRate,
+    int          numChannels,
+    VAD_CALLBACK callback,
+    void*        user         );
+
+
+/** @brief forget the samples and the levels, to start a new stream. */
+
+void resetVoiceActivity( VOICE_ACTIVITY* vad );
+
+
+/** @brief process the interleaved samples. A partial frame is kept for
+ *         the next call.
+ *
+ *  @param samples    (in): interleaved samples
+ *  @param numSamples (in): number of the samples over all the channels
+ */
+
+void feedVoiceActivity(
+    VOICE_ACTIVITY* vad,
+    const short*    samples,
+    int             numSamples );
+
+
+/** @brief end the speech in progress, if any, at the end of the stream. */
+
+void flushVoiceActivity( VOICE_ACTIVITY* vad );
+
+
+/** @brief 1 while in speech, 0 otherwise */
+
+int isVoiceActive( const VOICE_ACTIVITY* vad );
+
+
+/** @brief release the detector */
+
+void freeVoiceActivity( VOICE_ACTIVITY* vad );
+
+
+#endif /*_VOICE_ACTIVITY_H_*/
@@ -0,0 +1,286 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "waveFile.h"
+
+#define WF_UNKNOWN_SIZE         0xFFFFFFFF
+#define WF_FORMAT_PCM           0x0001
+#define WF_FORMAT_EXTENSIBLE    0xFFFE
+#define WF_FMT_SIZE             16
+#define WF_FMT_EXTENSIBLE_SIZE  40      /* incl. cbSize and the subformat */
+#define WF_FINGERPRINT_BLOCK    4096
+#define WF_FINGERPRINT_SAMPLES  8
+#define WF_FNV_OFFSET_BASIS     0xcbf29ce484222325ULL
+#define WF_FNV_PRIME            0x100000001b3ULL
+
+#if defined(__APPLE__)
+#define WF_MTIME_NSEC( st )     ( (st).st_mtimespec.tv_nsec )
+#else
+#define WF_MTIME_NSEC( st )     ( (st).st_mtim.tv_nsec )
+#endif
+
+/** @brief header of a chunk */
+struct WF_CHUNK {
+
+    unsigned char id [ 4 ];
+    unsigned char size [ 4 ];
+
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      read_exact ( FILE* fp, void* b, size_t len );
+
+static uint16_t le16 ( const unsigned char* b );
+
+static uint32_t le32 ( const unsigned char* b );
+
+static uint64_t le64 ( const unsigned char* b );
+
+static uint64_t fnv1a ( uint64_t hash, const unsigned char* b, size_t len );
+
+static int      is_pcm ( const unsigned char* fmt, uint64_t fmt_size );
+
+
+static int read_exact( FILE* fp, void* b, size_t len )
+{
+    return ( fread( b, 1, len, fp ) == len ) ? 0 : -1;
+}
+
+
+/* The format code is in the first two bytes of the subformat GUID of
+ * WAVE_FORMAT_EXTENSIBLE. */
+static int is_pcm( const unsigned char* fmt, uint64_t fmtSize )
+{
+    uint16_t format = le16( &(fmt[0]) );
+
+    if ( format == WF_FORMAT_EXTENSIBLE && fmtSize >= WF_FMT_EXTENSIBLE_SIZE ) {
+
+        format = le16( &(fmt[24]) );
+    }
+
+    return format == WF_FORMAT_PCM;
+}
+
+
+static uint16_t le16( const unsigned char* b )
+{
+    return (uint16_t)( b[0] | ( b[1] << 8 ) );
+}
+
+
+static uint32_t le32( const unsigned char* b )
+{
+    return   (uint32_t)b[0]
+           | ( (uint32_t)b[1] <<  8 )
+           | ( (uint32_t)b[2] << 16 )
+           | ( (uint32_t)b[3] << 24 );
+}
+
+
+static uint64_t le64( const unsigned char* b )
+{
+    return (uint64_t)le32( b ) | ( (uint64_t)le32( &(b[4]) ) << 32 );
+}
+
+
+static uint64_t fnv1a( uint64_t hash, const unsigned char* b, size_t len )
+{
+    for ( size_t i = 0; i < len; i++ ) {
+
+        hash ^= b[i];
+        hash *= WF_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+
+int computeWaveFingerprint( FILE* fp, WAVE_FINGERPRINT* fingerprint )
+{
+    unsigned char block [ WF_FINGERPRINT_BLOCK ];
+    struct stat   st;
+    int           fd = fileno( fp );
+
+    if ( fstat( fd, &st ) != 0 ) {
+        return -1;
+    }
+
+    fingerprint->size  = (uint64_t)st.st_size;
+    fingerprint->mtime = (int64_t) st.st_mtime * 1000000000
+                         + (int64_t) WF_MTIME_NSEC( st );
+    fingerprint->hash  = WF_FNV_OFFSET_BASIS;
+
+    int64_t span = (int64_t)st.st_size - WF_FINGERPRINT_BLOCK;
+
+    for ( int i = 0; i <= WF_FINGERPRINT_SAMPLES; i++ ) {
+
+        /* pread() leaves the position of fp as it is. */
+        off_t   offset = ( span > 0 ) ? (off_t)( span * i
+                                                 / WF_FINGERPRINT_SAMPLES )
+                                      : 0;
+        ssize_t len    = pread( fd, block, sizeof(block), offset );
+
+        if ( len < 0 ) {
+            return -1;
+        }
+
+        fingerprint->hash = fnv1a( fingerprint->hash, block, (size_t)len );
+
+        if ( span <= 0 ) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+int equalWaveFingerprints(
+    const WAVE_FINGERPRINT* f1,
+    const WAVE_FINGERPRINT* f2
+) {
+    return    f1->size  == f2->size
+           && f1->mtime == f2->mtime
+           && f1->hash  == f2->hash;
+}
+
+
+int readWaveFileInfo( FILE* fp, WAVE_FILE_INFO* info )
+{
+    unsigned char riff [ 12 ];
+    int           isRF64     = 0;
+    int           hasDs64    = 0;
+    int           isPCM      = 0;
+    uint64_t      ds64Data   = 0;
+
+    memset( info, 0, sizeof(WAVE_FILE_INFO) );
+
+    if ( read_exact( fp, riff, sizeof(riff) ) != 0 ) {
+        return -1;
+    }
+
+    if ( memcmp( riff, "RF64", 4 ) == 0 ) {
+
+        isRF64 = 1;
+    }
+    else if ( memcmp( riff, "RIFF", 4 ) != 0 ) {
+
+        return -1;
+    }
+
+    if ( memcmp( &(riff[8]), "WAVE", 4 ) != 0 ) {
+        return -1;
+    }
+
+    while ( 1 ) {
+
+        struct WF_CHUNK chunk;
+
+        if ( read_exact( fp, &chunk, sizeof(chunk) ) != 0 ) {
+            /* no data chunk */
+            return -1;
+        }
+
+        uint64_t size = le32( chunk.size );
+
+        if ( memcmp( chunk.id, "ds64", 4 ) == 0 && size >= 24 ) {
+
+            unsigned char ds64 [ 24 ];
+
+            if ( read_exact( fp, ds64, sizeof(ds64) ) != 0 ) {
+                return -1;
+            }
+
+            hasDs64  = 1;
+            ds64Data = le64( &(ds64[8]) );
+            size    -= sizeof(ds64);
+        }
+        else if ( memcmp( chunk.id, "fmt ", 4 ) == 0 && size >= WF_FMT_SIZE ) {
+
+            unsigned char fmt [ WF_FMT_EXTENSIBLE_SIZE ];
+            uint64_t      fmtSize = ( size < sizeof(fmt) ) ? size : sizeof(fmt);
+
+            if ( read_exact( fp, fmt, (size_t)fmtSize ) != 0 ) {
+                return -1;
+            }
+
+            isPCM               = is_pcm( fmt, fmtSize );
+            info->numChannels   = le16( &(fmt[2])  );
+            info->sampleRate    = le32( &(fmt[4])  );
+            info->bitsPerSample = le16( &(fmt[14]) );
+            size               -= fmtSize;
+        }
+        else if ( memcmp( chunk.id, "data", 4 ) == 0 ) {
+
+            /* Only 16-bit PCM is read by the analyses. */
+            if (    !isPCM
+                 || info->bitsPerSample != 16
+                 || info->numChannels   <= 0
+                 || info->sampleRate    <= 0  ) {
+                return -1;
+            }
+
+            info->dataOffset = (int64_t)ftello( fp );
+
+            if ( info->dataOffset < 0 ) {
+                return -1;
+            }
+
+            if ( size == WF_UNKNOWN_SIZE && isRF64 && hasDs64 ) {
+
+                size = ds64Data;
+            }
+            else if ( size == WF_UNKNOWN_SIZE ) {
+
+                struct stat st;
+
+                if ( fstat( fileno(fp), &st ) != 0 ) {
+                    return -1;
+                }
+
+                size = ( (int64_t)st.st_size > info->dataOffset )
+                       ? (uint64_t)( st.st_size - info->dataOffset ) : 0;
+            }
+
+            info->dataSize     = (int64_t)size;
+            info->totalSamples = (int64_t)( size / 2 );
+
+            return 0;
+        }
+
+        /* Skip the rest of the chunk, which is padded to an even size. */
+        if ( fseeko( fp, (off_t)( size + ( size & 1 ) ), SEEK_CUR ) != 0 ) {
+            return -1;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WAVE_FILE_H_
+#define _WAVE_FILE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/** @brief layout of the data chunk of a wave file */
+typedef struct wave_file_info {
+
+    int64_t dataOffset;    /* byte offset of the first sample     */
+    int64_t dataSize;      /* size of the data chunk in bytes     */
+    int64_t totalSamples;  /* dataSize / 2, i.e., 16-bit samples  */
+    int     numChannels;
+    int     sampleRate;
+    int     bitsPerSample;
+
+} WAVE_FILE_INFO;
+
+
+/** @brief identity of the contents of a wave file for the caches */
+typedef struct wave_fingerprint {
+
+    uint64_t size;         /* st_size  of the wave file */
+    int64_t  mtime;        /* st_mtime of the wave file in [ns] */
+    uint64_t hash;         /* of the header and the sampled blocks */
+
+} WAVE_FINGERPRINT;
+
+
+/** @brief parse the chunks of a RIFF or an RF64 (EBU Tech 3306) wave file
+ *         up to the data chunk. The sizes are taken from the ds64 chunk
+ *         for RF64, so that the data can exceed 4GB. A RIFF data chunk with
+ *         the size 0xFFFFFFFF is taken to extend to the end of the file.
+ *         Only 16-bit PCM is accepted, also as WAVE_FORMAT_EXTENSIBLE.
+ *         On success fp is positioned at the first sample.
+ *
+ *  @param fp          (in):  wave file opened for reading at its beginning
+ *  @param info        (out): layout of the data chunk
+ *
+ *  @return 0:  Success
+ *          -1: Failure mostlikely due to wrong input file, or a format
+ *              other than 16-bit PCM.
+ */
+
+int readWaveFileInfo( FILE* fp, WAVE_FILE_INFO* info );
+
+
+/** @brief take the fingerprint of the wave file. The hash covers the first
+ *         block, which contains the header, and a few blocks spread evenly
+ *         over the rest of the file, so that the cost does not depend on
+ *         the length of the file. The modification time is taken to the
+ *         nanosecond where the file system keeps it, so that a file
+ *         rewritten within the same second with the same size is told
+ *         apart. The position of fp is not changed.
+ *
+ *  @param fp          (in):  wave file opened for reading
+ *  @param fingerprint (out): fingerprint of the file
+ *
+ *  @return 0:  Success
+ *          -1: Failure
+ */
+
+int computeWaveFingerprint( FILE* fp, WAVE_FINGERPRINT* fingerprint );
+
+
+/** @brief check if the two fingerprints are of the same contents */
+
+int equalWaveFingerprints( const WAVE_FINGERPRINT* f1,
+                           const WAVE_FINGERPRINT* f2  );
+
+
+#endif /*_WAVE_FILE_H_*/
@@ -0,0 +1,735 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "wavePeakPyramid.h"
+#include "sampleMinMax.h"
+#include "sidecarFile.h"
+#include "waveFile.h"
+
+#define WPP_MAGIC              "WPKP"
+#define WPP_VERSION            2
+#define WPP_BLOCK_SIZE         512
+#define WPP_SIDECAR_EXTENSION  ".peaks"
+#define WPP_READ_BUF_SAMPLES   8192
+
+/** @brief header of the sidecar file followed by the levels */
+struct WPP_SIDECAR {
+
+    unsigned char    magic [ 4 ];
+    uint32_t         version;
+    WAVE_FINGERPRINT fingerprint;  /* of the wave file */
+    int64_t          totalSamples;
+    int32_t          peak;
+    int32_t          blockSize;
+
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int                read_bytes ( FILE *fp, char *b, int len );
+
+static WAVE_PEAK_PYRAMID* alloc_pyramid (
+                              const char* filename,
+                              int64_t     total_samples,
+                              int         block_size      );
+
+static int                build_pyramid ( WAVE_PEAK_PYRAMID* pyramid,
+                                          FILE*              fp       );
+
+static int                load_sidecar (
+                              WAVE_PEAK_PYRAMID* pyramid,
+                              const char*        path,
+                              WAVE_FINGERPRINT*  fingerprint );
+
+static int                save_sidecar (
+                              WAVE_PEAK_PYRAMID* pyramid,
+                              const char*        path,
+                              WAVE_FINGERPRINT*  fingerprint );
+
+static int64_t            storage_size ( WAVE_PEAK_PYRAMID* pyramid );
+
+static int                plot_from_samples (
+                              WAVE_PEAK_PYRAMID* pyramid,
+                              int64_t            from_sample,
+                              int64_t            to_sample,
+                              int                width,
+                              int*               plot_array );
+
+static void               plot_from_pyramid (
+                              WAVE_PEAK_PYRAMID* pyramid,
+                              int64_t            from_sample,
+                              int64_t            to_sample,
+                              int                width,
+                              int*               plot_array );
+
+
+static int read_bytes ( FILE *fp, char *b, int len )
+{
+    int totalRead = 0;
+
+    while ( totalRead < len ) {
+
+        int bytesRead = (int)fread ( &(b[totalRead]),
+                                     1,
+                                     (int)( len - totalRead ),
+                                     fp                        );
+        if ( bytesRead == 0 ) {
+
+            if ( ferror(fp) ) {
+                /* Error.*/
+                return -1;
+            }
+            /* EOF */
+            break;
+        }
+
+        totalRead += bytesRead;
+    }
+
+    return totalRead;
+}
+
+
+WAVE_PEAK_PYRAMID* openWavePeakPyramid( const char* filename )
+{
+    WAVE_FILE_INFO   info;
+    WAVE_FINGERPRINT fingerprint;
+    FILE*            fp;
+
+    fp = fopen( filename, "rb" );
+
+    if ( fp == NULL ) {
+        return NULL;
+    }
+
+    if ( computeWaveFingerprint( fp, &fingerprint ) != 0 ) {
+
+        fclose(fp);
+        return NULL;
+    }
+
+    if ( readWaveFileInfo( fp, &info ) != 0 ) {
+
+        fclose(fp);
+        return NULL;
+    }
+
+    WAVE_PEAK_PYRAMID* pyramid = alloc_pyramid( filename,
+                                                info.totalSamples,
+                                                WPP_BLOCK_SIZE     );
+    if ( pyramid == NULL ) {
+
+        fclose(fp);
+        return NULL;
+    }
+
+    pyramid->dataOffset  = info.dataOffset;
+    pyramid->sampleRate  = info.sampleRate;
+    pyramid->numChannels = ( info.numChannels > 0 ) ? info.numChannels : 1;
+
+    char* path = sidecarPathFor( filename, WPP_SIDECAR_EXTENSION );
+
+    if ( path != NULL && load_sidecar( pyramid, path, &fingerprint ) == 0 ) {
+
+        free(path);
+        fclose(fp);
+        return pyramid;
+    }
+
+    if ( build_pyramid( pyramid, fp ) != 0 ) {
+
+        free(path);
+        freeWavePeakPyramid( pyramid );
+        fclose(fp);
+        return NULL;
+    }
+
+    fclose(fp);
+
+    if ( path != NULL ) {
+
+        /* The sidecar is only a cache. Failing to save it is not fatal. */
+        save_sidecar( pyramid, path, &fingerprint );
+        free(path);
+    }
+
+    return pyramid;
+}
+
+
+static WAVE_PEAK_PYRAMID* alloc_pyramid(
+    const char* filename,
+    int64_t     totalSamples,
+    int         blockSize
+) {
+    WAVE_PEAK_PYRAMID* pyramid =
+                     (WAVE_PEAK_PYRAMID*)calloc( 1, sizeof(WAVE_PEAK_PYRAMID) );
+
+    if ( pyramid == NULL ) {
+        return NULL;
+    }
+
+    pyramid->totalSamples = totalSamples;
+    pyramid->peak         = 0;
+    pyramid->blockSize    = blockSize;
+
+    int64_t size = ( totalSamples + blockSize - 1 ) / blockSize;
+
+    pyramid->numLevels = 0;
+
+    for ( int64_t s = size; s > 0; s = ( s == 1 ) ? 0 : ( s + 1 ) / 2 ) {
+
+        pyramid->numLevels++;
+    }
+
+    pyramid->filename   = (char*)malloc( strlen(filename) + 1 );
+    pyramid->levelSizes = (int64_t*)   malloc( sizeof(int64_t)    * ( pyramid->numLevels + 1 ) );
+    pyramid->levels     = (WAVE_PEAK**)malloc( sizeof(WAVE_PEAK*) * ( pyramid->numLevels + 1 ) );
+
+    if (    pyramid->filename   == NULL
+         || pyramid->levelSizes == NULL
+         || pyramid->levels     == NULL ) {
+
+        freeWavePeakPyramid( pyramid );
+        return NULL;
+    }
+
+    strcpy( pyramid->filename, filename );
+
+    for ( int i = 0; i < pyramid->numLevels; i++ ) {
+
+        pyramid->levelSizes[i] = size;
+        size = ( size + 1 ) / 2;
+    }
+
+    pyramid->storage = malloc( storage_size( pyramid ) + 1 );
+
+    if ( pyramid->storage == NULL ) {
+
+        freeWavePeakPyramid( pyramid );
+        return NULL;
+    }
+
+    WAVE_PEAK* p = (WAVE_PEAK*)pyramid->storage;
+
+    for ( int i = 0; i < pyramid->numLevels; i++ ) {
+
+        pyramid->levels[i] = p;
+        p += pyramid->levelSizes[i];
+    }
+
+    return pyramid;
+}
+
+
+static int64_t storage_size( WAVE_PEAK_PYRAMID* pyramid )
+{
+    int64_t numElems = 0;
+
+    for ( int i = 0; i < pyramid->numLevels; i++ ) {
+
+        numElems += pyramid->levelSizes[i];
+    }
+
+    return numElems * sizeof(WAVE_PEAK);
+}
+
+
+void freeWavePeakPyramid( WAVE_PEAK_PYRAMID* pyramid )
+{
+    if ( pyramid == NULL ) {
+        return;
+    }
+
+    free( pyramid->filename   );
+    free( pyramid->levelSizes );
+    free( pyramid->levels     );
+    free( pyramid->storage    );
+    free( pyramid );
+}
+
+
+/** @brief make level 0 and the peak from the samples in fp, which is
+ *         positioned at the beginning of the data, and then the rest of
+ *         the levels from level 0.
+ */
+static int build_pyramid( WAVE_PEAK_PYRAMID* pyramid, FILE* fp )
+{
+    short* readBuffer = (short*)malloc( sizeof(short) * WPP_READ_BUF_SAMPLES );
+
+    if ( readBuffer == NULL ) {
+        return -1;
+    }
+
+    int64_t    samplesRead = 0;
+    int64_t    block       = 0;
+    int        inBlock     = 0;
+    int        minAll      = 0;
+    int        maxAll      = 0;
+    int        blockSize   = pyramid->blockSize;
+    WAVE_PEAK* level0      = ( pyramid->numLevels > 0 ) ? pyramid->levels[0]
+                                                        : NULL;
+    WAVE_PEAK  current     = { 0, 0 };
+
+    while ( pyramid->totalSamples > samplesRead ) {
+
+        int64_t samplesToBeRequested = pyramid->totalSamples - samplesRead;
+
+        if ( samplesToBeRequested > WPP_READ_BUF_SAMPLES ) {
+
+            samplesToBeRequested = WPP_READ_BUF_SAMPLES;
+        }
+
+        int bytesRead = read_bytes( fp,
+                                    (char*)readBuffer,
+                                    (int)samplesToBeRequested * 2 );
+        if ( bytesRead == -1 ) {
+
+            free(readBuffer);
+            return -1;
+        }
+
+        if ( bytesRead < 2 ) {
+            /* EOF before the end of the data chunk. */
+            break;
+        }
+
+        int numRead = bytesRead / 2;
+
+        samplesRead += numRead;
+
+        for ( int i = 0; i < numRead; ) {
+
+            int   segment = blockSize - inBlock;
+            short segMin;
+            short segMax;
+
+            if ( segment > numRead - i ) {
+                segment = numRead - i;
+            }
+
+            minMaxOfSamples( &(readBuffer[i]), segment, &segMin, &segMax );
+
+            if ( inBlock == 0 ) {
+
+                current.min = segMin;
+                current.max = segMax;
+            }
+            else {
+                if ( segMin < current.min ) {
+                    current.min = segMin;
+                }
+
+                if ( segMax > current.max ) {
+                    current.max = segMax;
+                }
+            }
+
+            if ( segMin < minAll ) {
+                minAll = segMin;
+            }
+
+            if ( segMax > maxAll ) {
+                maxAll = segMax;
+            }
+
+            i       += segment;
+            inBlock += segment;
+
+            if ( inBlock == blockSize ) {
+
+                level0[ block++ ] = current;
+                inBlock = 0;
+            }
+        }
+    }
+
+    if ( inBlock > 0 ) {
+
+        level0[ block++ ] = current;
+    }
+
+    /* The part missing in the file is silence. */
+    while ( level0 != NULL && block < pyramid->levelSizes[0] ) {
+
+        level0[ block ].min = 0;
+        level0[ block ].max = 0;
+        block++;
+    }
+
+    free(readBuffer);
+
+    pyramid->peak = ( maxAll > -minAll ) ? maxAll : -minAll;
+
+    for ( int l = 1; l < pyramid->numLevels; l++ ) {
+
+        WAVE_PEAK* from = pyramid->levels[ l - 1 ];
+        WAVE_PEAK* to   = pyramid->levels[ l     ];
+
+        for ( int64_t i = 0; i < pyramid->levelSizes[l]; i++ ) {
+
+            to[i] = from[ i * 2 ];
+
+            if ( i * 2 + 1 < pyramid->levelSizes[ l - 1 ] ) {
+
+                WAVE_PEAK next = from[ i * 2 + 1 ];
+
+                if ( next.min < to[i].min ) {
+                    to[i].min = next.min;
+                }
+
+                if ( next.max > to[i].max ) {
+                    to[i].max = next.max;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+static int load_sidecar(
+    WAVE_PEAK_PYRAMID* pyramid,
+    const char*        path,
+    WAVE_FINGERPRINT*  fingerprint
+) {
+    struct WPP_SIDECAR sidecar;
+    FILE*              fp;
+
+    fp = fopen( path, "rb" );
+
+    if ( fp == NULL ) {
+        return -1;
+    }
+
+    if ( read_bytes( fp,
+                     (char *)&sidecar,
+                     sizeof(sidecar)   ) < (int)sizeof(sidecar) ) {
+
+        fclose(fp);
+        return -1;
+    }
+
+    if (    memcmp( sidecar.magic, WPP_MAGIC, 4 ) != 0
+         || sidecar.version      != WPP_VERSION
+         || !equalWaveFingerprints( &sidecar.fingerprint, fingerprint )
+         || sidecar.totalSamples != pyramid->totalSamples
+         || sidecar.blockSize    != pyramid->blockSize              ) {
+
+        fclose(fp);
+        return -1;
+    }
+
+    int64_t size = storage_size( pyramid );
+
+    if ( (int64_t)fread( pyramid->storage, 1, size, fp ) != size ) {
+
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+
+    pyramid->peak = sidecar.peak;
+
+    return 0;
+}
+
+
+/** @brief write the sidecar to a temporary file and rename it, so that
+ *         a reader never sees a partially written one.
+ */
+static int save_sidecar(
+    WAVE_PEAK_PYRAMID* pyramid,
+    const char*        path,
+    WAVE_FINGERPRINT*  fingerprint
+) {
+    struct WPP_SIDECAR sidecar;
+
+    memset( &sidecar, 0, sizeof(sidecar) );
+    memcpy( sidecar.magic, WPP_MAGIC, 4 );
+
+    sidecar.version      = WPP_VERSION;
+    sidecar.fingerprint  = *fingerprint;
+    sidecar.totalSamples = pyramid->totalSamples;
+    sidecar.peak         = pyramid->peak;
+    sidecar.blockSize    = pyramid->blockSize;
+
+    return saveSidecarFile( path,
+                            &sidecar,
+                            sizeof(sidecar),
+                            pyramid->storage,
+                            (size_t)storage_size( pyramid ) );
+}
+
+
+int* computePlotsFromWavePeakPyramid(
+    WAVE_PEAK_PYRAMID* pyramid,
+    int64_t            fromSample,
+    int64_t            toSample,
+    int                width,
+    int                height
+) {
+    if ( width <= 0 ) {
+        return NULL;
+    }
+
+    if ( fromSample < 0 ) {
+        fromSample = 0;
+    }
+
+    if ( toSample > pyramid->totalSamples ) {
+        toSample = pyramid->totalSamples;
+    }
+
+    if ( toSample < fromSample ) {
+        toSample = fromSample;
+    }
+
+    int *plotArray = (int*)malloc( sizeof(int) * width * 2 );
+
+    if ( plotArray == NULL ) {
+        return NULL;
+    }
+
+    memset( plotArray, 0, sizeof(int) * width * 2 );
+
+    int64_t samplesPerColumn = ( toSample - fromSample ) / width;
+
+    if ( samplesPerColumn < pyramid->blockSize ) {
+
+        if ( plot_from_samples( pyramid,
+                                fromSample,
+                                toSample,
+                                width,
+                                plotArray  ) != 0 ) {
+            free(plotArray);
+            return NULL;
+        }
+    }
+    else {
+
+        plot_from_pyramid( pyramid,
+                           fromSample,
+                           toSample,
+                           width,
+                           plotArray  );
+    }
+
+    int i2;
+    double halfHeight = ((double)height) / 2.0 ;
+
+    for ( i2 = 0; i2 < width * 2; i2++ ) {
+
+        plotArray[i2] = (int) ( ((double)plotArray[i2])
+                                * halfHeight
+                                / 32767.0
+                                + halfHeight            );
+    }
+
+    return plotArray;
+}
+
+
+/** @brief plot the columns from the raw samples. Column x covers the
+ *         samples whose offset r in the window satisfies
+ *         x = r * width / (toSample - fromSample), as in
+ *         computePeakAndPlots().
+ */
+static int plot_from_samples(
+    WAVE_PEAK_PYRAMID* pyramid,
+    int64_t            fromSample,
+    int64_t            toSample,
+    int                width,
+    int*               plotArray
+) {
+    int64_t numSamples = toSample - fromSample;
+
+    if ( numSamples == 0 ) {
+        return 0;
+    }
+
+    FILE* fp = fopen( pyramid->filename, "rb" );
+
+    if ( fp == NULL ) {
+        return -1;
+    }
+
+    if ( fseeko( fp,
+                 (off_t)( pyramid->dataOffset + fromSample * 2 ),
+                 SEEK_SET                                        ) != 0 ) {
+        fclose(fp);
+        return -1;
+    }
+
+    short* readBuffer = (short*)malloc( sizeof(short) * WPP_READ_BUF_SAMPLES );
+
+    if ( readBuffer == NULL ) {
+
+        fclose(fp);
+        return -1;
+    }
+
+    int64_t samplesRead = 0;
+    int     currentX    = 0;
+    int64_t nextColumn  = ( numSamples + width - 1 ) / width;
+    int     maxYp       = 0;
+    int     maxYn       = 0;
+
+    while ( numSamples > samplesRead ) {
+
+        int64_t samplesToBeRequested = numSamples - samplesRead;
+
+        if ( samplesToBeRequested > WPP_READ_BUF_SAMPLES ) {
+
+            samplesToBeRequested = WPP_READ_BUF_SAMPLES;
+        }
+
+        int bytesRead = read_bytes( fp,
+                                    (char*)readBuffer,
+                                    (int)samplesToBeRequested * 2 );
+        if ( bytesRead == -1 ) {
+
+            free(readBuffer);
+            fclose(fp);
+            return -1;
+        }
+
+        if ( bytesRead < 2 ) {
+            break;
+        }
+
+        int numRead = bytesRead / 2;
+
+        for ( int i = 0; i < numRead; ) {
+
+            while ( samplesRead >= nextColumn ) {
+
+                plotArray [ currentX * 2     ] = maxYp;
+                plotArray [ currentX * 2 + 1 ] = maxYn;
+                maxYp = 0;
+                maxYn = 0;
+                currentX++;
+                nextColumn = ( numSamples * ( currentX + 1 ) + width - 1 )
+                             / width;
+            }
+
+            int64_t toBoundary = nextColumn - samplesRead;
+            int     segment    = ( toBoundary < numRead - i )
+                                 ? (int)toBoundary : ( numRead - i );
+            short   segMin;
+            short   segMax;
+
+            minMaxOfSamples( &(readBuffer[i]), segment, &segMin, &segMax );
+
+            if ( segMax > maxYp ) {
+                maxYp = segMax;
+            }
+
+            if ( segMin < maxYn ) {
+                maxYn = segMin;
+            }
+
+            i           += segment;
+            samplesRead += segment;
+        }
+    }
+
+    if ( currentX < width ) {
+
+        plotArray [ currentX * 2     ] = maxYp;
+        plotArray [ currentX * 2 + 1 ] = maxYn;
+    }
+
+    free(readBuffer);
+    fclose(fp);
+
+    return 0;
+}
+
+
+/** @brief plot the columns from the pyramid. The samples of each column
+ *         are rounded out to the level 0 blocks, and the blocks are covered
+ *         by the fewest aligned elements of the levels, i.e., O(log)
+ *         elements per column. A peak is never missed, but it can bleed
+ *         into the neighboring column by less than one block.
+ */
+static void plot_from_pyramid(
+    WAVE_PEAK_PYRAMID* pyramid,
+    int64_t            fromSample,
+    int64_t            toSample,
+    int                width,
+    int*               plotArray
+) {
+    int64_t numSamples = toSample - fromSample;
+    int64_t blockSize  = pyramid->blockSize;
+
+    for ( int x = 0; x < width; x++ ) {
+
+        int64_t begin = fromSample + ( numSamples * x       + width - 1 ) / width;
+        int64_t end   = fromSample + ( numSamples * (x + 1) + width - 1 ) / width;
+
+        if ( begin >= end ) {
+            continue;
+        }
+
+        int64_t lo    = begin / blockSize;
+        int64_t hi    = ( end + blockSize - 1 ) / blockSize;
+        int     maxYp = 0;
+        int     maxYn = 0;
+
+        for ( int l = 0; lo < hi && l < pyramid->numLevels; l++ ) {
+
+            WAVE_PEAK* peaks = pyramid->levels[l];
+
+            if ( lo & 1 ) {
+
+                maxYp = ( peaks[lo].max > maxYp ) ? peaks[lo].max : maxYp;
+                maxYn = ( peaks[lo].min < maxYn ) ? peaks[lo].min : maxYn;
+                lo++;
+            }
+
+            if ( hi & 1 ) {
+
+                hi--;
+                maxYp = ( peaks[hi].max > maxYp ) ? peaks[hi].max : maxYp;
+                maxYn = ( peaks[hi].min < maxYn ) ? peaks[hi].min : maxYn;
+            }
+
+            lo >>= 1;
+            hi >>= 1;
+        }
+
+        plotArray [ x * 2     ] = maxYp;
+        plotArray [ x * 2 + 1 ] = maxYn;
+    }
+}
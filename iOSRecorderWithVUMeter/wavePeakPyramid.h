@@ -0,0 +1,109 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WAVE_PEAK_PYRAMID_H_
+#define _WAVE_PEAK_PYRAMID_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+/** @brief min and max amplitudes of a run of samples */
+typedef struct wave_peak {
+
+    int16_t min;
+    int16_t max;
+
+} WAVE_PEAK;
+
+
+/** @brief multi-resolution min/max summary of a wave file.
+ *         Level 0 has one WAVE_PEAK per blockSize samples, and each of
+ *         the following levels halves the resolution of the previous one
+ *         like mipmaps, until a level has only one element.
+ *         It is stored in a sidecar file next to the wave file, which
+ *         is invalidated by the fingerprint of the wave file.
+ */
+typedef struct wave_peak_pyramid {
+
+    char*       filename;     /* wave file name */
+    int64_t     dataOffset;   /* byte offset of the first sample */
+    int64_t     totalSamples; /* of all the channels */
+    int         sampleRate;
+    int         numChannels;
+    int         peak;         /* absolute peak amplitude */
+    int         blockSize;    /* samples per element at level 0 */
+    int         numLevels;
+    int64_t*    levelSizes;
+    WAVE_PEAK** levels;
+    void*       storage;
+
+} WAVE_PEAK_PYRAMID;
+
+
+/** @brief open the peak pyramid of the given wave file. It is loaded from
+ *         the sidecar file if it is up to date. Otherwise it is built
+ *         with one scan of the wave file, and the sidecar is (re)written.
+ *
+ *  @param filename    (in):  wave file name
+ *
+ *  @return the pyramid to be released by freeWavePeakPyramid(),
+ *          or NULL on failure.
+ */
+
+WAVE_PEAK_PYRAMID* openWavePeakPyramid( const char* filename );
+
+
+/** @brief generate an array of integers to plot the samples in
+ *         [fromSample, toSample) on the 2D screen in the same format as
+ *         computePeakAndPlots(). The cost is proportional to width and
+ *         logarithmic in the samples per column, and a column can include
+ *         up to one block of its neighbors' samples.
+ *         If a column spans less than blockSize samples, the window is
+ *         read from the wave file to plot it at the sample resolution.
+ *
+ *  @param pyramid     (in):  pyramid of the wave file
+ *  @param fromSample  (in):  first sample of the window
+ *  @param toSample    (in):  end of the window (exclusive)
+ *  @param width       (in):  width of the screen (axis of time)
+ *  @param height      (in):  height of the screen (axis of amplitude)
+ *
+ *  @return array of width * 2 integers to plot the wave,
+ *          or NULL on failure.
+ */
+
+int* computePlotsFromWavePeakPyramid(
+    WAVE_PEAK_PYRAMID* pyramid,
+    int64_t            fromSample,
+    int64_t            toSample,
+    int                width,
+    int                height       );
+
+
+/** @brief release the pyramid */
+
+void freeWavePeakPyramid( WAVE_PEAK_PYRAMID* pyramid );
+
+
+#endif /*_WAVE_PEAK_PYRAMID_H_*/
@@ -0,0 +1,210 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include "waveRaster.h"
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int  draw_span ( WAVE_RASTER* raster, int column, int row0, int row1 );
+
+static void fill_rows ( WAVE_RASTER* raster,
+                        int          column,
+                        int          top,
+                        int          bottom,
+                        uint32_t     pixel   );
+
+
+WAVE_RASTER* createWaveRaster(
+    int      width,
+    int      height,
+    uint32_t background,
+    uint32_t foreground
+) {
+    if ( width <= 0 || height <= 0 ) {
+        return NULL;
+    }
+
+    WAVE_RASTER* raster = (WAVE_RASTER*)calloc( 1, sizeof(WAVE_RASTER) );
+
+    if ( raster == NULL ) {
+        return NULL;
+    }
+
+    raster->width       = width;
+    raster->height      = height;
+    raster->background  = background;
+    raster->foreground  = foreground;
+    raster->pixels      = (uint32_t*)malloc( sizeof(uint32_t)
+                                             * (size_t)width * height );
+    raster->spanTops    = (int*)malloc( sizeof(int) * width );
+    raster->spanBottoms = (int*)malloc( sizeof(int) * width );
+
+    if (    raster->pixels   == NULL
+         || raster->spanTops == NULL || raster->spanBottoms == NULL ) {
+
+        freeWaveRaster( raster );
+        return NULL;
+    }
+
+    for ( size_t i = 0; i < (size_t)width * height; i++ ) {
+        raster->pixels[i] = background;
+    }
+
+    for ( int x = 0; x < width; x++ ) {
+        raster->spanTops   [x] = 0;
+        raster->spanBottoms[x] = -1;
+    }
+
+    return raster;
+}
+
+
+int rasterizeWavePlots(
+    WAVE_RASTER* raster,
+    int          firstColumn,
+    int          numColumns,
+    const int*   plots
+) {
+    int numChanged = 0;
+
+    for ( int i = 0; i < numColumns; i++ ) {
+
+        numChanged += draw_span( raster,
+                                 firstColumn + i,
+                                 plots[ i * 2 ],
+                                 plots[ i * 2 + 1 ] );
+    }
+
+    return numChanged;
+}
+
+
+int rasterizeWaveLevels(
+    WAVE_RASTER* raster,
+    int          firstColumn,
+    int          numColumns,
+    const short* mins,
+    const short* maxs
+) {
+    double halfHeight = ( (double)raster->height ) / 2.0;
+    int    numChanged = 0;
+
+    for ( int i = 0; i < numColumns; i++ ) {
+
+        int row0 = (int)( mins[i] * halfHeight / 32767.0 + halfHeight );
+        int row1 = (int)( maxs[i] * halfHeight / 32767.0 + halfHeight );
+
+        numChanged += draw_span( raster, firstColumn + i, row0, row1 );
+    }
+
+    return numChanged;
+}
+
+
+/* Only the rows of the old span out of the new one are erased, and only
+ * the rows of the new span out of the old one are filled. */
+static int draw_span( WAVE_RASTER* raster, int column, int row0, int row1 )
+{
+    if ( column < 0 || column >= raster->width ) {
+        return 0;
+    }
+
+    int top    = ( row0 < row1 ) ? row0 : row1;
+    int bottom = ( row0 < row1 ) ? row1 : row0;
+
+    top    = ( top    < 0 ) ? 0 : top;
+    top    = ( top    < raster->height ) ? top    : raster->height - 1;
+    bottom = ( bottom < 0 ) ? 0 : bottom;
+    bottom = ( bottom < raster->height ) ? bottom : raster->height - 1;
+
+    int oldTop    = raster->spanTops   [ column ];
+    int oldBottom = raster->spanBottoms[ column ];
+
+    if ( top == oldTop && bottom == oldBottom ) {
+        return 0;
+    }
+
+    uint32_t bg = raster->background;
+    uint32_t fg = raster->foreground;
+
+    if ( oldBottom < oldTop ) {
+
+        fill_rows( raster, column, top, bottom, fg );
+    }
+    else {
+        /* Empty ranges are skipped by fill_rows(). */
+        fill_rows( raster, column, oldTop, ( oldBottom < top )
+                                           ? oldBottom : top - 1,    bg );
+        fill_rows( raster, column, ( oldTop > bottom )
+                                   ? oldTop : bottom + 1, oldBottom, bg );
+        fill_rows( raster, column, top, ( bottom < oldTop )
+                                        ? bottom : oldTop - 1,       fg );
+        fill_rows( raster, column, ( top > oldBottom )
+                                   ? top : oldBottom + 1, bottom,    fg );
+    }
+
+    raster->spanTops   [ column ] = top;
+    raster->spanBottoms[ column ] = bottom;
+
+    return 1;
+}
+
+
+static void fill_rows(
+    WAVE_RASTER* raster,
+    int          column,
+    int          top,
+    int          bottom,
+    uint32_t     pixel
+) {
+    if ( top > bottom ) {
+        return;
+    }
+
+    uint32_t* p = &(raster->pixels[ (size_t)top * raster->width + column ]);
+
+    for ( int y = top; y <= bottom; y++ ) {
+
+        *p  = pixel;
+        p  += raster->width;
+    }
+}
+
+
+void freeWaveRaster( WAVE_RASTER* raster )
+{
+    if ( raster == NULL ) {
+        return;
+    }
+
+    free( raster->pixels );
+    free( raster->spanTops );
+    free( raster->spanBottoms );
+    free( raster );
+}
@@ -0,0 +1,122 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Raster of the waveform, for a view to draw without stroking a path.
+ *
+ * Each column of the plot is a vertical span of pixels from the minimum to
+ * the maximum of its samples, drawn into a pixel buffer kept by the raster.
+ * The span drawn in each column is remembered, so that a column is redrawn
+ * only when its span has changed, and then only in the rows that differ.
+ * The plots and the levels are read in place, and nothing is allocated
+ * after the creation.
+ */
+
+#ifndef _WAVE_RASTER_H_
+#define _WAVE_RASTER_H_
+
+#include <stdint.h>
+
+/** @brief a pixel of the color, whose bytes in memory are R, G, B and A on
+ *         a little-endian CPU, which is the layout of
+ *         kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big.
+ */
+#define WAVE_RASTER_RGBA( r, g, b, a )  (   (uint32_t)(r)         \
+                                          | (uint32_t)(g) << 8    \
+                                          | (uint32_t)(b) << 16   \
+                                          | (uint32_t)(a) << 24 )
+
+
+typedef struct wave_raster {
+
+    int       width;
+    int       height;
+    uint32_t  background;
+    uint32_t  foreground;
+    uint32_t* pixels;       /* [ height ][ width ], row 0 at the top */
+    int*      spanTops;     /* [ width ] first row drawn in each column */
+    int*      spanBottoms;  /* [ width ] last row, < spanTops if none */
+
+} WAVE_RASTER;
+
+
+/** @brief create a raster filled with the background.
+ *
+ *  @param width       (in): width in pixels, which is the number of columns
+ *  @param height      (in): height in pixels
+ *  @param background  (in): pixel of the background, e.g., 0 to see through
+ *  @param foreground  (in): pixel of the spans
+ *
+ *  @return raster, or NULL on failure.
+ */
+
+WAVE_RASTER* createWaveRaster(
+    int      width,
+    int      height,
+    uint32_t background,
+    uint32_t foreground  );
+
+
+/** @brief draw the columns from the plots in the format of
+ *         computePlotsFromWavePeakPyramid(), whose rows are clamped into
+ *         the raster.
+ *
+ *  @param firstColumn (in): column of plots[0] and plots[1]
+ *  @param numColumns  (in): number of the columns in plots
+ *  @param plots       (in): numColumns * 2 rows, two of each column
+ *
+ *  @return number of the columns whose pixels have changed
+ */
+
+int rasterizeWavePlots(
+    WAVE_RASTER* raster,
+    int          firstColumn,
+    int          numColumns,
+    const int*   plots        );
+
+
+/** @brief draw the columns from the minimum and the maximum of their
+ *         samples, e.g., from readLiveWaveform(), scaled to the height in
+ *         the same way as computePlotsFromWavePeakPyramid().
+ *
+ *  @param firstColumn (in): column of mins[0] and maxs[0]
+ *  @param numColumns  (in): number of the columns in mins and maxs
+ *  @param mins        (in): minimum of each column
+ *  @param maxs        (in): maximum of each column
+ *
+ *  @return number of the columns whose pixels have changed
+ */
+
+int rasterizeWaveLevels(
+    WAVE_RASTER* raster,
+    int          firstColumn,
+    int          numColumns,
+    const short* mins,
+    const short* maxs         );
+
+
+/** @brief release the raster */
+
+void freeWaveRaster( WAVE_RASTER* raster );
+
+
+#endif /*_WAVE_RASTER_H_*/
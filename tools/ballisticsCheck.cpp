@@ -0,0 +1,344 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//
+// Unit checks and benchmark of the meter ballistics MeterBallistics.cpp.
+//
+// It checks the dB scale by the table against log10(), the step response
+// of the VU needle against the analytic one of the damped spring, that the
+// needles move the same at any display refresh, the fall rates of the PPM
+// and the peak meter and the hold marker. Then it times a batch of
+// thousands of meters, as a mixing console would show.
+// The exit status is non-zero if any check fails.
+//
+// Build on Linux from the top directory, in one line:
+//
+//   c++ -O2 -std=c++14 -IiOSRecorderWithVUMeter -o ballisticsCheck
+//       tools/ballisticsCheck.cpp iOSRecorderWithVUMeter/MeterBallistics.cpp
+//
+// Usage:
+//
+//   ballisticsCheck [-m meters to time] [-s seconds to time]
+//
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MeterBallistics.hpp"
+
+#define BC_STEP       ( 1.0f / 480.0f )
+#define BC_REFERENCE  1000.0f
+#define BC_FLOOR_DB   -60.0f
+#define BC_CEILING_DB   0.0f
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int    check_db_table    ();
+
+static int    check_vu_step     ();
+
+static int    check_refresh     ();
+
+static int    check_falls       ();
+
+static int    check             ( const char* what, bool ok, double value );
+
+static float  amplitude_at      ( float position );
+
+static void   show              ( MeterBallistics& meters, double seconds );
+
+static double now_seconds       ();
+
+
+int main( int argc, char* argv[] )
+{
+    int    numMeters = 4096;
+    double seconds   = 10.0;
+    int    numFailed = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "m:s:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'm': numMeters = atoi( optarg ); break;
+          case 's': seconds   = atof( optarg ); break;
+
+          default:
+            fprintf( stderr, "usage: %s [-m meters] [-s seconds]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    numFailed += check_db_table();
+    numFailed += check_vu_step();
+    numFailed += check_refresh();
+    numFailed += check_falls();
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    // Throughput: the meters driven by new levels at every 1/60s.
+    static const int modes[] = { MeterBallistics::MODE_VU,
+                                 MeterBallistics::MODE_PPM,
+                                 MeterBallistics::MODE_PEAK_HOLD };
+    static const char* names[] = { "VU", "PPM", "peak hold" };
+
+    float* levels = (float*) malloc( sizeof(float) * numMeters );
+
+    if ( levels == NULL ) {
+        return 1;
+    }
+
+    for ( int k = 0; k < 3; k++ ) {
+
+        MeterBallistics meters( numMeters, modes[k], BC_STEP );
+        int64_t         steps = 0;
+        double          start = now_seconds();
+
+        for ( int f = 0; f < (int)( seconds * 60.0 ); f++ ) {
+
+            for ( int i = 0; i < numMeters; i++ ) {
+                levels[i] = 100.0f + 10.0f * ( ( f * 7 + i * 13 ) % 97 );
+            }
+
+            meters.setLevels( 0, numMeters, levels );
+            steps += meters.advance( 1.0 / 60.0 );
+        }
+
+        double elapsed = now_seconds() - start;
+
+        printf( "%-10s %d meters for %.0f seconds: %.3f seconds, "
+                "%.0f meter steps per second (%g)\n",
+                names[k], numMeters, seconds, elapsed,
+                steps * (double) numMeters / elapsed,
+                meters.positions()[ numMeters / 2 ]              );
+    }
+
+    free( levels );
+
+    return ( numFailed == 0 ) ? 0 : 2;
+}
+
+
+static int check_db_table()
+{
+    MeterBallistics meters( 1, MeterBallistics::MODE_VU, BC_STEP );
+    double          maxError = 0.0;
+
+    meters.setScale( BC_REFERENCE, BC_FLOOR_DB, BC_CEILING_DB );
+
+    for ( float a = 1.0f; a <= 32768.0f; a *= 1.0001f ) {
+
+        double error = fabs( meters.toDB( a )
+                             - 20.0 * log10( a / BC_REFERENCE ) );
+
+        maxError = ( error > maxError ) ? error : maxError;
+    }
+
+    return check( "dB by the table, max error [dB]", maxError < 1.0e-3,
+                  maxError                                            );
+}
+
+
+// A step from the left end to the middle. The spring of 100/s^2 with the
+// friction of 10/s is damped by 0.5, and overshoots by exp(-pi/sqrt(3)).
+static int check_vu_step()
+{
+    MeterBallistics meters( 1, MeterBallistics::MODE_VU, BC_STEP );
+    float           level  = amplitude_at( 0.5f );
+    float           peak   = 0.0f;
+    int             failed = 0;
+
+    meters.setScale( BC_REFERENCE, BC_FLOOR_DB, BC_CEILING_DB );
+    meters.setLevels( 0, 1, &level );
+
+    for ( int f = 0; f < 60 * 3; f++ ) {
+
+        meters.advance( 1.0 / 60.0 );
+
+        peak = ( meters.positions()[0] > peak ) ? meters.positions()[0] : peak;
+    }
+
+    double overshoot = ( peak - 0.5 ) / 0.5;
+    double expected  = exp( -M_PI / sqrt( 3.0 ) );
+
+    failed |= check( "VU overshoot", fabs( overshoot - expected ) < 0.01,
+                     overshoot                                          );
+    failed |= check( "VU settled at 0.5",
+                     fabs( meters.positions()[0] - 0.5 ) < 1.0e-3,
+                     meters.positions()[0]                         );
+    return failed;
+}
+
+
+// The same levels shown at 60Hz, at 144Hz, and at irregular intervals.
+static int check_refresh()
+{
+    static const double refresh[] = { 1.0 / 60.0, 1.0 / 144.0, 0.0 };
+
+    float  results [ 3 ];
+    int    failed = 0;
+
+    for ( int k = 0; k < 3; k++ ) {
+
+        MeterBallistics meters( 1, MeterBallistics::MODE_VU, BC_STEP );
+        double          shown = 0.0;
+        unsigned        seed  = 1;
+
+        meters.setScale( BC_REFERENCE, BC_FLOOR_DB, BC_CEILING_DB );
+
+        while ( shown < 2.0 - 1.0e-9 ) {
+
+            double dt = refresh[k];
+
+            if ( dt == 0.0 ) {
+                seed = seed * 1103515245u + 12345u;
+                dt   = 0.002 + 0.03 * ( ( seed >> 16 ) % 1000 ) / 1000.0;
+            }
+
+            dt = ( shown + dt < 2.0 ) ? dt : 2.0 - shown;
+
+            // The level changes at 1s, on a step of any refresh.
+            float level = amplitude_at( ( shown < 1.0 ) ? 0.8f : 0.3f );
+
+            meters.setLevels( 0, 1, &level );
+            meters.advance( dt );
+
+            shown += dt;
+        }
+
+        results[k] = meters.positions()[0];
+    }
+
+    for ( int k = 1; k < 3; k++ ) {
+
+        failed |= check( "same needle at another refresh",
+                         fabs( results[k] - results[0] ) < 0.02,
+                         results[k] - results[0]                 );
+    }
+
+    return failed;
+}
+
+
+static int check_falls()
+{
+    const double range  = BC_CEILING_DB - BC_FLOOR_DB;
+    float        top    = amplitude_at( 1.0f );
+    float        bottom = 0.0f;
+    int          failed = 0;
+
+    // PPM: up from the left end within 5 time constants, then falls by
+    // 24dB in 2.8s.
+    MeterBallistics ppm( 1, MeterBallistics::MODE_PPM, BC_STEP );
+
+    ppm.setScale( BC_REFERENCE, BC_FLOOR_DB, BC_CEILING_DB );
+    ppm.setLevels( 0, 1, &top );
+    show( ppm, 0.025 );
+
+    failed |= check( "PPM up in 25ms", ppm.positions()[0] > 0.98,
+                     ppm.positions()[0]                          );
+
+    float from = ppm.positions()[0];
+
+    ppm.setLevels( 0, 1, &bottom );
+    show( ppm, 1.4 );
+
+    double dB = ( from - ppm.positions()[0] ) * range;
+
+    failed |= check( "PPM fall in 1.4s [dB]", fabs( dB - 12.0 ) < 0.1, dB );
+
+    // Peak: at the top at once, then falls by 20dB in 1.7s. The marker
+    // stays at the top for 2s, and then falls at the same rate.
+    MeterBallistics peak( 1, MeterBallistics::MODE_PEAK_HOLD, BC_STEP );
+
+    peak.setScale( BC_REFERENCE, BC_FLOOR_DB, BC_CEILING_DB );
+    peak.setLevels( 0, 1, &top );
+    peak.advance( BC_STEP );
+
+    failed |= check( "peak up in a step", peak.positions()[0] == 1.0f,
+                     peak.positions()[0]                              );
+
+    peak.setLevels( 0, 1, &bottom );
+    show( peak, 1.7 );
+
+    dB = ( 1.0 - peak.positions()[0] ) * range;
+
+    failed |= check( "peak fall in 1.7s [dB]", fabs( dB - 20.0 ) < 0.1, dB );
+    failed |= check( "hold marker held", peak.holds()[0] == 1.0f,
+                     peak.holds()[0]                             );
+
+    show( peak, 0.3 + 0.85 );
+
+    dB = ( 1.0 - peak.holds()[0] ) * range;
+
+    failed |= check( "hold marker fall in 0.85s [dB]",
+                     fabs( dB - 10.0 ) < 0.2, dB       );
+    return failed;
+}
+
+
+static int check( const char* what, bool ok, double value )
+{
+    printf( "%-36s %10.6f  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+// Advances at the refresh of 60Hz, within MaxCatchUpSeconds.
+static void show( MeterBallistics& meters, double seconds )
+{
+    for ( ; seconds > 1.0 / 60.0; seconds -= 1.0 / 60.0 ) {
+        meters.advance( 1.0 / 60.0 );
+    }
+
+    meters.advance( seconds );
+}
+
+
+// The amplitude that puts a needle at the position.
+static float amplitude_at( float position )
+{
+    float dB = BC_FLOOR_DB + position * ( BC_CEILING_DB - BC_FLOOR_DB );
+
+    return BC_REFERENCE * powf( 10.0f, dB / 20.0f );
+}
+
+
+static double now_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,518 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Checks and benchmark of the callback timing callbackTrace.c and of the
+ * dropout markers dropoutMarkers.c.
+ *
+ * An audio device is simulated on a clock of nanoseconds: callbacks of
+ * 1024 frames, sometimes more, at 48kHz, with a jitter on their host time,
+ * some callbacks never made as in a dropout, and a restart of the capture.
+ * One thread traces the callbacks as the capture thread would, and another
+ * reads and analyzes them at the same time. The gaps found must be the
+ * dropouts made, at the samples of the stream where they are, and the
+ * histograms must count every callback. The sidecar of the markers is
+ * saved and loaded for a wave file made for it, and not loaded once the
+ * file has changed. Then it times the trace of a callback.
+ * The exit status is non-zero if any check fails.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -IiOSRecorderWithVUMeter -o callbackTraceCheck \
+ *      tools/callbackTraceCheck.c iOSRecorderWithVUMeter/callbackTrace.c \
+ *      iOSRecorderWithVUMeter/dropoutMarkers.c \
+ *      iOSRecorderWithVUMeter/sidecarFile.c \
+ *      iOSRecorderWithVUMeter/waveFile.c -lpthread -lm
+ *
+ * Usage:
+ *
+ *   callbackTraceCheck [-n callbacks] [-d directory for the wave file]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "callbackTrace.h"
+#include "dropoutMarkers.h"
+
+#define CTC_RATE          48000
+#define CTC_CHANNELS      2
+#define CTC_FRAMES        1024
+#define CTC_LONG_FRAMES   1115
+#define CTC_JITTER_NS     500000    /* +/- on the host time */
+#define CTC_DROPOUT_ODDS  400       /* one callback in it starts a dropout */
+#define CTC_MAX_GAPS      4096
+#define CTC_TRACE_EVENTS  256
+
+
+/* Callbacks of the simulated device, made by one thread. */
+typedef struct ctc_device {
+
+    CALLBACK_TRACE* trace;
+    int64_t         numCallbacks;
+
+    /* The dropouts made, as the gaps expected. */
+    CALLBACK_GAP    gaps [ CTC_MAX_GAPS ];
+    int             numGaps;
+    int64_t         lostFrames;
+    int64_t         numFull;     /* the ring was full, and it waited */
+
+    atomic_int      done;
+
+} CTC_DEVICE;
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static void*    run_device       ( void* arg );
+
+static int      check_full       ( void );
+
+static int      check_sidecar    ( const char* dir );
+
+static double   time_trace       ( int64_t num_callbacks );
+
+static int      check            ( const char* what, int ok, double value );
+
+static uint32_t next_random      ( uint32_t* state );
+
+static double   now_seconds      ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    int64_t numCallbacks = 200000;
+    char*   dir          = "/tmp";
+    int     numFailed    = 0;
+    int     opt;
+
+    while ( ( opt = getopt( argc, argv, "n:d:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'n': numCallbacks = atoll( optarg ); break;
+          case 'd': dir          = optarg;          break;
+
+          default:
+            fprintf( stderr, "usage: %s [-n callbacks] [-d directory]\n",
+                     argv[0]                                             );
+            return 1;
+        }
+    }
+
+    CTC_DEVICE*      device = (CTC_DEVICE*) calloc( 1, sizeof(CTC_DEVICE) );
+    CALLBACK_TIMING* timing = createCallbackTiming( 1.0e-9 );
+
+    if ( device == NULL || timing == NULL || numCallbacks < 2 ) {
+        return 1;
+    }
+
+    device->trace        = createCallbackTrace( CTC_TRACE_EVENTS );
+    device->numCallbacks = numCallbacks;
+
+    atomic_init( &(device->done), 0 );
+
+    if ( device->trace == NULL ) {
+        return 1;
+    }
+
+    pthread_t thread;
+
+    if ( pthread_create( &thread, NULL, run_device, device ) != 0 ) {
+        return 1;
+    }
+
+    CALLBACK_EVENT events [ 64 ];
+    CALLBACK_GAP*  gaps    = (CALLBACK_GAP*) malloc( sizeof(CALLBACK_GAP)
+                                                     * CTC_MAX_GAPS        );
+    int            numGaps = 0;
+    int            finished = 0;
+
+    if ( gaps == NULL ) {
+        return 1;
+    }
+
+    /* As the reader of the app, in batches as they come. */
+    while ( !finished ) {
+
+        finished = atomic_load( &(device->done) );
+
+        int n;
+
+        while ( ( n = readCallbackTrace( device->trace, events, 64 ) ) > 0 ) {
+
+            numGaps += analyzeCallbackEvents( timing, events, n,
+                                              &gaps[ numGaps ],
+                                              CTC_MAX_GAPS - numGaps );
+        }
+    }
+
+    pthread_join( thread, NULL );
+
+    int sameGaps = ( numGaps == device->numGaps );
+
+    for ( int i = 0; sameGaps && i < numGaps; i++ ) {
+
+        sameGaps =    gaps[i].streamSample == device->gaps[i].streamSample
+                   && gaps[i].lostFrames   == device->gaps[i].lostFrames;
+    }
+
+    int64_t framesTotal = 0;
+
+    for ( int b = 0; b < CBT_FRAMES_BINS; b++ ) {
+        framesTotal += timing->framesHistogram[b];
+    }
+
+    int64_t intervalsTotal = 0;
+
+    for ( int b = 0; b < CBT_INTERVAL_BINS; b++ ) {
+        intervalsTotal += timing->intervalHistogram[b];
+    }
+
+    double nominal = (double)CTC_FRAMES / CTC_RATE;
+    double median  = callbackIntervalPercentile( timing, 0.5 );
+
+    char summary [ 256 ];
+
+    formatCallbackTiming( timing, summary, sizeof(summary) );
+
+    printf( "%s\n", summary );
+    printf( "ring full %lld times\n", (long long)device->numFull );
+
+    numFailed += check( "callbacks analyzed",
+                        timing->numCallbacks == numCallbacks,
+                        (double)timing->numCallbacks          );
+
+    numFailed += check( "gaps found as made",
+                        sameGaps && timing->lostFrames == device->lostFrames,
+                        numGaps                                              );
+
+    numFailed += check( "restarts", timing->numRestarts == 1,
+                        (double)timing->numRestarts          );
+
+    numFailed += check( "frames histogram total",
+                        framesTotal == numCallbacks, (double)framesTotal );
+
+    numFailed += check( "interval histogram total",
+                        intervalsTotal == numCallbacks - 2,
+                        (double)intervalsTotal              );
+
+    numFailed += check( "median interval [ms]",
+                           median > nominal - 0.0005
+                        && median < nominal + 0.0005 + CBT_INTERVAL_BIN_MS,
+                        median * 1000.0                                    );
+
+    numFailed += check_full();
+    numFailed += check_sidecar( dir );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    double cost = time_trace( 10000000 );
+
+    printf( "trace of a callback: %.1f ns, %.6f%% of a callback of %d "
+            "frames\n",
+            cost * 1.0e9, cost / nominal * 100.0, CTC_FRAMES          );
+
+    freeCallbackTiming( timing );
+    freeCallbackTrace( device->trace );
+    free( device );
+    free( gaps );
+
+    return ( numFailed == 0 ) ? 0 : 1;
+}
+
+
+/* The device goes on when a callback is not made, so the sample time
+ * jumps by its frames, and the host time with it. Halfway it restarts
+ * from the sample time 0. */
+static void* run_device( void* arg )
+{
+    CTC_DEVICE* device   = (CTC_DEVICE*) arg;
+    uint32_t    state    = 9;
+    double      sample   = 0.0;         /* of the device */
+    int64_t     base     = 1000000000;  /* host time of sample 0 [ns] */
+    int64_t     stream   = 0;           /* samples written to the stream */
+    int64_t     lost     = 0;           /* frames skipped since the last */
+
+    for ( int64_t k = 0; k < device->numCallbacks; ) {
+
+        int frames = ( next_random( &state ) % 8 == 0 ) ? CTC_LONG_FRAMES
+                                                        : CTC_FRAMES;
+
+        if ( k == device->numCallbacks / 2 ) {
+
+            /* The capture restarts a while later. */
+            base  += (int64_t)( sample / CTC_RATE * 1.0e9 ) + 500000000;
+            sample = 0.0;
+            lost   = 0;
+        }
+        else if ( k > 0 && next_random( &state ) % CTC_DROPOUT_ODDS == 0 ) {
+
+            sample += frames;
+            lost   += frames;
+            continue;
+        }
+
+        int64_t jitter = (int64_t)( next_random( &state )
+                                    % ( 2 * CTC_JITTER_NS ) ) - CTC_JITTER_NS;
+
+        CALLBACK_EVENT event;
+
+        event.sampleTime   = sample;
+        event.hostTime     = (uint64_t)( base + sample / CTC_RATE * 1.0e9
+                                         + jitter                        );
+        event.streamSample = stream;
+        event.numFrames    = frames;
+
+        if ( lost > 0 ) {
+
+            if ( device->numGaps < CTC_MAX_GAPS ) {
+
+                device->gaps[ device->numGaps ].streamSample = stream;
+                device->gaps[ device->numGaps ].lostFrames   = lost;
+                device->numGaps++;
+            }
+
+            device->lostFrames += lost;
+            lost = 0;
+        }
+
+        /* A test must not lose any, where the capture thread would. */
+        while ( traceCallback( device->trace, &event ) != 0 ) {
+
+            device->numFull++;
+            sched_yield();
+        }
+
+        sample += frames;
+        stream += (int64_t)frames * CTC_CHANNELS;
+        k++;
+    }
+
+    atomic_store( &(device->done), 1 );
+
+    return NULL;
+}
+
+
+/* A full ring drops the event and counts it, and takes them again once
+ * read. */
+static int check_full( void )
+{
+    CALLBACK_TRACE* trace = createCallbackTrace( 4 );
+    CALLBACK_EVENT  event;
+    CALLBACK_EVENT  events [ 4 ];
+
+    if ( trace == NULL ) {
+        return 1;
+    }
+
+    memset( &event, 0, sizeof(event) );
+
+    int ok = 1;
+
+    for ( int i = 0; i < 4; i++ ) {
+
+        event.numFrames = i;
+        ok = ok && traceCallback( trace, &event ) == 0;
+    }
+
+    ok =    ok
+         && traceCallback( trace, &event ) == -1
+         && droppedCallbackEvents( trace ) == 1
+         && readCallbackTrace( trace, events, 4 ) == 4
+         && events[0].numFrames == 0 && events[3].numFrames == 3
+         && traceCallback( trace, &event ) == 0;
+
+    freeCallbackTrace( trace );
+
+    return check( "full ring", ok, 4 );
+}
+
+
+static int check_sidecar( const char* dir )
+{
+    char path [ 4096 ];
+    char drop [ 4096 + 8 ];
+
+    snprintf( path, sizeof(path), "%s/callbackTraceCheck.wav", dir );
+    snprintf( drop, sizeof(drop), "%s.drop", path );
+
+    FILE* fp = fopen( path, "wb" );
+
+    if ( fp == NULL ) {
+        return check( "sidecar [markers]", 0, 0 );
+    }
+
+    /* A second of silence, mono at 48kHz. */
+    unsigned char header [ 44 ];
+    uint32_t      values [ 4 ];
+    short         silence [ 480 ];
+
+    memset( silence, 0, sizeof(silence) );
+    memcpy( &(header[0]),  "RIFF", 4 );
+    values[0] = CTC_RATE * 2 + 36;
+    memcpy( &(header[4]),  &(values[0]), 4 );
+    memcpy( &(header[8]),  "WAVEfmt ", 8 );
+    values[1] = 16;
+    memcpy( &(header[16]), &(values[1]), 4 );
+    header[20] = 1;  header[21] = 0;
+    header[22] = 1;  header[23] = 0;
+    values[2] = CTC_RATE;
+    memcpy( &(header[24]), &(values[2]), 4 );
+    values[3] = CTC_RATE * 2;
+    memcpy( &(header[28]), &(values[3]), 4 );
+    header[32] = 2;  header[33] = 0;
+    header[34] = 16; header[35] = 0;
+    memcpy( &(header[36]), "data", 4 );
+    values[0] = CTC_RATE * 2;
+    memcpy( &(header[40]), &(values[0]), 4 );
+
+    int written = fwrite( header, 1, sizeof(header), fp ) == sizeof(header);
+
+    for ( int i = 0; i < 100; i++ ) {
+        written = written && fwrite( silence, sizeof(silence), 1, fp ) == 1;
+    }
+
+    written = ( fclose(fp) == 0 ) && written;
+
+    DROPOUT_LIST* list = createDropoutList( CTC_RATE, 1 );
+
+    if ( !written || list == NULL ) {
+        return check( "sidecar [markers]", 0, 0 );
+    }
+
+    /* Past the initial room. */
+    for ( int i = 0; i < 40; i++ ) {
+        addDropoutMarker( list, i * 1000, 1024 + i );
+    }
+
+    int ok = saveDropoutList( list, path ) == 0;
+
+    DROPOUT_LIST* loaded = ok ? loadDropoutList( path ) : NULL;
+
+    ok =    loaded != NULL
+         && loaded->sampleRate  == CTC_RATE
+         && loaded->numChannels == 1
+         && loaded->numMarkers  == 40
+         && memcmp( loaded->markers, list->markers,
+                    sizeof(DROPOUT_MARKER) * 40     ) == 0;
+
+    freeDropoutList( loaded );
+
+    /* The file changes, and the markers are not of it any more. */
+    fp = fopen( path, "ab" );
+
+    if ( fp != NULL ) {
+        fwrite( silence, sizeof(silence), 1, fp );
+        fclose( fp );
+    }
+
+    loaded = loadDropoutList( path );
+    ok     = ok && loaded == NULL;
+
+    freeDropoutList( loaded );
+    freeDropoutList( list );
+    unlink( drop );
+    unlink( path );
+
+    return check( "sidecar [markers]", ok, 40 );
+}
+
+
+/* Seconds per callback traced, with the reader taking them on the same
+ * thread now and then. */
+static double time_trace( int64_t num_callbacks )
+{
+    CALLBACK_TRACE* trace = createCallbackTrace( CTC_TRACE_EVENTS );
+    CALLBACK_EVENT  events [ 64 ];
+    CALLBACK_EVENT  event;
+
+    if ( trace == NULL ) {
+        return 1.0;
+    }
+
+    memset( &event, 0, sizeof(event) );
+
+    double start = now_seconds();
+
+    for ( int64_t k = 0; k < num_callbacks; k++ ) {
+
+        event.sampleTime   = (double)( k * CTC_FRAMES );
+        event.hostTime     = (uint64_t)k * 21333333;
+        event.streamSample = k * CTC_FRAMES;
+        event.numFrames    = CTC_FRAMES;
+
+        traceCallback( trace, &event );
+
+        if ( k % 64 == 63 ) {
+            readCallbackTrace( trace, events, 64 );
+        }
+    }
+
+    double elapsed = now_seconds() - start;
+
+    freeCallbackTrace( trace );
+
+    return elapsed / num_callbacks;
+}
+
+
+static int check( const char* what, int ok, double value )
+{
+    printf( "%-40s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
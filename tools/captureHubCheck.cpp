@@ -0,0 +1,404 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//
+// Stress check of the broadcast ring CaptureHub.cpp.
+//
+// The samples written carry a hash of their index, so that a reader can
+// tell each sample it gets is the one at its position. First it writes and
+// reads from every position of a small ring, overrunning the reader by
+// every count up to the capacity, and checks the samples and the overruns
+// reported. Then one producer writes chunks of random sizes for a while,
+// as the capture thread does, and three readers at their own paces check
+// every sample they get, and that the samples read and lost add up to the
+// samples written. The exit status is non-zero if any check fails.
+//
+// The reader copies the samples while the producer may be overwriting
+// them, and drops the head of the copy afterwards if it was overwritten.
+// ThreadSanitizer reports this race on the samples, which is by design,
+// so run the TSan build with the suppressions in captureHubCheck.supp.
+// GCC also warns that TSan does not model the fences of CaptureHub.cpp.
+//
+//   TSAN_OPTIONS=suppressions=tools/captureHubCheck.supp ./captureHubCheck
+//
+// Build on Linux from the top directory, in one line, optionally with
+// -fsanitize=thread:
+//
+//   c++ -O2 -std=c++14 -pthread -IiOSRecorderWithVUMeter -o captureHubCheck
+//       tools/captureHubCheck.cpp iOSRecorderWithVUMeter/CaptureHub.cpp
+//
+// Usage:
+//
+//   captureHubCheck [-c capacity] [-s seconds]
+//
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+
+#include "CaptureHub.hpp"
+
+#define CHC_NUM_READERS  3
+#define CHC_MAX_CHUNK    64      // samples per read of the readers
+
+
+// Counts of a reader of the stress run.
+struct ChcReader {
+    int     cursor;
+    int     pace;                // 0: fast, 1: slow, 2: small reads
+    int64_t numRead;
+    int64_t numLost;
+    int64_t numOverruns;         // reads which lost samples
+    int64_t numWrong;            // samples not the ones at their index
+    int64_t lostByHub;           // CaptureHub::lost() at the end
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      check_positions ( int capacity );
+
+static int      check_stress    ( int capacity, double seconds );
+
+static void     run_reader      ( CaptureHub*        hub,
+                                  ChcReader*         reader,
+                                  std::atomic<bool>* done    );
+
+static int      write_from      ( CaptureHub* hub, int64_t from, int n );
+
+static int64_t  read_checked    ( CaptureHub* hub, int cursor, int max_samples,
+                                  int64_t* lost, int64_t* num_wrong          );
+
+static short    sample_at       ( int64_t index );
+
+static int      check           ( const char* what, bool ok, double value );
+
+static uint32_t next_random     ( uint32_t* state );
+
+static double   now_seconds     ();
+
+
+int main( int argc, char* argv[] )
+{
+    int    capacity  = 256;
+    double seconds   = 2.0;
+    int    numFailed = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "c:s:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'c': capacity = atoi( optarg ); break;
+          case 's': seconds  = atof( optarg ); break;
+
+          default:
+            fprintf( stderr, "usage: %s [-c capacity] [-s seconds]\n",
+                     argv[0]                                          );
+            return 1;
+        }
+    }
+
+    if ( capacity < 2 || seconds <= 0.0 ) {
+
+        fprintf( stderr, "bad capacity or seconds\n" );
+        return 1;
+    }
+
+    numFailed += check_positions( capacity );
+    numFailed += check_stress( capacity, seconds );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    return ( numFailed == 0 ) ? 0 : 2;
+}
+
+
+// From every position of the ring, the writes overrun the reader by every
+// count from 0 to the capacity. The reader then gets the latest capacity
+// samples, and the rest is reported lost.
+static int check_positions( int capacity )
+{
+    int64_t numCases = 0;
+    int64_t numBad   = 0;
+    int64_t numWrong = 0;
+
+    for ( int start = 0; start < capacity; start++ ) {
+
+        for ( int over = 0; over <= capacity; over++ ) {
+
+            CaptureHub hub( capacity, 1 );
+            int        cursor = hub.openCursor();
+            int64_t    lost   = 0;
+
+            write_from( &hub, 0, start );
+            read_checked( &hub, cursor, capacity, &lost, &numWrong );
+
+            // Two writes, as one must not exceed the capacity.
+            write_from( &hub, start, capacity );
+            write_from( &hub, start + capacity, over );
+
+            int64_t n = read_checked( &hub, cursor, capacity, &lost,
+                                      &numWrong                      );
+
+            if (    n != capacity || lost != over
+                 || hub.lost( cursor ) != over
+                 || hub.lag( cursor )  != 0
+                 || read_checked( &hub, cursor, capacity, &lost,
+                                  &numWrong                      ) != 0 ) {
+                numBad++;
+            }
+
+            numCases++;
+        }
+    }
+
+    int failed = 0;
+
+    failed |= check( "positions x overruns", numBad == 0, (double)numCases );
+    failed |= check( "positions, wrong samples", numWrong == 0,
+                     (double)numWrong                          );
+    return failed;
+}
+
+
+// One producer and three readers: one reading as fast as it can, one
+// sleeping between the reads so that it is overrun, and one reading a few
+// samples at a time.
+static int check_stress( int capacity, double seconds )
+{
+    CaptureHub        hub( capacity, CHC_NUM_READERS );
+    ChcReader         readers [ CHC_NUM_READERS ];
+    std::thread       threads [ CHC_NUM_READERS ];
+    std::atomic<bool> done( false );
+
+    for ( int i = 0; i < CHC_NUM_READERS; i++ ) {
+
+        readers[i]        = ChcReader();
+        readers[i].cursor = hub.openCursor();
+        readers[i].pace   = i;
+        threads[i]        = std::thread( run_reader, &hub, &readers[i],
+                                         &done                         );
+    }
+
+    uint32_t state   = 12345;
+    int64_t  written = 0;
+    double   end     = now_seconds() + seconds;
+
+    while ( now_seconds() < end ) {
+
+        int n = (int)( next_random( &state ) % ( capacity + 1 ) );
+
+        write_from( &hub, written, n );
+        written += n;
+
+        if ( next_random( &state ) % 16 == 0 ) {
+            std::this_thread::yield();
+        }
+    }
+
+    done.store( true );
+
+    int failed = 0;
+
+    for ( int i = 0; i < CHC_NUM_READERS; i++ ) {
+
+        static const char* names[] = { "fast", "slow", "small" };
+
+        char       what [ 64 ];
+        ChcReader& r = readers[i];
+
+        threads[i].join();
+
+        snprintf( what, sizeof(what), "%s reader, wrong samples", names[i] );
+        failed |= check( what, r.numWrong == 0, (double)r.numWrong );
+
+        snprintf( what, sizeof(what), "%s reader, read + lost", names[i] );
+        failed |= check( what,
+                            r.numRead + r.numLost == written
+                         && r.lostByHub == r.numLost,
+                         (double)( r.numRead + r.numLost ) );
+
+        snprintf( what, sizeof(what), "%s reader, overruns", names[i] );
+        failed |= check( what, r.pace != 1 || r.numOverruns > 0,
+                         (double)r.numOverruns                   );
+    }
+
+    printf( "%.0f samples written in %.1f seconds\n",
+            (double)written, seconds                  );
+
+    return failed;
+}
+
+
+// Reads until the producer is done and the cursor has caught up.
+static void run_reader(
+    CaptureHub*        hub,
+    ChcReader*         reader,
+    std::atomic<bool>* done
+) {
+    uint32_t state = 777 + reader->pace;
+
+    while ( true ) {
+
+        bool    last = done->load();
+        int     max  = ( reader->pace == 2 )
+                       ? 1 + (int)( next_random( &state ) % 8 )
+                       : CHC_MAX_CHUNK;
+        int64_t lost = 0;
+        int64_t n    = read_checked( hub, reader->cursor, max, &lost,
+                                     &reader->numWrong                );
+
+        reader->numRead     += n;
+        reader->numLost     += lost;
+        reader->numOverruns += ( lost > 0 );
+
+        if ( last && hub->lag( reader->cursor ) == 0 ) {
+            break;
+        }
+
+        if ( reader->pace == 1 ) {
+
+            struct timespec ts = { 0, 1000000 };
+
+            nanosleep( &ts, NULL );
+        }
+        else if ( n == 0 ) {
+
+            std::this_thread::yield();
+        }
+    }
+
+    reader->lostByHub = hub->lost( reader->cursor );
+}
+
+
+static int write_from( CaptureHub* hub, int64_t from, int n )
+{
+    short* samples = (short*) malloc( sizeof(short) * ( n + 1 ) );
+
+    if ( samples == NULL ) {
+        return CaptureHub::ERR_MEMORY;
+    }
+
+    for ( int i = 0; i < n; i++ ) {
+        samples[i] = sample_at( from + i );
+    }
+
+    int rtnVal = hub->write( samples, n );
+
+    free( samples );
+
+    return rtnVal;
+}
+
+
+// Reads through the cursor, and counts the samples which are not the ones
+// at their index.
+static int64_t read_checked(
+    CaptureHub* hub,
+    int         cursor,
+    int         maxSamples,
+    int64_t*    lost,
+    int64_t*    numWrong
+) {
+    short*  samples = (short*) malloc( sizeof(short) * maxSamples );
+    int64_t from    = hub->position( cursor );
+    int     n       = ( samples != NULL )
+                      ? hub->read( cursor, samples, maxSamples, lost )
+                      : CaptureHub::ERR_MEMORY;
+
+    if ( n < 0 ) {
+
+        free( samples );
+        ( *numWrong )++;
+        return 0;
+    }
+
+    from += *lost;
+
+    for ( int i = 0; i < n; i++ ) {
+
+        if ( samples[i] != sample_at( from + i ) ) {
+            ( *numWrong )++;
+        }
+    }
+
+    if ( hub->position( cursor ) != from + n ) {
+        ( *numWrong )++;
+    }
+
+    free( samples );
+
+    return n;
+}
+
+
+// A hash of the index, so that a sample of another lap of the ring does not
+// pass for the one expected.
+static short sample_at( int64_t index )
+{
+    uint64_t x = (uint64_t)index * 0x9E3779B97F4A7C15ULL;
+
+    return (short)( x >> 48 );
+}
+
+
+static int check( const char* what, bool ok, double value )
+{
+    printf( "%-36s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+
+    return x;
+}
+
+
+static double now_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
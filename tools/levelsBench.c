@@ -0,0 +1,386 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Benchmark and correctness check of the metering kernel levelsOfSamples().
+ *
+ * It checks the kernel against a plain reference on blocks of every size
+ * up to 4096 and at random offsets, with full-scale, clipped and random
+ * samples, and levelsOfChannels() on the same blocks interleaved as 2 to
+ * SMM_MAX_CHANNELS + 2 channels. Then it times the kernel against the former metering, which
+ * converted the samples to float and made two more passes over them, on
+ * blocks of a typical and an unusual size.
+ * The exit status is non-zero if the kernel disagrees with the reference.
+ *
+ * Build on Linux from the top directory, with -mavx2 for the AVX2 path:
+ *
+ *   cc -O2 [-mavx2] -IiOSRecorderWithVUMeter -o levelsBench \
+ *      tools/levelsBench.c iOSRecorderWithVUMeter/sampleMinMax.c -lm
+ *
+ * Usage:
+ *
+ *   levelsBench [-s seconds of samples per block size]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sampleMinMax.h"
+
+#define LB_MAX_CHECK_SIZE  4096
+#define LB_NUM_RANDOM      20000
+#define LB_RATE            48000
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static void     reference_levels (
+                    const short*   samples,
+                    int            num_samples,
+                    SAMPLE_LEVELS* levels       );
+
+static void     float_levels (
+                    const short* samples,
+                    int          num_samples,
+                    float*       buffer,
+                    float*       rms,
+                    float*       abs_max      );
+
+static int      check_block (
+                    const short* samples,
+                    int          num_samples );
+
+static int      check_channels (
+                    const short* samples,
+                    int          num_frames,
+                    int          num_channels );
+
+static uint32_t next_random ( uint32_t* state );
+
+static double   now_seconds ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    double seconds   = 600.0;
+    int    numFailed = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "s:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 's': seconds = atof( optarg ); break;
+
+          default:
+            fprintf( stderr, "usage: %s [-s seconds]\n", argv[0] );
+            return 1;
+        }
+    }
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    printf( "kernel: NEON\n" );
+#elif defined(__AVX2__)
+    printf( "kernel: AVX2\n" );
+#elif defined(__SSE2__)
+    printf( "kernel: SSE2\n" );
+#else
+    printf( "kernel: scalar\n" );
+#endif
+
+    int64_t  numSamples = (int64_t)( seconds * LB_RATE );
+    short*   samples    = (short*)malloc( sizeof(short) * numSamples );
+    float*   buffer     = (float*)malloc( sizeof(float) * numSamples );
+    uint32_t state      = 12345;
+
+    if ( numSamples < 2 * LB_MAX_CHECK_SIZE ) {
+
+        fprintf( stderr, "too few seconds\n" );
+        return 1;
+    }
+
+    if ( samples == NULL || buffer == NULL ) {
+
+        fprintf( stderr, "out of memory\n" );
+        return 1;
+    }
+
+    /* Correctness: every size at offset 0 and 1, on the extremes. */
+    for ( int i = 0; i < LB_MAX_CHECK_SIZE + 1; i++ ) {
+        samples[i] = ( i % 3 == 0 ) ? -32768 : ( i % 3 == 1 ) ? 32767 : -32767;
+    }
+
+    for ( int n = 0; n <= LB_MAX_CHECK_SIZE; n++ ) {
+
+        numFailed += check_block( samples,     n );
+        numFailed += check_block( samples + 1, n );
+    }
+
+    for ( int c = 2; c <= SMM_MAX_CHANNELS + 2; c++ ) {
+
+        for ( int n = 0; n <= LB_MAX_CHECK_SIZE / c; n++ ) {
+
+            numFailed += check_channels( samples,     n, c );
+            numFailed += check_channels( samples + 1, n, c );
+        }
+    }
+
+    /* Correctness: random blocks of random samples. */
+    for ( int64_t i = 0; i < numSamples; i++ ) {
+
+        uint32_t r = next_random( &state );
+
+        samples[i] = ( r % 97 == 0 ) ? ( ( r & 0x100 ) ? 32767 : -32768 )
+                                     : (short)( r >> 16 );
+    }
+
+    for ( int i = 0; i < LB_NUM_RANDOM; i++ ) {
+
+        int n      = next_random( &state ) % ( LB_MAX_CHECK_SIZE + 1 );
+        int offset = next_random( &state ) % ( numSamples - n );
+
+        numFailed += check_block( samples + offset, n );
+
+        int c = 2 + next_random( &state ) % ( SMM_MAX_CHANNELS + 1 );
+
+        numFailed += check_channels( samples + offset, n / c, c );
+    }
+
+    /* One block of all the samples, to exercise the clip counter flush. */
+    numFailed += check_block( samples, (int)numSamples );
+
+    for ( int c = 2; c <= SMM_MAX_CHANNELS; c++ ) {
+        numFailed += check_channels( samples, (int)( numSamples / c ), c );
+    }
+
+    printf( "correctness: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    /* Throughput on the blocks of the typical and unusual sizes. */
+    static const int blockSizes[] = { 1024, 4096, 1000, 4133 };
+
+    printf( "%8s %16s %16s %8s\n",
+            "block", "float [MB/s]", "kernel [MB/s]", "speedup" );
+
+    for ( size_t k = 0; k < sizeof(blockSizes) / sizeof(int); k++ ) {
+
+        int     blockSize = blockSizes[k];
+        int64_t numBlocks = numSamples / blockSize;
+        double  megabytes = numBlocks * blockSize * sizeof(short) / 1.0e6;
+        double  checksum  = 0.0;
+
+        double  start     = now_seconds();
+
+        for ( int64_t b = 0; b < numBlocks; b++ ) {
+
+            float rms;
+            float absMax;
+
+            float_levels( samples + b * blockSize, blockSize,
+                          buffer, &rms, &absMax                 );
+            checksum += rms + absMax;
+        }
+
+        double floatSeconds = now_seconds() - start;
+
+        start = now_seconds();
+
+        for ( int64_t b = 0; b < numBlocks; b++ ) {
+
+            SAMPLE_LEVELS levels;
+
+            levelsOfSamples( samples + b * blockSize, blockSize, &levels );
+            checksum += sqrt( (double)levels.sumOfSquares / blockSize )
+                        + levels.absPeak;
+        }
+
+        double kernelSeconds = now_seconds() - start;
+
+        printf( "%8d %16.0f %16.0f %7.1fx  (%g)\n",
+                blockSize,
+                megabytes / floatSeconds,
+                megabytes / kernelSeconds,
+                floatSeconds / kernelSeconds,
+                checksum                       );
+    }
+
+    free( samples );
+    free( buffer );
+
+    return ( numFailed == 0 ) ? 0 : 2;
+}
+
+
+static void reference_levels(
+    const short*   samples,
+    int            numSamples,
+    SAMPLE_LEVELS* levels
+) {
+    levels->sumOfSquares = 0;
+    levels->absPeak      = 0;
+    levels->numClipped   = 0;
+
+    for ( int i = 0; i < numSamples; i++ ) {
+
+        int64_t v = samples[i];
+
+        levels->sumOfSquares += (uint64_t)( v * v );
+
+        if ( llabs( v ) > levels->absPeak ) {
+            levels->absPeak = (int)llabs( v );
+        }
+
+        if ( llabs( v ) >= 32767 ) {
+            levels->numClipped++;
+        }
+    }
+}
+
+
+/** @brief the former metering: convert, then RMS and peak as vDSP_rmsqv()
+ *         and vDSP_maxmgv() do.
+ */
+static void float_levels(
+    const short* samples,
+    int          numSamples,
+    float*       buffer,
+    float*       rms,
+    float*       absMax
+) {
+    for ( int i = 0; i < numSamples; i++ ) {
+        buffer[i] = (float)( samples[i] );
+    }
+
+    float sum = 0.0f;
+
+    for ( int i = 0; i < numSamples; i++ ) {
+        sum += buffer[i] * buffer[i];
+    }
+
+    float max = 0.0f;
+
+    for ( int i = 0; i < numSamples; i++ ) {
+        max = ( fabsf( buffer[i] ) > max ) ? fabsf( buffer[i] ) : max;
+    }
+
+    *rms    = sqrtf( sum / numSamples );
+    *absMax = max;
+}
+
+
+static int check_block( const short* samples, int numSamples )
+{
+    SAMPLE_LEVELS expected;
+    SAMPLE_LEVELS actual;
+
+    reference_levels( samples, numSamples, &expected );
+    levelsOfSamples ( samples, numSamples, &actual   );
+
+    if (    expected.sumOfSquares == actual.sumOfSquares
+         && expected.absPeak      == actual.absPeak
+         && expected.numClipped   == actual.numClipped   ) {
+        return 0;
+    }
+
+    fprintf( stderr,
+             "mismatch at %d samples: sum %llu/%llu peak %d/%d clip %d/%d\n",
+             numSamples,
+             (unsigned long long)expected.sumOfSquares,
+             (unsigned long long)actual.sumOfSquares,
+             expected.absPeak, actual.absPeak,
+             expected.numClipped, actual.numClipped                          );
+    return 1;
+}
+
+
+/** @brief check levelsOfChannels() against the reference on each channel
+ *         taken out of the interleaved samples.
+ */
+static int check_channels(
+    const short* samples,
+    int          numFrames,
+    int          numChannels
+) {
+    SAMPLE_LEVELS actual [ SMM_MAX_CHANNELS + 2 ];
+    short*        channel = (short*)malloc( sizeof(short) * ( numFrames + 1 ) );
+    int           failed  = 0;
+
+    if ( channel == NULL ) {
+        return 1;
+    }
+
+    levelsOfChannels( samples, numFrames, numChannels, actual );
+
+    for ( int c = 0; c < numChannels; c++ ) {
+
+        SAMPLE_LEVELS expected;
+
+        for ( int i = 0; i < numFrames; i++ ) {
+            channel[i] = samples[ i * numChannels + c ];
+        }
+
+        reference_levels( channel, numFrames, &expected );
+
+        if (    expected.sumOfSquares != actual[c].sumOfSquares
+             || expected.absPeak      != actual[c].absPeak
+             || expected.numClipped   != actual[c].numClipped   ) {
+
+            fprintf( stderr,
+                     "mismatch at %d frames of %d channels on channel %d\n",
+                     numFrames, numChannels, c                             );
+            failed = 1;
+        }
+    }
+
+    free( channel );
+
+    return failed;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,476 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Checks and benchmark of the live waveform liveWaveform.c.
+ *
+ * It feeds pseudo-random samples in blocks of pseudo-random sizes, as they
+ * come from the capture, and checks every column read against the minimum
+ * and the maximum of its frames found directly, for several channels and
+ * column widths. It checks that a reader fallen behind gets the latest
+ * columns, and reads from another thread while the samples are fed in
+ * paced blocks, checking every column it gets and that it gets them all
+ * but those overwritten before it could read them. Then it times the feed over a
+ * short and a long recording, whose cost per second of audio must be the
+ * same.
+ * The exit status is non-zero if any check fails.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -IiOSRecorderWithVUMeter -o liveWaveformCheck \
+ *      tools/liveWaveformCheck.c iOSRecorderWithVUMeter/liveWaveform.c \
+ *      iOSRecorderWithVUMeter/sampleMinMax.c -lpthread
+ *
+ * Usage:
+ *
+ *   liveWaveformCheck [-s seconds of the long recording to time]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "liveWaveform.h"
+
+#define LWC_RATE          48000
+#define LWC_MAX_BLOCK     4096          /* frames */
+#define LWC_TIME_BLOCK    1024          /* frames, as the meter reader */
+#define LWC_TIME_COLUMN   256           /* frames */
+#define LWC_PACE_NSEC     20000         /* between the fed blocks */
+#define LWC_SHORT_SECONDS 60.0
+
+
+/* Samples fed from one thread, and checked from another. */
+typedef struct lwc_stream {
+
+    LIVE_WAVEFORM* waveform;
+    const short*   samples;
+    int64_t        numFrames;
+    int            numChannels;
+    atomic_int     done;
+
+} LWC_STREAM;
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      check_columns     ( int num_channels, int frames_per_column );
+
+static int      check_behind      ( void );
+
+static int      check_concurrent  ( void );
+
+static void*    feed_thread       ( void* arg );
+
+static int      match_columns     ( const short* samples,
+                                    int          num_channels,
+                                    int          frames_per_column,
+                                    int64_t      first,
+                                    int          num_columns,
+                                    const short* mins,
+                                    const short* maxs              );
+
+static double   time_feed         ( const short* samples, double seconds );
+
+static short*   make_samples      ( int64_t num_samples, uint32_t seed );
+
+static int      check             ( const char* what, int ok, double value );
+
+static uint32_t next_random       ( uint32_t* state );
+
+static double   now_seconds       ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    double seconds   = 3600.0;
+    int    numFailed = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "s:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 's': seconds = atof( optarg ); break;
+
+          default:
+            fprintf( stderr, "usage: %s [-s seconds]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    static const int channels[] = { 1, 2, 6 };
+    static const int widths  [] = { 1, 7, 480 };
+
+    for ( int c = 0; c < 3; c++ ) {
+        for ( int w = 0; w < 3; w++ ) {
+            numFailed += check_columns( channels[c], widths[w] );
+        }
+    }
+
+    numFailed += check_behind();
+    numFailed += check_concurrent();
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    /* The same second of stereo over and over. */
+    short* samples = make_samples( 2 * LWC_RATE, 7 );
+
+    if ( samples == NULL ) {
+        return 1;
+    }
+
+    double shortCost = time_feed( samples, LWC_SHORT_SECONDS );
+    double longCost  = time_feed( samples, seconds );
+
+    printf( "feed of %.0f seconds: %.2f ns per frame, "
+            "%.0f times real time\n",
+            LWC_SHORT_SECONDS, shortCost * 1.0e9,
+            1.0 / ( shortCost * LWC_RATE )        );
+
+    printf( "feed of %.0f seconds: %.2f ns per frame, "
+            "%.0f times real time\n",
+            seconds, longCost * 1.0e9,
+            1.0 / ( longCost * LWC_RATE ) );
+
+    /* Generous for the noise of the timing, and far from any growth. */
+    numFailed += check( "cost long / short recording",
+                        longCost < shortCost * 1.5, longCost / shortCost );
+
+    free( samples );
+
+    return ( numFailed == 0 ) ? 0 : 1;
+}
+
+
+static int check_columns( int num_channels, int frames_per_column )
+{
+    int64_t  numFrames  = LWC_RATE * 3;
+    int64_t  numColumns = numFrames / frames_per_column;
+    short*   samples    = make_samples( numFrames * num_channels, 1 );
+    short*   mins       = (short*) malloc( sizeof(short) * numColumns );
+    short*   maxs       = (short*) malloc( sizeof(short) * numColumns );
+    uint32_t state      = 3;
+    int      numFailed  = 0;
+
+    LIVE_WAVEFORM* waveform =
+        createLiveWaveform( frames_per_column, num_channels, (int)numColumns );
+
+    if ( samples == NULL || mins == NULL || maxs == NULL || waveform == NULL ) {
+        return 1;
+    }
+
+    int64_t fed  = 0;
+    int64_t next = 0;
+    int     read = 0;
+
+    /* Read now and then, as a view would. */
+    while ( fed < numFrames ) {
+
+        int block = 1 + next_random( &state ) % LWC_MAX_BLOCK;
+
+        block = ( block < numFrames - fed ) ? block : (int)( numFrames - fed );
+
+        feedLiveWaveform( waveform, &samples[ fed * num_channels ], block );
+
+        fed += block;
+
+        if ( next_random( &state ) % 4 == 0 ) {
+            read += readLiveWaveform( waveform, &next, (int)numColumns - read,
+                                      &mins[read], &maxs[read]             );
+        }
+    }
+
+    read += readLiveWaveform( waveform, &next, (int)numColumns - read,
+                              &mins[read], &maxs[read]             );
+
+    char what[ 64 ];
+
+    snprintf( what, sizeof(what), "%d ch %d frames per column [columns]",
+              num_channels, frames_per_column                             );
+
+    numFailed += check( what,
+                        read == numColumns
+                        && match_columns( samples, num_channels,
+                                          frames_per_column, 0, read,
+                                          mins, maxs                  ),
+                        read                                             );
+
+    freeLiveWaveform( waveform );
+    free( samples );
+    free( mins );
+    free( maxs );
+
+    return numFailed;
+}
+
+
+/* A reader 1000 columns behind a ring of 64 gets the latest 64 columns,
+ * none of them being written. */
+static int check_behind( void )
+{
+    short* samples = make_samples( 1000 * 10, 2 );
+    short  mins [ 64 ];
+    short  maxs [ 64 ];
+
+    LIVE_WAVEFORM* waveform = createLiveWaveform( 10, 1, 64 );
+
+    if ( samples == NULL || waveform == NULL ) {
+        return 1;
+    }
+
+    feedLiveWaveform( waveform, samples, 1000 * 10 );
+
+    int64_t next = 0;
+    int     read = readLiveWaveform( waveform, &next, 64, mins, maxs );
+
+    int ok =    read == 64 && next == 1000
+             && match_columns( samples, 1, 10, 1000 - read, read, mins, maxs );
+
+    freeLiveWaveform( waveform );
+    free( samples );
+
+    return check( "reader behind [columns]", ok, read );
+}
+
+
+static int check_concurrent( void )
+{
+    int64_t numFrames = LWC_RATE * 60;
+    short*  samples   = make_samples( numFrames * 2, 5 );
+    short   mins [ 128 ];
+    short   maxs [ 128 ];
+
+    LWC_STREAM stream;
+
+    stream.waveform    = createLiveWaveform( 16, 2, 256 );
+    stream.samples     = samples;
+    stream.numFrames   = numFrames;
+    stream.numChannels = 2;
+
+    atomic_init( &(stream.done), 0 );
+
+    if ( samples == NULL || stream.waveform == NULL ) {
+        return 1;
+    }
+
+    pthread_t thread;
+
+    if ( pthread_create( &thread, NULL, feed_thread, &stream ) != 0 ) {
+        return 1;
+    }
+
+    int64_t next     = 0;
+    int64_t checked  = 0;
+    int64_t skipped  = 0;
+    int     matched  = 1;
+
+    for (;;) {
+
+        /* Read to the end after the feed has finished. */
+        int     finished = atomic_load( &(stream.done) );
+        int64_t from     = next;
+        int     read     = readLiveWaveform( stream.waveform, &next, 128,
+                                             mins, maxs                 );
+
+        skipped += next - read - from;
+        checked += read;
+        matched  = matched && match_columns( samples, 2, 16, next - read,
+                                             read, mins, maxs            );
+
+        if ( finished && read == 0 ) {
+            break;
+        }
+    }
+
+    pthread_join( thread, NULL );
+
+    printf( "concurrent read: %lld columns checked, %lld skipped\n",
+            (long long)checked, (long long)skipped                  );
+
+    int ok = matched && checked + skipped == numFrames / 16 && checked > 0;
+
+    freeLiveWaveform( stream.waveform );
+    free( samples );
+
+    return check( "concurrent read [columns]", ok, (double)checked );
+}
+
+
+static void* feed_thread( void* arg )
+{
+    LWC_STREAM* stream = (LWC_STREAM*) arg;
+    uint32_t    state  = 11;
+    int64_t     fed    = 0;
+
+    struct timespec pace = { 0, LWC_PACE_NSEC };
+
+    while ( fed < stream->numFrames ) {
+
+        int block = 1 + next_random( &state ) % LWC_MAX_BLOCK;
+
+        block = ( block < stream->numFrames - fed )
+                ? block : (int)( stream->numFrames - fed );
+
+        feedLiveWaveform( stream->waveform,
+                          &(stream->samples[ fed * stream->numChannels ]),
+                          block                                          );
+        fed += block;
+
+        /* Paced, so that the reads interleave with the feed all along. */
+        nanosleep( &pace, NULL );
+    }
+
+    atomic_store( &(stream->done), 1 );
+
+    return NULL;
+}
+
+
+/* The columns from first found directly from the samples. */
+static int match_columns(
+    const short* samples,
+    int          num_channels,
+    int          frames_per_column,
+    int64_t      first,
+    int          num_columns,
+    const short* mins,
+    const short* maxs
+) {
+    int span = frames_per_column * num_channels;
+
+    for ( int i = 0; i < num_columns; i++ ) {
+
+        const short* s      = &samples[ ( first + i ) * span ];
+        short        minVal = s[0];
+        short        maxVal = s[0];
+
+        for ( int j = 1; j < span; j++ ) {
+            minVal = ( s[j] < minVal ) ? s[j] : minVal;
+            maxVal = ( s[j] > maxVal ) ? s[j] : maxVal;
+        }
+
+        if ( mins[i] != minVal || maxs[i] != maxVal ) {
+
+            fprintf( stderr, "column %lld: %d %d, expected %d %d\n",
+                     (long long)( first + i ), mins[i], maxs[i],
+                     minVal, maxVal                              );
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/* Seconds of the feed per frame, of the stereo samples fed in the blocks
+ * of the meter reader for the seconds of audio, with the columns read
+ * as a view at 60Hz would. */
+static double time_feed( const short* samples, double seconds )
+{
+    LIVE_WAVEFORM* waveform = createLiveWaveform( LWC_TIME_COLUMN, 2, 2048 );
+    short          mins [ 2048 ];
+    short          maxs [ 2048 ];
+    int64_t        next      = 0;
+    int64_t        numBlocks = (int64_t)( seconds * LWC_RATE / LWC_TIME_BLOCK );
+    int            perRead   = LWC_RATE / LWC_TIME_BLOCK / 60 + 1;
+
+    if ( waveform == NULL ) {
+        return 1.0;
+    }
+
+    double start = now_seconds();
+
+    for ( int64_t b = 0; b < numBlocks; b++ ) {
+
+        int offset = (int)( ( b * LWC_TIME_BLOCK )
+                            % ( LWC_RATE - LWC_TIME_BLOCK ) );
+
+        feedLiveWaveform( waveform, &samples[ offset * 2 ], LWC_TIME_BLOCK );
+
+        if ( b % perRead == 0 ) {
+            readLiveWaveform( waveform, &next, 2048, mins, maxs );
+        }
+    }
+
+    double elapsed = now_seconds() - start;
+
+    freeLiveWaveform( waveform );
+
+    return elapsed / ( (double)numBlocks * LWC_TIME_BLOCK );
+}
+
+
+static short* make_samples( int64_t num_samples, uint32_t seed )
+{
+    short*   samples = (short*) malloc( sizeof(short) * num_samples );
+    uint32_t state   = seed;
+
+    if ( samples == NULL ) {
+        return NULL;
+    }
+
+    for ( int64_t i = 0; i < num_samples; i++ ) {
+        samples[i] = (short)( next_random( &state ) >> 16 );
+    }
+
+    return samples;
+}
+
+
+static int check( const char* what, int ok, double value )
+{
+    printf( "%-40s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
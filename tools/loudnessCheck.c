@@ -0,0 +1,423 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Conformance check and benchmark of the loudness meter loudnessMeter.c.
+ *
+ * It synthesizes the test signals of EBU Tech 3341 whose results are
+ * given by the signals alone, i.e., 1kHz sines at known levels, and the
+ * steps of them for the gating, and checks the momentary, the short-term
+ * and the integrated loudness against the expected values within the
+ * tolerance of the standard, +/-0.1 LU. The signals are fed in blocks of
+ * pseudo-random sizes, as they come from the capture. The true peak is
+ * checked on sines whose peaks fall between the samples, within +0.2 and
+ * -0.4 dB. Then it times the meter on blocks of a typical size, in
+ * multiples of real time.
+ * The exit status is non-zero if any check fails.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -IiOSRecorderWithVUMeter -o loudnessCheck \
+ *      tools/loudnessCheck.c iOSRecorderWithVUMeter/loudnessMeter.c -lm
+ *
+ * Usage:
+ *
+ *   loudnessCheck [-s seconds to time]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "loudnessMeter.h"
+
+#define LC_MAX_SEGMENTS   5
+#define LC_MAX_CHANNELS   6
+#define LC_MAX_BLOCK      4096
+#define LC_TOLERANCE_LU   0.1
+#define LC_TP_OVER_DB     0.2
+#define LC_TP_UNDER_DB    0.4
+#define LC_NONE           999.0   /* not checked */
+#define LC_WEIGHTED       888.0   /* from the levels and the weights */
+
+
+/* Steps of a sine at the levels in dBFS of each channel. */
+typedef struct lc_segment {
+
+    double seconds;
+    double levels [ LC_MAX_CHANNELS ];
+
+} LC_SEGMENT;
+
+
+typedef struct lc_case {
+
+    const char* name;
+    int         sampleRate;
+    int         numChannels;
+    double      frequency;      /* [Hz] */
+    double      phase;          /* [rad] */
+    int         numSegments;
+    LC_SEGMENT  segments [ LC_MAX_SEGMENTS ];
+    double      momentary;      /* expected at the end [LUFS] */
+    double      shortTerm;      /* expected at the end [LUFS] */
+    double      integrated;     /* expected [LUFS] */
+    double      truePeak;       /* expected [dBTP] */
+
+} LC_CASE;
+
+
+static const LC_CASE Cases[] = {
+
+    /* Tech 3341 cases 1 and 2: stereo sines, M, S and I. */
+    { "3341-1 stereo -23dBFS", 48000, 2, 1000.0, 0.0,
+      1, { { 20.0, { -23.0, -23.0 } } },
+      -23.0, -23.0, -23.0, LC_NONE },
+
+    { "3341-2 stereo -33dBFS", 48000, 2, 1000.0, 0.0,
+      1, { { 20.0, { -33.0, -33.0 } } },
+      -33.0, -33.0, -33.0, LC_NONE },
+
+    /* Cases 3 to 5: the absolute and the relative gates. */
+    { "3341-3 gating", 48000, 2, 1000.0, 0.0,
+      3, { { 10.0, { -36.0, -36.0 } },
+           { 60.0, { -23.0, -23.0 } },
+           { 10.0, { -36.0, -36.0 } } },
+      LC_NONE, LC_NONE, -23.0, LC_NONE },
+
+    { "3341-4 gating", 48000, 2, 1000.0, 0.0,
+      5, { { 10.0, { -72.0, -72.0 } },
+           { 10.0, { -36.0, -36.0 } },
+           { 60.0, { -23.0, -23.0 } },
+           { 10.0, { -36.0, -36.0 } },
+           { 10.0, { -72.0, -72.0 } } },
+      LC_NONE, LC_NONE, -23.0, LC_NONE },
+
+    { "3341-5 gating", 48000, 2, 1000.0, 0.0,
+      3, { { 20.0, { -26.0, -26.0 } },
+           { 20.1, { -20.0, -20.0 } },
+           { 20.0, { -26.0, -26.0 } } },
+      LC_NONE, LC_NONE, -23.0, LC_NONE },
+
+    /* The filters derived for another rate. */
+    { "stereo -23dBFS at 44.1kHz", 44100, 2, 1000.0, 0.0,
+      1, { { 20.0, { -23.0, -23.0 } } },
+      -23.0, -23.0, -23.0, LC_NONE },
+
+    /* 5.1 with the surround channels weighted by 1.41, and a loud LFE
+       which must be ignored. */
+    { "5.1 weights", 48000, 6, 1000.0, 0.0,
+      1, { { 20.0, { -26.0, -26.0, -26.0, -1.0, -27.5, -27.5 } } },
+      LC_WEIGHTED, LC_WEIGHTED, LC_WEIGHTED, LC_NONE },
+
+    /* True peak: the peaks of a sine at fs/4 with a phase of 45 degrees
+       fall half way between the samples, 3dB above them. */
+    { "true peak fs/4 45deg", 48000, 1, 12000.0, M_PI / 4.0,
+      1, { { 1.0, { -6.0 } } },
+      LC_NONE, LC_NONE, LC_NONE, -6.0 },
+
+    { "true peak 1kHz", 48000, 2, 1000.0, 0.0,
+      1, { { 1.0, { -1.0, -1.0 } } },
+      LC_NONE, LC_NONE, LC_NONE, -1.0 },
+
+    { "true peak 19.2kHz", 48000, 1, 19200.0, 0.3,
+      1, { { 1.0, { -3.0 } } },
+      LC_NONE, LC_NONE, LC_NONE, -3.0 },
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static short*   synthesize (
+                    const LC_CASE* test,
+                    int64_t*       num_frames );
+
+static int      run_case ( const LC_CASE* test, uint32_t* state );
+
+static int      check_value (
+                    const char* name,
+                    const char* what,
+                    double      expected,
+                    double      actual,
+                    double      over,
+                    double      under     );
+
+static double   expected_weighted_sine (
+                    const double* levels,
+                    int           num_channels );
+
+static uint32_t next_random ( uint32_t* state );
+
+static double   now_seconds ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    double   seconds   = 600.0;
+    int      numFailed = 0;
+    uint32_t state     = 12345;
+    int      opt;
+
+    while ( ( opt = getopt( argc, argv, "s:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 's': seconds = atof( optarg ); break;
+
+          default:
+            fprintf( stderr, "usage: %s [-s seconds]\n", argv[0] );
+            return 1;
+        }
+    }
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    printf( "filters: NEON\n" );
+#elif defined(__SSE2__)
+    printf( "filters: SSE2\n" );
+#else
+    printf( "filters: scalar\n" );
+#endif
+
+    for ( size_t k = 0; k < sizeof(Cases) / sizeof(LC_CASE); k++ ) {
+        numFailed += run_case( &(Cases[k]), &state );
+    }
+
+    printf( "conformance: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    /* Throughput on stereo blocks of 1024 frames at 48kHz. */
+    LC_CASE timing = Cases[0];
+
+    timing.segments[0].seconds = seconds;
+
+    int64_t         numFrames;
+    short*          samples = synthesize( &timing, &numFrames );
+    LOUDNESS_METER* meter   = createLoudnessMeter( 48000, 2 );
+    LOUDNESS_LEVELS levels;
+
+    if ( samples == NULL || meter == NULL ) {
+
+        fprintf( stderr, "out of memory\n" );
+        return 1;
+    }
+
+    double start = now_seconds();
+
+    for ( int64_t i = 0; i + 1024 <= numFrames; i += 1024 ) {
+
+        feedLoudnessMeter( meter, &(samples[ i * 2 ]), 1024 );
+        loudnessLevels( meter, &levels );
+    }
+
+    double elapsed = now_seconds() - start;
+
+    printf( "%.0f seconds of stereo at 48kHz in %.3f seconds, %.0fx real time"
+            " (%.2f LUFS)\n",
+            seconds, elapsed, seconds / elapsed, levels.integrated          );
+
+    freeLoudnessMeter( meter );
+    free( samples );
+
+    return ( numFailed == 0 ) ? 0 : 2;
+}
+
+
+/** @brief the sine steps of the case, interleaved. */
+static short* synthesize( const LC_CASE* test, int64_t* numFrames )
+{
+    int64_t total = 0;
+
+    for ( int s = 0; s < test->numSegments; s++ ) {
+        total += (int64_t)( test->segments[s].seconds * test->sampleRate
+                            + 0.5                                      );
+    }
+
+    short* samples = (short*)malloc( sizeof(short) * total
+                                     * test->numChannels   );
+    if ( samples == NULL ) {
+        return NULL;
+    }
+
+    int64_t n = 0;
+
+    for ( int s = 0; s < test->numSegments; s++ ) {
+
+        const LC_SEGMENT* seg = &(test->segments[s]);
+        int64_t           len = (int64_t)( seg->seconds * test->sampleRate
+                                           + 0.5                          );
+
+        for ( int64_t i = 0; i < len; i++, n++ ) {
+
+            double v = sin( 2.0 * M_PI * test->frequency * n
+                            / test->sampleRate + test->phase );
+
+            for ( int c = 0; c < test->numChannels; c++ ) {
+
+                double a = 32768.0 * pow( 10.0, seg->levels[c] / 20.0 );
+
+                samples[ n * test->numChannels + c ] =
+                                              (short)lrint( a * v );
+            }
+        }
+    }
+
+    *numFrames = total;
+
+    return samples;
+}
+
+
+/** @brief feed the signal of the case in blocks of random sizes, and
+ *         check the levels at the end.
+ */
+static int run_case( const LC_CASE* test, uint32_t* state )
+{
+    int64_t         numFrames;
+    short*          samples = synthesize( test, &numFrames );
+    LOUDNESS_METER* meter   = createLoudnessMeter( test->sampleRate,
+                                                   test->numChannels );
+    LOUDNESS_LEVELS levels;
+    int             failed  = 0;
+
+    if ( samples == NULL || meter == NULL ) {
+
+        fprintf( stderr, "%s: out of memory\n", test->name );
+        free( samples );
+        freeLoudnessMeter( meter );
+        return 1;
+    }
+
+    for ( int64_t i = 0; i < numFrames; ) {
+
+        int n = 1 + next_random( state ) % LC_MAX_BLOCK;
+
+        n = ( n < numFrames - i ) ? n : (int)( numFrames - i );
+
+        feedLoudnessMeter( meter, &(samples[ i * test->numChannels ]), n );
+
+        i += n;
+    }
+
+    loudnessLevels( meter, &levels );
+
+    double weighted = expected_weighted_sine( test->segments[0].levels,
+                                              test->numChannels        );
+    double expected [ 3 ] = { test->momentary, test->shortTerm,
+                              test->integrated                  };
+
+    for ( int k = 0; k < 3; k++ ) {
+        expected[k] = ( expected[k] == LC_WEIGHTED ) ? weighted : expected[k];
+    }
+
+    failed |= check_value( test->name, "M", expected[0], levels.momentary,
+                           LC_TOLERANCE_LU, LC_TOLERANCE_LU               );
+    failed |= check_value( test->name, "S", expected[1], levels.shortTerm,
+                           LC_TOLERANCE_LU, LC_TOLERANCE_LU               );
+    failed |= check_value( test->name, "I", expected[2], levels.integrated,
+                           LC_TOLERANCE_LU, LC_TOLERANCE_LU               );
+    failed |= check_value( test->name, "TP", test->truePeak, levels.truePeak,
+                           LC_TP_OVER_DB, LC_TP_UNDER_DB                  );
+
+    printf( "%-28s M %7.2f  S %7.2f  I %7.2f  TP %6.2f  SP %6.2f  %s\n",
+            test->name,
+            levels.momentary, levels.shortTerm, levels.integrated,
+            levels.truePeak, levels.samplePeak,
+            failed ? "FAILED" : "OK"                               );
+
+    freeLoudnessMeter( meter );
+    free( samples );
+
+    return failed;
+}
+
+
+static int check_value(
+    const char* name,
+    const char* what,
+    double      expected,
+    double      actual,
+    double      over,
+    double      under
+) {
+    if ( expected == LC_NONE ) {
+        return 0;
+    }
+
+    if ( actual > expected + over || actual < expected - under ) {
+
+        fprintf( stderr, "%s: %s is %.3f, expected %.3f\n",
+                 name, what, actual, expected           );
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/** @brief loudness of steady 1kHz sines at the levels in dBFS with the
+ *         channel weights of BS.1770. A stereo pair at -23dBFS measures
+ *         -23LUFS by the design of the K-weighting.
+ */
+static double expected_weighted_sine( const double* levels, int numChannels )
+{
+    double sum = 0.0;
+
+    for ( int c = 0; c < numChannels; c++ ) {
+
+        int    surround = ( numChannels == 5 && c >= 3 )
+                          || ( numChannels == 6 && c >= 4 );
+        int    lfe      = ( numChannels == 6 && c == 3 );
+        double weight   = lfe ? 0.0 : surround ? 1.41 : 1.0;
+
+        sum += weight * pow( 10.0, levels[c] / 10.0 );
+    }
+
+    return 10.0 * log10( sum / 2.0 );
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,441 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Checks of the pre-roll ring preRollRing.c.
+ *
+ * It pushes numbered samples in chunks of random sizes, from one sample to
+ * more than the length, and checks that each splice detached has the
+ * latest samples up to the length, oldest first, also when it is taken
+ * across the wrap point of the buffer in two pieces. A splice must stay
+ * intact while the pushes go on until it is released, a second detach
+ * before the release must give an empty splice, and a reset must forget
+ * the samples. Then a writer thread holds each splice for a while and
+ * releases it, as the recording does, while the pushes go on.
+ * The exit status is non-zero if any check fails.
+ *
+ * Build on Linux from the top directory, optionally with
+ * -fsanitize=thread:
+ *
+ *   cc -O2 -pthread -IiOSRecorderWithVUMeter -o preRollRingCheck \
+ *      tools/preRollRingCheck.c                                  \
+ *      iOSRecorderWithVUMeter/preRollRing.c
+ *
+ * Usage:
+ *
+ *   preRollRingCheck [-r rate] [-c channels] [-n rounds]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "preRollRing.h"
+
+#define PRC_SECONDS  0.1f      /* of the pre-roll */
+
+
+/** @brief the numbered samples pushed so far */
+typedef struct prc_source {
+
+    int64_t  numPushed;        /* samples of all the channels */
+    uint32_t state;
+
+} PRC_SOURCE;
+
+
+/** @brief a splice handed to the writer thread */
+typedef struct prc_handoff {
+
+    PRE_ROLL_RING*  ring;
+    PRE_ROLL_SPLICE splice;
+    int64_t         end;         /* numbered sample after the splice */
+    int64_t         length;      /* samples expected in the splice */
+    atomic_int      full;        /* a splice is handed over */
+    atomic_int      done;
+    int64_t         numChecked;
+    int64_t         numBad;
+
+} PRC_HANDOFF;
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      check_splices   ( int rate, int num_channels, int rounds );
+
+static int      check_handoff   ( int rate, int num_channels, int rounds );
+
+static void*    write_splices   ( void* p );
+
+static void     push_random     ( PRE_ROLL_RING* ring, PRC_SOURCE* source,
+                                  int max_samples                        );
+
+static int      splice_is       ( const PRE_ROLL_SPLICE* splice,
+                                  int64_t end, int64_t length    );
+
+static short    sample_at       ( int64_t index );
+
+static int      check           ( const char* what, int ok, double value );
+
+static uint32_t next_random     ( uint32_t* state );
+
+
+int main( int argc, char* argv[] )
+{
+    int rate        = 48000;
+    int numChannels = 2;
+    int rounds      = 500;
+    int numFailed   = 0;
+    int opt;
+
+    while ( ( opt = getopt( argc, argv, "r:c:n:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'r': rate        = atoi( optarg ); break;
+          case 'c': numChannels = atoi( optarg ); break;
+          case 'n': rounds      = atoi( optarg ); break;
+
+          default:
+            fprintf( stderr, "usage: %s [-r rate] [-c channels] [-n rounds]\n",
+                     argv[0]                                                  );
+            return 1;
+        }
+    }
+
+    if ( rate < 1000 || numChannels < 1 || rounds < 1 ) {
+
+        fprintf( stderr, "bad rate, channels or rounds\n" );
+        return 1;
+    }
+
+    numFailed += check_splices( rate, numChannels, rounds );
+    numFailed += check_handoff( rate, numChannels, rounds );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    return ( numFailed == 0 ) ? 0 : 2;
+}
+
+
+/** @brief detach after pushes of random sizes, push on while the splice is
+ *         held, and release it.
+ */
+static int check_splices( int rate, int numChannels, int rounds )
+{
+    PRE_ROLL_RING* ring     = createPreRollRing( rate, numChannels,
+                                                 PRC_SECONDS        );
+    int64_t        capacity = (int64_t)( PRC_SECONDS * rate ) * numChannels;
+    PRC_SOURCE     source   = { 0, 12345 };
+    int64_t        numBad   = 0;
+    int64_t        numHeld  = 0;
+    int64_t        numWraps = 0;
+    int64_t        from     = 0;   /* first sample since the last detach */
+    int            failed   = 0;
+
+    if ( ring == NULL ) {
+        return check( "splices, create", 0, 0 );
+    }
+
+    for ( int r = 0; r < rounds; r++ ) {
+
+        PRE_ROLL_SPLICE splice;
+        PRE_ROLL_SPLICE second;
+
+        /* From nothing to a few times the length. */
+        int numPushes = (int)( next_random( &source.state ) % 8 );
+
+        for ( int i = 0; i < numPushes; i++ ) {
+            push_random( ring, &source, (int)capacity * 3 / 2 );
+        }
+
+        int64_t kept = source.numPushed - from;
+
+        kept = ( kept < capacity ) ? kept : capacity;
+
+        if (    !detachPreRoll( ring, &splice )
+             || !splice_is( &splice, source.numPushed, kept ) ) {
+            numBad++;
+        }
+
+        numWraps += ( splice.numSamples[0] > 0 && splice.numSamples[1] > 0 );
+
+        /* Held: the pushes go to the other buffer, and a second detach
+           gets nothing. */
+        int64_t end = source.numPushed;
+
+        from = end;
+
+        push_random( ring, &source, (int)capacity * 3 / 2 );
+        push_random( ring, &source, (int)capacity / 3 );
+
+        if (    detachPreRoll( ring, &second )
+             || second.numSamples[0] + second.numSamples[1] != 0
+             || !splice_is( &splice, end, kept )                 ) {
+            numBad++;
+        }
+
+        numHeld++;
+
+        releasePreRoll( ring );
+
+        /* The samples pushed while the splice was held are kept. */
+        if ( r % 4 == 0 ) {
+
+            int64_t held = source.numPushed - end;
+
+            held = ( held < capacity ) ? held : capacity;
+
+            if (    !detachPreRoll( ring, &splice )
+                 || !splice_is( &splice, source.numPushed, held ) ) {
+                numBad++;
+            }
+
+            from = source.numPushed;
+            releasePreRoll( ring );
+        }
+
+        /* A reset forgets everything. */
+        if ( r % 16 == 0 ) {
+
+            push_random( ring, &source, (int)capacity );
+            resetPreRollRing( ring );
+            from = source.numPushed;
+
+            if (    !detachPreRoll( ring, &splice )
+                 || splice.numSamples[0] + splice.numSamples[1] != 0 ) {
+                numBad++;
+            }
+
+            releasePreRoll( ring );
+        }
+    }
+
+    freePreRollRing( ring );
+
+    failed |= check( "splices, bad", numBad == 0, (double)numBad );
+    failed |= check( "splices across the wrap point", numWraps > 0,
+                     (double)numWraps                              );
+    failed |= check( "splices held while pushing", numHeld == rounds,
+                     (double)numHeld                                 );
+    return failed;
+}
+
+
+/** @brief the pushes go on in this thread, and a writer thread takes each
+ *         splice, checks it while the pushes go on, and releases it.
+ */
+static int check_handoff( int rate, int numChannels, int rounds )
+{
+    PRC_HANDOFF handoff;
+    PRC_SOURCE  source   = { 0, 777 };
+    int64_t     capacity = (int64_t)( PRC_SECONDS * rate ) * numChannels;
+    int64_t     numBusy  = 0;
+    pthread_t   writer;
+
+    memset( &handoff, 0, sizeof(handoff) );
+
+    handoff.ring = createPreRollRing( rate, numChannels, PRC_SECONDS );
+
+    atomic_init( &handoff.full, 0 );
+    atomic_init( &handoff.done, 0 );
+
+    if (    handoff.ring == NULL
+         || pthread_create( &writer, NULL, write_splices, &handoff ) != 0 ) {
+
+        freePreRollRing( handoff.ring );
+        return check( "handoff, create", 0, 0 );
+    }
+
+    int64_t from = 0;
+
+    for ( int r = 0; r < rounds; ) {
+
+        push_random( handoff.ring, &source, (int)capacity / 4 );
+
+        if ( atomic_load( &handoff.full ) ) {
+            continue;
+        }
+
+        PRE_ROLL_SPLICE splice;
+
+        if ( !detachPreRoll( handoff.ring, &splice ) ) {
+
+            numBusy++;
+            continue;
+        }
+
+        int64_t kept = source.numPushed - from;
+
+        handoff.splice = splice;
+        handoff.end    = source.numPushed;
+        handoff.length = ( kept < capacity ) ? kept : capacity;
+        from           = source.numPushed;
+
+        atomic_store( &handoff.full, 1 );
+        r++;
+    }
+
+    while ( atomic_load( &handoff.full ) ) {
+        push_random( handoff.ring, &source, (int)capacity / 4 );
+    }
+
+    atomic_store( &handoff.done, 1 );
+    pthread_join( writer, NULL );
+    freePreRollRing( handoff.ring );
+
+    int failed = 0;
+
+    failed |= check( "handoff, splices checked", handoff.numChecked == rounds,
+                     (double)handoff.numChecked                              );
+    failed |= check( "handoff, bad", handoff.numBad == 0,
+                     (double)handoff.numBad              );
+    failed |= check( "handoff, detaches before a release", numBusy > 0,
+                     (double)numBusy                                  );
+
+    return failed;
+}
+
+
+/** @brief check each splice handed over while the pushes go on, twice
+ *         with a pause in between, and release it.
+ */
+static void* write_splices( void* p )
+{
+    PRC_HANDOFF* handoff = (PRC_HANDOFF*)p;
+
+    while ( !atomic_load( &handoff->done ) ) {
+
+        if ( !atomic_load( &handoff->full ) ) {
+
+            sched_yield();
+            continue;
+        }
+
+        int ok = splice_is( &handoff->splice, handoff->end, handoff->length );
+
+        struct timespec ts = { 0, 20000 };
+
+        nanosleep( &ts, NULL );
+
+        ok = ok && splice_is( &handoff->splice, handoff->end, handoff->length );
+
+        handoff->numChecked++;
+        handoff->numBad += !ok;
+
+        /* Free the slot before the ring, so that a detach may come before
+           the release, as a recording started again at once. */
+        atomic_store( &handoff->full, 0 );
+        nanosleep( &ts, NULL );
+        releasePreRoll( handoff->ring );
+    }
+
+    return NULL;
+}
+
+
+static void push_random( PRE_ROLL_RING* ring, PRC_SOURCE* source,
+                         int maxSamples                          )
+{
+    int    n       = 1 + (int)( next_random( &source->state ) % maxSamples );
+    short* samples = (short*)malloc( sizeof(short) * n );
+
+    if ( samples == NULL ) {
+        return;
+    }
+
+    for ( int i = 0; i < n; i++ ) {
+        samples[i] = sample_at( source->numPushed + i );
+    }
+
+    pushPreRoll( ring, samples, n );
+
+    source->numPushed += n;
+
+    free( samples );
+}
+
+
+/** @brief the splice has the length numbered samples before end */
+static int splice_is(
+    const PRE_ROLL_SPLICE* splice,
+    int64_t                end,
+    int64_t                length
+) {
+    if ( splice->numSamples[0] + splice->numSamples[1] != length ) {
+        return 0;
+    }
+
+    int64_t index = end - length;
+
+    for ( int k = 0; k < 2; k++ ) {
+
+        for ( int i = 0; i < splice->numSamples[k]; i++ ) {
+
+            if ( splice->pieces[k][i] != sample_at( index++ ) ) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+/** @brief a hash of the index, so that a sample of a previous lap does not
+ *         pass for the one expected.
+ */
+static short sample_at( int64_t index )
+{
+    uint64_t x = (uint64_t)index * 0x9E3779B97F4A7C15ULL;
+
+    return (short)( x >> 48 );
+}
+
+
+static int check( const char* what, int ok, double value )
+{
+    printf( "%-40s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
@@ -0,0 +1,589 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Check of the silence gate silenceGate.c on a synthetic session.
+ *
+ * A recording of speech-like bursts of noise over a steady background noise
+ * is fed through the gate in chunks of random sizes, as the wave writer
+ * does with the samples of the capture. The samples written are saved as a
+ * wave file with its edit list, and the edit list is loaded back. Each
+ * sample of the file must be the sample of the session at the offset that
+ * gatedToSourceOffset() gives, every sample of a burst must be in the file,
+ * and the gate must drop the silence away from the bursts, so the drop
+ * ratio must be at least what the pre-roll and the hangover allow.
+ * The edit list must not be loaded once the file has changed.
+ * A session of digital silence with a short tone in it must go through
+ * the gate too, though the history of the detector has a single level.
+ * The exit status is non-zero if any check fails.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -pthread -IiOSRecorderWithVUMeter -o silenceGateCheck \
+ *      tools/silenceGateCheck.c                                   \
+ *      iOSRecorderWithVUMeter/silenceGate.c                       \
+ *      iOSRecorderWithVUMeter/preRollRing.c                       \
+ *      iOSRecorderWithVUMeter/voiceActivity.c                     \
+ *      iOSRecorderWithVUMeter/estimateSNR.c                       \
+ *      iOSRecorderWithVUMeter/jobRunner.c                         \
+ *      iOSRecorderWithVUMeter/sampleMinMax.c                      \
+ *      iOSRecorderWithVUMeter/sidecarFile.c                       \
+ *      iOSRecorderWithVUMeter/waveFile.c -lm
+ *
+ * Usage:
+ *
+ *   silenceGateCheck [-r rate] [-c channels] [-s snr dB] [-d directory]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "silenceGate.h"
+
+#define SGC_SECONDS          60
+#define SGC_NOISE_SIGMA      30.0
+#define SGC_PRE_ROLL         0.5f
+#define SGC_HANGOVER         1.0f
+#define SGC_MAX_CHUNK        4096   /* frames */
+#define SGC_DETECTOR_SLACK   0.5    /* seconds the detector may add */
+#define SGC_PI               3.14159265358979323846
+#define SGC_SILENT_SECONDS   3
+#define SGC_TONE_AT          1.0    /* seconds */
+#define SGC_TONE_SECONDS     0.03
+
+/* The bursts of the session in seconds, short and long, close and apart. */
+static const double SGC_BURSTS [][2] = {
+
+    {  5.0,  7.0 }, { 10.0, 10.5 }, { 15.0, 18.0 }, { 22.0, 22.1 },
+    { 25.0, 29.0 }, { 40.0, 41.0 }, { 41.8, 43.0 }
+
+};
+
+#define SGC_NUM_BURSTS  ( sizeof(SGC_BURSTS) / sizeof(SGC_BURSTS[0]) )
+
+
+/* The samples written through the gate. */
+typedef struct sgc_output {
+
+    short*  samples;
+    int64_t numSamples;
+    int64_t capacity;
+
+} SGC_OUTPUT;
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      write_gated   ( const short* samples, int num_samples,
+                                void* user                          );
+
+static int      in_burst      ( double t );
+
+static double   kept_bound    ( double seconds );
+
+static int      check_silent_session ( int rate, int num_channels );
+
+static void     put_le16      ( unsigned char* p, uint16_t v );
+
+static void     put_le32      ( unsigned char* p, uint32_t v );
+
+static int      write_wave    ( const char* path, const SGC_OUTPUT* output,
+                                int rate, int num_channels              );
+
+static int      check         ( const char* what, int ok, double value );
+
+static uint32_t next_random   ( uint32_t* state );
+
+static double   gaussian      ( uint32_t* state );
+
+static double   now_seconds   ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    int    rate        = 48000;
+    int    numChannels = 1;
+    double snr         = 20.0;
+    char*  dir         = "/tmp";
+    int    numFailed   = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "r:c:s:d:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'r': rate        = atoi( optarg ); break;
+          case 'c': numChannels = atoi( optarg ); break;
+          case 's': snr         = atof( optarg ); break;
+          case 'd': dir         = optarg;         break;
+
+          default:
+            fprintf( stderr,
+                     "usage: %s [-r rate] [-c channels] [-s snr dB] "
+                     "[-d directory]\n",
+                     argv[0]                                         );
+            return 1;
+        }
+    }
+
+    if ( rate < 8000 || numChannels < 1 ) {
+        return 1;
+    }
+
+    int64_t numFrames = (int64_t)rate * SGC_SECONDS;
+    int64_t total     = numFrames * numChannels;
+    short*  session   = (short*)malloc( sizeof(short) * total );
+
+    SGC_OUTPUT output;
+
+    output.samples    = (short*)malloc( sizeof(short) * total );
+    output.numSamples = 0;
+    output.capacity   = total;
+
+    if ( session == NULL || output.samples == NULL ) {
+        return 1;
+    }
+
+    uint32_t state       = 7;
+    double   burstSigma  = SGC_NOISE_SIGMA * pow( 10.0, snr / 20.0 );
+
+    for ( int64_t i = 0; i < numFrames; i++ ) {
+
+        int on = in_burst( (double)i / rate );
+
+        for ( int c = 0; c < numChannels; c++ ) {
+
+            double y = SGC_NOISE_SIGMA * gaussian( &state );
+
+            if ( on ) {
+                y += burstSigma * gaussian( &state );
+            }
+
+            y = ( y >  32767.0 ) ?  32767.0 : y;
+            y = ( y < -32768.0 ) ? -32768.0 : y;
+
+            session[ i * numChannels + c ] = (short)lrint( y );
+        }
+    }
+
+    SILENCE_GATE* gate = createSilenceGate( rate, numChannels,
+                                            SGC_PRE_ROLL, SGC_HANGOVER,
+                                            write_gated, &output       );
+
+    if ( gate == NULL ) {
+        return 1;
+    }
+
+    /* In chunks of random sizes as the capture gives them. */
+    double  start = now_seconds();
+    int     fed   = 1;
+
+    for ( int64_t i = 0; fed && i < numFrames; ) {
+
+        int64_t n = 1 + next_random( &state ) % SGC_MAX_CHUNK;
+
+        n   = ( n < numFrames - i ) ? n : numFrames - i;
+        fed = feedSilenceGate( gate,
+                               &session[ i * numChannels ],
+                               (int)( n * numChannels )     ) == 0;
+        i  += n;
+    }
+
+    double elapsed = now_seconds() - start;
+
+    int64_t fedFrames;
+    int64_t writtenFrames;
+
+    silenceGateTotals( gate, &fedFrames, &writtenFrames );
+
+    char path [ 4096 ];
+    char edl  [ 4096 + 8 ];
+
+    snprintf( path, sizeof(path), "%s/silenceGateCheck.wav", dir );
+    snprintf( edl,  sizeof(edl),  "%s.edl", path );
+
+    int saved =    write_wave( path, &output, rate, numChannels ) == 0
+                && saveGateEditList( gate, path ) == 0;
+
+    freeSilenceGate( gate );
+
+    GATE_EDIT_LIST* list = saved ? loadGateEditList( path ) : NULL;
+
+    numFailed += check( "fed and written [frames]",
+                           fed
+                        && fedFrames == numFrames
+                        && writtenFrames * numChannels == output.numSamples,
+                        (double)writtenFrames                              );
+
+    numFailed += check( "edit list saved and loaded",
+                           list != NULL
+                        && list->sampleRate  == rate
+                        && list->numChannels == numChannels,
+                        ( list != NULL ) ? (double)list->numSegments : 0.0 );
+
+    if ( list == NULL ) {
+
+        printf( "checks: FAILED\n" );
+        return 1;
+    }
+
+    /* The segments follow each other in the file, and go forward in the
+     * session without overlapping. */
+    int     ordered    = 1;
+    int64_t fileEnd    = 0;
+    int64_t sourceEnd  = 0;
+
+    for ( int64_t k = 0; k < list->numSegments; k++ ) {
+
+        const GATE_SEGMENT* segment = &(list->segments[k]);
+
+        ordered =    ordered
+                  && segment->fileOffset   == fileEnd
+                  && segment->sourceOffset >= sourceEnd
+                  && segment->length       >  0;
+
+        fileEnd   = segment->fileOffset   + segment->length;
+        sourceEnd = segment->sourceOffset + segment->length;
+    }
+
+    numFailed += check( "segments in order",
+                        ordered && fileEnd == writtenFrames,
+                        (double)fileEnd                      );
+
+    /* Each sample of the file is the sample of the session it maps to. */
+    char*   covered    = (char*)calloc( (size_t)numFrames, 1 );
+    int64_t mismatches = 0;
+
+    if ( covered == NULL ) {
+        return 1;
+    }
+
+    for ( int64_t i = 0; i < writtenFrames; i++ ) {
+
+        int64_t source = gatedToSourceOffset( list, i );
+
+        if ( source < 0 || source >= numFrames ) {
+
+            mismatches++;
+            continue;
+        }
+
+        covered[ source ] = 1;
+
+        if ( memcmp( &(output.samples[ i * numChannels ]),
+                     &(session[ source * numChannels ]),
+                     sizeof(short) * numChannels          ) != 0 ) {
+            mismatches++;
+        }
+    }
+
+    numFailed += check( "samples at the mapped offsets",
+                        mismatches == 0, (double)mismatches );
+
+    numFailed += check( "offsets beyond the file",
+                           gatedToSourceOffset( list, writtenFrames ) == -1
+                        && gatedToSourceOffset( list, -1 )            == -1,
+                        (double)writtenFrames                              );
+
+    int64_t missed      = 0;
+    int64_t speechTotal = 0;
+
+    for ( int64_t i = 0; i < numFrames; i++ ) {
+
+        if ( in_burst( (double)i / rate ) ) {
+
+            speechTotal++;
+            missed += !covered[i];
+        }
+    }
+
+    numFailed += check( "speech kept [%]",
+                        missed == 0,
+                        100.0 * ( speechTotal - missed ) / speechTotal );
+
+    /* What the gate may keep is the bursts widened by the pre-roll before
+     * them and by the hangover and the detector after them. */
+    double dropRatio = 1.0 - (double)writtenFrames / numFrames;
+    double minRatio  = 1.0 - kept_bound( SGC_SECONDS ) / SGC_SECONDS;
+
+    printf( "dropped %.1f%% of the session, at least %.1f%% expected\n",
+            dropRatio * 100.0, minRatio * 100.0                         );
+
+    numFailed += check( "drop ratio [%]",
+                        dropRatio >= minRatio && dropRatio < 1.0,
+                        dropRatio * 100.0                         );
+
+    /* The file changes, and the edit list is not of it any more. */
+    FILE* fp = fopen( path, "ab" );
+
+    if ( fp != NULL ) {
+
+        fwrite( session, sizeof(short), (size_t)numChannels, fp );
+        fclose( fp );
+    }
+
+    GATE_EDIT_LIST* stale = loadGateEditList( path );
+
+    numFailed += check( "edit list of a changed file", stale == NULL, 0 );
+
+    numFailed += check_silent_session( rate, numChannels );
+
+    printf( "gate: %.0f times real time\n",
+            ( elapsed > 0.0 ) ? SGC_SECONDS / elapsed : 0.0 );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    freeGateEditList( stale );
+    freeGateEditList( list );
+    unlink( edl );
+    unlink( path );
+    free( covered );
+    free( output.samples );
+    free( session );
+
+    return ( numFailed == 0 ) ? 0 : 1;
+}
+
+
+static int write_gated( const short* samples, int numSamples, void* user )
+{
+    SGC_OUTPUT* output = (SGC_OUTPUT*)user;
+
+    if ( output->numSamples + numSamples > output->capacity ) {
+        return -1;
+    }
+
+    memcpy( &(output->samples[ output->numSamples ]),
+            samples,
+            sizeof(short) * numSamples               );
+
+    output->numSamples += numSamples;
+
+    return 0;
+}
+
+
+static int in_burst( double t )
+{
+    for ( size_t k = 0; k < SGC_NUM_BURSTS; k++ ) {
+
+        if ( t >= SGC_BURSTS[k][0] && t < SGC_BURSTS[k][1] ) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* Length of the union of the bursts widened by what the gate may keep
+ * around them, in seconds of the session. */
+static double kept_bound( double seconds )
+{
+    double total = 0.0;
+    double end   = 0.0;
+
+    for ( size_t k = 0; k < SGC_NUM_BURSTS; k++ ) {
+
+        double from = SGC_BURSTS[k][0] - SGC_PRE_ROLL;
+        double to   = SGC_BURSTS[k][1] + SGC_HANGOVER + SGC_DETECTOR_SLACK;
+
+        from = ( from > end     ) ? from : end;
+        to   = ( to   < seconds ) ? to   : seconds;
+
+        if ( to > from ) {
+
+            total += to - from;
+            end    = to;
+        }
+    }
+
+    return total;
+}
+
+
+/* Digital silence with a tone of a few frames, through the gate in the
+ * chunks of 10ms of the meters. The detector must not fail on the
+ * histogram of one level, and the silence must be dropped. */
+static int check_silent_session( int rate, int numChannels )
+{
+    int64_t numFrames = (int64_t)rate * SGC_SILENT_SECONDS;
+    int64_t toneFrom  = (int64_t)( rate * SGC_TONE_AT );
+    int64_t toneTo    = toneFrom + (int64_t)( rate * SGC_TONE_SECONDS );
+    short*  session   = (short*)calloc( (size_t)( numFrames * numChannels ),
+                                        sizeof(short)                       );
+
+    SGC_OUTPUT output;
+
+    output.samples    = (short*)malloc( sizeof(short) * numFrames
+                                        * numChannels             );
+    output.numSamples = 0;
+    output.capacity   = numFrames * numChannels;
+
+    if ( session == NULL || output.samples == NULL ) {
+        return check( "silence with a tone [frames]", 0, 0 );
+    }
+
+    for ( int64_t i = toneFrom; i < toneTo; i++ ) {
+
+        for ( int c = 0; c < numChannels; c++ ) {
+
+            session[ i * numChannels + c ] =
+                (short)lrint( 10000.0 * sin( 2.0 * SGC_PI * 1000.0 * i
+                                             / rate                   ) );
+        }
+    }
+
+    SILENCE_GATE* gate = createSilenceGate( rate, numChannels,
+                                            SGC_PRE_ROLL, SGC_HANGOVER,
+                                            write_gated, &output       );
+    int     chunk = rate / 100;
+    int     fed   = ( gate != NULL );
+
+    for ( int64_t i = 0; fed && i < numFrames; i += chunk ) {
+
+        int64_t n = ( chunk < numFrames - i ) ? chunk : numFrames - i;
+
+        fed = feedSilenceGate( gate,
+                               &session[ i * numChannels ],
+                               (int)( n * numChannels )     ) == 0;
+    }
+
+    int64_t fedFrames     = 0;
+    int64_t writtenFrames = 0;
+
+    if ( gate != NULL ) {
+        silenceGateTotals( gate, &fedFrames, &writtenFrames );
+    }
+
+    freeSilenceGate( gate );
+    free( output.samples );
+    free( session );
+
+    return check( "silence with a tone [frames]",
+                     fed
+                  && fedFrames == numFrames
+                  && writtenFrames < numFrames,
+                  (double)writtenFrames          );
+}
+
+
+static void put_le16( unsigned char* p, uint16_t v )
+{
+    p[0] = (unsigned char)( v );
+    p[1] = (unsigned char)( v >> 8 );
+}
+
+
+static void put_le32( unsigned char* p, uint32_t v )
+{
+    put_le16( p,     (uint16_t)( v ) );
+    put_le16( p + 2, (uint16_t)( v >> 16 ) );
+}
+
+
+static int write_wave(
+    const char*       path,
+    const SGC_OUTPUT* output,
+    int               rate,
+    int               numChannels
+) {
+    unsigned char header [ 44 ];
+    uint32_t      dataSize = (uint32_t)( output->numSamples * sizeof(short) );
+
+    memcpy( &(header[0]),  "RIFF", 4 );
+    put_le32( &(header[4]),  36 + dataSize );
+    memcpy( &(header[8]),  "WAVEfmt ", 8 );
+    put_le32( &(header[16]), 16 );
+    put_le16( &(header[20]), 1 );
+    put_le16( &(header[22]), (uint16_t)numChannels );
+    put_le32( &(header[24]), (uint32_t)rate );
+    put_le32( &(header[28]), (uint32_t)( rate * numChannels * 2 ) );
+    put_le16( &(header[32]), (uint16_t)( numChannels * 2 ) );
+    put_le16( &(header[34]), 16 );
+    memcpy( &(header[36]), "data", 4 );
+    put_le32( &(header[40]), dataSize );
+
+    FILE* fp = fopen( path, "wb" );
+
+    if ( fp == NULL ) {
+        return -1;
+    }
+
+    int written =    fwrite( header, 1, sizeof(header), fp ) == sizeof(header)
+                  && fwrite( output->samples, sizeof(short),
+                             (size_t)output->numSamples, fp )
+                     == (size_t)output->numSamples;
+
+    written = ( fclose(fp) == 0 ) && written;
+
+    return written ? 0 : -1;
+}
+
+
+static int check( const char* what, int ok, double value )
+{
+    printf( "%-40s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+/** @brief Box-Muller */
+static double gaussian( uint32_t* state )
+{
+    double u = ( next_random( state ) + 1.0 ) / 4294967297.0;
+    double v = ( next_random( state ) + 1.0 ) / 4294967297.0;
+
+    return sqrt( -2.0 * log( u ) ) * cos( 2.0 * SGC_PI * v );
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,470 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Batch analysis of the wave files with the same engine as the play screen.
+ *
+ * It walks the directories given, and analyzes every .wav file found with
+ * estimateSNRAndPeak() on a pool of threads. One record per file is written
+ * to stdout as CSV or JSON lines, and the throughput is reported to stderr.
+ * The files are streamed, and never loaded whole. A file which can not be
+ * read, or is not in 16-bit PCM, gets a record with the status error.
+ *
+ * The pool has a thread per core by default, but no more than the files.
+ * The cores left over per thread go to the jobs of each estimateSNR(), so
+ * that the threads of the pool and their jobs do not oversubscribe the
+ * cores.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -pthread -IiOSRecorderWithVUMeter -o snrBatch tools/snrBatch.c \
+ *      iOSRecorderWithVUMeter/estimateSNR.c                               \
+ *      iOSRecorderWithVUMeter/jobRunner.c                                 \
+ *      iOSRecorderWithVUMeter/sampleMinMax.c                              \
+ *      iOSRecorderWithVUMeter/waveFile.c -lm
+ *
+ * Usage:
+ *
+ *   snrBatch [-j threads] [-f csv|json] path...
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <ftw.h>
+#include <pthread.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "estimateSNR.h"
+#include "jobRunner.h"
+#include "waveFile.h"
+
+#define SB_MAX_THREADS    64
+#define SB_NFTW_FDS       32
+
+/** @brief analysis result of one file */
+typedef struct sb_record {
+
+    const char* path;
+    int         status;        /* 0: OK, -1: failed */
+    float       noiseLevel;
+    float       speechLevel;
+    int         peak;
+    double      duration;      /* seconds */
+
+} SB_RECORD;
+
+
+/** @brief the work shared by the threads of the pool */
+typedef struct sb_pool {
+
+    char**          paths;
+    int             numPaths;
+    int             next;          /* next path to be taken */
+    int             json;
+    int             numFailed;
+    double          totalDuration;
+    pthread_mutex_t lock;
+
+} SB_POOL;
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int    collect_path (
+                  const char*        path,
+                  const struct stat* st,
+                  int                type,
+                  struct FTW*        ftw   );
+
+static int    has_wave_extension ( const char* path );
+
+static void   analyze_file ( const char* path, SB_RECORD* record );
+
+static void*  pool_worker ( void* p );
+
+static void   print_record ( const SB_RECORD* record, int json );
+
+static void   print_json_string ( const char* s );
+
+static double now_seconds ( void );
+
+
+/* nftw() takes no context, so the paths are collected into these. */
+static char** stPaths    = NULL;
+static int    stNumPaths = 0;
+static int    stCapacity = 0;
+
+
+int main( int argc, char* argv[] )
+{
+    long numCores   = sysconf( _SC_NPROCESSORS_ONLN );
+    long numThreads = 0;           /* one per core */
+    int  json       = 0;
+    int  opt;
+
+    while ( ( opt = getopt( argc, argv, "j:f:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'j':
+            numThreads = atol( optarg );
+            numThreads = ( numThreads < 1 ) ? 1 : numThreads;
+            break;
+
+          case 'f':
+            if ( strcmp( optarg, "json" ) == 0 ) {
+                json = 1;
+            }
+            else if ( strcmp( optarg, "csv" ) == 0 ) {
+                json = 0;
+            }
+            else {
+                fprintf( stderr, "unknown format: %s\n", optarg );
+                return 1;
+            }
+            break;
+
+          default:
+            fprintf( stderr,
+                     "usage: %s [-j threads] [-f csv|json] path...\n",
+                     argv[0]                                        );
+            return 1;
+        }
+    }
+
+    if ( optind >= argc ) {
+
+        fprintf( stderr,
+                 "usage: %s [-j threads] [-f csv|json] path...\n",
+                 argv[0]                                        );
+        return 1;
+    }
+
+    for ( int i = optind; i < argc; i++ ) {
+
+        if ( nftw( argv[i], collect_path, SB_NFTW_FDS, FTW_PHYS ) != 0 ) {
+
+            fprintf( stderr, "can not walk %s\n", argv[i] );
+            return 1;
+        }
+    }
+
+    if ( numCores < 1 ) {
+        numCores = 1;
+    }
+
+    if ( numThreads < 1 ) {
+
+        numThreads = ( numCores < stNumPaths ) ? numCores : stNumPaths;
+        numThreads = ( numThreads < 1 ) ? 1 : numThreads;
+    }
+
+    if ( numThreads > SB_MAX_THREADS ) {
+        numThreads = SB_MAX_THREADS;
+    }
+
+    int jobsPerFile = (int)( numCores / numThreads );
+
+    jobsPerFile = ( jobsPerFile < 1 ) ? 1 : jobsPerFile;
+
+    limitJobs( jobsPerFile );
+
+    SB_POOL pool;
+
+    pool.paths         = stPaths;
+    pool.numPaths      = stNumPaths;
+    pool.next          = 0;
+    pool.json          = json;
+    pool.numFailed     = 0;
+    pool.totalDuration = 0.0;
+
+    pthread_mutex_init( &pool.lock, NULL );
+
+    if ( !json ) {
+        printf( "path,snr_db,speech_db,noise_db,peak,duration_sec,status\n" );
+    }
+
+    double    startTime = now_seconds();
+    pthread_t threads [ SB_MAX_THREADS ];
+    int       created [ SB_MAX_THREADS ];
+
+    for ( int i = 1; i < numThreads; i++ ) {
+
+        created[i] = ( pthread_create( &threads[i],
+                                       NULL,
+                                       pool_worker,
+                                       &pool        ) == 0 );
+    }
+
+    pool_worker( &pool );
+
+    for ( int i = 1; i < numThreads; i++ ) {
+
+        if ( created[i] ) {
+            pthread_join( threads[i], NULL );
+        }
+    }
+
+    double elapsed = now_seconds() - startTime;
+
+    if ( elapsed <= 0.0 ) {
+        elapsed = 1e-9;
+    }
+
+    fprintf( stderr,
+             "%d files (%d failed), %.2f hours of audio in %.2f sec "
+             "with %ld threads of %d jobs: %.2f files/sec, %.2f hours/sec\n",
+             pool.numPaths,
+             pool.numFailed,
+             pool.totalDuration / 3600.0,
+             elapsed,
+             numThreads,
+             jobsPerFile,
+             pool.numPaths / elapsed,
+             pool.totalDuration / 3600.0 / elapsed                );
+
+    pthread_mutex_destroy( &pool.lock );
+
+    for ( int i = 0; i < stNumPaths; i++ ) {
+        free( stPaths[i] );
+    }
+    free( stPaths );
+
+    return ( pool.numFailed > 0 ) ? 2 : 0;
+}
+
+
+static int collect_path(
+    const char*        path,
+    const struct stat* st,
+    int                type,
+    struct FTW*        ftw
+) {
+    (void)st;
+    (void)ftw;
+
+    if ( type != FTW_F || !has_wave_extension( path ) ) {
+        return 0;
+    }
+
+    if ( stNumPaths == stCapacity ) {
+
+        int    capacity = ( stCapacity == 0 ) ? 256 : stCapacity * 2;
+        char** paths    = (char**)realloc( stPaths, sizeof(char*) * capacity );
+
+        if ( paths == NULL ) {
+            return -1;
+        }
+
+        stPaths    = paths;
+        stCapacity = capacity;
+    }
+
+    stPaths[ stNumPaths ] = strdup( path );
+
+    if ( stPaths[ stNumPaths ] == NULL ) {
+        return -1;
+    }
+
+    stNumPaths++;
+
+    return 0;
+}
+
+
+static int has_wave_extension( const char* path )
+{
+    size_t len = strlen( path );
+
+    return ( len >= 4 && strcasecmp( &(path[ len - 4 ]), ".wav" ) == 0 );
+}
+
+
+/** @brief take the paths one by one until none is left. */
+static void* pool_worker( void* p )
+{
+    SB_POOL* pool = (SB_POOL*)p;
+
+    while ( 1 ) {
+
+        pthread_mutex_lock( &pool->lock );
+
+        int index = pool->next++;
+
+        pthread_mutex_unlock( &pool->lock );
+
+        if ( index >= pool->numPaths ) {
+            break;
+        }
+
+        SB_RECORD record;
+
+        analyze_file( pool->paths[ index ], &record );
+
+        pthread_mutex_lock( &pool->lock );
+
+        print_record( &record, pool->json );
+
+        if ( record.status == 0 ) {
+            pool->totalDuration += record.duration;
+        }
+        else {
+            pool->numFailed++;
+        }
+
+        pthread_mutex_unlock( &pool->lock );
+    }
+
+    return NULL;
+}
+
+
+static void analyze_file( const char* path, SB_RECORD* record )
+{
+    WAVE_FILE_INFO info;
+    FILE*          fp;
+
+    memset( record, 0, sizeof(SB_RECORD) );
+
+    record->path   = path;
+    record->status = -1;
+
+    fp = fopen( path, "rb" );
+
+    if ( fp == NULL ) {
+        return;
+    }
+
+    int rtnVal = readWaveFileInfo( fp, &info );
+
+    fclose( fp );
+
+    if ( rtnVal != 0 ) {
+        return;
+    }
+
+    if ( estimateSNRAndPeak( path,
+                             &(record->noiseLevel),
+                             &(record->speechLevel),
+                             &(record->peak)         ) != 0 ) {
+        return;
+    }
+
+    /* readWaveFileInfo() has checked the channels and the rate. */
+    record->duration = (double)info.totalSamples
+                       / info.numChannels
+                       / info.sampleRate;
+    record->status   = 0;
+}
+
+
+static void print_record( const SB_RECORD* record, int json )
+{
+    if ( json ) {
+
+        printf( "{\"path\":" );
+        print_json_string( record->path );
+
+        if ( record->status == 0 ) {
+
+            printf( ",\"snr_db\":%.2f,\"speech_db\":%.2f,\"noise_db\":%.2f,"
+                    "\"peak\":%d,\"duration_sec\":%.3f,\"status\":\"ok\"}\n",
+                    record->speechLevel - record->noiseLevel,
+                    record->speechLevel,
+                    record->noiseLevel,
+                    record->peak,
+                    record->duration                                        );
+        }
+        else {
+            printf( ",\"status\":\"error\"}\n" );
+        }
+    }
+    else {
+
+        /* Quote the path as CSV does, doubling the quotes in it. */
+        putchar( '"' );
+
+        for ( const char* c = record->path; *c != '\0'; c++ ) {
+
+            if ( *c == '"' ) {
+                putchar( '"' );
+            }
+            putchar( *c );
+        }
+
+        putchar( '"' );
+
+        if ( record->status == 0 ) {
+
+            printf( ",%.2f,%.2f,%.2f,%d,%.3f,ok\n",
+                    record->speechLevel - record->noiseLevel,
+                    record->speechLevel,
+                    record->noiseLevel,
+                    record->peak,
+                    record->duration                          );
+        }
+        else {
+            printf( ",,,,,,error\n" );
+        }
+    }
+}
+
+
+static void print_json_string( const char* s )
+{
+    putchar( '"' );
+
+    for ( ; *s != '\0'; s++ ) {
+
+        unsigned char c = (unsigned char)*s;
+
+        if ( c == '"' || c == '\\' ) {
+
+            putchar( '\\' );
+            putchar( c );
+        }
+        else if ( c < 0x20 ) {
+
+            printf( "\\u%04x", c );
+        }
+        else {
+            putchar( c );
+        }
+    }
+
+    putchar( '"' );
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,461 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Benchmark and accuracy guard of the analysis engine.
+ *
+ * It generates synthetic wave files from 1 minute to 10 hours, which have
+ * speech-like bursts of noise over a steady background noise at a known
+ * SNR. Each stage of the analysis is timed separately, and reported in
+ * MB/s and in multiples of real time. The SNR estimated is checked against
+ * the ground truth, and the exit status is non-zero if it is off by more
+ * than the tolerance.
+ *
+ * estimateSNR.c is included, not linked, to time its static stages.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -pthread -IiOSRecorderWithVUMeter -o snrBench tools/snrBench.c \
+ *      iOSRecorderWithVUMeter/jobRunner.c                                 \
+ *      iOSRecorderWithVUMeter/sampleMinMax.c                              \
+ *      iOSRecorderWithVUMeter/sidecarFile.c                               \
+ *      iOSRecorderWithVUMeter/waveFile.c                                  \
+ *      iOSRecorderWithVUMeter/wavePeakPyramid.c -lm
+ *
+ * Usage:
+ *
+ *   snrBench [-m max seconds] [-r rate] [-c channels] [-t tolerance dB]
+ *            [-d directory] [-k]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <time.h>
+#include <unistd.h>
+
+#include "estimateSNR.c"
+#include "wavePeakPyramid.h"
+
+#define SB_PATTERN_SECONDS  60
+#define SB_NOISE_DB         30.0   /* 10 log10 of the noise power */
+#define SB_RAMP_SECONDS     0.01
+#define SB_PLOT_WIDTH       1920
+
+/** @brief a synthetic recording to be generated and analyzed */
+typedef struct sb_case {
+
+    double seconds;
+    double snr;        /* ground truth in [dB] */
+
+} SB_CASE;
+
+
+static const SB_CASE stCases[] = {
+
+    {    60.0, 10.0 },
+    {    60.0, 20.0 },
+    {    60.0, 30.0 },
+    {   600.0, 20.0 },
+    {  3600.0, 20.0 },
+    { 36000.0, 20.0 }
+
+};
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      generate_wave (
+                    const char* path,
+                    double      seconds,
+                    int         sample_rate,
+                    int         num_channels,
+                    double      snr           );
+
+static uint32_t next_random ( uint32_t* state );
+
+static double   uniform ( uint32_t* state );
+
+static double   gaussian ( uint32_t* state );
+
+static double   now_seconds ( void );
+
+static void     report_stage (
+                    const char* name,
+                    double      elapsed,
+                    double      megabytes,
+                    double      seconds   );
+
+
+int main( int argc, char* argv[] )
+{
+    double maxSeconds  = 36000.0;
+    int    sampleRate  = 16000;
+    int    numChannels = 1;
+    double tolerance   = 2.0;
+    char*  dir         = "/tmp";
+    int    keep        = 0;
+    int    numFailed   = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "m:r:c:t:d:k" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'm': maxSeconds  = atof( optarg ); break;
+          case 'r': sampleRate  = atoi( optarg ); break;
+          case 'c': numChannels = atoi( optarg ); break;
+          case 't': tolerance   = atof( optarg ); break;
+          case 'd': dir         = optarg;         break;
+          case 'k': keep        = 1;              break;
+
+          default:
+            fprintf( stderr,
+                     "usage: %s [-m max seconds] [-r rate] [-c channels] "
+                     "[-t tolerance dB] [-d directory] [-k]\n",
+                     argv[0]                                             );
+            return 1;
+        }
+    }
+
+    if ( sampleRate < 8000 || numChannels < 1 ) {
+
+        fprintf( stderr, "bad rate or channels\n" );
+        return 1;
+    }
+
+    for ( size_t c = 0; c < sizeof(stCases) / sizeof(stCases[0]); c++ ) {
+
+        const SB_CASE* sbCase = &(stCases[c]);
+        char           path [ 1024 ];
+
+        if ( sbCase->seconds > maxSeconds ) {
+            continue;
+        }
+
+        snprintf( path, sizeof(path), "%s/snrBench_%.0fs_%.0fdB.wav",
+                  dir, sbCase->seconds, sbCase->snr                  );
+
+        printf( "%s: %.0f sec, %d Hz, %d ch, SNR %.1f dB\n",
+                path, sbCase->seconds, sampleRate, numChannels, sbCase->snr );
+
+        double t0 = now_seconds();
+
+        if ( generate_wave( path,
+                            sbCase->seconds,
+                            sampleRate,
+                            numChannels,
+                            sbCase->snr     ) != 0 ) {
+
+            fprintf( stderr, "can not write %s\n", path );
+            return 1;
+        }
+
+        double megabytes = sbCase->seconds * sampleRate * numChannels * 2.0
+                           / 1e6;
+
+        report_stage( "generate", now_seconds() - t0, megabytes,
+                      sbCase->seconds                           );
+
+        /* The stages of estimateSNR() one by one. */
+        WAVE_FILE_INFO info;
+        SNR_FRAMING    framing;
+        FILE*          fp = fopen( path, "rb" );
+
+        if ( fp == NULL || readWaveFileInfo( fp, &info ) != 0 ) {
+
+            fprintf( stderr, "can not read %s\n", path );
+            return 1;
+        }
+
+        fclose( fp );
+
+        framing_for( &info, &framing );
+
+        t0 = now_seconds();
+        float dcBias = compute_dc_bias( path, &info, NULL );
+        report_stage( "compute_dc_bias", now_seconds() - t0, megabytes,
+                      sbCase->seconds                                  );
+
+        SNR_HIST** powerHist = init_hist( SNR_NUM_BINS,
+                                          SNR_LOW_DB,
+                                          SNR_HIGH_DB   );
+        t0 = now_seconds();
+        compute_pwr_hist_sd( path, &info, &framing,
+                             powerHist, SNR_NUM_BINS, dcBias );
+        report_stage( "compute_pwr_hist_sd", now_seconds() - t0, megabytes,
+                      sbCase->seconds                                      );
+
+        float noiseLevel;
+        float speechLevel;
+
+        t0 = now_seconds();
+        snr( powerHist, SNR_NUM_BINS, SNR_PEAK_LEVEL,
+             &noiseLevel, &speechLevel              );
+        report_stage( "snr (fit)", now_seconds() - t0, megabytes,
+                      sbCase->seconds                            );
+
+        free_hist( powerHist, SNR_NUM_BINS );
+
+        t0 = now_seconds();
+        estimateSNR( path, &noiseLevel, &speechLevel );
+        report_stage( "estimateSNR", now_seconds() - t0, megabytes,
+                      sbCase->seconds                              );
+
+        int     peak;
+        int64_t length;
+
+        t0 = now_seconds();
+        int* plots = computePeakAndPlots( path, SB_PLOT_WIDTH, 200,
+                                          &peak, &length           );
+        report_stage( "computePeakAndPlots", now_seconds() - t0, megabytes,
+                      sbCase->seconds                                      );
+        free( plots );
+
+        char peaksPath [ 1100 ];
+
+        snprintf( peaksPath, sizeof(peaksPath), "%s.peaks", path );
+        unlink( peaksPath );
+
+        t0 = now_seconds();
+        WAVE_PEAK_PYRAMID* pyramid = openWavePeakPyramid( path );
+        report_stage( "openWavePeakPyramid", now_seconds() - t0, megabytes,
+                      sbCase->seconds                                      );
+
+        if ( pyramid != NULL ) {
+
+            t0 = now_seconds();
+            plots = computePlotsFromWavePeakPyramid( pyramid, 0,
+                                                     pyramid->totalSamples,
+                                                     SB_PLOT_WIDTH, 200    );
+            report_stage( "computePlotsFromWavePeakPyramid",
+                          now_seconds() - t0, megabytes, sbCase->seconds );
+            free( plots );
+            freeWavePeakPyramid( pyramid );
+        }
+
+        /* The low-pass of the decimation passes 1/decimation of white
+           noise. */
+        float noiseTruth = SB_NOISE_DB - 10.0 * log10( framing.decimation );
+        float error      = ( speechLevel - noiseLevel ) - (float)sbCase->snr;
+        int   pass       = ( fabs( error ) <= tolerance );
+
+        printf( "  noise %.2f dB (truth %.2f), speech %.2f dB, "
+                "SNR %.2f dB (truth %.2f, error %+.2f): %s\n\n",
+                noiseLevel, noiseTruth, speechLevel,
+                speechLevel - noiseLevel, sbCase->snr, error,
+                pass ? "PASS" : "FAIL"                           );
+
+        if ( !pass ) {
+            numFailed++;
+        }
+
+        if ( !keep ) {
+            unlink( peaksPath );
+            unlink( path );
+        }
+    }
+
+    return ( numFailed > 0 ) ? 2 : 0;
+}
+
+
+static void report_stage(
+    const char* name,
+    double      elapsed,
+    double      megabytes,
+    double      seconds
+) {
+    if ( elapsed <= 0.0 ) {
+        elapsed = 1e-9;
+    }
+
+    printf( "  %-32s %10.2f ms %10.1f MB/s %10.0fx real time\n",
+            name, elapsed * 1e3, megabytes / elapsed, seconds / elapsed );
+}
+
+
+/** @brief write a wave file of a steady white background noise at
+ *         SB_NOISE_DB with bursts of white noise, ramped in and out like
+ *         syllables, at snr dB above the background. The first
+ *         SB_PATTERN_SECONDS are repeated to make the longer files quickly.
+ */
+static int generate_wave(
+    const char* path,
+    double      seconds,
+    int         sampleRate,
+    int         numChannels,
+    double      snr
+) {
+    int64_t  numFrames      = (int64_t)( seconds * sampleRate );
+    int64_t  patternFrames  = (int64_t)SB_PATTERN_SECONDS * sampleRate;
+    uint32_t state          = 12345;
+    double   noiseSigma     = sqrt( pow( 10.0, SB_NOISE_DB / 10.0 ) );
+    double   burstSigma     = noiseSigma * sqrt( pow( 10.0, snr / 10.0 ) - 1.0 );
+    int      rampFrames     = (int)( SB_RAMP_SECONDS * sampleRate );
+
+    if ( patternFrames > numFrames ) {
+        patternFrames = numFrames;
+    }
+
+    short* pattern = (short*)malloc( sizeof(short) * patternFrames * numChannels );
+
+    if ( pattern == NULL ) {
+        return -1;
+    }
+
+    /* Bursts of 0.2-1.2 sec and gaps of 0.1-0.8 sec. */
+    int64_t burstBegin = 0;
+    int64_t burstEnd   = 0;
+
+    for ( int64_t i = 0; i < patternFrames; i++ ) {
+
+        if ( i >= burstEnd ) {
+
+            burstBegin = i + (int64_t)( ( 0.1 + 0.7 * uniform( &state ) )
+                                        * sampleRate                      );
+            burstEnd   = burstBegin
+                         + (int64_t)( ( 0.2 + 1.0 * uniform( &state ) )
+                                      * sampleRate                      );
+        }
+
+        double envelope = 0.0;
+
+        if ( i >= burstBegin ) {
+
+            int64_t fromBegin = i - burstBegin;
+            int64_t toEnd     = burstEnd - i;
+            int64_t edge      = ( fromBegin < toEnd ) ? fromBegin : toEnd;
+
+            envelope = ( edge >= rampFrames )
+                       ? 1.0
+                       : 0.5 - 0.5 * cos( SNR_PI * edge / rampFrames );
+        }
+
+        for ( int c = 0; c < numChannels; c++ ) {
+
+            double y = noiseSigma * gaussian( &state )
+                       + envelope * burstSigma * gaussian( &state );
+
+            y = ( y >  32767.0 ) ?  32767.0 : y;
+            y = ( y < -32768.0 ) ? -32768.0 : y;
+
+            pattern[ i * numChannels + c ] = (short)lrint( y );
+        }
+    }
+
+    FILE* fp = fopen( path, "wb" );
+
+    if ( fp == NULL ) {
+
+        free( pattern );
+        return -1;
+    }
+
+    unsigned char header [ 44 ];
+    uint64_t      dataSize = (uint64_t)numFrames * numChannels * 2;
+    uint32_t      size32   = ( dataSize > 0xFFFFFFF0ULL ) ? 0xFFFFFFFF
+                                                          : (uint32_t)dataSize;
+    uint32_t      values [ 4 ];
+
+    memcpy( &(header[0]),  "RIFF", 4 );
+    values[0] = size32 + 36;
+    memcpy( &(header[4]),  &(values[0]), 4 );
+    memcpy( &(header[8]),  "WAVEfmt ", 8 );
+    values[1] = 16;
+    memcpy( &(header[16]), &(values[1]), 4 );
+    header[20] = 1;  header[21] = 0;                  /* PCM            */
+    header[22] = (unsigned char)numChannels;  header[23] = 0;
+    values[2] = (uint32_t)sampleRate;
+    memcpy( &(header[24]), &(values[2]), 4 );
+    values[3] = (uint32_t)sampleRate * numChannels * 2;
+    memcpy( &(header[28]), &(values[3]), 4 );
+    header[32] = (unsigned char)( numChannels * 2 );  header[33] = 0;
+    header[34] = 16; header[35] = 0;                  /* bits per sample */
+    memcpy( &(header[36]), "data", 4 );
+    memcpy( &(header[40]), &size32, 4 );
+
+    int rtnVal = ( fwrite( header, 1, sizeof(header), fp ) == sizeof(header) )
+                 ? 0 : -1;
+
+    for ( int64_t i = 0; rtnVal == 0 && i < numFrames; i += patternFrames ) {
+
+        int64_t n = ( numFrames - i < patternFrames ) ? numFrames - i
+                                                      : patternFrames;
+
+        if ( (int64_t)fwrite( pattern, sizeof(short) * numChannels, n, fp )
+             != n ) {
+            rtnVal = -1;
+        }
+    }
+
+    free( pattern );
+
+    if ( fclose( fp ) != 0 ) {
+        rtnVal = -1;
+    }
+
+    return rtnVal;
+}
+
+
+/** @brief xorshift32 */
+static uint32_t next_random( uint32_t* state )
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+
+    return x;
+}
+
+
+static double uniform( uint32_t* state )
+{
+    return ( next_random( state ) + 1.0 ) / 4294967297.0;
+}
+
+
+/** @brief Box-Muller */
+static double gaussian( uint32_t* state )
+{
+    double u = uniform( state );
+    double v = uniform( state );
+
+    return sqrt( -2.0 * log( u ) ) * cos( 2.0 * SNR_PI * v );
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,367 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *
+ * Equality check and benchmark of the noise floor fitting of the analysis
+ * engine.
+ *
+ * It fills random two-mode histograms of the frame powers, a background
+ * noise mode and a louder and wider speech mode, and fits each of them with
+ * snr(). The tool is built twice: with the tabulated and memoized
+ * evaluations of comp1(), and with -DSNR_USE_FIT_TABLES=0, which evaluates
+ * over the full width of the histogram at every evaluation, as comp1()
+ * originally did. The full width build writes the levels and its time to a
+ * file with -w, and the tabulated build compares its levels against them
+ * with -c. The levels must be identical, and the time of both fits is
+ * reported. The exit status is non-zero if any level differs.
+ *
+ * estimateSNR.c is included, not linked, to reach its static fitting.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -pthread -IiOSRecorderWithVUMeter -o snrFitCheck \
+ *      tools/snrFitCheck.c                                   \
+ *      iOSRecorderWithVUMeter/jobRunner.c                    \
+ *      iOSRecorderWithVUMeter/sampleMinMax.c                 \
+ *      iOSRecorderWithVUMeter/waveFile.c -lm
+ *
+ *   cc -O2 -pthread -IiOSRecorderWithVUMeter -DSNR_USE_FIT_TABLES=0 \
+ *      -o snrFitCheckFull tools/snrFitCheck.c                        \
+ *      iOSRecorderWithVUMeter/jobRunner.c                            \
+ *      iOSRecorderWithVUMeter/sampleMinMax.c                         \
+ *      iOSRecorderWithVUMeter/waveFile.c -lm
+ *
+ * Usage:
+ *
+ *   snrFitCheckFull [-n histograms] [-s seed] -w levels
+ *   snrFitCheck     [-n histograms] [-s seed] -c levels
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <time.h>
+#include <unistd.h>
+
+#include "estimateSNR.c"
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      write_levels (
+                    const char*  path,
+                    int          numHists,
+                    double       seconds,
+                    const float* levels   );
+
+static int      check_levels (
+                    const char*  path,
+                    int          numHists,
+                    double       seconds,
+                    const float* levels   );
+
+static void     fill_two_modes ( SNR_HIST** hist, uint32_t* state );
+
+static void     add_mode (
+                    SNR_HIST** hist,
+                    float      from,
+                    float      dist,
+                    double     mean,
+                    double     sigma,
+                    int        count,
+                    uint32_t*  state  );
+
+static uint32_t next_random ( uint32_t* state );
+
+static double   uniform ( uint32_t* state );
+
+static double   gaussian ( uint32_t* state );
+
+static double   now_seconds ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    int         numHists  = 2000;
+    uint32_t    state     = 2463534242u;
+    const char* writePath = NULL;
+    const char* checkPath = NULL;
+    int         opt;
+
+    while ( ( opt = getopt( argc, argv, "n:s:w:c:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'n': numHists  = atoi( optarg );                      break;
+          case 's': state     = (uint32_t)strtoul( optarg, NULL, 0 ); break;
+          case 'w': writePath = optarg;                               break;
+          case 'c': checkPath = optarg;                               break;
+
+          default:
+            fprintf( stderr, "usage: %s [-n histograms] [-s seed] "
+                             "[-w levels | -c levels]\n", argv[0]  );
+            return 1;
+        }
+    }
+
+    if ( numHists < 1 || state == 0 ) {
+
+        fprintf( stderr, "bad count or seed\n" );
+        return 1;
+    }
+
+    SNR_HIST** hist   = init_hist( SNR_NUM_BINS, SNR_LOW_DB, SNR_HIGH_DB );
+    float*     levels = malloc( sizeof(float) * 2 * numHists );
+
+    if ( hist == NULL || levels == NULL ) {
+
+        free_hist( hist, SNR_NUM_BINS );
+        free( levels );
+        return 1;
+    }
+
+    double seconds = 0.0;
+
+    for ( int h = 0; h < numHists; h++ ) {
+
+        fill_two_modes( hist, &state );
+
+        double t0 = now_seconds();
+
+        snr( hist, SNR_NUM_BINS, SNR_PEAK_LEVEL,
+             &levels[ 2 * h ], &levels[ 2 * h + 1 ] );
+
+        seconds += now_seconds() - t0;
+    }
+
+    free_hist( hist, SNR_NUM_BINS );
+
+    printf( "%s fit: %10.2f us per histogram\n",
+            SNR_USE_FIT_TABLES ? "tabulated " : "full width",
+            seconds * 1e6 / numHists                          );
+
+    int status = 0;
+
+    if ( writePath != NULL ) {
+
+        status = write_levels( writePath, numHists, seconds, levels );
+    }
+    else if ( checkPath != NULL ) {
+
+        status = check_levels( checkPath, numHists, seconds, levels );
+    }
+
+    free( levels );
+
+    return status;
+}
+
+
+/** @brief write the levels of the histograms after their count and the time
+ *         of the fits.
+ *
+ *  @return 0 on success, 1 on failure.
+ */
+static int write_levels(
+    const char*  path,
+    int          numHists,
+    double       seconds,
+    const float* levels
+) {
+    FILE* fp = fopen( path, "wb" );
+
+    if ( fp == NULL ) {
+
+        fprintf( stderr, "can not write %s\n", path );
+        return 1;
+    }
+
+    int ok =    fwrite( &numHists, sizeof(int),    1, fp ) == 1
+             && fwrite( &seconds,  sizeof(double), 1, fp ) == 1
+             && fwrite( levels, sizeof(float), 2 * (size_t)numHists, fp )
+                                                   == 2 * (size_t)numHists;
+
+    if ( fclose( fp ) != 0 || !ok ) {
+
+        fprintf( stderr, "can not write %s\n", path );
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/** @brief compare the levels against those written by the other build, and
+ *         report the time of both fits.
+ *
+ *  @return 0 if all the levels are identical, 1 otherwise.
+ */
+static int check_levels(
+    const char*  path,
+    int          numHists,
+    double       seconds,
+    const float* levels
+) {
+    FILE*  fp          = fopen( path, "rb" );
+    int    numExpected = 0;
+    double fullSeconds = 0.0;
+    float  expected[2];
+    int    numDiffs    = 0;
+
+    if (    fp == NULL
+         || fread( &numExpected, sizeof(int),    1, fp ) != 1
+         || fread( &fullSeconds, sizeof(double), 1, fp ) != 1
+         || numExpected != numHists                            ) {
+
+        fprintf( stderr, "can not read %d histograms from %s\n",
+                 numHists, path                                 );
+        if ( fp != NULL ) {
+            fclose( fp );
+        }
+        return 1;
+    }
+
+    for ( int h = 0; h < numHists; h++ ) {
+
+        if ( fread( expected, sizeof(float), 2, fp ) != 2 ) {
+
+            fprintf( stderr, "%s ends at histogram %d\n", path, h );
+            fclose( fp );
+            return 1;
+        }
+
+        if (    levels[ 2 * h ]     != expected[0]
+             || levels[ 2 * h + 1 ] != expected[1] ) {
+
+            if ( numDiffs < 10 ) {
+
+                printf( "histogram %d: noise %.4f / %.4f dB, "
+                        "speech %.4f / %.4f dB\n",
+                        h, levels[ 2 * h ], expected[0],
+                        levels[ 2 * h + 1 ], expected[1] );
+            }
+
+            numDiffs++;
+        }
+    }
+
+    fclose( fp );
+
+    printf( "%d histograms, %d with different levels\n",
+            numHists, numDiffs                             );
+    printf( "full width fit: %10.2f us per histogram (%.2fx)\n",
+            fullSeconds * 1e6 / numHists,
+            ( seconds > 0.0 ) ? fullSeconds / seconds : 0.0 );
+    printf( "checks: %s\n", ( numDiffs == 0 ) ? "OK" : "FAILED" );
+
+    return ( numDiffs == 0 ) ? 0 : 1;
+}
+
+
+/** @brief a noise mode of 1.5-4 dB deviation at 10-50 dB, and a speech mode
+ *         of 4-8 dB deviation 10-35 dB above it, of random frame counts.
+ */
+static void fill_two_modes( SNR_HIST** hist, uint32_t* state )
+{
+    float  from        = hist [0]->from;
+    float  dist        = hist [SNR_NUM_BINS - 1]->to - from;
+    double noiseMean   = 10.0 + 40.0 * uniform( state );
+    double noiseSigma  =  1.5 +  2.5 * uniform( state );
+    double speechMean  = noiseMean + 10.0 + 25.0 * uniform( state );
+    double speechSigma =  4.0 +  4.0 * uniform( state );
+    int    noiseCount  = 2000 + (int)( 18000 * uniform( state ) );
+    int    speechCount = 1000 + (int)( 19000 * uniform( state ) );
+
+    erase_hist( hist, SNR_NUM_BINS );
+
+    add_mode( hist, from, dist, noiseMean,  noiseSigma,  noiseCount,  state );
+    add_mode( hist, from, dist, speechMean, speechSigma, speechCount, state );
+}
+
+
+/** @brief count the frame powers drawn from a normal distribution in [dB]
+ *         into the bins, as the analysis does.
+ */
+static void add_mode(
+    SNR_HIST** hist,
+    float      from,
+    float      dist,
+    double     mean,
+    double     sigma,
+    int        count,
+    uint32_t*  state
+) {
+    for ( int i = 0; i < count; i++ ) {
+
+        int index = pwr_bin( (float)( mean + sigma * gaussian( state ) ),
+                             SNR_NUM_BINS,
+                             from,
+                             dist                                        );
+        if ( index >= 0 ) {
+            hist [ index ]->count++;
+        }
+    }
+}
+
+
+/** @brief xorshift32 */
+static uint32_t next_random( uint32_t* state )
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+
+    return x;
+}
+
+
+static double uniform( uint32_t* state )
+{
+    return ( next_random( state ) + 1.0 ) / 4294967297.0;
+}
+
+
+/** @brief Box-Muller */
+static double gaussian( uint32_t* state )
+{
+    double u = uniform( state );
+    double v = uniform( state );
+
+    return sqrt( -2.0 * log( u ) ) * cos( 2.0 * SNR_PI * v );
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,449 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *
+ * Memory guard of the analysis engine on multi-hour recordings.
+ *
+ * It writes a synthetic RF64 wave file of 10 hours by default, in 48kHz
+ * stereo, whose data exceeds 4GB, with speech-like bursts of noise over a
+ * steady background noise at a known SNR. Then it runs estimateSNR() and
+ * estimateSNRTimeline() on it, and checks the results and that the peak
+ * resident set size of the process, ru_maxrss of getrusage(), stays within
+ * the budget, 32MB by default, whatever the length of the recording.
+ * The exit status is non-zero if any check fails.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -pthread -IiOSRecorderWithVUMeter -o snrLongCheck \
+ *      tools/snrLongCheck.c                                   \
+ *      iOSRecorderWithVUMeter/estimateSNR.c                   \
+ *      iOSRecorderWithVUMeter/jobRunner.c                     \
+ *      iOSRecorderWithVUMeter/sampleMinMax.c                  \
+ *      iOSRecorderWithVUMeter/waveFile.c -lm
+ *
+ * Usage:
+ *
+ *   snrLongCheck [-s seconds] [-r rate] [-c channels] [-b budget MB]
+ *                [-t tolerance dB] [-d directory] [-k]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "estimateSNR.h"
+#include "waveFile.h"
+
+#define SLC_PATTERN_SECONDS 10       /* repeated to make the file quickly */
+#define SLC_NOISE_DB        30.0     /* 10 log10 of the noise power */
+#define SLC_SNR_DB          20.0
+#define SLC_RAMP_SECONDS    0.01
+#define SLC_WINDOW_SECONDS  10.0f
+#define SLC_HOP_SECONDS     1.0f
+#define SLC_HEADER_BYTES    80       /* RF64, ds64, fmt and data headers */
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      generate_rf64 (
+                    const char* path,
+                    double      seconds,
+                    int         sample_rate,
+                    int         num_channels );
+
+static void     put_le16 ( unsigned char* p, uint32_t v );
+
+static void     put_le32 ( unsigned char* p, uint32_t v );
+
+static void     put_le64 ( unsigned char* p, uint64_t v );
+
+static long     max_rss_kb ( void );
+
+static int      check ( const char* what, int ok, double value );
+
+static uint32_t next_random ( uint32_t* state );
+
+static double   uniform ( uint32_t* state );
+
+static double   gaussian ( uint32_t* state );
+
+static double   now_seconds ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    double seconds     = 36000.0;
+    int    sampleRate  = 48000;
+    int    numChannels = 2;
+    double budgetMB    = 32.0;
+    double tolerance   = 2.0;
+    char*  dir         = "/tmp";
+    int    keep        = 0;
+    int    numFailed   = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "s:r:c:b:t:d:k" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 's': seconds     = atof( optarg ); break;
+          case 'r': sampleRate  = atoi( optarg ); break;
+          case 'c': numChannels = atoi( optarg ); break;
+          case 'b': budgetMB    = atof( optarg ); break;
+          case 't': tolerance   = atof( optarg ); break;
+          case 'd': dir         = optarg;         break;
+          case 'k': keep        = 1;              break;
+
+          default:
+            fprintf( stderr,
+                     "usage: %s [-s seconds] [-r rate] [-c channels] "
+                     "[-b budget MB] [-t tolerance dB] [-d directory] "
+                     "[-k]\n",
+                     argv[0]                                           );
+            return 1;
+        }
+    }
+
+    if (    seconds < 2.0 * SLC_WINDOW_SECONDS
+         || sampleRate < 8000 || numChannels < 1 ) {
+
+        fprintf( stderr, "bad length, rate or channels\n" );
+        return 1;
+    }
+
+    char path [ 1024 ];
+
+    snprintf( path, sizeof(path), "%s/snrLongCheck_%.0fs.wav",
+              dir, seconds                                    );
+
+    int64_t numSamples = (int64_t)( seconds * sampleRate ) * numChannels;
+    double  gigabytes  = numSamples * 2.0 / 1e9;
+
+    printf( "%s: %.0f sec, %d Hz, %d ch, %.2f GB, SNR %.1f dB\n",
+            path, seconds, sampleRate, numChannels, gigabytes, SLC_SNR_DB );
+
+    double t0 = now_seconds();
+
+    if ( generate_rf64( path, seconds, sampleRate, numChannels ) != 0 ) {
+
+        fprintf( stderr, "can not write %s\n", path );
+        unlink( path );
+        return 1;
+    }
+
+    printf( "generate: %.1f sec\n", now_seconds() - t0 );
+
+    WAVE_FILE_INFO info;
+    FILE*          fp = fopen( path, "rb" );
+
+    if ( fp == NULL || readWaveFileInfo( fp, &info ) != 0 ) {
+
+        fprintf( stderr, "can not read %s\n", path );
+        return 1;
+    }
+
+    fclose( fp );
+
+    numFailed += check( "RF64 samples", info.totalSamples == numSamples,
+                        (double)info.totalSamples                       );
+
+    float noiseLevel  = 0.0f;
+    float speechLevel = 0.0f;
+
+    t0 = now_seconds();
+
+    int result = estimateSNR( path, &noiseLevel, &speechLevel );
+
+    printf( "estimateSNR: %.1f sec, noise %.2f dB, speech %.2f dB\n",
+            now_seconds() - t0, noiseLevel, speechLevel              );
+
+    numFailed += check( "estimateSNR SNR [dB]",
+                           result == 0
+                        && fabs( speechLevel - noiseLevel - SLC_SNR_DB )
+                           <= tolerance,
+                        speechLevel - noiseLevel                         );
+
+    t0 = now_seconds();
+
+    SNR_TIMELINE* timeline = estimateSNRTimeline( path,
+                                                  SLC_WINDOW_SECONDS,
+                                                  SLC_HOP_SECONDS     );
+
+    printf( "estimateSNRTimeline: %.1f sec\n", now_seconds() - t0 );
+
+    if ( timeline == NULL ) {
+
+        numFailed += check( "estimateSNRTimeline", 0, 0.0 );
+    }
+    else {
+
+        double expected = ( seconds - SLC_WINDOW_SECONDS ) / SLC_HOP_SECONDS
+                          + 1.0;
+        double sumSNR   = 0.0;
+
+        for ( int64_t i = 0; i < timeline->numWindows; i++ ) {
+
+            sumSNR += timeline->speechLevels[i] - timeline->noiseLevels[i];
+        }
+
+        double meanSNR = ( timeline->numWindows > 0 )
+                         ? sumSNR / timeline->numWindows : 0.0;
+
+        numFailed += check( "timeline windows",
+                            fabs( timeline->numWindows - expected ) <= 1.0,
+                            (double)timeline->numWindows                  );
+
+        numFailed += check( "timeline mean SNR [dB]",
+                            fabs( meanSNR - SLC_SNR_DB ) <= tolerance,
+                            meanSNR                                   );
+
+        freeSNRTimeline( timeline );
+    }
+
+    /* In kilobytes on Linux. */
+    double maxRSSMB = max_rss_kb() / 1024.0;
+
+    numFailed += check( "peak RSS [MB]", maxRSSMB <= budgetMB, maxRSSMB );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    if ( !keep ) {
+        unlink( path );
+    }
+
+    return ( numFailed == 0 ) ? 0 : 1;
+}
+
+
+/** @brief write an RF64 (EBU Tech 3306) wave file of a steady white
+ *         background noise at SLC_NOISE_DB with bursts of white noise,
+ *         ramped in and out like syllables, at SLC_SNR_DB above the
+ *         background. The first SLC_PATTERN_SECONDS are repeated, so that
+ *         the memory used does not depend on the length.
+ */
+static int generate_rf64(
+    const char* path,
+    double      seconds,
+    int         sampleRate,
+    int         numChannels
+) {
+    int64_t  numFrames     = (int64_t)( seconds * sampleRate );
+    int64_t  patternFrames = (int64_t)SLC_PATTERN_SECONDS * sampleRate;
+    uint32_t state         = 12345;
+    double   noiseSigma    = sqrt( pow( 10.0, SLC_NOISE_DB / 10.0 ) );
+    double   burstSigma    = noiseSigma
+                             * sqrt( pow( 10.0, SLC_SNR_DB / 10.0 ) - 1.0 );
+    int      rampFrames    = (int)( SLC_RAMP_SECONDS * sampleRate );
+
+    if ( patternFrames > numFrames ) {
+        patternFrames = numFrames;
+    }
+
+    short* pattern = (short*)malloc( sizeof(short) * patternFrames
+                                                   * numChannels   );
+    if ( pattern == NULL ) {
+        return -1;
+    }
+
+    /* Bursts of 0.2-1.2 sec and gaps of 0.1-0.8 sec. */
+    int64_t burstBegin = 0;
+    int64_t burstEnd   = 0;
+
+    for ( int64_t i = 0; i < patternFrames; i++ ) {
+
+        if ( i >= burstEnd ) {
+
+            burstBegin = i + (int64_t)( ( 0.1 + 0.7 * uniform( &state ) )
+                                        * sampleRate                      );
+            burstEnd   = burstBegin
+                         + (int64_t)( ( 0.2 + 1.0 * uniform( &state ) )
+                                      * sampleRate                      );
+        }
+
+        double envelope = 0.0;
+
+        if ( i >= burstBegin ) {
+
+            int64_t fromBegin = i - burstBegin;
+            int64_t toEnd     = burstEnd - i;
+            int64_t edge      = ( fromBegin < toEnd ) ? fromBegin : toEnd;
+
+            envelope = ( edge >= rampFrames )
+                       ? 1.0
+                       : 0.5 - 0.5 * cos( M_PI * edge / rampFrames );
+        }
+
+        for ( int c = 0; c < numChannels; c++ ) {
+
+            double y = noiseSigma * gaussian( &state )
+                       + envelope * burstSigma * gaussian( &state );
+
+            y = ( y >  32767.0 ) ?  32767.0 : y;
+            y = ( y < -32768.0 ) ? -32768.0 : y;
+
+            pattern[ i * numChannels + c ] = (short)lrint( y );
+        }
+    }
+
+    FILE* fp = fopen( path, "wb" );
+
+    if ( fp == NULL ) {
+
+        free( pattern );
+        return -1;
+    }
+
+    /* The 32-bit sizes are all 0xFFFFFFFF, and the real ones in ds64. */
+    unsigned char header [ SLC_HEADER_BYTES ];
+    uint64_t      dataSize = (uint64_t)numFrames * numChannels * 2;
+
+    memset( header, 0, sizeof(header) );
+
+    memcpy( &(header[0]),  "RF64", 4 );
+    put_le32( &(header[4]), 0xFFFFFFFF );
+    memcpy( &(header[8]),  "WAVEds64", 8 );
+    put_le32( &(header[16]), 28 );
+    put_le64( &(header[20]), dataSize + SLC_HEADER_BYTES - 8 );
+    put_le64( &(header[28]), dataSize );
+    put_le64( &(header[36]), (uint64_t)numFrames );
+    put_le32( &(header[44]), 0 );                 /* no table */
+    memcpy( &(header[48]), "fmt ", 4 );
+    put_le32( &(header[52]), 16 );
+    put_le16( &(header[56]), 1 );                 /* PCM */
+    put_le16( &(header[58]), (uint32_t)numChannels );
+    put_le32( &(header[60]), (uint32_t)sampleRate );
+    put_le32( &(header[64]), (uint32_t)sampleRate * numChannels * 2 );
+    put_le16( &(header[68]), (uint32_t)numChannels * 2 );
+    put_le16( &(header[70]), 16 );                /* bits per sample */
+    memcpy( &(header[72]), "data", 4 );
+    put_le32( &(header[76]), 0xFFFFFFFF );
+
+    int rtnVal = ( fwrite( header, 1, sizeof(header), fp ) == sizeof(header) )
+                 ? 0 : -1;
+
+    for ( int64_t i = 0; rtnVal == 0 && i < numFrames; i += patternFrames ) {
+
+        int64_t n = ( numFrames - i < patternFrames ) ? numFrames - i
+                                                      : patternFrames;
+
+        if ( (int64_t)fwrite( pattern, sizeof(short) * numChannels, n, fp )
+             != n ) {
+            rtnVal = -1;
+        }
+    }
+
+    free( pattern );
+
+    if ( fclose( fp ) != 0 ) {
+        rtnVal = -1;
+    }
+
+    return rtnVal;
+}
+
+
+static void put_le16( unsigned char* p, uint32_t v )
+{
+    p[0] = (unsigned char)( v      );
+    p[1] = (unsigned char)( v >> 8 );
+}
+
+
+static void put_le32( unsigned char* p, uint32_t v )
+{
+    put_le16( p,     v       );
+    put_le16( p + 2, v >> 16 );
+}
+
+
+static void put_le64( unsigned char* p, uint64_t v )
+{
+    put_le32( p,     (uint32_t)v         );
+    put_le32( p + 4, (uint32_t)( v >> 32 ) );
+}
+
+
+static long max_rss_kb( void )
+{
+    struct rusage usage;
+
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 ) {
+        return -1;
+    }
+
+    return usage.ru_maxrss;
+}
+
+
+static int check( const char* what, int ok, double value )
+{
+    printf( "%-40s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+/** @brief xorshift32 */
+static uint32_t next_random( uint32_t* state )
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+
+    return x;
+}
+
+
+static double uniform( uint32_t* state )
+{
+    return ( next_random( state ) + 1.0 ) / 4294967297.0;
+}
+
+
+/** @brief Box-Muller */
+static double gaussian( uint32_t* state )
+{
+    double u = uniform( state );
+    double v = uniform( state );
+
+    return sqrt( -2.0 * log( u ) ) * cos( 2.0 * M_PI * v );
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
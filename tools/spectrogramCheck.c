@@ -0,0 +1,640 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Checks and benchmark of the spectrogram tiles spectrogramTiles.c.
+ *
+ * It writes a wave file of an hour by default, a tone on the centre of a
+ * bin in the first half and on another bin in the second half, over a
+ * faint noise. It times the tiles of level 0 computed on one thread and
+ * on JOB_MAX_THREADS threads, which must be the same byte for byte, and
+ * the image of the whole file. It checks that the tone is in its bin at
+ * level 0 and at the top level, that the sidecar reopened has all the
+ * tiles, and that tiles stored from many threads at once into the same
+ * slots are each stored once and read back intact.
+ * The exit status is non-zero if any check fails.
+ *
+ * spectrogramTiles.c is included, not linked, to reach store_tile() and to
+ * run the jobs on a given number of threads whatever the cores.
+ *
+ * Build on Linux from the top directory, optionally with
+ * -fsanitize=thread:
+ *
+ *   cc -O2 -pthread -IiOSRecorderWithVUMeter -o spectrogramCheck \
+ *      tools/spectrogramCheck.c                                  \
+ *      iOSRecorderWithVUMeter/jobRunner.c                        \
+ *      iOSRecorderWithVUMeter/realFFT.c                          \
+ *      iOSRecorderWithVUMeter/sidecarFile.c                      \
+ *      iOSRecorderWithVUMeter/waveFile.c -lm
+ *
+ * Usage:
+ *
+ *   spectrogramCheck [-s seconds] [-r rate] [-d directory] [-k]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <time.h>
+
+#include "spectrogramTiles.c"
+
+#define SPC_AMPLITUDE    8000.0
+#define SPC_NOISE        16       /* samples of noise in [-16, 16] */
+#define SPC_BIN_FIRST    64       /* of the tone in the first half  */
+#define SPC_BIN_SECOND   160      /* of the tone in the second half */
+#define SPC_BLOCK        65536    /* frames written at once */
+#define SPC_IMAGE_WIDTH  1920
+#define SPC_PI           3.14159265358979323846
+
+/** @brief a job storing every slot, from its own slot onwards */
+typedef struct spc_store_job {
+
+    SPECTROGRAM* spectrogram;
+    int          jobIndex;
+    int          numJobs;
+
+} SPC_STORE_JOB;
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      generate_wave ( const char* path, double seconds, int rate );
+
+static int      compute_level ( SPECTROGRAM* spectrogram, int level,
+                                int num_jobs                          );
+
+static int      hash_level    ( SPECTROGRAM* spectrogram, int level,
+                                uint64_t* hashes                      );
+
+static int      peak_bin      ( SPECTROGRAM* spectrogram, int level,
+                                double fraction                       );
+
+static int      check_stores  ( const char* path, const char* sidecar );
+
+static void*    store_tiles_job ( void* p );
+
+static void     pattern_tile  ( int64_t slot, unsigned char* tile );
+
+static int64_t  file_size     ( const char* path );
+
+static void     put_le16      ( unsigned char* p, uint16_t v );
+
+static void     put_le32      ( unsigned char* p, uint32_t v );
+
+static int      check         ( const char* what, int ok, double value );
+
+static uint32_t next_random   ( uint32_t* state );
+
+static double   now_seconds   ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    double seconds   = 3600.0;
+    int    rate      = 48000;
+    char*  dir       = "/tmp";
+    int    keep      = 0;
+    int    numFailed = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "s:r:d:k" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 's': seconds = atof( optarg ); break;
+          case 'r': rate    = atoi( optarg ); break;
+          case 'd': dir     = optarg;         break;
+          case 'k': keep    = 1;              break;
+
+          default:
+            fprintf( stderr,
+                     "usage: %s [-s seconds] [-r rate] [-d directory] [-k]\n",
+                     argv[0]                                                 );
+            return 1;
+        }
+    }
+
+    if ( seconds < 10.0 || rate < 8000 ) {
+
+        fprintf( stderr, "bad length or rate\n" );
+        return 1;
+    }
+
+    char path [ 1024 ];
+
+    snprintf( path, sizeof(path), "%s/spectrogramCheck_%.0fs.wav",
+              dir, seconds                                        );
+
+    char* sidecar = sidecarPathFor( path, SPG_SIDECAR_EXTENSION );
+
+    if ( sidecar == NULL || generate_wave( path, seconds, rate ) != 0 ) {
+
+        fprintf( stderr, "can not write %s\n", path );
+        return 1;
+    }
+
+    unlink( sidecar );
+
+    printf( "%s: %.0f sec, %d Hz, tones in bins %d and %d\n",
+            path, seconds, rate, SPC_BIN_FIRST, SPC_BIN_SECOND );
+
+    /* Level 0 on one thread, and the image of the whole file. */
+    double       t0          = now_seconds();
+    SPECTROGRAM* spectrogram = openSpectrogram( path );
+
+    if ( spectrogram == NULL ) {
+
+        fprintf( stderr, "can not open %s\n", path );
+        return 1;
+    }
+
+    int       numTiles   = (int)spectrogram->levelTiles[ 0 ];
+    int       topLevel   = spectrogram->numLevels - 1;
+    int64_t   numSamples = spectrogram->numFrames;
+    uint64_t* hashes1    = (uint64_t*)calloc( numTiles, sizeof(uint64_t) );
+    uint64_t* hashesN    = (uint64_t*)calloc( numTiles, sizeof(uint64_t) );
+
+    if ( hashes1 == NULL || hashesN == NULL ) {
+        return 1;
+    }
+
+    printf( "open:                      %8.3f sec\n", now_seconds() - t0 );
+
+    t0 = now_seconds();
+    numFailed += check( "level 0, 1 thread",
+                        compute_level( spectrogram, 0, 1 ) == 0,
+                        (double)numTiles                         );
+    double elapsed1 = now_seconds() - t0;
+
+    printf( "level 0, 1 thread:         %8.3f sec, %.0fx real time\n",
+            elapsed1, seconds / elapsed1                             );
+
+    t0 = now_seconds();
+    unsigned char* image = computeSpectrogramImage( spectrogram, 0,
+                                                    numSamples,
+                                                    SPC_IMAGE_WIDTH,
+                                                    SPG_TILE_BINS    );
+    printf( "image of the file:         %8.3f sec\n", now_seconds() - t0 );
+    free( image );
+
+    numFailed += check( "tile hashes, 1 thread",
+                        hash_level( spectrogram, 0, hashes1 ) == 0, 0 );
+
+    int bin = peak_bin( spectrogram, 0, 0.25 );
+    numFailed += check( "level 0, bin of the first tone",
+                        bin == SPC_BIN_FIRST, bin             );
+
+    bin = peak_bin( spectrogram, 0, 0.75 );
+    numFailed += check( "level 0, bin of the second tone",
+                        bin == SPC_BIN_SECOND, bin            );
+
+    bin = peak_bin( spectrogram, topLevel, 0.25 );
+    numFailed += check( "top level, bin of the first tone",
+                        bin == SPC_BIN_FIRST, bin             );
+
+    bin = peak_bin( spectrogram, topLevel, 0.75 );
+    numFailed += check( "top level, bin of the second tone",
+                        bin == SPC_BIN_SECOND, bin            );
+
+    freeSpectrogram( spectrogram );
+
+    /* The sidecar reopened has every tile computed. */
+    t0          = now_seconds();
+    spectrogram = openSpectrogram( path );
+
+    printf( "reopen:                    %8.3f sec\n", now_seconds() - t0 );
+
+    int numCached = 0;
+
+    for ( int i = 0; spectrogram != NULL && i < numTiles; i++ ) {
+        numCached += ( spectrogram->tileOffsets[ i ] != 0 );
+    }
+
+    numFailed += check( "reopened, tiles of level 0 cached",
+                        numCached == numTiles, numCached    );
+
+    if ( spectrogram != NULL ) {
+
+        t0 = now_seconds();
+        image = computeSpectrogramImage( spectrogram, 0, numSamples,
+                                         SPC_IMAGE_WIDTH, SPG_TILE_BINS );
+        printf( "image of the file, cached: %8.3f sec\n", now_seconds() - t0 );
+        free( image );
+
+        numFailed += check( "reopened, same tiles",
+                               hash_level( spectrogram, 0, hashesN ) == 0
+                            && memcmp( hashes1, hashesN,
+                                       sizeof(uint64_t) * numTiles ) == 0,
+                            0                                            );
+        freeSpectrogram( spectrogram );
+    }
+
+    /* Level 0 on many threads into a new sidecar. */
+    unlink( sidecar );
+    memset( hashesN, 0, sizeof(uint64_t) * numTiles );
+    spectrogram = openSpectrogram( path );
+
+    if ( spectrogram == NULL ) {
+        return 1;
+    }
+
+    t0 = now_seconds();
+    int rtnVal = compute_level( spectrogram, 0, JOB_MAX_THREADS );
+    double elapsedN = now_seconds() - t0;
+
+    printf( "level 0, %d threads:        %8.3f sec, %.0fx real time\n",
+            JOB_MAX_THREADS, elapsedN, seconds / elapsedN            );
+
+    int64_t tilesBegin = (int64_t)( sizeof(struct SPG_SIDECAR)
+                                    + sizeof(int64_t) * spectrogram->numTiles );
+
+    numFailed += check( "threads, same tiles as 1 thread",
+                           rtnVal == 0
+                        && hash_level( spectrogram, 0, hashesN ) == 0
+                        && memcmp( hashes1, hashesN,
+                                   sizeof(uint64_t) * numTiles ) == 0,
+                        JOB_MAX_THREADS                               );
+
+    numFailed += check( "threads, each tile stored once",
+                        file_size( sidecar )
+                        == tilesBegin + (int64_t)numTiles * SPG_TILE_BYTES,
+                        (double)file_size( sidecar )                       );
+
+    freeSpectrogram( spectrogram );
+
+    numFailed += check_stores( path, sidecar );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    if ( !keep ) {
+        unlink( sidecar );
+        unlink( path );
+    }
+
+    free( sidecar );
+    free( hashes1 );
+    free( hashesN );
+
+    return ( numFailed == 0 ) ? 0 : 2;
+}
+
+
+/** @brief write a mono wave file of a tone on the centre of the bin
+ *         SPC_BIN_FIRST in the first half and of SPC_BIN_SECOND in the
+ *         second half, over a faint uniform noise.
+ */
+static int generate_wave( const char* path, double seconds, int rate )
+{
+    int64_t       numFrames = (int64_t)( seconds * rate );
+    uint32_t      dataSize  = (uint32_t)( numFrames * sizeof(short) );
+    uint32_t      state     = 12345;
+    unsigned char header [ 44 ];
+
+    memcpy( &(header[0]),  "RIFF", 4 );
+    put_le32( &(header[4]),  36 + dataSize );
+    memcpy( &(header[8]),  "WAVEfmt ", 8 );
+    put_le32( &(header[16]), 16 );
+    put_le16( &(header[20]), 1 );
+    put_le16( &(header[22]), 1 );
+    put_le32( &(header[24]), (uint32_t)rate );
+    put_le32( &(header[28]), (uint32_t)( rate * 2 ) );
+    put_le16( &(header[32]), 2 );
+    put_le16( &(header[34]), 16 );
+    memcpy( &(header[36]), "data", 4 );
+    put_le32( &(header[40]), dataSize );
+
+    short* block = (short*)malloc( sizeof(short) * SPC_BLOCK );
+    FILE*  fp    = fopen( path, "wb" );
+
+    if ( block == NULL || fp == NULL ) {
+
+        free( block );
+
+        if ( fp != NULL ) {
+            fclose( fp );
+        }
+        return -1;
+    }
+
+    int written = fwrite( header, 1, sizeof(header), fp ) == sizeof(header);
+
+    for ( int64_t i = 0; written && i < numFrames; i += SPC_BLOCK ) {
+
+        int64_t n = ( SPC_BLOCK < numFrames - i ) ? SPC_BLOCK : numFrames - i;
+
+        for ( int64_t j = 0; j < n; j++ ) {
+
+            int64_t t   = i + j;
+            int     bin = ( t < numFrames / 2 ) ? SPC_BIN_FIRST
+                                                : SPC_BIN_SECOND;
+
+            /* The phase is exact over the period of SPG_FFT_SIZE samples. */
+            double  tone = SPC_AMPLITUDE
+                           * sin( 2.0 * SPC_PI * bin * ( t % SPG_FFT_SIZE )
+                                  / SPG_FFT_SIZE                            );
+            int     noise = (int)( next_random( &state )
+                                   % ( 2 * SPC_NOISE + 1 ) ) - SPC_NOISE;
+
+            block[j] = (short)( lrint( tone ) + noise );
+        }
+
+        written = fwrite( block, sizeof(short), (size_t)n, fp ) == (size_t)n;
+    }
+
+    written = ( fclose(fp) == 0 ) && written;
+
+    free( block );
+
+    return written ? 0 : -1;
+}
+
+
+/** @brief compute every tile of the level on num_jobs threads, as
+ *         prepareSpectrogramTiles() does on the cores.
+ */
+static int compute_level( SPECTROGRAM* spectrogram, int level, int numJobs )
+{
+    int64_t      numIndices = spectrogram->levelTiles[ level ];
+    int64_t*     indices    = (int64_t*)malloc( sizeof(int64_t) * numIndices );
+    SPG_TILE_JOB jobs [ JOB_MAX_THREADS ];
+
+    if ( indices == NULL ) {
+        return -1;
+    }
+
+    for ( int64_t i = 0; i < numIndices; i++ ) {
+        indices[i] = i;
+    }
+
+    for ( int j = 0; j < numJobs; j++ ) {
+
+        jobs[j].spectrogram = spectrogram;
+        jobs[j].level       = level;
+        jobs[j].indices     = indices;
+        jobs[j].numIndices  = numIndices;
+        jobs[j].jobIndex    = j;
+        jobs[j].numJobs     = numJobs;
+        jobs[j].rtnVal      = 0;
+    }
+
+    runJobs( compute_tiles_job, jobs, sizeof(SPG_TILE_JOB), numJobs );
+
+    free( indices );
+
+    for ( int j = 0; j < numJobs; j++ ) {
+
+        if ( jobs[j].rtnVal != 0 ) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/** @brief FNV-1a of each tile of the level */
+static int hash_level( SPECTROGRAM* spectrogram, int level, uint64_t* hashes )
+{
+    unsigned char* tile = (unsigned char*)malloc( SPG_TILE_BYTES );
+
+    if ( tile == NULL ) {
+        return -1;
+    }
+
+    for ( int64_t i = 0; i < spectrogram->levelTiles[ level ]; i++ ) {
+
+        if ( readSpectrogramTile( spectrogram, level, i, tile ) != 0 ) {
+
+            free( tile );
+            return -1;
+        }
+
+        uint64_t hash = 0xcbf29ce484222325ULL;
+
+        for ( int k = 0; k < SPG_TILE_BYTES; k++ ) {
+            hash = ( hash ^ tile[k] ) * 0x100000001b3ULL;
+        }
+
+        hashes[i] = hash;
+    }
+
+    free( tile );
+
+    return 0;
+}
+
+
+/** @brief the loudest bin of the frame of the level at the fraction of the
+ *         file, or -1 on failure.
+ */
+static int peak_bin( SPECTROGRAM* spectrogram, int level, double fraction )
+{
+    unsigned char* tile  = (unsigned char*)malloc( SPG_TILE_BYTES );
+    int64_t        frame = (int64_t)( fraction * spectrogram->numFrames )
+                           / ( (int64_t)SPG_HOP << level );
+    int            peak  = -1;
+
+    if (    tile != NULL
+         && readSpectrogramTile( spectrogram, level, frame / SPG_TILE_FRAMES,
+                                 tile                                        )
+            == 0                                                             ) {
+
+        const unsigned char* row = &(tile[ ( frame % SPG_TILE_FRAMES )
+                                           * SPG_TILE_BINS             ]);
+        peak = 0;
+
+        for ( int k = 1; k < SPG_TILE_BINS; k++ ) {
+
+            if ( row[k] > row[peak] ) {
+                peak = k;
+            }
+        }
+    }
+
+    free( tile );
+
+    return peak;
+}
+
+
+/** @brief JOB_MAX_THREADS threads store a pattern into every slot of a new
+ *         sidecar at once, each from its own slot onwards, so that they
+ *         race for each slot. Every slot must be stored once, and read
+ *         back intact, also after a reopen.
+ */
+static int check_stores( const char* path, const char* sidecar )
+{
+    SPC_STORE_JOB jobs [ JOB_MAX_THREADS ];
+    int           failed = 0;
+
+    unlink( sidecar );
+
+    SPECTROGRAM* spectrogram = openSpectrogram( path );
+
+    if ( spectrogram == NULL ) {
+        return check( "stores, open", 0, 0 );
+    }
+
+    for ( int j = 0; j < JOB_MAX_THREADS; j++ ) {
+
+        jobs[j].spectrogram = spectrogram;
+        jobs[j].jobIndex    = j;
+        jobs[j].numJobs     = JOB_MAX_THREADS;
+    }
+
+    runJobs( store_tiles_job, jobs, sizeof(SPC_STORE_JOB), JOB_MAX_THREADS );
+
+    int64_t numSlots   = spectrogram->numTiles;
+    int64_t tilesBegin = (int64_t)( sizeof(struct SPG_SIDECAR)
+                                    + sizeof(int64_t) * numSlots );
+
+    failed |= check( "stores, each slot stored once",
+                        spectrogram->cacheEnd
+                        == tilesBegin + numSlots * SPG_TILE_BYTES
+                     && file_size( sidecar ) == spectrogram->cacheEnd,
+                     (double)numSlots                                 );
+
+    freeSpectrogram( spectrogram );
+
+    unsigned char* tile     = (unsigned char*)malloc( SPG_TILE_BYTES );
+    unsigned char* expected = (unsigned char*)malloc( SPG_TILE_BYTES );
+    int64_t        numBad   = 0;
+
+    spectrogram = openSpectrogram( path );
+
+    if ( spectrogram == NULL || tile == NULL || expected == NULL ) {
+
+        free( tile );
+        free( expected );
+        freeSpectrogram( spectrogram );
+        return check( "stores, reopen", 0, 0 );
+    }
+
+    for ( int64_t slot = 0; slot < numSlots; slot++ ) {
+
+        pattern_tile( slot, expected );
+
+        if (    read_cached_tile( spectrogram, slot, tile ) != 0
+             || memcmp( tile, expected, SPG_TILE_BYTES )   != 0 ) {
+            numBad++;
+        }
+    }
+
+    failed |= check( "stores, reopened, bad tiles", numBad == 0,
+                     (double)numBad                             );
+
+    free( tile );
+    free( expected );
+    freeSpectrogram( spectrogram );
+
+    return failed;
+}
+
+
+static void* store_tiles_job( void* p )
+{
+    SPC_STORE_JOB* job      = (SPC_STORE_JOB*)p;
+    SPECTROGRAM*   spg      = job->spectrogram;
+    int64_t        numSlots = spg->numTiles;
+    int64_t        first    = numSlots * job->jobIndex / job->numJobs;
+    unsigned char* tile     = (unsigned char*)malloc( SPG_TILE_BYTES );
+
+    if ( tile == NULL ) {
+        return NULL;
+    }
+
+    for ( int64_t i = 0; i < numSlots; i++ ) {
+
+        int64_t slot = ( first + i ) % numSlots;
+
+        pattern_tile( slot, tile );
+        store_tile( spg, slot, tile );
+    }
+
+    free( tile );
+
+    return NULL;
+}
+
+
+static void pattern_tile( int64_t slot, unsigned char* tile )
+{
+    for ( int k = 0; k < SPG_TILE_BYTES; k++ ) {
+        tile[k] = (unsigned char)( slot * 131 + k * 7 + ( k >> 8 ) );
+    }
+}
+
+
+static int64_t file_size( const char* path )
+{
+    struct stat st;
+
+    return ( stat( path, &st ) == 0 ) ? (int64_t)st.st_size : -1;
+}
+
+
+static void put_le16( unsigned char* p, uint16_t v )
+{
+    p[0] = (unsigned char)( v );
+    p[1] = (unsigned char)( v >> 8 );
+}
+
+
+static void put_le32( unsigned char* p, uint32_t v )
+{
+    p[0] = (unsigned char)( v );
+    p[1] = (unsigned char)( v >> 8 );
+    p[2] = (unsigned char)( v >> 16 );
+    p[3] = (unsigned char)( v >> 24 );
+}
+
+
+static int check( const char* what, int ok, double value )
+{
+    printf( "%-40s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,450 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Checks and benchmark of the spectrum analyzer spectrumAnalyzer.c and its
+ * real FFT realFFT.c.
+ *
+ * It compares the power spectra of random frames, tones over noise, with a
+ * naive DFT in double precision at every size of the FFT, directly and
+ * through the analyzer fed with the two channels of different frames,
+ * before and after a reset. A bin at or above the mean power of its frame
+ * must be within SPC_MAX_DB of the DFT; the bins far below it are dominated
+ * by the rounding of the loudest ones in float. Then it times the analyzer on 48kHz stereo in
+ * chunks of 10ms, which must take at most 0.3% of one core.
+ * The exit status is non-zero if any check fails.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -IiOSRecorderWithVUMeter -o spectrumCheck tools/spectrumCheck.c \
+ *      iOSRecorderWithVUMeter/realFFT.c                                   \
+ *      iOSRecorderWithVUMeter/spectrumAnalyzer.c -lm
+ *
+ * Usage:
+ *
+ *   spectrumCheck [-n fft size to time] [-s seconds to time] [-b budget %]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "realFFT.h"
+#include "spectrumAnalyzer.h"
+
+#define SPC_MIN_FFT_SIZE  64
+#define SPC_MAX_FFT_SIZE  16384
+#define SPC_FRAMES        8        /* random frames per size */
+#define SPC_MAX_DB        4.0e-5   /* off the DFT */
+#define SPC_RATE          48000
+#define SPC_CHANNELS      2
+#define SPC_CHUNK         480      /* frames fed at once, 10ms */
+#define SPC_PI            3.14159265358979323846
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      check_fft       ( void );
+
+static int      check_analyzer  ( void );
+
+static int      check_cost      ( int fft_size, double seconds,
+                                  double budget                  );
+
+static void     random_frame    ( uint32_t* state, int n, double* frame );
+
+static void     naive_dft       ( const double* frame, int n, double* power );
+
+static double   max_error_db    ( const float* power, const double* truth,
+                                  int num_bins, int in_db                 );
+
+static int      check           ( const char* what, int ok, double value );
+
+static uint32_t next_random     ( uint32_t* state );
+
+static double   gaussian        ( uint32_t* state );
+
+static double   now_seconds     ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    int    fftSize   = 1024;
+    double seconds   = 600.0;
+    double budget    = 0.3;
+    int    numFailed = 0;
+    int    opt;
+
+    while ( ( opt = getopt( argc, argv, "n:s:b:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'n': fftSize = atoi( optarg ); break;
+          case 's': seconds = atof( optarg ); break;
+          case 'b': budget  = atof( optarg ); break;
+
+          default:
+            fprintf( stderr,
+                     "usage: %s [-n fft size] [-s seconds] [-b budget %%]\n",
+                     argv[0]                                                );
+            return 1;
+        }
+    }
+
+    numFailed += check_fft();
+    numFailed += check_analyzer();
+    numFailed += check_cost( fftSize, seconds, budget );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    return ( numFailed == 0 ) ? 0 : 2;
+}
+
+
+/** @brief powerSpectrumOfFrame() against the DFT at every size */
+static int check_fft( void )
+{
+    uint32_t state  = 12345;
+    int      failed = 0;
+    double*  frame  = (double*)malloc( sizeof(double) * SPC_MAX_FFT_SIZE );
+    double*  truth  = (double*)malloc( sizeof(double)
+                                       * ( SPC_MAX_FFT_SIZE / 2 + 1 ) );
+    float*   input  = (float*) malloc( sizeof(float) * SPC_MAX_FFT_SIZE );
+    float*   work   = (float*) malloc( sizeof(float) * SPC_MAX_FFT_SIZE );
+    float*   power  = (float*) malloc( sizeof(float)
+                                       * ( SPC_MAX_FFT_SIZE / 2 + 1 ) );
+
+    if (    frame == NULL || truth == NULL || input == NULL
+         || work  == NULL || power == NULL                  ) {
+        return check( "FFT, buffers", 0, 0 );
+    }
+
+    for ( int n = SPC_MIN_FFT_SIZE; n <= SPC_MAX_FFT_SIZE; n *= 2 ) {
+
+        REAL_FFT* fft   = createRealFFT( n );
+        double    error = 0.0;
+
+        if ( fft == NULL ) {
+
+            failed |= check( "FFT, plan", 0, n );
+            continue;
+        }
+
+        for ( int f = 0; f < SPC_FRAMES; f++ ) {
+
+            random_frame( &state, n, frame );
+
+            for ( int i = 0; i < n; i++ ) {
+                input[i] = (float)frame[i];
+            }
+
+            naive_dft( frame, n, truth );
+            powerSpectrumOfFrame( fft, input, work, power );
+
+            double e = max_error_db( power, truth, n / 2 + 1, 0 );
+
+            error = ( e > error ) ? e : error;
+        }
+
+        char what [ 64 ];
+
+        snprintf( what, sizeof(what), "FFT %5d, max error [dB]", n );
+        failed |= check( what, error <= SPC_MAX_DB, error );
+
+        freeRealFFT( fft );
+    }
+
+    free( frame );
+    free( truth );
+    free( input );
+    free( work );
+    free( power );
+
+    return failed;
+}
+
+
+/** @brief the first frame of each channel through the analyzer, which is
+ *         not averaged with anything yet, against the DFT.
+ */
+static int check_analyzer( void )
+{
+    const int N      = 1024;
+    uint32_t  state  = 777;
+    int       failed = 0;
+    double    frames [ SPC_CHANNELS ][ 1024 ];
+    double    truth  [ 1024 / 2 + 1 ];
+    short     samples [ SPC_CHANNELS * 1024 ];
+
+    for ( int c = 0; c < SPC_CHANNELS; c++ ) {
+
+        random_frame( &state, N, frames[c] );
+
+        for ( int i = 0; i < N; i++ ) {
+
+            /* On the grid of the 16-bit samples. */
+            frames[c][i] = lrint( frames[c][i] );
+            samples[ i * SPC_CHANNELS + c ] = (short)frames[c][i];
+        }
+    }
+
+    SPECTRUM_ANALYZER* analyzer = createSpectrumAnalyzer( N, SPC_RATE,
+                                                          SPC_CHANNELS,
+                                                          1.0f          );
+    SPECTRUM_SNAPSHOT* snapshot = ( analyzer != NULL )
+                                  ? allocSpectrumSnapshot( analyzer ) : NULL;
+
+    if ( snapshot == NULL ) {
+
+        freeSpectrumAnalyzer( analyzer );
+        return check( "analyzer, create", 0, 0 );
+    }
+
+    /* The second session, after a reset, starts from its own first frame
+       too. */
+    for ( int session = 0; session < 2; session++ ) {
+
+        if ( session > 0 ) {
+
+            short loud [ SPC_CHANNELS * 1024 ];
+
+            for ( int i = 0; i < SPC_CHANNELS * N; i++ ) {
+                loud[i] = (short)( ( next_random( &state ) % 60001 ) - 30000 );
+            }
+
+            feedSpectrumAnalyzer( analyzer, loud, SPC_CHANNELS * N );
+            resetSpectrumAnalyzer( analyzer );
+        }
+
+        /* In uneven pieces, to cross the calls within a frame. */
+        feedSpectrumAnalyzer( analyzer, samples, 2 * 301 );
+        feedSpectrumAnalyzer( analyzer, &(samples[ 2 * 301 ]),
+                              SPC_CHANNELS * N - 2 * 301      );
+
+        int updated = readSpectrumSnapshot( analyzer, snapshot );
+
+        failed |= check( "analyzer, snapshot of a frame",
+                         updated == 1 && snapshot->numFrames == 1,
+                         (double)snapshot->numFrames               );
+
+        for ( int c = 0; c < SPC_CHANNELS; c++ ) {
+
+            const float* averageDB = &(snapshot->averageDB[ c * ( N / 2
+                                                                  + 1 ) ]);
+            char         what [ 64 ];
+
+            naive_dft( frames[c], N, truth );
+
+            double error = max_error_db( averageDB, truth, N / 2 + 1, 1 );
+
+            snprintf( what, sizeof(what), "analyzer session %d ch %d [dB]",
+                      session, c                                         );
+            failed |= check( what, error <= SPC_MAX_DB, error );
+        }
+    }
+
+    freeSpectrumSnapshot( snapshot );
+    freeSpectrumAnalyzer( analyzer );
+
+    return failed;
+}
+
+
+/** @brief feed the analyzer with seconds of 48kHz stereo noise in chunks of
+ *         10ms, and take the time per second of audio.
+ */
+static int check_cost( int fftSize, double seconds, double budget )
+{
+    uint32_t state = 4242;
+    short    samples [ SPC_CHUNK * SPC_CHANNELS ];
+
+    SPECTRUM_ANALYZER* analyzer = createSpectrumAnalyzer( fftSize, SPC_RATE,
+                                                          SPC_CHANNELS,
+                                                          1.0f            );
+    if ( analyzer == NULL ) {
+        return check( "cost, create", 0, fftSize );
+    }
+
+    for ( int i = 0; i < SPC_CHUNK * SPC_CHANNELS; i++ ) {
+        samples[i] = (short)lrint( 1000.0 * gaussian( &state ) );
+    }
+
+    int64_t numChunks = (int64_t)( seconds * SPC_RATE / SPC_CHUNK );
+    double  t0        = now_seconds();
+
+    for ( int64_t i = 0; i < numChunks; i++ ) {
+        feedSpectrumAnalyzer( analyzer, samples, SPC_CHUNK * SPC_CHANNELS );
+    }
+
+    double percent = 100.0 * ( now_seconds() - t0 )
+                     / ( (double)numChunks * SPC_CHUNK / SPC_RATE );
+
+    freeSpectrumAnalyzer( analyzer );
+
+    char what [ 64 ];
+
+    snprintf( what, sizeof(what), "cost FFT %d, %% of a core", fftSize );
+
+    return check( what, percent <= budget, percent );
+}
+
+
+/** @brief a tone of a random frequency and amplitude over white noise,
+ *         as the 16-bit samples of a microphone.
+ */
+static void random_frame( uint32_t* state, int n, double* frame )
+{
+    double freq  = ( next_random( state ) % 100000 ) / 200000.0;  /* /rate */
+    double amp   = 100.0 + ( next_random( state ) % 20000 );
+    double sigma = 1.0 + ( next_random( state ) % 1000 );
+
+    for ( int i = 0; i < n; i++ ) {
+
+        frame[i] = amp * sin( 2.0 * SPC_PI * freq * i )
+                   + sigma * gaussian( state );
+    }
+}
+
+
+/** @brief power of the frame windowed by the Hann window normalized by its
+ *         energy, as realFFT.h states, by the definition of the DFT.
+ */
+static void naive_dft( const double* frame, int n, double* power )
+{
+    double* windowed  = (double*)malloc( sizeof(double) * n );
+    double* cosines   = (double*)malloc( sizeof(double) * n );
+    double* sines     = (double*)malloc( sizeof(double) * n );
+    double  sumSquare = 0.0;
+
+    for ( int i = 0; i < n; i++ ) {
+
+        double w = 0.5 - 0.5 * cos( 2.0 * SPC_PI * i / n );
+
+        windowed[i] = frame[i] * w;
+        sumSquare  += w * w;
+        cosines[i]  = cos( -2.0 * SPC_PI * i / n );
+        sines[i]    = sin( -2.0 * SPC_PI * i / n );
+    }
+
+    for ( int k = 0; k <= n / 2; k++ ) {
+
+        double re = 0.0;
+        double im = 0.0;
+        int    j  = 0;     /* k * i mod n */
+
+        for ( int i = 0; i < n; i++ ) {
+
+            re += windowed[i] * cosines[j];
+            im += windowed[i] * sines[j];
+
+            j += k;
+            j -= ( j >= n ) ? n : 0;
+        }
+
+        power[k] = ( re * re + im * im ) / sumSquare;
+    }
+
+    free( windowed );
+    free( cosines );
+    free( sines );
+}
+
+
+/** @brief the largest difference in dB from the DFT over the bins at or
+ *         above the mean power of the frame.
+ */
+static double max_error_db(
+    const float*  power,
+    const double* truth,
+    int           numBins,
+    int           inDB
+) {
+    double mean  = 0.0;
+    double error = 0.0;
+
+    for ( int k = 0; k < numBins; k++ ) {
+        mean += truth[k];
+    }
+
+    mean /= numBins;
+
+    for ( int k = 0; k < numBins; k++ ) {
+
+        if ( truth[k] < mean ) {
+            continue;
+        }
+
+        double dB = inDB ? power[k] : 10.0 * log10( power[k] );
+        double e  = fabs( dB - 10.0 * log10( truth[k] ) );
+
+        error = ( e > error ) ? e : error;
+    }
+
+    return error;
+}
+
+
+static int check( const char* what, int ok, double value )
+{
+    printf( "%-40s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+/** @brief Box-Muller */
+static double gaussian( uint32_t* state )
+{
+    double u = ( next_random( state ) + 1.0 ) / 4294967297.0;
+    double v = ( next_random( state ) + 1.0 ) / 4294967297.0;
+
+    return sqrt( -2.0 * log( u ) ) * cos( 2.0 * SPC_PI * v );
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,589 @@
+// MIT License
+//
+// Copyright (c) [2018] [Shoichiro Yamanishi]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//
+// Headless checks and counters of the VU meter renderer VUMeterRenderer.cpp
+// on a software OpenGL ES 2.0 such as Mesa llvmpipe, through a surfaceless
+// EGL context and an offscreen framebuffer.
+//
+// It draws with the shaders of the App and a synthesized texture, and
+// checks the pixels of the hand and the LED, that a frame with no change
+// is neither uploaded nor drawn, that a moving hand uploads the attributes
+// of its meter only, that a move under the resolution is not drawn, and
+// that all the meters are drawn in one draw call. Then it drives
+// the meters by MeterBallistics with bursts and pauses like speech for a
+// while at 60Hz, and reports the uploads and the draws per second against
+// the first renderer, which uploaded and drew every meter at every frame.
+// The exit status is non-zero if any check fails.
+//
+// Build on Linux from the top directory, in one line:
+//
+//   c++ -O2 -std=c++14 -IiOSRecorderWithVUMeter -o vuRendererCheck
+//       tools/vuRendererCheck.cpp iOSRecorderWithVUMeter/VUMeterRenderer.cpp
+//       iOSRecorderWithVUMeter/MeterBallistics.cpp -lEGL -lGLESv2
+//
+// Usage:
+//
+//   vuRendererCheck [-d shader directory] [-m meters] [-s seconds]
+//
+// The shaders are in iOSRecorderWithVUMeter by default.
+//
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "VUMeterRenderer.hpp"
+#include "MeterBallistics.hpp"
+
+#define VR_WIDTH        512     // one meter maps the base 1:1 to the pixels
+#define VR_HEIGHT       300
+#define VR_FPS          60
+#define VR_PATH_LEN     4096
+#define VR_METER_BYTES  ( 12 * 4 * sizeof(float) )  // attributes of a meter
+
+#define VR_LEFT         ( (float) M_PI * 0.75f )
+#define VR_RIGHT        ( (float) M_PI * 0.25f )
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int    open_context     ();
+
+static char*  load_text        ( const char* dir, const char* name );
+
+static GLuint make_texture     ();
+
+static int    check_pixels     ( VUMeterRenderer& renderer );
+
+static int    check_uploads    ( VUMeterRenderer& renderer );
+
+static int    check_draw_calls ( VUMeterRenderer& renderer );
+
+static int    run_meters       ( VUMeterRenderer& renderer,
+                                 int              num_meters,
+                                 double           seconds     );
+
+static void   read_pixel       ( int x, int y, unsigned char* rgba );
+
+static int    check            ( const char* what, bool ok, double value );
+
+static double now_seconds      ();
+
+
+int main( int argc, char* argv[] )
+{
+    const char* dir       = "iOSRecorderWithVUMeter";
+    int         numMeters = 2;
+    double      seconds   = 60.0;
+    int         numFailed = 0;
+    int         opt;
+
+    while ( ( opt = getopt( argc, argv, "d:m:s:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'd': dir       = optarg;         break;
+          case 'm': numMeters = atoi( optarg ); break;
+          case 's': seconds   = atof( optarg ); break;
+
+          default:
+            fprintf( stderr, "usage: %s [-d shader directory] [-m meters] "
+                             "[-s seconds]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if ( numMeters < 1 || numMeters > 64 ) {
+        fprintf( stderr, "meters must be in [1, 64]\n" );
+        return 1;
+    }
+
+    if ( open_context() != 0 ) {
+        return 1;
+    }
+
+    printf( "renderer: %s\n", (const char*) glGetString( GL_RENDERER ) );
+
+    char* vertexShader   = load_text( dir, "VUMeterInstanceVertex.glsl");
+    char* fragmentShader = load_text( dir, "PassThruFragment.glsl"      );
+
+    if ( vertexShader == NULL || fragmentShader == NULL ) {
+        return 1;
+    }
+
+    VUMeterRenderer renderer( 64 );
+
+    if ( renderer.open( vertexShader, fragmentShader, make_texture() )
+         != VUMeterRenderer::OK ) {
+
+        fprintf( stderr, "open: %s\n", renderer.infoLog() );
+        return 1;
+    }
+
+    free( vertexShader   );
+    free( fragmentShader );
+
+    renderer.setSurface( VR_WIDTH, VR_HEIGHT );
+
+    numFailed += check_pixels ( renderer );
+    numFailed += check_uploads( renderer );
+    numFailed += check_draw_calls( renderer );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    numFailed += run_meters( renderer, numMeters, seconds );
+
+    return ( numFailed == 0 ) ? 0 : 1;
+}
+
+
+// A surfaceless context on Mesa, drawing to a renderbuffer of the size of
+// the base of the meter.
+static int open_context()
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+            eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+
+    EGLDisplay display =
+        ( getPlatformDisplay != NULL )
+        ? getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA,
+                              EGL_DEFAULT_DISPLAY, NULL      )
+        : eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+    EGLint major;
+    EGLint minor;
+
+    if ( !eglInitialize( display, &major, &minor ) ) {
+        fprintf( stderr, "eglInitialize: 0x%x\n", eglGetError() );
+        return -1;
+    }
+
+    EGLint    configAttribs[]  = { EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+                                   EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+                                   EGL_NONE                                };
+    EGLint    contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+    EGLConfig config;
+    EGLint    numConfigs;
+
+    if (    !eglChooseConfig( display, configAttribs, &config, 1, &numConfigs )
+         || numConfigs < 1 ) {
+        fprintf( stderr, "no OpenGL ES 2.0 config\n" );
+        return -1;
+    }
+
+    eglBindAPI( EGL_OPENGL_ES_API );
+
+    EGLContext context = eglCreateContext( display,
+                                           config,
+                                           EGL_NO_CONTEXT,
+                                           contextAttribs  );
+
+    if (    context == EGL_NO_CONTEXT
+         || !eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                             context                                  ) ) {
+        fprintf( stderr, "no OpenGL ES 2.0 context: 0x%x\n", eglGetError() );
+        return -1;
+    }
+
+    GLuint framebuffer;
+    GLuint renderbuffer;
+
+    glGenFramebuffers ( 1, &framebuffer  );
+    glGenRenderbuffers( 1, &renderbuffer );
+
+    glBindRenderbuffer   ( GL_RENDERBUFFER, renderbuffer );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA4, VR_WIDTH, VR_HEIGHT );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, framebuffer );
+
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER,
+                               GL_COLOR_ATTACHMENT0,
+                               GL_RENDERBUFFER,
+                               renderbuffer          );
+
+    if ( glCheckFramebufferStatus( GL_FRAMEBUFFER )
+         != GL_FRAMEBUFFER_COMPLETE                 ) {
+        fprintf( stderr, "incomplete framebuffer\n" );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static char* load_text( const char* dir, const char* name )
+{
+    char path[ VR_PATH_LEN ];
+
+    snprintf( path, sizeof(path), "%s/%s", dir, name );
+
+    FILE* fp = fopen( path, "rb" );
+
+    if ( fp == NULL ) {
+        fprintf( stderr, "cannot open %s\n", path );
+        return NULL;
+    }
+
+    fseek( fp, 0, SEEK_END );
+    long size = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+
+    char* text = (char*) malloc( size + 1 );
+
+    if ( text == NULL || fread( text, 1, size, fp ) != (size_t) size ) {
+        fclose( fp );
+        free( text );
+        return NULL;
+    }
+
+    text[ size ] = '\0';
+    fclose( fp );
+
+    return text;
+}
+
+
+// In place of VU_Meter_Texture.png, the base in gray, the hand in red and
+// the LED in green, at the same positions. The rest is transparent.
+static GLuint make_texture()
+{
+    static unsigned char pixels[ 512 * 512 * 4 ];
+
+    for ( int y = 0; y < 512; y++ ) {
+
+        for ( int x = 0; x < 512; x++ ) {
+
+            unsigned char* p = &pixels[ ( y * 512 + x ) * 4 ];
+
+            p[0] = p[1] = p[2] = p[3] = 0;
+
+            if ( y < 300 ) {
+                p[0] = p[1] = p[2] = 128; p[3] = 255;
+            }
+            else if ( x >= 8 && x < 187 && y >= 313 && y < 316 ) {
+                p[0] = 255; p[3] = 255;
+            }
+            else if ( x >= 198 && x < 231 && y >= 304 && y < 339 ) {
+                p[1] = 255; p[3] = 255;
+            }
+        }
+    }
+
+    GLuint texture;
+
+    glGenTextures( 1, &texture );
+    glBindTexture( GL_TEXTURE_2D, texture );
+
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 512, 512, 0,
+                  GL_RGBA, GL_UNSIGNED_BYTE, pixels       );
+
+    return texture;
+}
+
+
+// The pixel at x, y of the base, whose y is downward.
+static void read_pixel( int x, int y, unsigned char* rgba )
+{
+    glReadPixels( x, VR_HEIGHT - 1 - y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba );
+}
+
+
+static int check_pixels( VUMeterRenderer& renderer )
+{
+    unsigned char rgba[4];
+    int           numFailed = 0;
+
+    renderer.setNumMeters( 1 );
+
+    // Upright, the hand crosses the middle of the base.
+    renderer.setMeter( 0, (float) M_PI * 0.5f, false );
+    renderer.render();
+    read_pixel( 251, 150, rgba );
+
+    numFailed += check( "hand upright drawn [red]",
+                        rgba[0] > 200 && rgba[1] < 50, rgba[0] );
+
+    read_pixel( 430, 133, rgba );
+
+    numFailed += check( "LED off [green]", rgba[1] < 200, rgba[1] );
+
+    // At the left end, the middle is the bare base.
+    renderer.setMeter( 0, VR_LEFT, true );
+    renderer.render();
+    read_pixel( 251, 150, rgba );
+
+    numFailed += check( "hand moved away [red]",
+                        rgba[0] > 100 && rgba[0] < 160, rgba[0] );
+
+    read_pixel( 430, 133, rgba );
+
+    numFailed += check( "LED on [green]",
+                        rgba[1] > 200 && rgba[0] < 50, rgba[1] );
+
+    renderer.setMeter( 0, VR_LEFT, false );
+
+    // In 2 x 2 cells of the half size, the hand of the bottom right only.
+    renderer.setNumMeters( 4 );
+    renderer.setMeter( 3, (float) M_PI * 0.5f, false );
+    renderer.render();
+    read_pixel( 256 + 251 / 2, 150 + 150 / 2, rgba );
+
+    numFailed += check( "hand upright of meter 3 [red]",
+                        rgba[0] > 200 && rgba[1] < 50, rgba[0] );
+
+    read_pixel( 251 / 2, 150 / 2, rgba );
+
+    numFailed += check( "hand at the left of meter 0 [red]",
+                        rgba[0] > 100 && rgba[0] < 160, rgba[0] );
+
+    renderer.setMeter( 3, VR_LEFT, false );
+    renderer.setNumMeters( 1 );
+    renderer.render();
+
+    return numFailed;
+}
+
+
+static int check_uploads( VUMeterRenderer& renderer )
+{
+    int numFailed = 0;
+
+    renderer.setNumMeters( 4 );
+    renderer.render();
+
+    for ( int m = 0; m < 4; m++ ) {
+        renderer.setMeter( m, VR_LEFT, false );
+    }
+
+    renderer.render();
+    renderer.resetStats();
+
+    // Nothing changed.
+    for ( int f = 0; f < 10; f++ ) {
+        renderer.render();
+    }
+
+    VUMeterRenderer::Stats s = renderer.stats();
+
+    numFailed += check( "still frames skipped",
+                        s.mFramesSkipped == 10 && s.mFramesDrawn == 0,
+                        (double) s.mFramesSkipped                       );
+
+    numFailed += check( "still frames uploaded [bytes]",
+                        s.mUploads == 0 && s.mUploadBytes == 0,
+                        (double) s.mUploadBytes                 );
+
+    numFailed += check( "still frames drawn [calls]",
+                        s.mDrawCalls == 0, (double) s.mDrawCalls );
+
+    // One hand by 1/1000 rad is under a quarter pixel at its tip.
+    renderer.resetStats();
+    renderer.setMeter( 2, VR_LEFT - 0.001f, false );
+
+    numFailed += check( "move under the resolution skipped",
+                        !renderer.render(), 0.0 );
+
+    // One hand by 0.1 rad uploads the attributes of its meter, and redraws
+    // all the meters in one call.
+    renderer.resetStats();
+    renderer.setMeter( 2, VR_LEFT - 0.1f, false );
+    renderer.render();
+    s = renderer.stats();
+
+    numFailed += check( "one hand moved uploaded [bytes]",
+                        s.mUploads == 1
+                        && s.mUploadBytes == VR_METER_BYTES,
+                        (double) s.mUploadBytes                   );
+
+    numFailed += check( "one hand moved drawn [calls]",
+                        s.mFramesDrawn == 1 && s.mDrawCalls == 1,
+                        (double) s.mDrawCalls                     );
+
+    // As does an LED turned on.
+    renderer.resetStats();
+    renderer.setMeter( 1, VR_LEFT, true );
+    renderer.render();
+    s = renderer.stats();
+
+    numFailed += check( "LED turned on [bytes]",
+                        s.mUploads == 1 && s.mUploadBytes == VR_METER_BYTES
+                        && s.mDrawCalls == 1,
+                        (double) s.mUploadBytes                             );
+
+    renderer.setMeter( 1, VR_LEFT, false );
+    renderer.setMeter( 2, VR_LEFT, false );
+    renderer.render();
+
+    return numFailed;
+}
+
+
+// One draw call per frame however many meters.
+static int check_draw_calls( VUMeterRenderer& renderer )
+{
+    static const int counts[] = { 1, 2, 8, 64 };
+
+    int numFailed = 0;
+
+    for ( int k = 0; k < 4; k++ ) {
+
+        renderer.setNumMeters( counts[k] );
+
+        for ( int m = 0; m < counts[k]; m++ ) {
+            renderer.setMeter( m, VR_LEFT - 0.01f * ( m % 50 ), m % 3 == 0 );
+        }
+
+        renderer.resetStats();
+        renderer.render();
+
+        char what[ 64 ];
+
+        snprintf( what, sizeof(what), "%d meters drawn [calls]", counts[k] );
+
+        numFailed += check( what,
+                            renderer.stats().mDrawCalls == 1,
+                            (double) renderer.stats().mDrawCalls );
+    }
+
+    for ( int m = 0; m < 64; m++ ) {
+        renderer.setMeter( m, VR_LEFT, false );
+    }
+
+    return numFailed;
+}
+
+
+// Bursts of 1 to 3 seconds of speech at about -20dB, with pauses of 1 to
+// 4 seconds of silence, as the meters on a speech recording see.
+static int run_meters( VUMeterRenderer& renderer,
+                       int              num_meters,
+                       double           seconds     )
+{
+    MeterBallistics ballistics( num_meters, MeterBallistics::MODE_VU,
+                                1.0f / 480.0f                        );
+    float*          levels = (float*) malloc( sizeof(float) * num_meters );
+
+    if ( levels == NULL ) {
+        return 1;
+    }
+
+    renderer.setNumMeters( num_meters );
+    renderer.render();
+    renderer.resetStats();
+
+    int    numFrames = (int) ( seconds * VR_FPS );
+    int    nextSwap  = 0;
+    bool   talking   = false;
+    double start     = now_seconds();
+
+    srand( 1 );
+
+    for ( int f = 0; f < numFrames; f++ ) {
+
+        if ( f == nextSwap ) {
+            talking   = !talking;
+            nextSwap += VR_FPS * ( talking ? 1 + rand() % 3 : 1 + rand() % 4 );
+        }
+
+        for ( int m = 0; m < num_meters; m++ ) {
+            levels[m] = talking ? 2300.0f * ( 0.5f + ( rand() % 100 ) * 0.01f )
+                                : 0.0f;
+        }
+
+        ballistics.setLevels( 0, num_meters, levels );
+        ballistics.advance( 1.0 / VR_FPS );
+
+        const float* positions = ballistics.positions();
+
+        for ( int m = 0; m < num_meters; m++ ) {
+            float theta = VR_LEFT + ( VR_RIGHT - VR_LEFT ) * positions[m];
+
+            renderer.setMeter( m, theta, levels[m] >= 32267.0f );
+        }
+
+        renderer.render();
+    }
+
+    glFinish();
+
+    double elapsed = now_seconds() - start;
+
+    free( levels );
+
+    VUMeterRenderer::Stats s = renderer.stats();
+
+    // The first renderer uploaded the indices once and all the vertices
+    // per meter, and drew the base and the hand per meter, at every frame.
+    double firstUploads  = ( 1.0 + num_meters ) * VR_FPS;
+    double firstBytes    = ( 18.0 + 12.0 * 5 * sizeof(float) * num_meters )
+                           * VR_FPS;
+    double firstDraws    = 2.0 * num_meters * VR_FPS;
+
+    printf( "%d meters for %.0f seconds at %dHz: %.3f seconds, "
+            "%.1f%% of the frames drawn\n",
+            num_meters, seconds, VR_FPS, elapsed,
+            100.0 * s.mFramesDrawn / numFrames    );
+
+    printf( "  per second  uploads %6.1f (first  %6.1f)  "
+            "bytes %8.1f (first  %8.1f)  draws %6.1f (first  %6.1f)\n",
+            s.mUploads     / seconds, firstUploads,
+            s.mUploadBytes / seconds, firstBytes,
+            s.mDrawCalls   / seconds, firstDraws   );
+
+    return check( "frames skipped in the pauses",
+                  s.mFramesSkipped > 0 && s.mFramesDrawn < numFrames,
+                  (double) s.mFramesSkipped                           );
+}
+
+
+static int check( const char* what, bool ok, double value )
+{
+    printf( "%-38s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static double now_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
@@ -0,0 +1,449 @@
+/* MIT License
+ *
+ * Copyright (c) [2018] [Shoichiro Yamanishi]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * Checks and benchmark of the waveform raster waveRaster.c.
+ *
+ * It draws random plots over random ranges of columns again and again, as
+ * a view would, and checks the pixels after each against a raster drawn
+ * from scratch, and that the columns reported changed are the ones whose
+ * span has changed. Then it times a frame at a 4K width: the plots copied
+ * and every column drawn again, as the path stroked in drawRect did,
+ * against the raster redrawn with the same plots, with the plots of a
+ * scrolled window, and with the new columns of a live waveform.
+ * The exit status is non-zero if any check fails.
+ *
+ * Build on Linux from the top directory:
+ *
+ *   cc -O2 -IiOSRecorderWithVUMeter -o waveRasterBench \
+ *      tools/waveRasterBench.c iOSRecorderWithVUMeter/waveRaster.c
+ *
+ * Usage:
+ *
+ *   waveRasterBench [-w width] [-h height] [-f frames]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "waveRaster.h"
+
+#define WRB_BG            WAVE_RASTER_RGBA(   0,   0, 0, 255 )
+#define WRB_FG            WAVE_RASTER_RGBA(   0, 255, 0, 255 )
+#define WRB_UPDATES       200
+#define WRB_LIVE_COLUMNS  13    /* per frame, 5 seconds over 3840 at 60Hz */
+
+
+/******************************/
+/* static function definition */
+/******************************/
+
+
+static int      check_updates    ( int width, int height, uint32_t seed );
+
+static int      check_levels     ( int width, int height );
+
+static void     draw_reference   ( uint32_t*  pixels,
+                                   int        width,
+                                   int        height,
+                                   const int* plots   );
+
+static void     make_levels      ( short*   mins,
+                                   short*   maxs,
+                                   int      num_columns,
+                                   uint32_t seed         );
+
+static void     plots_of_levels  ( int*         plots,
+                                   const short* mins,
+                                   const short* maxs,
+                                   int          num_columns,
+                                   int          height       );
+
+static int      check            ( const char* what, int ok, double value );
+
+static uint32_t next_random      ( uint32_t* state );
+
+static double   now_seconds      ( void );
+
+
+int main( int argc, char* argv[] )
+{
+    int width     = 3840;
+    int height    = 1080;
+    int numFrames = 300;
+    int numFailed = 0;
+    int opt;
+
+    while ( ( opt = getopt( argc, argv, "w:h:f:" ) ) != -1 ) {
+
+        switch ( opt ) {
+
+          case 'w': width     = atoi( optarg ); break;
+          case 'h': height    = atoi( optarg ); break;
+          case 'f': numFrames = atoi( optarg ); break;
+
+          default:
+            fprintf( stderr, "usage: %s [-w width] [-h height] [-f frames]\n",
+                     argv[0]                                                );
+            return 1;
+        }
+    }
+
+    if ( width <= 0 || height <= 0 || numFrames <= 0 ) {
+        fprintf( stderr, "invalid size\n" );
+        return 1;
+    }
+
+    numFailed += check_updates( 301, 147, 1 );
+    numFailed += check_updates( width, height, 2 );
+    numFailed += check_levels ( 301, 147 );
+
+    printf( "checks: %s\n", ( numFailed == 0 ) ? "OK" : "FAILED" );
+
+    /* A recording of numFrames + width columns, scrolled by a column per
+     * frame. */
+    int     numLevels = width + numFrames + WRB_LIVE_COLUMNS * numFrames;
+    short*  mins      = (short*) malloc( sizeof(short) * numLevels );
+    short*  maxs      = (short*) malloc( sizeof(short) * numLevels );
+    int*    plots     = (int*)   malloc( sizeof(int) * 2 * numLevels );
+    size_t  numPixels = (size_t)width * height;
+    uint32_t* pixels  = (uint32_t*) malloc( sizeof(uint32_t) * numPixels );
+
+    WAVE_RASTER* raster = createWaveRaster( width, height, WRB_BG, WRB_FG );
+
+    if (    mins == NULL || maxs == NULL || plots == NULL || pixels == NULL
+         || raster == NULL                                                ) {
+        return 1;
+    }
+
+    make_levels( mins, maxs, numLevels, 3 );
+    plots_of_levels( plots, mins, maxs, numLevels, height );
+
+    /* The path in drawRect copied the plots and drew every column. */
+    double start = now_seconds();
+
+    for ( int f = 0; f < numFrames; f++ ) {
+
+        int* copy = (int*) malloc( sizeof(int) * 2 * width );
+
+        memcpy( copy, &plots[ f * 2 ], sizeof(int) * 2 * width );
+        draw_reference( pixels, width, height, copy );
+        free( copy );
+    }
+
+    double copyDraw = ( now_seconds() - start ) / numFrames;
+
+    rasterizeWavePlots( raster, 0, width, plots );
+
+    start = now_seconds();
+
+    int numChanged = 0;
+
+    for ( int f = 0; f < numFrames; f++ ) {
+        numChanged += rasterizeWavePlots( raster, 0, width, plots );
+    }
+
+    double sameDraw = ( now_seconds() - start ) / numFrames;
+
+    numFailed += check( "columns changed with the same plots",
+                        numChanged == 0, numChanged           );
+
+    start = now_seconds();
+
+    for ( int f = 0; f < numFrames; f++ ) {
+        rasterizeWavePlots( raster, 0, width, &plots[ f * 2 ] );
+    }
+
+    double scrollDraw = ( now_seconds() - start ) / numFrames;
+
+    /* The live view writes the new columns over the oldest of its ring. */
+    int liveX = 0;
+
+    start = now_seconds();
+
+    for ( int f = 0; f < numFrames; f++ ) {
+
+        int from = f * WRB_LIVE_COLUMNS;
+        int run  = width - liveX;
+
+        run = ( run < WRB_LIVE_COLUMNS ) ? run : WRB_LIVE_COLUMNS;
+
+        rasterizeWaveLevels( raster, liveX, run, &mins[from], &maxs[from] );
+        rasterizeWaveLevels( raster, 0, WRB_LIVE_COLUMNS - run,
+                             &mins[ from + run ], &maxs[ from + run ] );
+
+        liveX = ( liveX + WRB_LIVE_COLUMNS ) % width;
+    }
+
+    double liveDraw = ( now_seconds() - start ) / numFrames;
+
+    printf( "%d x %d, %d frames\n", width, height, numFrames );
+    printf( "copy and draw every column:   %8.3f ms per frame\n",
+            copyDraw * 1000.0                                     );
+    printf( "raster, same plots:           %8.3f ms per frame %8.1fx\n",
+            sameDraw * 1000.0, copyDraw / sameDraw                     );
+    printf( "raster, window scrolled:      %8.3f ms per frame %8.1fx\n",
+            scrollDraw * 1000.0, copyDraw / scrollDraw                 );
+    printf( "raster, %2d live columns:      %8.3f ms per frame %8.1fx\n",
+            WRB_LIVE_COLUMNS, liveDraw * 1000.0, copyDraw / liveDraw   );
+
+    numFailed += check( "raster scrolled / copy and draw",
+                        scrollDraw < copyDraw, scrollDraw / copyDraw );
+
+    freeWaveRaster( raster );
+    free( pixels );
+    free( plots );
+    free( mins );
+    free( maxs );
+
+    return ( numFailed == 0 ) ? 0 : 1;
+}
+
+
+/* Random plots over random ranges, some out of the raster or the same as
+ * drawn, against the raster drawn from scratch with the latest of each
+ * column. */
+static int check_updates( int width, int height, uint32_t seed )
+{
+    uint32_t     state     = seed;
+    size_t       numPixels = (size_t)width * height;
+    int*         latest    = (int*) malloc( sizeof(int) * 2 * width );
+    int*         plots     = (int*) malloc( sizeof(int) * 2 * width );
+    uint32_t*    pixels    = (uint32_t*) malloc( sizeof(uint32_t) * numPixels );
+    int          ok        = 1;
+
+    WAVE_RASTER* raster = createWaveRaster( width, height, WRB_BG, WRB_FG );
+
+    if ( latest == NULL || plots == NULL || pixels == NULL || raster == NULL ) {
+        return 1;
+    }
+
+    /* Rows above the raster, where the reference draws nothing. */
+    for ( int i = 0; i < 2 * width; i++ ) {
+        latest[i] = INT32_MIN;
+    }
+
+    for ( int u = 0; u < WRB_UPDATES && ok; u++ ) {
+
+        int first    = next_random( &state ) % width;
+        int num      = 1 + next_random( &state ) % ( width - first );
+        int keep     = ( next_random( &state ) % 4 == 0 );
+        int expected = 0;
+
+        for ( int i = 0; i < num; i++ ) {
+
+            int* prev = &latest[ ( first + i ) * 2 ];
+            int* next = &plots[ i * 2 ];
+
+            if ( keep && prev[0] != INT32_MIN ) {
+
+                /* The same span, the rows swapped or not. */
+                next[0] = prev[1];
+                next[1] = prev[0];
+            }
+            else {
+                /* Up to a few rows out of the raster at either end. */
+                next[0] = (int)( next_random( &state ) % ( height + 8 ) ) - 4;
+                next[1] = (int)( next_random( &state ) % ( height + 8 ) ) - 4;
+
+                expected++;
+            }
+
+            prev[0] = next[0];
+            prev[1] = next[1];
+        }
+
+        int changed = rasterizeWavePlots( raster, first, num, plots );
+
+        draw_reference( pixels, width, height, latest );
+
+        /* A new span may happen to be the same once clamped. */
+        ok =    memcmp( pixels, raster->pixels,
+                        sizeof(uint32_t) * numPixels ) == 0
+             && changed <= expected && ( keep ? changed == 0 : 1 );
+    }
+
+    char what[ 64 ];
+
+    snprintf( what, sizeof(what), "%d x %d random updates", width, height );
+
+    freeWaveRaster( raster );
+    free( latest );
+    free( plots );
+    free( pixels );
+
+    return check( what, ok, WRB_UPDATES );
+}
+
+
+/* The levels draw the same pixels as their plots. */
+static int check_levels( int width, int height )
+{
+    short*   mins  = (short*) malloc( sizeof(short) * width );
+    short*   maxs  = (short*) malloc( sizeof(short) * width );
+    int*     plots = (int*)   malloc( sizeof(int) * 2 * width );
+
+    WAVE_RASTER* fromLevels = createWaveRaster( width, height, WRB_BG, WRB_FG );
+    WAVE_RASTER* fromPlots  = createWaveRaster( width, height, WRB_BG, WRB_FG );
+
+    if (    mins == NULL || maxs == NULL || plots == NULL
+         || fromLevels == NULL || fromPlots == NULL       ) {
+        return 1;
+    }
+
+    make_levels( mins, maxs, width, 4 );
+
+    /* Full scale at both ends too. */
+    mins[0] = -32768;
+    maxs[0] =  32767;
+
+    plots_of_levels( plots, mins, maxs, width, height );
+
+    rasterizeWaveLevels( fromLevels, 0, width, mins, maxs );
+    rasterizeWavePlots ( fromPlots,  0, width, plots );
+
+    int ok = memcmp( fromLevels->pixels, fromPlots->pixels,
+                     sizeof(uint32_t) * width * height     ) == 0;
+
+    freeWaveRaster( fromLevels );
+    freeWaveRaster( fromPlots );
+    free( mins );
+    free( maxs );
+    free( plots );
+
+    return check( "levels as their plots", ok, width );
+}
+
+
+/* Every column filled from scratch, from the lower row to the higher one
+ * clamped into the raster, none if the rows are INT32_MIN. */
+static void draw_reference(
+    uint32_t*  pixels,
+    int        width,
+    int        height,
+    const int* plots
+) {
+    for ( size_t i = 0; i < (size_t)width * height; i++ ) {
+        pixels[i] = WRB_BG;
+    }
+
+    for ( int x = 0; x < width; x++ ) {
+
+        int a = plots[ x * 2 ];
+        int b = plots[ x * 2 + 1 ];
+
+        if ( a == INT32_MIN ) {
+            continue;
+        }
+
+        int top    = ( a < b ) ? a : b;
+        int bottom = ( a < b ) ? b : a;
+
+        top    = ( top    < 0 ) ? 0 : ( top    < height ) ? top    : height - 1;
+        bottom = ( bottom < 0 ) ? 0 : ( bottom < height ) ? bottom : height - 1;
+
+        for ( int y = top; y <= bottom; y++ ) {
+            pixels[ (size_t)y * width + x ] = WRB_FG;
+        }
+    }
+}
+
+
+/* Bursts like speech over a low noise. */
+static void make_levels(
+    short*   mins,
+    short*   maxs,
+    int      num_columns,
+    uint32_t seed
+) {
+    uint32_t state    = seed;
+    double   envelope = 0.0;
+
+    for ( int i = 0; i < num_columns; i++ ) {
+
+        if ( i % 40 == 0 ) {
+            envelope = ( next_random( &state ) % 3 == 0 )
+                       ? 0.02 : 0.2 + ( next_random( &state ) % 80 ) / 100.0;
+        }
+
+        double a = envelope * ( 0.5 + ( next_random( &state ) % 50 ) / 100.0 );
+        double b = envelope * ( 0.5 + ( next_random( &state ) % 50 ) / 100.0 );
+
+        mins[i] = (short)( -a * 32767.0 );
+        maxs[i] = (short)(  b * 32767.0 );
+    }
+}
+
+
+/* In the same way as computePlotsFromWavePeakPyramid(). */
+static void plots_of_levels(
+    int*         plots,
+    const short* mins,
+    const short* maxs,
+    int          num_columns,
+    int          height
+) {
+    double halfHeight = ( (double)height ) / 2.0;
+
+    for ( int i = 0; i < num_columns; i++ ) {
+
+        plots[ i * 2 ]     = (int)( maxs[i] * halfHeight / 32767.0
+                                    + halfHeight                    );
+        plots[ i * 2 + 1 ] = (int)( mins[i] * halfHeight / 32767.0
+                                    + halfHeight                    );
+    }
+}
+
+
+static int check( const char* what, int ok, double value )
+{
+    printf( "%-40s %10.6g  %s\n", what, value, ok ? "OK" : "FAILED" );
+
+    return ok ? 0 : 1;
+}
+
+
+static uint32_t next_random( uint32_t* state )
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}